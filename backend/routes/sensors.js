@@ -448,6 +448,449 @@ async function handleSensorDataUpdate(deviceId, sensorData) {
   }
 }
 
+// 🔥 센서 타입별 값 변환 (스키마 v1/v2 공용)
+// v1 레코드 필드(value1, value2, reserved1, reserved2) 기준
+function convertBinarySensorValues(sensorType, value1, value2, reserved1, reserved2) {
+  let convertedValues = [];
+  let valueNames = [];
+
+  switch (sensorType) {
+    case 1: // SHT20 - 온도/습도 (×100)
+      convertedValues = [value1 / 100, value2 / 100];
+      valueNames = ['temperature', 'humidity'];
+      // console.log(`   - 변환값: 온도=${convertedValues[0]}°C, 습도=${convertedValues[1]}%`);
+      break;
+
+    case 2: // TSL2591 - 조도 (×1로 전송, 그대로 사용)
+      convertedValues = [value1];  // 🔥 UNO에서 ×1로 전송하므로 그대로 사용
+      valueNames = ['light_level'];
+      // console.log(`   - 변환값: 조도=${convertedValues[0]} lux`);
+      break;
+
+    case 3: // ADS1115 - pH/EC/WaterTemp 🔥 waterTemp 추가
+      convertedValues = [
+        value1 / 100,           // pH는 그대로
+        value2 / 10,            // 🔥 EC: dS/m (×10으로 전송됨)
+        (reserved1 << 8 | reserved2) / 100  // 🔥 waterTemp: ×100으로 전송됨
+      ];
+      valueNames = ['ph', 'ec', 'water_temp'];
+      // console.log(`   - 변환값: pH=${convertedValues[0]}, EC=${convertedValues[1]} dS/m, WaterTemp=${convertedValues[2]}°C`);
+      break;
+
+    case 4: // SCD30 - CO2 (정수값 그대로) 🔥 값 하나만
+      convertedValues = [value1];  // 🔥 배열에 값 하나만 추가
+      valueNames = ['co2_ppm'];
+      // console.log(`   - 변환값: CO2=${convertedValues[0]} ppm`);
+      break;
+
+    case 5: // DS18B20 - 온도 (×100) 🔥 값 하나만
+      convertedValues = [value1 / 100];  // 🔥 배열에 값 하나만 추가
+      valueNames = ['temperature'];
+      // console.log(`   - 변환값: 온도=${convertedValues[0]}°C`);
+      break;
+
+    case 6: // BH1750 (×1로 전송, 그대로 사용)
+      convertedValues = [value1];  // 🔥 UNO에서 ×1로 전송하므로 그대로 사용
+      valueNames = ['light_level'];
+      // console.log(` - 변환값: 조도=${convertedValues[0]} lux (type=6)`);
+      break;
+
+    case 7: // MH-Z19 (PWM, CO2)
+      convertedValues = [value1];
+      valueNames = ['co2_ppm'];
+      // console.log(`   - 변환값: CO2=${convertedValues[0]} ppm (MH-Z19)`);
+      break;
+
+    case 16: // 🔥 풍향 센서
+      // 8방향 문자열 배열
+      const directions = ['북풍(N)', '북동풍(NE)', '동풍(E)', '남동풍(SE)',
+        '남풍(S)', '남서풍(SW)', '서풍(W)', '북서풍(NW)'];
+
+      const gearDirection = value1;
+      const degreeDirection = value2;
+
+      // 풍향 문자열 계산
+      let windDirectionStr = '';
+      if (gearDirection >= 0 && gearDirection <= 7) {
+        windDirectionStr = directions[gearDirection];
+      } else {
+        // 360도 값으로 계산
+        if (degreeDirection >= 0 && degreeDirection < 22.5) windDirectionStr = '북풍(N)';
+        else if (degreeDirection < 67.5) windDirectionStr = '북동풍(NE)';
+        else if (degreeDirection < 112.5) windDirectionStr = '동풍(E)';
+        else if (degreeDirection < 157.5) windDirectionStr = '남동풍(SE)';
+        else if (degreeDirection < 202.5) windDirectionStr = '남풍(S)';
+        else if (degreeDirection < 247.5) windDirectionStr = '남서풍(SW)';
+        else if (degreeDirection < 292.5) windDirectionStr = '서풍(W)';
+        else if (degreeDirection < 337.5) windDirectionStr = '북서풍(NW)';
+        else windDirectionStr = '북풍(N)';
+      }
+
+      convertedValues = [gearDirection, degreeDirection, windDirectionStr];
+      valueNames = ['gear_direction', 'degree_direction', 'direction_text'];
+      console.log(`   - 변환값: 기어=${gearDirection}, 각도=${degreeDirection}°, 방향=${windDirectionStr}`);
+      break;
+
+    case 17: // 🔥 풍속 센서
+      const rawWindSpeed = value1;
+      const windSpeedMs = rawWindSpeed / 10.0;  // 실제 m/s 값
+
+      // 풍속 등급 계산 (보퍼트 풍력계급)
+      let windScale = '';
+      let windCondition = '';
+
+      if (windSpeedMs === 0) {
+        windScale = '무풍';
+        windCondition = '고요';
+      } else if (windSpeedMs < 0.2) {
+        windScale = '감지한계';
+        windCondition = '연기 방향 감지 곤란';
+      } else if (windSpeedMs < 1.5) {
+        windScale = '실바람';
+        windCondition = '연기 방향으로 감지';
+      } else if (windSpeedMs < 3.3) {
+        windScale = '남실바람';
+        windCondition = '바람이 얼굴에 느껴짐';
+      } else if (windSpeedMs < 5.4) {
+        windScale = '산들바람';
+        windCondition = '나뭇잎이 흔들림';
+      } else if (windSpeedMs < 7.9) {
+        windScale = '건들바람';
+        windCondition = '작은 가지가 흔들림';
+      } else if (windSpeedMs < 10.7) {
+        windScale = '흔들바람';
+        windCondition = '큰 가지가 흔들림';
+      } else if (windSpeedMs < 13.8) {
+        windScale = '된바람';
+        windCondition = '나무 전체가 흔들림';
+      } else if (windSpeedMs < 17.1) {
+        windScale = '센바람';
+        windCondition = '걷기 곤란';
+      } else {
+        windScale = '강풍';
+        windCondition = '심한 손상 가능';
+      }
+
+      convertedValues = [windSpeedMs, windScale, windCondition];
+      valueNames = ['wind_speed_ms', 'wind_scale', 'wind_condition'];
+      console.log(`   - 변환값: 풍속=${windSpeedMs.toFixed(1)}m/s, 등급=${windScale}, 상태=${windCondition}`);
+      break;
+
+
+
+    case 18: // 🔥 강우/강설 센서 (새로 추가)
+      // 첫 번째 값: 강수 상태(상위 4비트) + 수분 레벨(하위 12비트)
+      const precipStatus = (value1 >> 12) & 0x0F;
+      const moistureLevel = value1 & 0x0FFF;
+
+      // 두 번째 값: 온도(상위 8비트) + 습도(하위 8비트)
+      const tempByte = (value2 >> 8) & 0xFF;
+      const humidity = value2 & 0xFF;
+      const temperature = tempByte - 40; // -40~215°C 범위에서 실제 온도로 변환
+
+      // 강수 상태 문자열 변환
+      let precipStatusText = '';
+      let precipIcon = '';
+      switch (precipStatus) {
+        case 0:
+          precipStatusText = '건조';
+          precipIcon = '☀️';
+          break;
+        case 1:
+          precipStatusText = '강우';
+          precipIcon = '🌧️';
+          break;
+        case 2:
+          precipStatusText = '강설';
+          precipIcon = '🌨️';
+          break;
+        default:
+          precipStatusText = '알 수 없음';
+          precipIcon = '❓';
+          break;
+      }
+
+      // 수분 레벨에 따른 강도 평가
+      let moistureIntensity = '';
+      if (precipStatus > 0) { // 강우 또는 강설이 감지된 경우
+        if (moistureLevel > 3000) {
+          moistureIntensity = '강함';
+        } else if (moistureLevel > 1500) {
+          moistureIntensity = '보통';
+        } else if (moistureLevel > 500) {
+          moistureIntensity = '약함';
+        } else {
+          moistureIntensity = '미약';
+        }
+      } else {
+        if (moistureLevel > 500) {
+          moistureIntensity = '잔여수분';
+        } else {
+          moistureIntensity = '완전건조';
+        }
+      }
+
+      // 온도 상태 평가
+      let tempStatus = '';
+      if (temperature >= 30) {
+        tempStatus = '높음';
+      } else if (temperature >= 20) {
+        tempStatus = '적정';
+      } else if (temperature >= 10) {
+        tempStatus = '낮음';
+      } else if (temperature >= 0) {
+        tempStatus = '매우낮음';
+      } else {
+        tempStatus = '결빙위험';
+      }
+
+      convertedValues = [
+        precipStatus,           // 강수 상태 코드 (0=건조, 1=강우, 2=강설)
+        precipStatusText,       // 강수 상태 텍스트
+        moistureLevel,          // 수분 레벨 (0-4095)
+        moistureIntensity,      // 수분 강도 텍스트
+        temperature,            // 온도 (°C)
+        humidity,               // 습도 (%)
+        tempStatus,             // 온도 상태 텍스트
+        precipIcon              // 아이콘
+      ];
+
+      valueNames = [
+        'precip_status', 'precip_status_text', 'moisture_level', 'moisture_intensity',
+        'temperature', 'humidity', 'temp_status', 'precip_icon'
+      ];
+
+      console.log(`   - 변환값: ${precipIcon}${precipStatusText}(${precipStatus}), 수분=${moistureLevel}(${moistureIntensity}), 온도=${temperature}°C(${tempStatus}), 습도=${humidity}%`);
+      break;
+
+    case 19: // 🔥 토양 센서 (H, T, EC, PH, NPK) - 습도 활성화
+      // ✅ UNO 레지스터 순서: reg0=습도, reg1=온도, reg2=EC, reg3=pH
+      // ✅ Mega 전송 순서: value1=습도, value2=온도, reserved1=EC, reserved2=pH
+      // ✅ 서버 기대 순서: pH, EC, 온도, 습도
+
+      // 🔥 디버깅: 원시 값 출력
+      console.log(`   - 토양센서 원시값: value1=${value1} (습도), value2=${value2} (온도), reserved1=${reserved1} (EC), reserved2=${reserved2} (pH)`);
+
+      // UNO에서 전송된 값 (16비트)
+      // 습도: value1 (0-1000, 실제값 = value1 / 10.0)
+      // 온도: value2 (0-2550, 실제값 = value2 / 10.0)
+      // EC: reserved1 (μS/cm, 실제값 = reserved1 / 1000.0 → dS/m)
+      // pH: reserved2 (×10 스케일, 실제값 = reserved2 / 10.0)
+
+      const soilHumidity = value1 / 10.0;      // 습도 (%)
+      const soilTemp = value2 / 10.0;          // 온도 (°C)
+      const soilEC = reserved1 / 1000.0;       // EC (μS/cm → dS/m 변환)
+      const soilPH = reserved2 / 10.0;         // pH (×10 스케일)
+
+      // ✅ 토양센서: pH, EC, 온도, 습도 순서로 변환 (서버 기대 순서)
+      convertedValues = [
+        soilPH, soilEC, soilTemp, soilHumidity
+      ];
+
+      valueNames = [
+        'soil_ph','soil_ec','soil_temperature','soil_humidity'
+      ];
+
+      console.log(`   - 변환값: pH=${soilPH.toFixed(1)}, EC=${soilEC.toFixed(3)}dS/m, 온도=${soilTemp.toFixed(1)}°C, 습도=${soilHumidity.toFixed(1)}%`);
+      break;
+
+    default: // Modbus 센서들 또는 알 수 없는 센서
+      if (sensorType >= 11) {
+        convertedValues = [value1 / 100, value2 / 100];
+        valueNames = ['value1', 'value2'];
+        console.log(`   - 변환값: Modbus값1=${convertedValues[0]}, 값2=${convertedValues[1]}`);
+      } else {
+        convertedValues = [value1, value2];
+        valueNames = ['value1', 'value2'];
+        console.log(`   - 변환값: 원시값1=${convertedValues[0]}, 값2=${convertedValues[1]}`);
+      }
+      break;
+  }
+
+  return { convertedValues, valueNames };
+}
+
+// 🔥 센서 업링크 스키마 (Mega modbusHandler.h 센서 업링크 페이로드와 동일)
+// v2 키프레임 레코드: [타입][Combined ID][CH][값 개수 n] + n × uint16 BE, 센서당 1회
+// v3 델타: 헤더 + [키프레임 millis 4B BE][키프레임 레코드 수] + 바뀐 레코드만
+//   레코드: [키프레임 내 순번][값 마스크] + 마스크 비트마다 zig-zag varint (현재값 - 키프레임값)
+const SENSOR_SCHEMA_V2 = 2;
+const SENSOR_SCHEMA_DELTA = 3;
+
+// 디바이스별 최근 v2 키프레임 (델타 복원 기준)
+// 재연결 후 재전송되는 백로그 델타는 그 사이 바뀐 이전 키프레임을 참조할 수 있어 몇 개 보관
+const SENSOR_KEYFRAME_HISTORY = 4;
+const sensorKeyframes = {};
+
+// v2 키프레임 보관: 헤더 millis + 레코드별 [타입, Combined ID, CH] 및 원시 값
+function rememberSensorKeyframe(deviceId, buffer) {
+  const records = [];
+  let offset = 8;
+  for (let i = 0; i < buffer[6]; i++) {
+    if (offset + 4 > buffer.length) return;
+    const count = buffer[offset + 3];
+    if (offset + 4 + count * 2 > buffer.length) return;
+    const values = [];
+    for (let k = 0; k < count; k++) values.push(buffer.readUInt16BE(offset + 4 + k * 2));
+    records.push({ head: buffer.subarray(offset, offset + 3), values });
+    offset += 4 + count * 2;
+  }
+  const history = sensorKeyframes[deviceId] || (sensorKeyframes[deviceId] = []);
+  history.push({ stampMs: buffer.readUInt32BE(2), records });
+  if (history.length > SENSOR_KEYFRAME_HISTORY) history.shift();
+}
+
+// v3 델타 → 키프레임에 적용한 v2 버퍼 (기준 키프레임이 없거나 다르면 null)
+function expandSensorDeltaFrame(deviceId, buffer) {
+  if (buffer.length < 13) return null;
+  const keyStampMs = buffer.readUInt32BE(8);
+  const key = (sensorKeyframes[deviceId] || []).find(k => k.stampMs === keyStampMs);
+  if (!key || key.records.length !== buffer[12]) {
+    console.log(`⏭️ 델타 기준 키프레임 없음: ${deviceId} (다음 키프레임 대기)`);
+    return null;
+  }
+
+  const values = key.records.map(r => r.values.slice());
+  let offset = 13;
+  for (let i = 0; i < buffer[6]; i++) {
+    if (offset + 2 > buffer.length) return null;
+    const index = buffer[offset++];
+    const mask = buffer[offset++];
+    if (index >= values.length) return null;
+    for (let k = 0; k < values[index].length; k++) {
+      if (!(mask & (1 << k))) continue;
+      // LEB128 varint → zig-zag 복원, 16비트 랩
+      let z = 0, shift = 0, b;
+      do {
+        if (offset >= buffer.length) return null;
+        b = buffer[offset++];
+        z |= (b & 0x7F) << shift;
+        shift += 7;
+      } while (b & 0x80);
+      const delta = (z >>> 1) ^ -(z & 1);
+      values[index][k] = (values[index][k] + delta) & 0xFFFF;
+    }
+  }
+
+  // 델타 시각의 v2 프레임으로 재구성
+  const size = 8 + key.records.reduce((n, r) => n + 4 + r.values.length * 2, 0);
+  const out = Buffer.alloc(size);
+  buffer.copy(out, 0, 0, 6);
+  out[6] = key.records.length;
+  out[7] = SENSOR_SCHEMA_V2;
+  let pos = 8;
+  key.records.forEach((r, i) => {
+    r.head.copy(out, pos);
+    out[pos + 3] = values[i].length;
+    pos += 4;
+    values[i].forEach(v => { out.writeUInt16BE(v, pos); pos += 2; });
+  });
+  return out;
+}
+
+// 한 프레임(헤더 포함)의 바이트 길이, 잘린 프레임이면 0
+// v1은 길이 정보가 없으므로 메시지 끝까지 (v1 펌웨어는 배치를 보내지 않음)
+function sensorFrameLength(buffer, offset) {
+  if (offset + 8 > buffer.length || buffer[offset] !== 0x01 || buffer[offset + 1] !== 0x03) return 0;
+  const count = buffer[offset + 6];
+  const schema = buffer[offset + 7];
+  let pos;
+  if (schema === SENSOR_SCHEMA_V2) {
+    pos = offset + 8;
+    for (let i = 0; i < count; i++) {
+      if (pos + 4 > buffer.length) return 0;
+      pos += 4 + buffer[pos + 3] * 2;
+    }
+  } else if (schema === SENSOR_SCHEMA_DELTA) {
+    pos = offset + 13;
+    for (let i = 0; i < count; i++) {
+      if (pos + 2 > buffer.length) return 0;
+      let mask = buffer[pos + 1];
+      pos += 2;
+      for (; mask; mask >>= 1) {
+        if (!(mask & 1)) continue;
+        while (pos < buffer.length && (buffer[pos] & 0x80)) pos++;
+        pos++;
+      }
+    }
+  } else {
+    return buffer.length - offset;
+  }
+  return pos <= buffer.length ? pos - offset : 0;
+}
+
+// 배치 메시지 → 프레임 목록 (오래된 순, Mega modbusHandler.h 배치 참고)
+function splitSensorFrames(message) {
+  const frames = [];
+  let offset = 0;
+  while (offset < message.length) {
+    const length = sensorFrameLength(message, offset);
+    if (!length) {
+      console.error(`❌ 센서 프레임 파싱 실패: offset=${offset}/${message.length}`);
+      break;
+    }
+    frames.push(message.subarray(offset, offset + length));
+    offset += length;
+  }
+  return frames;
+}
+
+// v1 레코드: [ID][타입][Combined ID][CH][value1 2B][value2 2B][reserved1][reserved2]
+// 토양센서(19)만 reserved1/reserved2가 16비트 (EC, pH)
+function readSensorRecordV1(buffer, offset) {
+  if (offset + 10 > buffer.length) return null;
+
+  const sensorId = buffer[offset++];
+  const sensorType = buffer[offset++];
+  const slaveId = buffer[offset++]; // 🔥 Combined ID (하위 5비트=타입코드, 상위 3비트=UNO_ID)
+  const channel = buffer[offset++]; // 🔥 CH = UNO_ID (1~6, Mega에서 할당한 물리적 순서)
+
+  const value1 = (buffer[offset++] << 8) | buffer[offset++];
+  const value2 = (buffer[offset++] << 8) | buffer[offset++];
+  let reserved1, reserved2;
+  if (sensorType === 19) { // 토양센서
+    reserved1 = (buffer[offset++] << 8) | buffer[offset++];  // EC (16비트)
+    reserved2 = (buffer[offset++] << 8) | buffer[offset++];  // pH (16비트)
+  } else {
+    reserved1 = buffer[offset++];  // 1바이트
+    reserved2 = buffer[offset++]; // 1바이트
+  }
+
+  return { next: offset, sensorId, sensorType, slaveId, channel, value1, value2, reserved1, reserved2 };
+}
+
+// v2 레코드를 v1 필드로 맞춤 (값 변환은 convertBinarySensorValues 공용)
+function readSensorRecordV2(buffer, offset) {
+  if (offset + 4 > buffer.length) return null;
+
+  const sensorType = buffer[offset];
+  const slaveId = buffer[offset + 1];
+  const channel = buffer[offset + 2];
+  const count = buffer[offset + 3];
+  const next = offset + 4 + count * 2;
+  if (next > buffer.length) return null;
+
+  const values = [];
+  for (let k = 0; k < count; k++) {
+    values.push(buffer.readUInt16BE(offset + 4 + k * 2));
+  }
+
+  // 세 번째 값: 토양센서는 EC/pH 16비트 그대로, ADS1115 수온은 v1처럼 상/하위 바이트로 분리
+  let reserved1 = 0, reserved2 = 0;
+  if (sensorType === 19) {
+    reserved1 = values[2] || 0;
+    reserved2 = values[3] || 0;
+  } else if (count >= 3) {
+    reserved1 = values[2] >> 8;
+    reserved2 = values[2] & 0xFF;
+  }
+
+  return {
+    next, sensorType, slaveId, channel,
+    value1: values[0] || 0, value2: values[1] || 0, reserved1, reserved2
+  };
+}
+
 // 🔥 바이너리 데이터 파싱 함수
 // 🔥 바이너리 데이터 파싱 함수에 로그 추가
 // routes/sensors.js - decompressBinaryData 함수 수정
@@ -474,27 +917,19 @@ function decompressBinaryData(buffer) {
 
     const sensors = [];
 
-    for (let i = 0; i < sensorCount && offset + 10 <= buffer.length; i++) {
+    // 🔥 헤더 마지막 바이트 = 스키마 버전 (0: v1 고정 10/14바이트 레코드, 2: v2 가변 길이 레코드)
+    const schema = reserved === SENSOR_SCHEMA_V2 ? 2 : 1;
+
+    for (let i = 0; i < sensorCount; i++) {
       // console.log(`🔧 센서 파싱 #${i}: offset=${offset}, buffer[offset]=${buffer[offset]}`);
-      
-      const sensorId = buffer[offset++];
-      const sensorType = buffer[offset++];
-      const slaveId = buffer[offset++]; // 🔥 Combined ID (하위 5비트=타입코드, 상위 3비트=UNO_ID)
-      const channel = buffer[offset++]; // 🔥 CH = UNO_ID (1~6, Mega에서 할당한 물리적 순서)
-      // 🔥 status 필드 제거됨 (Mega에서 전송하지 않음)
 
-      const value1 = (buffer[offset++] << 8) | buffer[offset++];
-      const value2 = (buffer[offset++] << 8) | buffer[offset++];
-      // ✅ 토양센서의 경우 reserved1, reserved2도 16비트 값 (EC, pH)
-      // 일반 센서는 1바이트씩, 토양센서는 2바이트씩 읽기
-      let reserved1, reserved2;
-      if (sensorType === 19) { // 토양센서
-        reserved1 = (buffer[offset++] << 8) | buffer[offset++];  // EC (16비트)
-        reserved2 = (buffer[offset++] << 8) | buffer[offset++];  // pH (16비트)
-      } else {
-        reserved1 = buffer[offset++];  // 1바이트
-        reserved2 = buffer[offset++]; // 1바이트
-      }
+      const record = schema === 2 ? readSensorRecordV2(buffer, offset) : readSensorRecordV1(buffer, offset);
+      if (!record) break;
+      offset = record.next;
+
+      // v2는 센서 ID를 보내지 않음 (v1도 0부터 순차 할당이었음)
+      const sensorId = schema === 2 ? i : record.sensorId;
+      const { sensorType, slaveId, channel, value1, value2, reserved1, reserved2 } = record;
 
       // const typeInfo = UNIFIED_SENSOR_TYPES[sensorType] || { 
       //   name: 'UNKNOWN', 
@@ -502,262 +937,8 @@ function decompressBinaryData(buffer) {
       //   values: ['value1', 'value2'] 
       // };
 
-      // 🔥 센서 타입별 값 변환 로직 수정
-      let convertedValues = [];
-      let valueNames = [];
-
-      switch (sensorType) {
-        case 1: // SHT20 - 온도/습도 (×100)
-          convertedValues = [value1 / 100, value2 / 100];
-          valueNames = ['temperature', 'humidity'];
-          // console.log(`   - 변환값: 온도=${convertedValues[0]}°C, 습도=${convertedValues[1]}%`);
-          break;
-
-        case 2: // TSL2591 - 조도 (×1로 전송, 그대로 사용)
-          convertedValues = [value1];  // 🔥 UNO에서 ×1로 전송하므로 그대로 사용
-          valueNames = ['light_level'];
-          // console.log(`   - 변환값: 조도=${convertedValues[0]} lux`);
-          break;
-
-        case 3: // ADS1115 - pH/EC/WaterTemp 🔥 waterTemp 추가
-          convertedValues = [
-            value1 / 100,           // pH는 그대로
-            value2 / 10,            // 🔥 EC: dS/m (×10으로 전송됨)
-            (reserved1 << 8 | reserved2) / 100  // 🔥 waterTemp: ×100으로 전송됨
-          ];
-          valueNames = ['ph', 'ec', 'water_temp'];
-          // console.log(`   - 변환값: pH=${convertedValues[0]}, EC=${convertedValues[1]} dS/m, WaterTemp=${convertedValues[2]}°C`);
-          break;
-
-        case 4: // SCD30 - CO2 (정수값 그대로) 🔥 값 하나만
-          convertedValues = [value1];  // 🔥 배열에 값 하나만 추가
-          valueNames = ['co2_ppm'];
-          // console.log(`   - 변환값: CO2=${convertedValues[0]} ppm`);
-          break;
-
-        case 5: // DS18B20 - 온도 (×100) 🔥 값 하나만
-          convertedValues = [value1 / 100];  // 🔥 배열에 값 하나만 추가
-          valueNames = ['temperature'];
-          // console.log(`   - 변환값: 온도=${convertedValues[0]}°C`);
-          break;
-
-        case 6: // BH1750 (×1로 전송, 그대로 사용)
-          convertedValues = [value1];  // 🔥 UNO에서 ×1로 전송하므로 그대로 사용
-          valueNames = ['light_level'];
-          // console.log(` - 변환값: 조도=${convertedValues[0]} lux (type=6)`);
-          break;
-
-        case 7: // MH-Z19 (PWM, CO2)
-          convertedValues = [value1];
-          valueNames = ['co2_ppm'];
-          // console.log(`   - 변환값: CO2=${convertedValues[0]} ppm (MH-Z19)`);
-          break;
-
-        case 16: // 🔥 풍향 센서
-          // 8방향 문자열 배열
-          const directions = ['북풍(N)', '북동풍(NE)', '동풍(E)', '남동풍(SE)',
-            '남풍(S)', '남서풍(SW)', '서풍(W)', '북서풍(NW)'];
-
-          const gearDirection = value1;
-          const degreeDirection = value2;
-
-          // 풍향 문자열 계산
-          let windDirectionStr = '';
-          if (gearDirection >= 0 && gearDirection <= 7) {
-            windDirectionStr = directions[gearDirection];
-          } else {
-            // 360도 값으로 계산
-            if (degreeDirection >= 0 && degreeDirection < 22.5) windDirectionStr = '북풍(N)';
-            else if (degreeDirection < 67.5) windDirectionStr = '북동풍(NE)';
-            else if (degreeDirection < 112.5) windDirectionStr = '동풍(E)';
-            else if (degreeDirection < 157.5) windDirectionStr = '남동풍(SE)';
-            else if (degreeDirection < 202.5) windDirectionStr = '남풍(S)';
-            else if (degreeDirection < 247.5) windDirectionStr = '남서풍(SW)';
-            else if (degreeDirection < 292.5) windDirectionStr = '서풍(W)';
-            else if (degreeDirection < 337.5) windDirectionStr = '북서풍(NW)';
-            else windDirectionStr = '북풍(N)';
-          }
-
-          convertedValues = [gearDirection, degreeDirection, windDirectionStr];
-          valueNames = ['gear_direction', 'degree_direction', 'direction_text'];
-          console.log(`   - 변환값: 기어=${gearDirection}, 각도=${degreeDirection}°, 방향=${windDirectionStr}`);
-          break;
-
-        case 17: // 🔥 풍속 센서
-          const rawWindSpeed = value1;
-          const windSpeedMs = rawWindSpeed / 10.0;  // 실제 m/s 값
-
-          // 풍속 등급 계산 (보퍼트 풍력계급)
-          let windScale = '';
-          let windCondition = '';
-
-          if (windSpeedMs === 0) {
-            windScale = '무풍';
-            windCondition = '고요';
-          } else if (windSpeedMs < 0.2) {
-            windScale = '감지한계';
-            windCondition = '연기 방향 감지 곤란';
-          } else if (windSpeedMs < 1.5) {
-            windScale = '실바람';
-            windCondition = '연기 방향으로 감지';
-          } else if (windSpeedMs < 3.3) {
-            windScale = '남실바람';
-            windCondition = '바람이 얼굴에 느껴짐';
-          } else if (windSpeedMs < 5.4) {
-            windScale = '산들바람';
-            windCondition = '나뭇잎이 흔들림';
-          } else if (windSpeedMs < 7.9) {
-            windScale = '건들바람';
-            windCondition = '작은 가지가 흔들림';
-          } else if (windSpeedMs < 10.7) {
-            windScale = '흔들바람';
-            windCondition = '큰 가지가 흔들림';
-          } else if (windSpeedMs < 13.8) {
-            windScale = '된바람';
-            windCondition = '나무 전체가 흔들림';
-          } else if (windSpeedMs < 17.1) {
-            windScale = '센바람';
-            windCondition = '걷기 곤란';
-          } else {
-            windScale = '강풍';
-            windCondition = '심한 손상 가능';
-          }
-
-          convertedValues = [windSpeedMs, windScale, windCondition];
-          valueNames = ['wind_speed_ms', 'wind_scale', 'wind_condition'];
-          console.log(`   - 변환값: 풍속=${windSpeedMs.toFixed(1)}m/s, 등급=${windScale}, 상태=${windCondition}`);
-          break;
-
-
-
-        case 18: // 🔥 강우/강설 센서 (새로 추가)
-          // 첫 번째 값: 강수 상태(상위 4비트) + 수분 레벨(하위 12비트)
-          const precipStatus = (value1 >> 12) & 0x0F;
-          const moistureLevel = value1 & 0x0FFF;
-
-          // 두 번째 값: 온도(상위 8비트) + 습도(하위 8비트)
-          const tempByte = (value2 >> 8) & 0xFF;
-          const humidity = value2 & 0xFF;
-          const temperature = tempByte - 40; // -40~215°C 범위에서 실제 온도로 변환
-
-          // 강수 상태 문자열 변환
-          let precipStatusText = '';
-          let precipIcon = '';
-          switch (precipStatus) {
-            case 0:
-              precipStatusText = '건조';
-              precipIcon = '☀️';
-              break;
-            case 1:
-              precipStatusText = '강우';
-              precipIcon = '🌧️';
-              break;
-            case 2:
-              precipStatusText = '강설';
-              precipIcon = '🌨️';
-              break;
-            default:
-              precipStatusText = '알 수 없음';
-              precipIcon = '❓';
-              break;
-          }
-
-          // 수분 레벨에 따른 강도 평가
-          let moistureIntensity = '';
-          if (precipStatus > 0) { // 강우 또는 강설이 감지된 경우
-            if (moistureLevel > 3000) {
-              moistureIntensity = '강함';
-            } else if (moistureLevel > 1500) {
-              moistureIntensity = '보통';
-            } else if (moistureLevel > 500) {
-              moistureIntensity = '약함';
-            } else {
-              moistureIntensity = '미약';
-            }
-          } else {
-            if (moistureLevel > 500) {
-              moistureIntensity = '잔여수분';
-            } else {
-              moistureIntensity = '완전건조';
-            }
-          }
-
-          // 온도 상태 평가
-          let tempStatus = '';
-          if (temperature >= 30) {
-            tempStatus = '높음';
-          } else if (temperature >= 20) {
-            tempStatus = '적정';
-          } else if (temperature >= 10) {
-            tempStatus = '낮음';
-          } else if (temperature >= 0) {
-            tempStatus = '매우낮음';
-          } else {
-            tempStatus = '결빙위험';
-          }
-
-          convertedValues = [
-            precipStatus,           // 강수 상태 코드 (0=건조, 1=강우, 2=강설)
-            precipStatusText,       // 강수 상태 텍스트
-            moistureLevel,          // 수분 레벨 (0-4095)
-            moistureIntensity,      // 수분 강도 텍스트
-            temperature,            // 온도 (°C)
-            humidity,               // 습도 (%)
-            tempStatus,             // 온도 상태 텍스트
-            precipIcon              // 아이콘
-          ];
-
-          valueNames = [
-            'precip_status', 'precip_status_text', 'moisture_level', 'moisture_intensity',
-            'temperature', 'humidity', 'temp_status', 'precip_icon'
-          ];
-
-          console.log(`   - 변환값: ${precipIcon}${precipStatusText}(${precipStatus}), 수분=${moistureLevel}(${moistureIntensity}), 온도=${temperature}°C(${tempStatus}), 습도=${humidity}%`);
-          break;
-
-        case 19: // 🔥 토양 센서 (H, T, EC, PH, NPK) - 습도 활성화
-          // ✅ UNO 레지스터 순서: reg0=습도, reg1=온도, reg2=EC, reg3=pH
-          // ✅ Mega 전송 순서: value1=습도, value2=온도, reserved1=EC, reserved2=pH
-          // ✅ 서버 기대 순서: pH, EC, 온도, 습도
-          
-          // 🔥 디버깅: 원시 값 출력
-          console.log(`   - 토양센서 원시값: value1=${value1} (습도), value2=${value2} (온도), reserved1=${reserved1} (EC), reserved2=${reserved2} (pH)`);
-          
-          // UNO에서 전송된 값 (16비트)
-          // 습도: value1 (0-1000, 실제값 = value1 / 10.0)
-          // 온도: value2 (0-2550, 실제값 = value2 / 10.0)
-          // EC: reserved1 (μS/cm, 실제값 = reserved1 / 1000.0 → dS/m)
-          // pH: reserved2 (×10 스케일, 실제값 = reserved2 / 10.0)
-          
-          const soilHumidity = value1 / 10.0;      // 습도 (%)
-          const soilTemp = value2 / 10.0;          // 온도 (°C)
-          const soilEC = reserved1 / 1000.0;       // EC (μS/cm → dS/m 변환)
-          const soilPH = reserved2 / 10.0;         // pH (×10 스케일)
-
-          // ✅ 토양센서: pH, EC, 온도, 습도 순서로 변환 (서버 기대 순서)
-          convertedValues = [
-            soilPH, soilEC, soilTemp, soilHumidity
-          ];
-
-          valueNames = [
-            'soil_ph','soil_ec','soil_temperature','soil_humidity'
-          ];
-
-          console.log(`   - 변환값: pH=${soilPH.toFixed(1)}, EC=${soilEC.toFixed(3)}dS/m, 온도=${soilTemp.toFixed(1)}°C, 습도=${soilHumidity.toFixed(1)}%`);
-          break;
-
-        default: // Modbus 센서들 또는 알 수 없는 센서
-          if (sensorType >= 11) {
-            convertedValues = [value1 / 100, value2 / 100];
-            valueNames = ['value1', 'value2'];
-            console.log(`   - 변환값: Modbus값1=${convertedValues[0]}, 값2=${convertedValues[1]}`);
-          } else {
-            convertedValues = [value1, value2];
-            valueNames = ['value1', 'value2'];
-            console.log(`   - 변환값: 원시값1=${convertedValues[0]}, 값2=${convertedValues[1]}`);
-          }
-          break;
-      }
+      const { convertedValues, valueNames } =
+        convertBinarySensorValues(sensorType, value1, value2, reserved1, reserved2);
 
       const typeInfo = UNIFIED_SENSOR_TYPES[sensorType] || {
         name: 'UNKNOWN',
@@ -1112,7 +1293,7 @@ async function saveUnifiedSensorData(deviceId, sensorData) {
   try {
     const compressed = {
       d: deviceId,
-      t: Date.now(),
+      t: sensorData.timestamp || Date.now(),
       c: sensorData.sensor_count,
       p: sensorData.protocols,
       s: sensorData.sensors.map(sensor => {
@@ -1229,7 +1410,7 @@ async function saveUnifiedSensorData(deviceId, sensorData) {
        VALUES ($1, $2, $3, $4, $5)`,
       [
         deviceId,
-        new Date(),
+        new Date(sensorData.timestamp || Date.now()),
         sensorData.sensor_count,
         JSON.stringify(compressed),
         'unified'
@@ -1283,7 +1464,55 @@ sensorMqttClient.on('message', async (topic, message) => {
       // console.log(`   - Sensor Count: ${message[6]}`);
       // console.log(`   - Reserved: ${message[7]}`);
       
-      const decompressed = decompressBinaryData(message);
+      // 🔥 배치: 프레임을 오래된 순으로 처리
+      // v3 델타는 보관한 키프레임에 적용해 v2로 복원
+      // 델타 기준은 라이브 배치의 꼬리 v2 키프레임뿐 (링 안의 v2는 오프라인 중 적재된 독립 샘플)
+      // 샘플 시각 = 수신 시각 - (마지막 프레임 millis - 프레임 millis)
+      const frames = splitSensorFrames(message);
+      const receivedAt = Date.now();
+      const lastStampMs = frames.length ? frames[frames.length - 1].readUInt32BE(2) : 0;
+
+      // 끝의 레코드 0개 v2 헤더 = 재전송 백로그의 시각 앵커 (이력으로만 저장)
+      const tail = frames[frames.length - 1];
+      const backlog = frames.length > 1 && tail[7] === SENSOR_SCHEMA_V2 && tail[6] === 0;
+      if (backlog) frames.pop();
+
+      const samples = [];
+      let skipped = false;
+      frames.forEach((raw, i) => {
+        let frame = raw;
+        if (raw[7] === SENSOR_SCHEMA_DELTA) {
+          frame = expandSensorDeltaFrame(deviceId, raw);
+          if (!frame) {
+            skipped = true;
+            return;
+          }
+        } else if (raw[7] === SENSOR_SCHEMA_V2 && !backlog && i === frames.length - 1) {
+          rememberSensorKeyframe(deviceId, raw);
+        }
+
+        const sample = decompressBinaryData(frame);
+        if (!sample) return;
+        sample.timestamp = receivedAt - ((lastStampMs - raw.readUInt32BE(2)) >>> 0);
+        samples.push(sample);
+      });
+      if (!samples.length && skipped) return;
+      if (backlog) {
+        console.log(`📦 백로그 재전송 수신: ${frames.length}개 프레임, ${samples.length}개 샘플`);
+        for (const sample of samples) {
+          await saveUnifiedSensorData(deviceId, sample);
+        }
+        return;
+      }
+      if (frames.length > 1) {
+        console.log(`📦 배치 수신: ${frames.length}개 프레임, ${samples.length}개 샘플`);
+      }
+
+      // 앞쪽 샘플은 이력으로만 저장, 마지막 샘플로 최신값/알림 처리
+      for (const sample of samples.slice(0, -1)) {
+        await saveUnifiedSensorData(deviceId, sample);
+      }
+      const decompressed = samples[samples.length - 1];
       if (decompressed) {
         latestSensorData[deviceId] = decompressed;
 
@@ -1659,4 +1888,4 @@ module.exports.handleSensorDataUpdate = handleSensorDataUpdate;
 module.exports.checkDeviceStatusChange = checkDeviceStatusChange;
 module.exports.getDeviceStatus = getDeviceStatus; // 🔥 commands.js에서 사용
 module.exports.getLatestSensorData = getLatestSensorData; // 🔥 추가
-module.exports.decompressUnifiedData = decompressUnifiedData; // 🔥 추가 (필요시)
\ No newline at end of file
+module.exports.decompressUnifiedData = decompressUnifiedData; // 🔥 추가 (필요시)
@@ -1,95 +1,38 @@
-#include <SoftwareSerial.h>
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include "DFRobot_ECPRO.h"
 #include "DFRobot_PH.h"
 #include <EEPROM.h>
 #include "nutCycle.h"
+#include "ModbusCRC.h"
+#include "rs485Port.h"
+#include "debugLog.h"
+#include "UnoLink.h"
 
 // ============================================
-// Slave: Arduino Uno (SoftwareSerial 사용)
-// RS485: RO->RX_PIN, DI->TX_PIN, (DE와 /RE를 묶어서) DE_RE_PIN으로 제어
-// 프레이밍: '\n' 줄바꿈 기반
+// Slave: Arduino Uno (하드웨어 USART 사용)
+// RS485: RO->D0(RXD), DI->D1(TXD), (DE와 /RE를 묶어서) RS485_DE_RE_PIN으로 제어 - rs485Port.h 참고
+// 프레이밍: UnoLink.h 링크 프레임 (SYNC + TYPE + SEQ + LEN + 페이로드 + CRC16) 단일 형식
+// 디버그 출력은 debugLog.h의 CMD_UNO_DEBUG로 선택 (기본 비활성)
 // ============================================
 
-// --- RS485 SoftwareSerial 핀 설정 ---
-#define RX_PIN 2   // RS485 모듈의 RO가 연결될 핀
-#define TX_PIN 3   // RS485 모듈의 DI가 연결될 핀
-SoftwareSerial rs485(RX_PIN, TX_PIN); // RX, TX
+#if CMD_UNO_DEBUG
+SoftwareSerial debugSerial(DEBUG_RX_PIN, DEBUG_TX_PIN);
+#endif
 
-// --- DE/RE 합산 제어 핀 (DE와 /RE를 물리적으로 묶어 이 핀에 연결) ---
-#define DE_RE_PIN A1
-
-// --- 통신/타이밍 파라미터 (속도 최적화) ---
+// --- 통신 파라미터 ---
 const uint32_t BAUD_RATE = 57600;       // slave_test.cpp와 동일
-const uint16_t TURNAROUND_US = 250;     // slave_test.cpp와 동일
-const uint16_t INTENTIONAL_REPLY_US = 250; // slave_test.cpp와 동일
-
-// SoftwareSerial은 .flush()가 "입력 버퍼 비우기"라 TX 완료 보장이 안 됩니다.
-// 바이트 전송 시간으로 근사 대기:
-const uint8_t  BITS_PER_BYTE = 10;  // 1Start + 8Data + 1Stop(=10)
-inline uint32_t byte_time_us(uint32_t baud) {
-  // 올림 처리(ceiling): (bits*1e6 + baud -1)/baud
-  return ( (uint32_t)BITS_PER_BYTE * 1000000UL + baud - 1 ) / baud;
-}
-
-inline void wait_tx_done_by_time(size_t bytes) {
-  // 고속 통신용 최적화: 바이트 시간 + 최소 가드 시간
-  uint32_t byteTime = byte_time_us(BAUD_RATE) * bytes;
-  uint32_t guardTime = TURNAROUND_US;
-  delayMicroseconds(byteTime + guardTime);
-}
-
-// --- 모드 전환 ---
-inline void enterTransmitMode() { digitalWrite(DE_RE_PIN, HIGH); } // DE=1, /RE=1 → TX
-inline void enterReceiveMode()  { digitalWrite(DE_RE_PIN, LOW);  } // DE=0, /RE=0 → RX
-
-// '\n'까지 읽어 buf에 저장 (바이트 배열로 처리). 성공시 true, 길이는 idx에 저장
-bool readLine(SoftwareSerial& s, char* buf, size_t maxLen, uint16_t timeout_ms, int* receivedLen) {
-  size_t idx = 0;
-  unsigned long t0 = millis();
-  bool hasData = false;
-  
-  while (millis() - t0 < timeout_ms) {
-    while (s.available()) {
-      hasData = true;
-      char c = (char)s.read();
-      
-      if (c == '\n') {
-        // null 문자로 종료하지 않고 실제 바이트 길이 반환
-        *receivedLen = idx;
-        return true; 
-      }
-      if (idx < maxLen - 1) {
-        buf[idx++] = c;
-      } else {
-        //Serial.println(F("Buffer overflow"));
-        return false; // 버퍼 오버플로우 시 즉시 종료
-      }
-    }
-  }
-  
-  if (hasData) {
-    // null 문자로 종료하지 않고 실제 바이트 길이 반환
-    *receivedLen = idx;
-    //Serial.print(F("Incomplete: "));
-    //Serial.print(idx);
-    //Serial.println(F("B"));
-  }
-  
-  return false;
-}
 
 // 릴레이 핀 설정 (절대 고정)
 int pins[] = {8, 7, 6, 5, 9, 10, 11, A2, 12, 13}; // 제어할 핀 배열. A3 고장
 int numPins = 10; // 핀 개수
 
 // 🔥 비트연산 명령 상수 추가
-const uint8_t CMD_MULTI_ON = 0x30;   // 다중 릴레이 ON
-const uint8_t CMD_MULTI_OFF = 0x31;  // 다중 릴레이 OFF
+const uint8_t CMD_MULTI_ON = 0x30;   // 다중 릴레이 ON (페이로드: 8비트 마스크)
+const uint8_t CMD_MULTI_OFF = 0x31;  // 다중 릴레이 OFF (페이로드: 8비트 마스크)
 
 
-// 바이트 기반 명령 정의 (NPN 충돌 방지) - 상단으로 이동
+// 링크 프레임 TYPE (Mega modbusHandler.h와 동일)
+// 페이로드: 채널/비트마스크 명령은 1바이트, MULTI_SET은 4바이트, nutCycle은 TLV, 나머지는 없음
 #define CMD_RESET          0x20  // 서버 호환성 (모든 핀 OFF)
 #define CMD_ALLOFF         0x21  // 서버 호환성 (모든 핀 OFF)
 #define CMD_TOGGLE         0x22  // 단일 핀 토글
@@ -97,16 +40,35 @@ const uint8_t CMD_MULTI_OFF = 0x31;  // 다중 릴레이 OFF
 #define CMD_OFF            0x24  // 단일 핀 OFF (채널 지정)
 #define CMD_SENSOR_REQUEST 0x25  // 센서 데이터 요청
 #define CMD_EC_PULSE       0x26  // EC 펄스 토글 (2개 핀 동시 제어)
-#define CMD_EC_OFF         0x27  // EC OFF (2개 핀 동시 제어)
+#define CMD_EC_OFF         0x28  // EC OFF (2개 핀 동시 제어)
 #define CMD_BED_ON         0x29  // 베드 ON (4개 핀 동시 제어) - NPN 충돌 방지
-#define CMD_NUTCYCLE_CONFIG 0x32 // nutCycle 설정 전달 (JSON)
 #define CMD_STATUS_REQUEST 0x33 // nutCycle 상태 요청
+#define CMD_MULTI_SET      0x34 // 다중 릴레이 원자 적용 (SET 마스크 16비트 + CLEAR 마스크 16비트, big-endian)
+#define CMD_NUTCYCLE_BIN   0x35 // nutCycle 설정 전달 (TLV, nutCycle.h 참고)
+#define MULTI_SET_PAYLOAD_LEN 4 // SET_H + SET_L + CLR_H + CLR_L
+
+// 요청 순번: 모든 응답 프레임에 에코 (Mega가 늦은 응답을 구분)
+uint8_t rxSeq = 0;
+
+// 링크 프레임 수신기
+ULinkParser linkRx;
+unsigned long lastLinkByteMs = 0;
 
-// 응답 코드 정의
+// 응답 TYPE 정의
 #define ACK_OK             0x80
 #define ACK_ERROR          0x81
 #define ACK_SENSOR_DATA    0x82
-#define ACK_STATUS_DATA    0x83 // 상태 데이터 응답
+#define ACK_STATUS_BIN     0x84 // 상태 데이터 응답 (고정 길이 바이너리)
+
+// 상태 응답 배치 (Mega modbusHandler.h와 동일). [0]은 TYPE, [1..21]이 링크 페이로드
+// [0] 0x84 [1] 버전 [2] cycle(int8) [3] status [4] flags [5] 시 [6] 분 [7..8] 릴레이 비트맵
+// [9] rm [10] rs [11] rh [12] rm_wait [13] rs_wait [14..15] pH×100 [16..17] EC(μS/cm)
+// [18..19] 수온×10(int16) [20..21] 예약
+#define STATUS_PAYLOAD_LEN 21
+#define STATUS_FRAME_VER   1
+#define STATUS_F_TIME      0x01
+#define STATUS_F_IN_RANGE  0x02
+#define STATUS_F_STARTED   0x04
 
 // 센서 핀 정의 (요청사항에 따라 수정)
 const int PH_PIN = A0;    // PH 센서 아날로그 핀
@@ -118,9 +80,6 @@ DFRobot_ECPRO ec;
 DFRobot_ECPRO_PT1000 ecpt; // EC 센서의 온도 센서 객체
 DFRobot_PH ph;
 
-// JSON 문서 (메모리 최적화: 192 → 128)
-StaticJsonDocument<128> doc;
-
 // 타이머 변수 (고속 통신용 최적화)
 const unsigned long SENSOR_INTERVAL = 5000; // 10초 → 5초로 단축
 
@@ -201,6 +160,60 @@ void setRelay(uint8_t channel, bool state) {
     //Serial.println(getRelayStatus(channel) ? F("H") : F("L"));
 }
 
+// ===================== 포트 단위 릴레이 일괄 적용 =====================
+// 채널 → (포트 출력 레지스터, 비트) 매핑. 10개 채널은 PORTB/PORTC/PORTD 3개 포트에 걸쳐 있음
+#define MAX_RELAY_PORTS 3
+volatile uint8_t* relayPortReg[MAX_RELAY_PORTS];
+uint8_t relayPortCount = 0;
+uint8_t relayPortIdx[10];
+uint8_t relayPortBit[10];
+
+void initRelayPortMap() {
+  relayPortCount = 0;
+  for (int i = 0; i < numPins; i++) {
+    volatile uint8_t* reg = portOutputRegister(digitalPinToPort(pins[i]));
+    uint8_t p = 0;
+    while (p < relayPortCount && relayPortReg[p] != reg) p++;
+    if (p == relayPortCount && relayPortCount < MAX_RELAY_PORTS) relayPortReg[relayPortCount++] = reg;
+    relayPortIdx[i] = p;
+    relayPortBit[i] = digitalPinToBitMask(pins[i]);
+  }
+}
+
+// SET/CLEAR 마스크를 포트당 한 번의 쓰기로 적용 (인터럽트 차단 구간 안에서 모든 포트 갱신)
+// 적용 후 실제 핀 상태를 확인하고, 어긋난 채널만 setRelay()로 자가복구
+void applyRelayMask(uint16_t setMask, uint16_t clearMask) {
+  uint8_t portSet[MAX_RELAY_PORTS] = {0};
+  uint8_t portClr[MAX_RELAY_PORTS] = {0};
+  for (int i = 0; i < numPins; i++) {
+    uint16_t bit = (uint16_t)1 << i;
+    if (relayPortIdx[i] >= relayPortCount) {  // 매핑 실패 채널은 개별 제어
+      if (setMask & bit) setRelay(i, true);
+      else if (clearMask & bit) setRelay(i, false);
+      continue;
+    }
+    if (setMask & bit) portSet[relayPortIdx[i]] |= relayPortBit[i];
+    else if (clearMask & bit) portClr[relayPortIdx[i]] |= relayPortBit[i];
+  }
+
+  uint8_t oldSREG = SREG;
+  cli();
+  for (uint8_t p = 0; p < relayPortCount; p++) {
+    if (portSet[p] | portClr[p]) {
+      *relayPortReg[p] = (uint8_t)((*relayPortReg[p] & ~portClr[p]) | portSet[p]);
+    }
+  }
+  SREG = oldSREG;
+
+  for (int i = 0; i < numPins; i++) {
+    uint16_t bit = (uint16_t)1 << i;
+    if ((setMask | clearMask) & bit) {
+      bool expected = (setMask & bit) != 0;
+      if (getRelayStatus(i) != expected) setRelay(i, expected);
+    }
+  }
+}
+
 bool getRelayStatus(uint8_t channel) {
     if (channel < numPins) {
         return digitalRead(pins[channel]) == HIGH;
@@ -209,19 +222,18 @@ bool getRelayStatus(uint8_t channel) {
 }
 
 void setup() {
-  pinMode(DE_RE_PIN, OUTPUT);
-  enterReceiveMode();
-
-  rs485.begin(BAUD_RATE);
-  
-  // RS485 하드웨어 테스트 (간소화)
-  //Serial.println(F("RS485 initialized"));
+  // DE=0 상태로 먼저 초기화: 이후 라이브러리의 Serial 출력(ph.begin 등)은 USB로만 나가고 버스에는 실리지 않음
+  rs485Begin(BAUD_RATE);
+  ulinkReset(linkRx);
+  DBG_BEGIN();
+  DBG_PRINTLN(F("RS485 initialized"));
 
   // 모든 릴레이 핀을 출력 모드로 설정
   for (int i = 0; i < numPins; i++) {
     pinMode(pins[i], OUTPUT);
-    digitalWrite(pins[i], LOW); // 초기값을 LOW로 설정
+    digitalWrite(pins[i], LOW); // 초기값을 LOW로 설정 (PWM 타이머 출력도 해제됨)
   }
+  initRelayPortMap();
   
   
   // 센서 핀 설정
@@ -229,9 +241,6 @@ void setup() {
   pinMode(PH_PIN, INPUT);
   pinMode(TEMP_PIN, INPUT);
   
-  Serial.begin(115200);  // 디버그용 시리얼 속도 향상
-  rs485.begin(BAUD_RATE); // 57600 보드레이트 사용
-  
   // 센서 초기화
   ph.begin();
   ec.setCalibration(1.0);
@@ -239,7 +248,7 @@ void setup() {
   // pH 보정 계수 계산
   updatePhCalibrationFactors();
   
-  //Serial.println(F("UNO Ready"));
+  DBG_PRINTLN(F("UNO Ready"));
   
   // nutCycle 초기화
   initNutrientCycle();
@@ -251,13 +260,7 @@ void loop() {
     static unsigned long lastHello = 0;
     if (millis() - lastHello > 3000) {
       lastHello = millis();
-      enterTransmitMode();
-      delayMicroseconds(TURNAROUND_US);
-      const char hello[] = "UNO_CTRL_HELLO\n";
-      for (size_t i=0;i<sizeof(hello)-1;i++) rs485.write((uint8_t)hello[i]);
-      rs485.flush();
-      wait_tx_done_by_time(sizeof(hello)-1);
-      enterReceiveMode();
+      sendLinkFrame(ULINK_HELLO, 0, nullptr, 0);
     }
   }
   
@@ -265,141 +268,29 @@ void loop() {
   static unsigned long lastHeartbeat = 0;
   if (millis() - lastHeartbeat > 30000) {
     lastHeartbeat = millis();
-    //Serial.print(F("Heartbeat: "));
-    //Serial.println(millis() / 1000);
-  }
-  
-  // 마스터 메시지 수신 처리
-  // 바이트 기반 명령과 JSON 명령(길이 기반)을 분리 처리
-  if (rs485.available() >= 1) {
-    char firstByte = rs485.peek();
-    
-    // 상태 요청 처리 (CMD_STATUS_REQUEST - 2바이트, CMD + param, \n 없음)
-    if (firstByte == CMD_STATUS_REQUEST) {
-      // CMD_STATUS_REQUEST는 2바이트만 (CMD + param, \n 없음)
-      char line[10] = {0};
-      int receivedLen = 0;
-      unsigned long startTime = millis();
-      while (millis() - startTime < 50 && receivedLen < 2) {
-        if (rs485.available()) {
-          line[receivedLen++] = rs485.read();
-        }
-        delay(1);
-      }
-      
-      if (receivedLen >= 1) {
-        sendNutrientStatus();
-      }
-    }
-    // JSON 명령 처리 (CMD_NUTCYCLE_CONFIG - 길이 기반 프로토콜)
-    else if (firstByte == CMD_NUTCYCLE_CONFIG) {
-      // 길이 기반 프로토콜: CMD(1) + 길이(2) + JSON 데이터
-      unsigned long startTime = millis();
-      uint8_t cmd = 0;
-      uint16_t jsonLen = 0;
-      
-      // 명령 코드 읽기
-      while (millis() - startTime < 100 && rs485.available() < 1) delay(1);
-      if (rs485.available() >= 1) {
-        cmd = rs485.read();
-      } else {
-        return; // 타임아웃
-      }
-      
-      // 길이 헤더 읽기 (2바이트)
-      while (millis() - startTime < 100 && rs485.available() < 2) delay(1);
-      if (rs485.available() >= 2) {
-        uint8_t lenHigh = rs485.read();
-        uint8_t lenLow = rs485.read();
-        jsonLen = (lenHigh << 8) | lenLow;
-        if (jsonLen > 512) jsonLen = 512; // 최대 길이 제한
-      } else {
-        sendAck(ACK_ERROR);
-        return; // 타임아웃
-      }
-      
-      // JSON 데이터 읽기 (메모리 최적화: 200바이트로 제한)
-      if (jsonLen > 200) jsonLen = 200;
-      char jsonStr[201] = {0}; // 최대 200 + null
-      uint16_t received = 0;
-      startTime = millis();
-      while (millis() - startTime < 1000 && received < jsonLen) {
-        while (rs485.available() && received < jsonLen) {
-          jsonStr[received++] = rs485.read();
-        }
-        delay(1);
-      }
-      
-      if (received == jsonLen) {
-        jsonStr[jsonLen] = '\0';
-        //Serial.print(F("JSON received: "));
-        //Serial.print(jsonLen);
-        //Serial.println(F("B"));
-        processNutrientCommand(jsonStr);
-        sendAck(ACK_OK);
-        //Serial.println(F("JSON processing complete"));
-      } else {
-        //Serial.print(F("JSON incomplete: "));
-        //Serial.print(received);
-        //Serial.print(F("/"));
-        //Serial.print(jsonLen);
-        //Serial.println(F("B"));
-        sendAck(ACK_ERROR);
-      }
-      delayMicroseconds(INTENTIONAL_REPLY_US);
-    }
-    // 바이트 기반 명령 처리
-    // CMD_SENSOR_REQUEST는 2바이트 (CMD + param, \n 없음)
-    // CMD_ON, CMD_OFF, CMD_TOGGLE, CMD_BED_ON 등은 3바이트 (CMD + param + \n)
-    else if (firstByte == CMD_SENSOR_REQUEST) {
-      // CMD_SENSOR_REQUEST는 2바이트만 (CMD + param, \n 없음)
-      char line[10] = {0};
-      int receivedLen = 0;
-      unsigned long startTime = millis();
-      while (millis() - startTime < 50 && receivedLen < 2) {
-        if (rs485.available()) {
-          line[receivedLen++] = rs485.read();
-        }
-        delay(1);
-      }
-      
-      if (receivedLen >= 1) {
-        processRS485Command(line, receivedLen);
-        // ACK는 processRS485Command 내부에서 전송되므로 추가 지연 불필요
-      }
-    } else if (firstByte >= 0x20 && firstByte <= 0x2F) {
-      // 기타 바이트 명령은 라인 단위로 처리 (\n으로 종료)
-      // Mega는 CMD_ON/OFF 등을 CMD + param + \n 형식으로 전송
-      char line[64] = {0};  // 100 → 64 (메모리 최적화)
-      int receivedLen = 0;
-      if (readLine(rs485, line, sizeof(line), 100, &receivedLen)) {
-        processRS485Command(line, receivedLen);
-        // ACK는 processRS485Command 내부에서 전송되므로 추가 지연 불필요
-      }
-    } else {
-      // 기타 라인 단위 명령 처리 (\n으로 종료) - CMD_MULTI_ON/OFF 등
-      char line[64] = {0};  // 100 → 64 (메모리 최적화)
-      int receivedLen = 0;
-      if (readLine(rs485, line, sizeof(line), 100, &receivedLen)) {
-        processRS485Command(line, receivedLen);
-        // ACK는 processRS485Command 내부에서 전송되므로 추가 지연 불필요
-      }
+    DBG_PRINT(F("Heartbeat: "));
+    DBG_PRINTLN(millis() / 1000);
+  }
+  
+  // 마스터 메시지 수신 처리: 모든 바이트를 링크 프레이머로 (NPN Modbus 트래픽은 SYNC/CRC에서 걸러짐)
+  while (rs485.available()) {
+    ulinkFeed(linkRx, (uint8_t)rs485.read());
+    lastLinkByteMs = millis();
+    uint8_t n;
+    while ((n = ulinkScan(linkRx)) != 0) {
+      processLinkFrame(linkRx.buf);
+      ulinkDrop(linkRx, n);
     }
   }
-  
-  // 주기적으로 RS485 버퍼 정리 (통신 안정성 향상)
-  static unsigned long lastBufferCleanup = 0;
-  if (millis() - lastBufferCleanup > 5000) { // 5초마다 버퍼 정리
-    lastBufferCleanup = millis();
-    int availableBytes = 0;
-    while (rs485.available()) {
-      uint8_t byte = rs485.read(); // 잔여 데이터 제거
-      availableBytes++;
-    }
-    if (availableBytes > 0) {
-      //Serial.print(F("Buffer cleanup: "));
-      //Serial.println(availableBytes);
+  // 프레임 중간 무음: 미완성 앞부분을 버리고 남은 바이트에서 재탐색
+  if (linkRx.len > 0 && millis() - lastLinkByteMs >= ULINK_GAP_MS) {
+    uint8_t n;
+    while ((n = ulinkFlushStale(linkRx)) != 0) {
+      processLinkFrame(linkRx.buf);
+      ulinkDrop(linkRx, n);
     }
+    DBG_PRINT(F("Link stale flush: "));
+    DBG_PRINTLN(linkRx.stats.staleFlush);
   }
   
   static unsigned long debugTimer = millis();
@@ -638,109 +529,91 @@ float readPH() {
   return voltageToPhValue(voltage);
 }
 
-// RS485 명령 처리 함수 (바이트 기반)
-void processRS485Command(const char* line, int lineLen) {
-  if (lineLen < 1) {
-    //Serial.println(F("Command length insufficient"));
-    return;
-  }
+// 링크 프레임 1건 처리 - 모든 요청은 같은 SEQ로 정확히 한 번 응답
+void processLinkFrame(const uint8_t* frame) {
+  uint8_t type = ulinkType(frame);
+  uint8_t len = ulinkLen(frame);
+  const uint8_t* payload = ulinkPayload(frame);
+  rxSeq = ulinkSeq(frame);
   
-  uint8_t cmd = (uint8_t)line[0];
-  uint8_t param = (lineLen >= 2) ? (uint8_t)line[1] : 0;
-  
-  // NPN Modbus 명령 완전 차단 (0x00-0x1F는 모두 무시)
-  if (cmd < 0x20) {
-    return; // NPN 명령 무시
+  switch (type) {
+    case CMD_STATUS_REQUEST:
+      sendNutrientStatus();
+      break;
+      
+    case CMD_MULTI_SET:
+      if (len == MULTI_SET_PAYLOAD_LEN) {
+        processMultiSetCommand(payload);
+      } else {
+        sendAck(ACK_ERROR);
+      }
+      break;
+      
+    case CMD_NUTCYCLE_BIN:
+      if (processNutrientCommand(payload, len)) {
+        sendAck(ACK_OK);
+      } else {
+        DBG_PRINT(F("NUT TLV error: "));
+        DBG_PRINTLN(len);
+        sendAck(ACK_ERROR);
+      }
+      break;
+      
+    default:
+      processRS485Command(type, payload, len);
+      break;
   }
+}
+
+// 단순 제어 명령 처리 (페이로드: 채널/비트마스크 1바이트 또는 없음)
+void processRS485Command(uint8_t cmd, const uint8_t* payload, uint8_t len) {
+  uint8_t param = (len >= 1) ? payload[0] : 0;
   
   // 🔥 비트연산 다중 릴레이 명령 처리
   if (cmd == CMD_MULTI_ON || cmd == CMD_MULTI_OFF) {
-    if (lineLen < 2) {
-      //Serial.println(F("MULTI length insufficient"));
+    if (len < 1) {
+      DBG_PRINTLN(F("MULTI length insufficient"));
       sendAck(ACK_ERROR);
       return;
     }
-    // 디버깅: 다중 릴레이 명령
-    //Serial.print(cmd == CMD_MULTI_ON ? F("MULTI_ON") : F("MULTI_OFF"));
-    //Serial.print(F(" bitmask=0x"));
-    //Serial.print(param, HEX);
-    //Serial.print(F(" ("));
-    // 비트마스크 해석
-    bool first = true;
-    for (int i = 0; i < 10; i++) {
-      if (param & (1 << i)) {
-        if (!first) //Serial.print(F(","));
-        //Serial.print(i);
-        first = false;
-      }
-    }
-    //Serial.println(F(")"));
     processMultiRelayCommand(cmd, param);
     return;
   }
   
-  // UNO 명령 범위 검증 (0x20-0x2F, 0x32 허용)
-  // 0x30-0x31: CMD_MULTI_ON/OFF (이미 위에서 처리됨)
-  // 0x32: CMD_NUTCYCLE_CONFIG (JSON 명령)
-  if (cmd > 0x2F && cmd != CMD_NUTCYCLE_CONFIG) {
-    //Serial.print(F("Unknown command: 0x"));
-    //Serial.println(cmd, HEX);
-    sendAck(ACK_ERROR);
-    return;
-  }
-  
   switch (cmd) {
     case CMD_RESET:
     case CMD_ALLOFF:
-      //Serial.print(cmd == CMD_RESET ? F("RESET") : F("ALLOFF"));
-      //Serial.println();
       allPinsOff();
       sendAck(ACK_OK);
       break;
       
     case CMD_TOGGLE:
-      if (lineLen >= 2 && param < numPins) {
-        //Serial.print(F("TOGGLE CH"));
-        //Serial.println(param);
+      if (len >= 1 && param < numPins) {
         bool currentState = getRelayStatus(param);
         setRelay(param, !currentState);
-        //Serial.print(F("CH"));
-        //Serial.print(param);
-        //Serial.print(F(" -> "));
-        //Serial.println(!currentState ? F("ON") : F("OFF"));
         sendAck(ACK_OK);
       } else {
-        //Serial.println(F("TOGGLE parameter error"));
+        DBG_PRINTLN(F("TOGGLE parameter error"));
         sendAck(ACK_ERROR);
       }
       break;
       
     case CMD_ON:
-      if (lineLen >= 2 && param < numPins) {
-        //Serial.print(F("ON CH"));
-        //Serial.println(param);
+      if (len >= 1 && param < numPins) {
         setRelay(param, HIGH);
-        //Serial.print(F("CH"));
-        //Serial.print(param);
-        //Serial.println(F(" ON"));
         sendAck(ACK_OK);
       } else {
-        //Serial.println(F("ON parameter error"));
+        DBG_PRINTLN(F("ON parameter error"));
         sendAck(ACK_ERROR);
       }
       break;
       
     case CMD_OFF:
-      if (lineLen >= 2 && param < numPins) {
-        //Serial.print(F("OFF CH"));
-        //Serial.println(param);
+      if (len >= 1 && param < numPins) {
         setRelay(param, LOW);
-        //Serial.print(F("CH"));
-        //Serial.print(param);
-        //Serial.println(F(" OFF"));
         sendAck(ACK_OK);
       } else {
-        //Serial.println(F("OFF parameter error"));
+        DBG_PRINTLN(F("OFF parameter error"));
         sendAck(ACK_ERROR);
       }
       break;
@@ -752,12 +625,7 @@ void processRS485Command(const char* line, int lineLen) {
       sendSensorData();
       break;
       
-    case CMD_STATUS_REQUEST:
-      // 상태 요청은 loop()에서 처리되므로 여기서는 오류
-      sendAck(ACK_ERROR);
-      break;
-      
-    case CMD_EC_PULSE:
+    case CMD_EC_PULSE: {
       // EC 펄스 토글 (2개 핀 동시 제어: 채널 4, 5)
       // EC1 토글 (채널 4 = pins[4] = 9번 핀)
       bool currentState1 = getRelayStatus(4);
@@ -769,6 +637,7 @@ void processRS485Command(const char* line, int lineLen) {
       
       sendAck(ACK_OK);
       break;
+    }
       
     case CMD_EC_OFF:
       // EC OFF (2개 핀 동시 제어: 채널 4, 5)
@@ -782,66 +651,53 @@ void processRS485Command(const char* line, int lineLen) {
       // 베드 ON (4개 핀 동시 제어: 채널 0, 1, 2, 3)
       // param의 비트마스크로 어떤 베드를 ON할지 결정
       // param: 0x01=A, 0x02=B, 0x04=C, 0x08=D
-      if (lineLen >= 2) {
-        //Serial.print(F("BED_ON: "));
-        if (param & 0x01) {
-          setRelay(UNO_CH_BED_A, HIGH);
-          //Serial.print(F("A"));
-        }
-        if (param & 0x02) {
-          setRelay(UNO_CH_BED_B, HIGH);
-          //Serial.print(F("B"));
-        }
-        if (param & 0x04) {
-          setRelay(UNO_CH_BED_C, HIGH);
-          //Serial.print(F("C"));
-        }
-        if (param & 0x08) {
-          setRelay(UNO_CH_BED_D, HIGH);
-          //Serial.print(F("D"));
-        }
-        //Serial.println();
+      if (len >= 1) {
+        if (param & 0x01) setRelay(UNO_CH_BED_A, HIGH);
+        if (param & 0x02) setRelay(UNO_CH_BED_B, HIGH);
+        if (param & 0x04) setRelay(UNO_CH_BED_C, HIGH);
+        if (param & 0x08) setRelay(UNO_CH_BED_D, HIGH);
         sendAck(ACK_OK);
       } else {
         sendAck(ACK_ERROR);
       }
       break;
       
-    case CMD_NUTCYCLE_CONFIG:
-      // JSON 명령은 loop()에서 길이 기반 프로토콜로 처리되므로 여기서는 오류
-      //Serial.println(F("CMD_NUTCYCLE_CONFIG must be processed in loop()"));
-      sendAck(ACK_ERROR);
-      break;
-      
     default:
+      DBG_PRINT(F("Unknown command: 0x"));
+      DBG_PRINTLN(cmd, HEX);
       sendAck(ACK_ERROR);
       break;
   }
 }
 
+// 링크 프레임 송신 (DE 해제는 TXC 인터럽트) - 헤더/페이로드/CRC를 나눠 써서 버퍼 복사 없음
+void sendLinkFrame(uint8_t type, uint8_t seq, const uint8_t* payload, uint8_t len) {
+  uint8_t header[ULINK_HEADER_LEN];
+  ulinkHeader(header, type, seq, len);
+  uint16_t crc = ulinkCrc(header, payload, len);
+  
+  rs485BeginTx();
+  rs485.write(header, ULINK_HEADER_LEN);
+  if (len) rs485.write(payload, len);
+  rs485.write((uint8_t)(crc & 0xFF));
+  rs485.write((uint8_t)(crc >> 8));
+  rs485EndTx();
+}
+
 // 바이트 기반 ACK 응답 전송 함수
 void sendAck(uint8_t ackCode) {
-  // ========== 프로토콜: ACK(1바이트) ==========
-  enterTransmitMode();
-  delayMicroseconds(TURNAROUND_US);
-  
-  rs485.write((uint8_t)ackCode);
-  rs485.flush();
-  wait_tx_done_by_time(1);
-  
-  // Mega가 수신 모드로 전환할 시간 확보
-  delayMicroseconds(INTENTIONAL_REPLY_US);
-  
-  enterReceiveMode();
+  // ========== 링크 프레임: TYPE = ACK_OK/ACK_ERROR, SEQ = 요청 순번, 페이로드 없음 ==========
+  // 송신 완료 대기 없음: 링버퍼에 적재 후 반환, DE 해제는 TXC 인터럽트가 처리
+  sendLinkFrame(ackCode, rxSeq, nullptr, 0);
   
   // 디버깅: ACK 전송 (간소화)
   if (ackCode == ACK_OK) {
-    //Serial.println(F("ACK_OK"));
+    DBG_PRINTLN(F("ACK_OK"));
   } else if (ackCode == ACK_ERROR) {
-    //Serial.println(F("ACK_ERROR"));
+    DBG_PRINTLN(F("ACK_ERROR"));
   } else {
-    //Serial.print(F("ACK=0x"));
-    //Serial.println(ackCode, HEX);
+    DBG_PRINT(F("ACK=0x"));
+    DBG_PRINTLN(ackCode, HEX);
   }
 }
 
@@ -853,9 +709,6 @@ void sendSensorData() {
   uint16_t temp_int = (uint16_t)(Temperature * 10); // 온도 * 10 (소수점 1자리)
   
   // ---------- 응답 송신 ----------
-  enterTransmitMode();
-  delayMicroseconds(TURNAROUND_US);
-  
   // 센서 데이터 전송 (8바이트) - 고속 통신용 최적화
   uint8_t sensorData[8] = {
     (uint8_t)ACK_SENSOR_DATA,  // 응답 코드 (1바이트)
@@ -868,14 +721,8 @@ void sendSensorData() {
     (uint8_t)0x00              // Reserved (1바이트)
   };
   
-  // 한 번에 모든 데이터 전송 (개별 write보다 빠름)
-  for (uint8_t i = 0; i < 8; i++) {
-    rs485.write(sensorData[i]);
-  }
-  rs485.flush();  // SoftwareSerial의 flush는 입력 버퍼 비움 용도 → TX 완료 보장 X
-  wait_tx_done_by_time(8); // 실제 송신 완료 보장(근사)
-  
-  enterReceiveMode();
+  // 링크 프레임: TYPE = ACK_SENSOR_DATA, 페이로드 = 나머지 7바이트
+  sendLinkFrame(sensorData[0], rxSeq, sensorData + 1, sizeof(sensorData) - 1);
   
   // SENSOR 디버깅 출력 제거 (사용자 요청)
 }
@@ -887,40 +734,36 @@ void allPinsOff() {
   }
 }
 
-// nutCycle 상태 전송 함수 (JSON 형식) - 메모리 최적화
+// nutCycle 상태 전송 함수 (21바이트 바이너리 페이로드, JSON 대비 버스 점유 약 1/8)
 void sendNutrientStatus() {
-  // JSON 문서 생성 (메모리 최적화: 160 → 192)
-  StaticJsonDocument<192> statusDoc;
-  statusDoc.clear();
+  uint8_t frame[1 + STATUS_PAYLOAD_LEN] = {0};
   
   // 기본 정보
-  statusDoc["id"] = "status";
-  statusDoc["ts"] = millis();
-  statusDoc["cycle"] = cycle;
-  statusDoc["status"] = (int)cycleStatus;
-  statusDoc["time_received"] = nutSystemFlags.timeReceived ? 1 : 0;
-  
-  // 현재 시간 (문자열 최소화)
-  char timeStr[6];
-  snprintf(timeStr, sizeof(timeStr), "%02d:%02d", currentHour, currentMinute);
-  statusDoc["current_time"] = timeStr;
-  statusDoc["in_range"] = isCurrentTimeInRange() ? 1 : 0;
-  statusDoc["cycle_started_today"] = nutSystemFlags.cycle_started_today ? 1 : 0;
-  
-  // 릴레이 상태 정보 (9개만: 0~8)
-  JsonArray relays = statusDoc.createNestedArray("relays");
-  for (uint8_t i = 0; i <= UNO_CH_PUMP; i++) {
-    relays.add(getRelayStatus(i) ? 1 : 0);
-  }
+  frame[0] = ACK_STATUS_BIN;
+  frame[1] = STATUS_FRAME_VER;
+  frame[2] = (uint8_t)cycle;
+  frame[3] = (uint8_t)cycleStatus;
+  uint8_t flags = 0;
+  if (nutSystemFlags.timeReceived) flags |= STATUS_F_TIME;
+  if (isCurrentTimeInRange()) flags |= STATUS_F_IN_RANGE;
+  if (nutSystemFlags.cycle_started_today) flags |= STATUS_F_STARTED;
+  frame[4] = flags;
+  frame[5] = currentHour;
+  frame[6] = currentMinute;
+  
+  // 릴레이 상태 비트맵 (채널 0 = bit0)
+  uint16_t relayBits = 0;
+  for (uint8_t i = 0; i < numPins; i++) {
+    if (getRelayStatus(i)) relayBits |= (uint16_t)1 << i;
+  }
+  frame[7] = (uint8_t)(relayBits >> 8);
+  frame[8] = (uint8_t)(relayBits & 0xFF);
   
   // 타이머 정보
   if (nutSystemFlags.pumpRunning && cycle > 5) {
     uint32_t pumpRunTime = getIrrigationElapsedTime() / 1000;
-    statusDoc["rm"] = pumpRunTime / 60; // 실행 분
-    statusDoc["rs"] = pumpRunTime % 60; // 실행 초
-  } else {
-    statusDoc["rm"] = 0;
-    statusDoc["rs"] = 0;
+    frame[9] = (uint8_t)(pumpRunTime / 60);  // 실행 분
+    frame[10] = (uint8_t)(pumpRunTime % 60); // 실행 초
   }
   
   // 대기 시간 계산
@@ -933,73 +776,45 @@ void sendNutrientStatus() {
       timeToNextActivation = 0;
     }
     
-    statusDoc["rh"] = timeToNextActivation / 3600000;
-    statusDoc["rm_wait"] = (timeToNextActivation % 3600000) / 60000;
-    statusDoc["rs_wait"] = (timeToNextActivation % 60000) / 1000;
-  } else {
-    statusDoc["rh"] = 0;
-    statusDoc["rm_wait"] = 0;
-    statusDoc["rs_wait"] = 0;
-  }
-  
-  // 센서 데이터
-  JsonObject sensors = statusDoc.createNestedObject("sensors");
-  sensors["ph"] = pH_Value;
-  sensors["ec"] = ecValue / 1000.0f; // μS/cm → dS/m
-  sensors["temp"] = waterTemp;
-  
-  // JSON 직렬화 (String 대신 직접 전송으로 메모리 절약)
-  char jsonBuffer[200] = {0};
-  size_t jsonLen = serializeJson(statusDoc, jsonBuffer, sizeof(jsonBuffer));
-  if (jsonLen >= sizeof(jsonBuffer)) {
-    // 버퍼가 부족하면 JSON 문서 크기 증가 필요
-    jsonLen = sizeof(jsonBuffer) - 1; // null 문자 공간 확보
-    //Serial.println(F("⚠️ STATUS JSON 버퍼 부족"));
-  }
-  
-  // JSON 직렬화 검증 (디버깅용)
-  //Serial.print(F("📤 STATUS JSON: "));
-  //Serial.print(jsonLen);
-  //Serial.println(F("B"));
-  
-  // 길이 기반 프로토콜로 전송: ACK_STATUS_DATA(0x83) + LEN_H(1) + LEN_L(1) + JSON(N)
-  enterTransmitMode();
-  delayMicroseconds(TURNAROUND_US);
-  
-  // 응답 코드 전송
-  rs485.write((uint8_t)ACK_STATUS_DATA);
-  
-  // 길이 헤더 전송 (2바이트, big-endian)
-  rs485.write((uint8_t)((jsonLen >> 8) & 0xFF)); // 상위 바이트
-  rs485.write((uint8_t)(jsonLen & 0xFF));       // 하위 바이트
-  
-  // JSON 데이터 전송
-  for (size_t i = 0; i < jsonLen; i++) {
-    rs485.write((uint8_t)jsonBuffer[i]);
-  }
-  rs485.flush();
-  wait_tx_done_by_time(jsonLen + 3); // ACK + LEN(2) + JSON
-  
-  enterReceiveMode();
+    frame[11] = (uint8_t)(timeToNextActivation / 3600000);
+    frame[12] = (uint8_t)((timeToNextActivation % 3600000) / 60000);
+    frame[13] = (uint8_t)((timeToNextActivation % 60000) / 1000);
+  }
+  
+  // 센서 데이터 (정수 스케일)
+  uint16_t phX100 = (pH_Value > 0) ? (uint16_t)(pH_Value * 100.0f + 0.5f) : 0;
+  uint16_t ecUs = (ecValue > 0) ? (uint16_t)min(ecValue + 0.5f, 65535.0f) : 0;
+  int16_t tempX10 = (int16_t)(waterTemp * 10.0f + (waterTemp >= 0 ? 0.5f : -0.5f));
+  frame[14] = (uint8_t)(phX100 >> 8);
+  frame[15] = (uint8_t)(phX100 & 0xFF);
+  frame[16] = (uint8_t)(ecUs >> 8);
+  frame[17] = (uint8_t)(ecUs & 0xFF);
+  frame[18] = (uint8_t)((uint16_t)tempX10 >> 8);
+  frame[19] = (uint8_t)((uint16_t)tempX10 & 0xFF);
+  
+  // ========== 링크 프레임: TYPE = ACK_STATUS_BIN(0x84), 페이로드 = [1..21] (무결성은 링크 CRC) ==========
+  sendLinkFrame(frame[0], rxSeq, frame + 1, STATUS_PAYLOAD_LEN);
 }
 
-  // 🔥 비트연산 다중 릴레이 제어 함수 (메모리 최적화: String 제거)
+  // 🔥 비트연산 다중 릴레이 제어 함수 (구형 8비트 프레임 호환, 메모리 최적화: String 제거)
 void processMultiRelayCommand(uint8_t cmd, uint8_t bitmask) {
-  for (int i = 0; i < numPins; i++) {
-    bool shouldTurnOn = (bitmask & (1 << i)) != 0;
-    bool currentState = getRelayStatus(i);
-    
-    if (cmd == CMD_MULTI_ON && shouldTurnOn) {
-      if (!currentState) {
-        setRelay(i, HIGH);
-      }
-    } else if (cmd == CMD_MULTI_OFF && shouldTurnOn) {
-      if (currentState) {
-        setRelay(i, LOW);
-      }
-    }
-  }
+  applyRelayMask(cmd == CMD_MULTI_ON ? bitmask : 0, cmd == CMD_MULTI_OFF ? bitmask : 0);
   
   // ACK 전송
   sendAck(ACK_OK);
 }
+
+// 🔥 다중 릴레이 원자 적용: 페이로드 SET_H + SET_L + CLR_H + CLR_L
+// 같은 채널이 SET/CLEAR 양쪽에 있거나 범위 밖 채널이면 아무것도 바꾸지 않고 ACK_ERROR
+void processMultiSetCommand(const uint8_t* payload) {
+  uint16_t setMask = ((uint16_t)payload[0] << 8) | payload[1];
+  uint16_t clearMask = ((uint16_t)payload[2] << 8) | payload[3];
+  uint16_t validMask = (uint16_t)((1UL << numPins) - 1);
+  
+  if ((setMask & clearMask) != 0 || ((setMask | clearMask) & ~validMask) != 0) {
+    sendAck(ACK_ERROR);
+    return;
+  }
+  applyRelayMask(setMask, clearMask);
+  sendAck(ACK_OK);
+}
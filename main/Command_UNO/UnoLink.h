@@ -0,0 +1,152 @@
+#pragma once
+
+// ============= Mega ↔ Command_UNO 제어 링크 프레임 (Serial3 RS485) =============
+// Mega / Command_UNO 공용 모듈
+// Arduino 스케치 폴더 제약으로 각 스케치 폴더에 동일한 파일을 두며, 수정 시 함께 갱신할 것
+//
+// [SYNC0 0xA5][SYNC1 0x5A][TYPE][SEQ][LEN][PAYLOAD × LEN][CRC16 하위][CRC16 상위]
+// - CRC16(Modbus)은 SYNC0부터 PAYLOAD 끝까지. 프레임 전체 누적 잔여값 0이면 정상
+// - TYPE: 요청은 CMD_*, 응답은 ACK_*, UNO 자발 알림은 ULINK_HELLO
+// - SEQ: 요청 순번 (1~255). 응답은 요청 SEQ를 그대로 에코, 자발 알림은 0
+// - 같은 버스의 NPN Modbus RTU 프레임은 SYNC/LEN/CRC 검사에서 걸러짐
+//
+// 수신은 헌팅 프레이머: 바이트를 ulinkFeed()로 넣고 ulinkScan()으로 완성 프레임을 꺼냄
+// SYNC/LEN이 그럴듯하지 않거나 CRC가 틀리면 1바이트씩 밀며 재동기 (뒤따르는 정상 프레임 보존)
+// 프레임 중간에 ULINK_GAP_MS 이상 무음이면 ulinkFlushStale()로 미완성 앞부분을 버림
+
+#include <stdint.h>
+#include <string.h>
+#include "ModbusCRC.h"
+
+#define ULINK_SYNC0        0xA5
+#define ULINK_SYNC1        0x5A
+#define ULINK_HEADER_LEN   5
+#define ULINK_OVERHEAD     (ULINK_HEADER_LEN + 2)
+#define ULINK_PAYLOAD_MAX  100   // nutCycle TLV(96) 수용
+#define ULINK_FRAME_MAX    (ULINK_PAYLOAD_MAX + ULINK_OVERHEAD)
+#define ULINK_GAP_MS       5     // 57600bps 바이트 시간(0.17ms)의 수십 배 - 프레임 내부 무음 한계
+#define ULINK_HELLO        0x90  // UNO → Mega 존재 알림 (페이로드 없음)
+
+// 헤더 5바이트 작성
+static inline void ulinkHeader(uint8_t *out, uint8_t type, uint8_t seq, uint8_t len)
+{
+  out[0] = ULINK_SYNC0;
+  out[1] = ULINK_SYNC1;
+  out[2] = type;
+  out[3] = seq;
+  out[4] = len;
+}
+
+// 헤더 + 페이로드 CRC (본문을 별도 버퍼로 보내는 송신부용)
+static inline uint16_t ulinkCrc(const uint8_t *header, const uint8_t *payload, uint8_t len)
+{
+  return crc16Block(payload, len, crc16Block(header, ULINK_HEADER_LEN));
+}
+
+// 완성 프레임 작성: out은 ULINK_OVERHEAD + len 바이트 이상. 프레임 길이 반환 (len 초과 시 0)
+static inline uint8_t ulinkEncode(uint8_t *out, uint8_t type, uint8_t seq, const uint8_t *payload, uint8_t len)
+{
+  if (len > ULINK_PAYLOAD_MAX) return 0;
+  ulinkHeader(out, type, seq, len);
+  if (len) memcpy(out + ULINK_HEADER_LEN, payload, len);
+  uint16_t crc = crc16Block(out, ULINK_HEADER_LEN + len);
+  out[ULINK_HEADER_LEN + len] = (uint8_t)(crc & 0xFF);
+  out[ULINK_HEADER_LEN + len + 1] = (uint8_t)(crc >> 8);
+  return ULINK_OVERHEAD + len;
+}
+
+struct ULinkStats {
+  uint16_t framesOk;      // CRC 통과 프레임
+  uint16_t crcFail;       // SYNC/LEN은 맞았으나 CRC 실패
+  uint16_t resyncShifts;  // 재동기를 위해 1바이트 민 횟수
+  uint16_t staleFlush;    // 프레임 중간 무음으로 버린 횟수
+  uint16_t overflow;      // 버퍼 초과로 버린 바이트
+};
+
+struct ULinkParser {
+  uint8_t buf[ULINK_FRAME_MAX];
+  uint8_t len;
+  uint8_t crcLen;         // buf[0..crcLen) 누적 완료
+  uint16_t crc;
+  ULinkStats stats;
+};
+
+static inline void ulinkReset(ULinkParser &p)
+{
+  p.len = 0;
+  p.crcLen = 0;
+  p.crc = CRC16_MODBUS_INIT;
+}
+
+// 앞에서 n바이트 버림 (CRC는 남은 바이트로 다시 누적)
+static inline void ulinkDrop(ULinkParser &p, uint8_t n)
+{
+  if (n > p.len) n = p.len;
+  uint8_t remain = p.len - n;
+  if (remain > 0) memmove(p.buf, p.buf + n, remain);
+  p.len = remain;
+  p.crcLen = 0;
+  p.crc = CRC16_MODBUS_INIT;
+}
+
+static inline void ulinkFeed(ULinkParser &p, uint8_t b)
+{
+  if (p.len >= sizeof(p.buf)) {
+    p.stats.overflow++;
+    ulinkDrop(p, 1);
+  }
+  p.buf[p.len++] = b;
+}
+
+// 완성 프레임이 버퍼 앞에 있으면 길이 반환 (처리 후 ulinkDrop(p, n)), 없으면 0
+static inline uint8_t ulinkScan(ULinkParser &p)
+{
+  while (p.len > 0) {
+    if (p.buf[0] != ULINK_SYNC0 ||
+        (p.len >= 2 && p.buf[1] != ULINK_SYNC1) ||
+        (p.len >= ULINK_HEADER_LEN && p.buf[4] > ULINK_PAYLOAD_MAX)) {
+      p.stats.resyncShifts++;
+      ulinkDrop(p, 1);
+      continue;
+    }
+    if (p.len < ULINK_HEADER_LEN) return 0;
+
+    uint8_t frameLen = ULINK_OVERHEAD + p.buf[4];
+    // 도착한 바이트만 프레임 경계까지 누적 → 완성 시 재계산 없이 잔여값만 비교
+    while (p.crcLen < p.len && p.crcLen < frameLen) p.crc = crc16Update(p.crc, p.buf[p.crcLen++]);
+    if (p.len < frameLen) return 0;
+
+    if (p.crc == CRC16_MODBUS_RESIDUE) {
+      p.stats.framesOk++;
+      return frameLen;
+    }
+    p.stats.crcFail++;
+    p.stats.resyncShifts++;
+    ulinkDrop(p, 1);
+  }
+  return 0;
+}
+
+// 무음 구간: 미완성 프레임은 더 이어지지 않으므로 앞에서부터 버리며 남은 바이트에서 프레임 탐색
+// 완성 프레임을 찾으면 길이 반환 (처리 후 ulinkDrop 후 다시 호출), 버퍼가 비면 0
+static inline uint8_t ulinkFlushStale(ULinkParser &p)
+{
+  bool counted = false;
+  while (p.len > 0) {
+    uint8_t n = ulinkScan(p);
+    if (n) return n;
+    if (p.len == 0) break;
+    if (!counted) {
+      p.stats.staleFlush++;
+      counted = true;
+    }
+    ulinkDrop(p, 1);
+  }
+  return 0;
+}
+
+// 프레임 필드 접근
+static inline uint8_t ulinkType(const uint8_t *frame) { return frame[2]; }
+static inline uint8_t ulinkSeq(const uint8_t *frame) { return frame[3]; }
+static inline uint8_t ulinkLen(const uint8_t *frame) { return frame[4]; }
+static inline const uint8_t *ulinkPayload(const uint8_t *frame) { return frame + ULINK_HEADER_LEN; }
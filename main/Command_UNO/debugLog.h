@@ -0,0 +1,23 @@
+#pragma once
+
+// ============= 디버그 출력 (컴파일 타임 선택) =============
+// 하드웨어 USART는 RS485 전용. CMD_UNO_DEBUG=1이면 SoftwareSerial 송신 전용 핀으로 출력
+// SoftwareSerial은 바이트 송신 중 인터럽트를 막으므로 현장 펌웨어는 0 유지 (RS485 수신 오버런 위험)
+#ifndef CMD_UNO_DEBUG
+#define CMD_UNO_DEBUG 0
+#endif
+
+#if CMD_UNO_DEBUG
+#include <SoftwareSerial.h>
+#define DEBUG_RX_PIN 2     // 미사용 (SoftwareSerial 생성자 요구)
+#define DEBUG_TX_PIN 3
+#define DEBUG_BAUD   115200
+extern SoftwareSerial debugSerial;
+#define DBG_BEGIN()      do { debugSerial.begin(DEBUG_BAUD); debugSerial.stopListening(); } while (0)
+#define DBG_PRINT(...)   debugSerial.print(__VA_ARGS__)
+#define DBG_PRINTLN(...) debugSerial.println(__VA_ARGS__)
+#else
+#define DBG_BEGIN()      ((void)0)
+#define DBG_PRINT(...)   ((void)0)
+#define DBG_PRINTLN(...) ((void)0)
+#endif
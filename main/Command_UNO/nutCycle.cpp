@@ -105,199 +105,141 @@ void initNutrientCycle() {
     //Serial.println(F("Nutrient cycle system initialized"));
 }
 
-// ============= JSON 명령 처리 =============
-void processNutrientCommand(const char *jsonCommand) {
-    StaticJsonDocument<160> doc;  // 192 → 160 (메모리 최적화)
-    DeserializationError error = deserializeJson(doc, jsonCommand);
+// ============= 바이너리(TLV) 명령 처리 =============
+
+// STOP: 사이클/펄스/타이머 정지 후 모든 릴레이 OFF (중요 릴레이 자가복구 확인)
+static void stopNutrientCycle() {
+    stopECPulse();
+    stopPHPulse();
+    memset(&pulseFlags, 0, sizeof(pulseFlags));
+    stopIrrigationTimer();
+    stopPhEcCheckTimer();
+    nutSystemFlags.isCycle = false;
+    nutSystemFlags.pumpRunning = false;
+    nutSystemFlags.cycle_started_today = false;
+    nutSystemFlags.scheduleEndRequested = false;
+    cycle = -1;
+    cycleStatus = INACTIVE;
+    manualStartMode = false;
+    memset(&cycleVars, 0, sizeof(cycleVars));
+    scheduleSettings.time_based_enabled = 0;
+    scheduleSettings.once_based_enabled = 0;
+    scheduleSettings.daily_based_enabled = 0;
+    //Serial.println(F("STOP command"));
+    allPinsOff();
+    setPumpStatus(false);
     
-    if (error) {
-        //Serial.print(F("JSON error: "));
-        //Serial.println(error.f_str());
-        return;
+    // STOP 명령 후 자가복구 확인 (중요 릴레이)
+    static const uint8_t criticalChannels[] = {
+        UNO_CH_PUMP, UNO_CH_EC, UNO_CH_EC2, UNO_CH_PH,
+        UNO_CH_BED_A, UNO_CH_BED_B, UNO_CH_BED_C, UNO_CH_BED_D
+    };
+    delay(10); // 하드웨어 안정화
+    bool recoveryNeeded = false;
+    for (uint8_t i = 0; i < sizeof(criticalChannels); i++) {
+        if (getRelayStatus(criticalChannels[i]) != LOW) {
+            setRelay(criticalChannels[i], LOW);
+            recoveryNeeded = true;
+        }
     }
+    if (recoveryNeeded) {
+        //Serial.print(F("STOP recovery -> retrying..."));
+        delay(10);
+    }
+}
+
+static float tlvFloat(const uint8_t *v) {
+    float f;
+    memcpy(&f, v, sizeof(f));  // IEEE754 float32 little-endian (Mega와 동일한 AVR 표현)
+    return f;
+}
+
+// TLV 본문 적용. 형식 오류나 검증 실패 시 아무것도 바꾸지 않고 false
+// 설정/스케줄은 사본에 적용해 검증을 통과한 경우에만 반영
+bool processNutrientCommand(const uint8_t *tlv, uint8_t len) {
+    uint8_t command = 0;
+    const uint8_t *timeValue = nullptr;
+    NutrientSettings newSettings = nutrientSettings;
+    ScheduleSettings newSchedule = scheduleSettings;
+    bool hasSet = false;
+    bool hasSch = false;
     
-    // TIME_SYNC는 로그 출력 생략 (메모리 최적화)
-    
-    // 명령어 확인 (나중에 처리하기 위해 저장)
-    bool hasStartCommand = false;
-    bool hasStopCommand = false;
-    bool hasTimeSync = false;
-    
-    if (doc.containsKey("cmd")) {
-        const char* command = doc["cmd"] | "";
-        if (strcmp_P(command, PSTR("TIME_SYNC")) == 0 && doc.containsKey("time")) {
-            hasTimeSync = true;
-        } else if (strcmp_P(command, PSTR("START")) == 0) {
-            hasStartCommand = true;
-        } else if (strcmp_P(command, PSTR("STOP")) == 0) {
-            hasStopCommand = true;
+    uint8_t pos = 0;
+    while (pos < len) {
+        if (pos + 2 > len) return false;
+        uint8_t tag = tlv[pos];
+        uint8_t vlen = tlv[pos + 1];
+        const uint8_t *v = tlv + pos + 2;
+        if (pos + 2 + vlen > len) return false;
+        pos += 2 + vlen;
+        
+        // 태그별 값 길이 검사: 실수 4바이트, 시간 7바이트, 그 외 1바이트
+        uint8_t expected = (tag >= NUT_TAG_PH && tag <= NUT_TAG_CT) ? 4 : (tag == NUT_TAG_TIME) ? 7 : 1;
+        if (vlen != expected) {
+            if (tag > NUT_TAG_EM) continue;  // 모르는 태그는 건너뜀 (상위 호환)
+            return false;
+        }
+        
+        switch (tag) {
+            case NUT_TAG_CMD:   command = v[0]; break;
+            case NUT_TAG_TIME:  timeValue = v; break;
+            case NUT_TAG_PH:    newSettings.target_ph = tlvFloat(v); hasSet = true; break;
+            case NUT_TAG_EC:    newSettings.target_ec = tlvFloat(v); hasSet = true; break;
+            case NUT_TAG_EP:    newSettings.error_ph = tlvFloat(v); hasSet = true; break;
+            case NUT_TAG_EE:    newSettings.error_ec = tlvFloat(v); hasSet = true; break;
+            case NUT_TAG_ST:    newSettings.supply_time = tlvFloat(v); hasSet = true; break;
+            case NUT_TAG_CT:    newSettings.cycle_time = tlvFloat(v); hasSet = true; break;
+            case NUT_TAG_BED_A: newSettings.bed_a = v[0] ? 1 : 0; hasSet = true; break;
+            case NUT_TAG_BED_B: newSettings.bed_b = v[0] ? 1 : 0; hasSet = true; break;
+            case NUT_TAG_BED_C: newSettings.bed_c = v[0] ? 1 : 0; hasSet = true; break;
+            case NUT_TAG_BED_D: newSettings.bed_d = v[0] ? 1 : 0; hasSet = true; break;
+            case NUT_TAG_TE:    newSchedule.time_based_enabled = v[0] ? 1 : 0; hasSch = true; break;
+            case NUT_TAG_DE:    newSchedule.daily_based_enabled = v[0] ? 1 : 0; hasSch = true; break;
+            case NUT_TAG_OE:    newSchedule.once_based_enabled = v[0] ? 1 : 0; hasSch = true; break;
+            case NUT_TAG_SH:    newSchedule.start_hour = v[0]; hasSch = true; break;
+            case NUT_TAG_SM:    newSchedule.start_minute = v[0]; hasSch = true; break;
+            case NUT_TAG_EH:    newSchedule.end_hour = v[0]; hasSch = true; break;
+            case NUT_TAG_EM:    newSchedule.end_minute = v[0]; hasSch = true; break;
+            default: break;
         }
     }
     
     // TIME_SYNC는 즉시 처리하고 리턴
-    if (hasTimeSync) {
-        const char* timeStr = doc["time"] | "";
-        int y, m, d, h, mi, s;
-        if (sscanf(timeStr, "%d-%d-%d %d:%d:%d", &y, &m, &d, &h, &mi, &s) == 6) {
-            currentHour = h;
-            currentMinute = mi;
-            currentDay = d;
-            currentMonth = m;
-            currentYear = y;
-            nutSystemFlags.timeReceived = true;
-        }
-        return;
+    if (timeValue) {
+        currentYear = ((uint16_t)timeValue[0] << 8) | timeValue[1];
+        currentMonth = timeValue[2];
+        currentDay = timeValue[3];
+        currentHour = timeValue[4];
+        currentMinute = timeValue[5];
+        nutSystemFlags.timeReceived = true;
+        return true;
     }
     
     // STOP 명령은 즉시 처리
-    if (hasStopCommand) {
-        stopECPulse();
-        stopPHPulse();
-        memset(&pulseFlags, 0, sizeof(pulseFlags));
-        stopIrrigationTimer();
-        stopPhEcCheckTimer();
-        nutSystemFlags.isCycle = false;
-        nutSystemFlags.pumpRunning = false;
-        nutSystemFlags.cycle_started_today = false;
-        nutSystemFlags.scheduleEndRequested = false;
-        cycle = -1;
-        cycleStatus = INACTIVE;
-        manualStartMode = false;
-        memset(&cycleVars, 0, sizeof(cycleVars));
-        scheduleSettings.time_based_enabled = 0;
-        scheduleSettings.once_based_enabled = 0;
-        scheduleSettings.daily_based_enabled = 0;
-        //Serial.println(F("STOP command"));
-        allPinsOff();
-        setPumpStatus(false);
-        
-        // STOP 명령 후 자가복구 확인 (중요 릴레이)
-        delay(10); // 하드웨어 안정화
-        bool recoveryNeeded = false;
-        if (getRelayStatus(UNO_CH_PUMP) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_EC) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_EC2) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_PH) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_BED_A) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_BED_B) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_BED_C) != LOW) recoveryNeeded = true;
-        if (getRelayStatus(UNO_CH_BED_D) != LOW) recoveryNeeded = true;
-        
-        if (recoveryNeeded) {
-            //Serial.print(F("STOP recovery: "));
-            if (getRelayStatus(UNO_CH_PUMP) != LOW) {
-                //Serial.print(F("PUMP=H "));
-                setRelay(UNO_CH_PUMP, LOW);
-            }
-            if (getRelayStatus(UNO_CH_EC) != LOW) {
-                //Serial.print(F("EC=H "));
-                setRelay(UNO_CH_EC, LOW);
-            }
-            if (getRelayStatus(UNO_CH_EC2) != LOW) {
-                //Serial.print(F("EC2=H "));
-                setRelay(UNO_CH_EC2, LOW);
-            }
-            if (getRelayStatus(UNO_CH_PH) != LOW) {
-                //Serial.print(F("PH=H "));
-                setRelay(UNO_CH_PH, LOW);
-            }
-            if (getRelayStatus(UNO_CH_BED_A) != LOW) {
-                //Serial.print(F("BED_A=H "));
-                setRelay(UNO_CH_BED_A, LOW);
-            }
-            if (getRelayStatus(UNO_CH_BED_B) != LOW) {
-                //Serial.print(F("BED_B=H "));
-                setRelay(UNO_CH_BED_B, LOW);
-            }
-            if (getRelayStatus(UNO_CH_BED_C) != LOW) {
-                //Serial.print(F("BED_C=H "));
-                setRelay(UNO_CH_BED_C, LOW);
-            }
-            if (getRelayStatus(UNO_CH_BED_D) != LOW) {
-                //Serial.print(F("BED_D=H "));
-                setRelay(UNO_CH_BED_D, LOW);
-            }
-            //Serial.print(F("-> retrying..."));
-            delay(10);
-            
-            // 복구 확인
-            bool allOK = (getRelayStatus(UNO_CH_PUMP) == LOW &&
-                         getRelayStatus(UNO_CH_EC) == LOW &&
-                         getRelayStatus(UNO_CH_EC2) == LOW &&
-                         getRelayStatus(UNO_CH_PH) == LOW &&
-                         getRelayStatus(UNO_CH_BED_A) == LOW &&
-                         getRelayStatus(UNO_CH_BED_B) == LOW &&
-                         getRelayStatus(UNO_CH_BED_C) == LOW &&
-                         getRelayStatus(UNO_CH_BED_D) == LOW);
-            //Serial.println(allOK ? F(" OK") : F(" FAILED"));
-        }
-        
-        // 실제 핀 상태 확인
-        //Serial.print(F("STOP actual: PUMP="));
-        //Serial.print(getRelayStatus(UNO_CH_PUMP) ? F("H") : F("L"));
-        //Serial.print(F(" EC="));
-        //Serial.print(getRelayStatus(UNO_CH_EC) ? F("H") : F("L"));
-        //Serial.print(F(" PH="));
-        //Serial.print(getRelayStatus(UNO_CH_PH) ? F("H") : F("L"));
-        //Serial.print(F(" BED="));
-        //Serial.print(getRelayStatus(UNO_CH_BED_A) ? F("H") : F("L"));
-        //Serial.print(getRelayStatus(UNO_CH_BED_B) ? F("H") : F("L"));
-        //Serial.print(getRelayStatus(UNO_CH_BED_C) ? F("H") : F("L"));
-        //Serial.println(getRelayStatus(UNO_CH_BED_D) ? F("H") : F("L"));
-        //Serial.println(F("STOP complete"));
-        return;
+    if (command == NUT_CMD_STOP) {
+        stopNutrientCycle();
+        return true;
     }
     
-    // 설정값 처리 (START 명령 전에 설정을 먼저 파싱)
-    if (doc.containsKey("set")) {
-        JsonObject settings = doc["set"];
-        if (parseNutrientSettings(settings)) {
-            motorInit(nutrientSettings.cycle_time);
-            // 디버깅 출력
-            //Serial.print(F("Settings: pH="));
-            //Serial.print(nutrientSettings.target_ph);
-            //Serial.print(F(", EC="));
-            //Serial.print(nutrientSettings.target_ec);
-            //Serial.print(F(", EP="));
-            //Serial.print(nutrientSettings.error_ph);
-            //Serial.print(F(", EE="));
-            //Serial.print(nutrientSettings.error_ec);
-            //Serial.print(F(", ST="));
-            //Serial.print(nutrientSettings.supply_time);
-            //Serial.print(F(", CT="));
-            //Serial.print(nutrientSettings.cycle_time);
-            //Serial.print(F(", Beds="));
-            //Serial.print(nutrientSettings.bed_a);
-            //Serial.print(nutrientSettings.bed_b);
-            //Serial.print(nutrientSettings.bed_c);
-            //Serial.println(nutrientSettings.bed_d);
-        }
+    // 설정값/스케줄 검증 후 반영 (START 명령 전에 설정을 먼저 적용)
+    if (hasSet && !intervalValidation(newSettings.supply_time, newSettings.cycle_time * 60.0f)) {
+        return false;
     }
-    
-    // 스케줄 처리
-    if (doc.containsKey("sch")) {
-        JsonObject schedule = doc["sch"];
-        if (parseScheduleSettings(schedule)) {
-            // 디버깅 출력
-            //Serial.print(F("Schedule: "));
-            //Serial.print(scheduleSettings.start_hour);
-            //Serial.print(F(":"));
-            //Serial.print(scheduleSettings.start_minute);
-            //Serial.print(F("-"));
-            //Serial.print(scheduleSettings.end_hour);
-            //Serial.print(F(":"));
-            //Serial.print(scheduleSettings.end_minute);
-            //Serial.print(F(", TE="));
-            //Serial.print(scheduleSettings.time_based_enabled);
-            //Serial.print(F(", OE="));
-            //Serial.print(scheduleSettings.once_based_enabled);
-            //Serial.print(F(", DE="));
-            //Serial.println(scheduleSettings.daily_based_enabled);
-        }
+    if (hasSch && !periodValidation(newSchedule.start_hour, newSchedule.start_minute,
+                                    newSchedule.end_hour, newSchedule.end_minute)) {
+        return false;
+    }
+    if (hasSet) {
+        nutrientSettings = newSettings;
+        nutrientSettings.last_updated = millis();
+        motorInit(nutrientSettings.cycle_time);
+    }
+    if (hasSch) {
+        scheduleSettings = newSchedule;
     }
     
-    // START 명령 처리 (설정 파싱 후)
-    if (hasStartCommand) {
+    // START 명령 처리 (설정 적용 후)
+    if (command == NUT_CMD_START) {
         if (!nutSystemFlags.isCycle) {
             manualStartMode = true;
             nutSystemFlags.scheduleEndRequested = false;
@@ -306,11 +248,11 @@ void processNutrientCommand(const char *jsonCommand) {
         } else {
             //Serial.println(F("Cycle already running, ignoring START"));
         }
-        return; // START 명령 처리 후 리턴
+        return true; // START 명령 처리 후 리턴
     }
     
     // 설정이 변경된 경우 자동 시작 로직 (START 명령이 없는 경우)
-    if (doc.containsKey("set") || doc.containsKey("sch")) {
+    if (hasSet || hasSch) {
         manualStartMode = false;
         
         if (scheduleSettings.once_based_enabled) {
@@ -345,104 +287,7 @@ void processNutrientCommand(const char *jsonCommand) {
             }
         }
     }
-}
-
-// ============= JSON 파싱 헬퍼 함수들 =============
-bool parseNutrientSettings(JsonObject &json) {
-    bool changed = false;
-    
-    if (json.containsKey("ph")) {
-        nutrientSettings.target_ph = json["ph"].as<float>();
-        changed = true;
-    }
-    if (json.containsKey("ec")) {
-        nutrientSettings.target_ec = json["ec"].as<float>();
-        changed = true;
-    }
-    if (json.containsKey("ep")) {
-        nutrientSettings.error_ph = json["ep"].as<float>();
-        changed = true;
-    }
-    if (json.containsKey("ee")) {
-        nutrientSettings.error_ec = json["ee"].as<float>();
-        changed = true;
-    }
-    if (json.containsKey("st")) {
-        nutrientSettings.supply_time = json["st"].as<float>();
-        changed = true;
-    }
-    if (json.containsKey("ct")) {
-        nutrientSettings.cycle_time = json["ct"].as<float>();
-        changed = true;
-    }
-    if (json.containsKey("a")) {
-        nutrientSettings.bed_a = json["a"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    if (json.containsKey("b")) {
-        nutrientSettings.bed_b = json["b"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    if (json.containsKey("c")) {
-        nutrientSettings.bed_c = json["c"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    if (json.containsKey("d")) {
-        nutrientSettings.bed_d = json["d"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    
-    if (changed) {
-        float cycle_time_minutes = nutrientSettings.cycle_time * 60.0f;
-        if (!intervalValidation(nutrientSettings.supply_time, cycle_time_minutes)) {
-            return false;
-        }
-        nutrientSettings.last_updated = millis();
-    }
-    
-    return changed;
-}
-
-bool parseScheduleSettings(JsonObject &json) {
-    bool changed = false;
-    
-    if (json.containsKey("te")) {
-        scheduleSettings.time_based_enabled = json["te"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    if (json.containsKey("de")) {
-        scheduleSettings.daily_based_enabled = json["de"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    if (json.containsKey("sh")) {
-        scheduleSettings.start_hour = json["sh"].as<int>();
-        changed = true;
-    }
-    if (json.containsKey("sm")) {
-        scheduleSettings.start_minute = json["sm"].as<int>();
-        changed = true;
-    }
-    if (json.containsKey("eh")) {
-        scheduleSettings.end_hour = json["eh"].as<int>();
-        changed = true;
-    }
-    if (json.containsKey("em")) {
-        scheduleSettings.end_minute = json["em"].as<int>();
-        changed = true;
-    }
-    if (json.containsKey("oe")) {
-        scheduleSettings.once_based_enabled = json["oe"].as<int>() ? 1 : 0;
-        changed = true;
-    }
-    
-    if (changed) {
-        if (!periodValidation(scheduleSettings.start_hour, scheduleSettings.start_minute,
-                              scheduleSettings.end_hour, scheduleSettings.end_minute)) {
-            return false;
-        }
-    }
-    
-    return changed;
+    return true;
 }
 
 bool periodValidation(int startHour, int startMinute, int endHour, int endMinute) {
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
 
 #define UNO_CH_BED_A   0
 #define UNO_CH_BED_B   1
@@ -14,6 +13,32 @@
 #define UNO_CH_PUMP    8
 #define UNO_CH_NULL2   9
 
+// ============= nutCycle 바이너리 설정 프레임 (Mega modbusHandler.h와 동일) =============
+// 링크 프레임 TYPE = CMD_NUTCYCLE_BIN(0x35), 페이로드 = TLV 나열 (최대 NUT_TLV_MAX, 프레임 형식은 UnoLink.h)
+// TLV: TAG(1) + LEN(1) + VALUE. 실수는 IEEE754 float32 little-endian, 연도는 big-endian
+#define NUT_TLV_MAX    96
+#define NUT_TAG_CMD    0x01  // u8: NUT_CMD_START / NUT_CMD_STOP
+#define NUT_TAG_TIME   0x02  // 7바이트: 연(2) 월 일 시 분 초
+#define NUT_TAG_PH     0x10  // f32 목표 pH
+#define NUT_TAG_EC     0x11  // f32 목표 EC
+#define NUT_TAG_EP     0x12  // f32 pH 허용 오차(%)
+#define NUT_TAG_EE     0x13  // f32 EC 허용 오차(%)
+#define NUT_TAG_ST     0x14  // f32 관수시간(분)
+#define NUT_TAG_CT     0x15  // f32 주기시간(시간)
+#define NUT_TAG_BED_A  0x16  // u8
+#define NUT_TAG_BED_B  0x17
+#define NUT_TAG_BED_C  0x18
+#define NUT_TAG_BED_D  0x19
+#define NUT_TAG_TE     0x20  // u8 시간대 스케줄 사용
+#define NUT_TAG_DE     0x21  // u8 매일 스케줄 사용
+#define NUT_TAG_OE     0x22  // u8 1회 실행
+#define NUT_TAG_SH     0x23  // u8 시작 시
+#define NUT_TAG_SM     0x24  // u8 시작 분
+#define NUT_TAG_EH     0x25  // u8 종료 시
+#define NUT_TAG_EM     0x26  // u8 종료 분
+#define NUT_CMD_START  1
+#define NUT_CMD_STOP   2
+
 #define PH_EC_CHECK_INTERVAL 90000  // 90초 간격
 #define PULSE_DURATION_MS 2000UL     // 펄스 토글 주기(2초)
 
@@ -151,7 +176,7 @@ bool getPumpStatus();
 // ============= 함수 선언 =============
 // 양액 사이클 메인 함수들
 void initNutrientCycle();
-void processNutrientCommand(const char* jsonCommand);
+bool processNutrientCommand(const uint8_t* tlv, uint8_t len);  // TLV 본문 적용 (실패 시 변경 없음)
 void startNewCycle();
 void updateCycle();
 void checkCycleRestart();
@@ -192,10 +217,6 @@ int getCurrentTimeInMinutes();
 int getTimeInMinutes(int hour, int minute);
 void checkDailyReset();
 
-// JSON 처리 헬퍼 함수들
-bool parseNutrientSettings(JsonObject& json);
-bool parseScheduleSettings(JsonObject& json);
-
 // 유틸리티 함수들
 void motorInit(float cycleTime);
 bool periodValidation(int startHour, int startMinute, int endHour, int endMinute);
@@ -0,0 +1,61 @@
+#include "rs485Port.h"
+#include <avr/interrupt.h>
+
+HardwareSerial& rs485 = Serial;
+
+static volatile uint8_t* deOut;
+static uint8_t deMask;
+static volatile bool txActive = false;
+
+void rs485Begin(uint32_t baud) {
+  deOut = portOutputRegister(digitalPinToPort(RS485_DE_RE_PIN));
+  deMask = digitalPinToBitMask(RS485_DE_RE_PIN);
+  pinMode(RS485_DE_RE_PIN, OUTPUT);
+  digitalWrite(RS485_DE_RE_PIN, LOW);  // 수신 대기
+  txActive = false;
+  rs485.begin(baud);
+}
+
+void rs485BeginTx() {
+  uint8_t oldSREG = SREG;
+  cli();
+  if (txActive) {
+    // 직전 프레임 송신 중 - DE 유지, 완료 인터럽트만 보류
+    UCSR0B &= ~_BV(TXCIE0);
+    SREG = oldSREG;
+    return;
+  }
+  SREG = oldSREG;
+
+  delayMicroseconds(RS485_REPLY_GAP_US);
+
+  cli();
+  *deOut |= deMask;
+  txActive = true;
+  SREG = oldSREG;
+}
+
+void rs485EndTx() {
+  // 이미 송출이 끝났다면 TXC 플래그가 남아 있어 즉시 인터럽트 발생
+  uint8_t oldSREG = SREG;
+  cli();
+  UCSR0B |= _BV(TXCIE0);
+  SREG = oldSREG;
+}
+
+bool rs485TxBusy() {
+  return txActive;
+}
+
+void rs485WaitTxDone() {
+  while (txActive) {
+  }
+}
+
+// 송신 완료: 링버퍼에 남은 바이트가 있으면(UDRIE 활성) 마지막 바이트 뒤에 다시 발생
+ISR(USART_TX_vect) {
+  if (UCSR0B & _BV(UDRIE0)) return;
+  *deOut &= ~deMask;
+  UCSR0B &= ~_BV(TXCIE0);
+  txActive = false;
+}
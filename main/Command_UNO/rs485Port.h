@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+// ============= RS485 하드웨어 USART 포트 =============
+// RO->D0(RXD), DI->D1(TXD), DE와 /RE를 묶어 RS485_DE_RE_PIN에 연결
+// - 송수신 버퍼/인터럽트는 코어 HardwareSerial(Serial) 사용
+// - DE/RE는 TXC 인터럽트(마지막 스톱 비트 송출 완료)에서 해제 → 바이트 시간 근사 대기 없음
+// - 송신 중에는 Serial.flush() 사용 금지 (TXC 플래그를 ISR이 소비하므로 대기가 끝나지 않음)
+//   송신 완료 대기가 필요하면 rs485WaitTxDone() 사용
+// - D0/D1은 USB-시리얼과 공유: 스케치 업로드 시 RS485 모듈의 RO를 분리할 것
+
+#define RS485_DE_RE_PIN    A1
+#define RS485_REPLY_GAP_US 300   // Mega는 TXC ISR에서 DE 해제 (수 us) - 트랜시버 전환 여유를 두고 응답 시작
+
+extern HardwareSerial& rs485;
+
+void rs485Begin(uint32_t baud);
+void rs485BeginTx();     // DE=1 (직전 프레임 송신 중이면 이어붙임)
+void rs485EndTx();       // 버퍼가 비고 마지막 바이트 송출이 끝나면 ISR이 DE=0
+bool rs485TxBusy();
+void rs485WaitTxDone();
@@ -73,6 +73,12 @@ extern const unsigned long NETWORK_RECOVERY_TIMEOUT;
 extern const unsigned long MQTT_FAILURE_TIMEOUT;
 extern const unsigned long BOOT_TIMEOUT;
 
+// ================== MQTT 버퍼 ==================
+// 센서/양액 상태/명령 응답은 beginPublish()로 스트리밍하므로 PubSubClient 버퍼는
+// 수신 명령(mqttCallback)과 짧은 문자열 ACK만 담으면 됨 - 센서 수와 무관
+#define MQTT_RX_PAYLOAD_MAX  512                        // 수신 명령 JSON 최대 길이
+#define MQTT_BUFFER_SIZE     (MQTT_RX_PAYLOAD_MAX + 64) // + 고정 헤더/토픽
+
 // ================== 네오픽셀 LED ==================
 #define NEOPIXEL_PIN         4   // 네오픽셀 데이터 핀 (D4)
 #define NEOPIXEL_COUNT       1   // 네오픽셀 개수 (단일 LED)
@@ -0,0 +1,48 @@
+#pragma once
+
+// ============= Modbus RTU CRC16 (다항식 0xA001, 초기값 0xFFFF) =============
+// Mega / Sensor_UNO / Command_UNO 공용 모듈
+// Arduino 스케치 폴더 제약으로 각 스케치 폴더에 동일한 파일을 두며, 수정 시 함께 갱신할 것
+//
+// 스트리밍 사용법: 수신 바이트마다 crc16Update()로 누적
+// [data...][crcLo][crcHi] 전체를 누적하면 정상 프레임은 잔여값이 0 → 프레임 끝에서 O(1) 검증
+// 구현 선택 근거는 main/bench/crc16_bench.cpp 참고
+
+#include <stdint.h>
+#if defined(__AVR__)
+#include <util/crc16.h>
+#endif
+
+#define CRC16_MODBUS_INIT    0xFFFF
+#define CRC16_MODBUS_RESIDUE 0x0000  // CRC 포함 전체 누적 시 정상 프레임 잔여값
+
+// 1바이트 누적
+static inline uint16_t crc16Update(uint16_t crc, uint8_t data)
+{
+#if defined(__AVR__)
+  // avr-libc 인라인 어셈블리: 테이블 없이 23사이클
+  return _crc16_update(crc, data);
+#else
+  crc ^= data;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x0001) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+#endif
+}
+
+// 버퍼 전체 계산 (송신 프레임 생성용)
+static inline uint16_t crc16Block(const uint8_t *buf, uint16_t len, uint16_t crc = CRC16_MODBUS_INIT)
+{
+  for (uint16_t i = 0; i < len; i++) crc = crc16Update(crc, buf[i]);
+  return crc;
+}
+
+// 프레임 끝에 CRC 2바이트(Lo, Hi) 추가 후 전체 길이 반환
+static inline uint16_t crc16Append(uint8_t *buf, uint16_t len)
+{
+  uint16_t crc = crc16Block(buf, len);
+  buf[len++] = (uint8_t)(crc & 0xFF);
+  buf[len++] = (uint8_t)(crc >> 8);
+  return len;
+}
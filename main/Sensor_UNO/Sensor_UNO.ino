@@ -66,6 +66,7 @@
 #include <Wire.h>
 #include <SoftwareSerial.h>
 #include <string.h>
+#include "ModbusCRC.h"
 #define FLASHSTR(ptr) (reinterpret_cast<const __FlashStringHelper*>(ptr))
 
 #if ENABLE_TSL2591
@@ -120,6 +121,44 @@
 // HELLO 송신 제어 (최초 정상 응답 이후 중단)
 static bool gHelloDone = false;
 
+// ============= Serial1 TDMA 슬롯 푸시 (Mega 동기 비콘 기준) =============
+// Mega가 사이클 시작마다 [0x00][0x44][slotMsHi][slotMsLo][slotCount][seq][CRC] 비콘을 브로드캐스트
+// 동기 상태에서는 gUnoId 번째 슬롯에서만 푸시 → UNO 간 충돌 없음 (Mega modbusHandler.h의 TDMA_* 참고)
+// 비콘이 없거나 ID 미할당이면 기존 3초 자유 주기 푸시로 동작
+#define TDMA_SYNC_FC              0x44
+#define TDMA_TX_GUARD_MS          40    // 슬롯 끝 보호 (loop 지터 + 비콘 검출 지연 + 프레임 길이)
+#define TDMA_SYNC_LOSS_CYCLES     3     // 비콘을 이 사이클 수만큼 못 받으면 자유 주기로 복귀
+#define TDMA_BEACON_MAX_LATENCY_MS 25   // 이보다 늦게 읽은 비콘은 시각 기준으로 쓰지 않음
+#define LEGACY_PUSH_INTERVAL_MS   3000
+
+// 예외 보고(report-by-exception): 값이 타입별 데드밴드를 넘거나 최대 무전송 시간이 지났을 때만 푸시
+// 데드밴드/무전송 시간은 SENSOR_TYPE_PROFILES 참고. 0이면 매 주기 전체 전송 (기존 동작)
+#define PUSH_REPORT_BY_EXCEPTION  1
+#define PUSH_DEFAULT_MAX_SILENCE_S 10  // 프로파일 포함 최댓값은 Mega UNO_PUSH_MAX_SILENCE_MS 이하로 (슬롯 대여/캐시 TTL 기준)
+#define MAX_PUSH_REGS             10    // 가장 긴 푸시 (강우센서 10 레지스터)
+
+struct TdmaSync {
+  unsigned long epochMs;        // 비콘 수신 시각 = 사이클 시작
+  unsigned long lastBeaconMs;   // 마지막 비콘 수신 (동기 유지 판단)
+  uint16_t slotMs;
+  uint8_t slotCount;
+  uint8_t seq;                  // epoch 비콘의 사이클 번호
+  bool synced;
+};
+static TdmaSync gTdma = { 0, 0, 0, 0, 0, false };
+
+// 푸시 프레임은 슬롯 전에 미리 만들어 두고 슬롯 시작에 송신만 수행 (센서 읽기 시간 제외)
+static uint8_t gPushFrame[32];
+static uint8_t gPushFrameLen = 0;
+static bool gPushDeferred = false;   // true면 sendModbusResponse()가 송신 대신 gPushFrame에 저장
+static uint8_t gPushLastCycle = 0xFF;
+
+// 마지막으로 실제 전송한 푸시 (데드밴드 비교 기준)
+static uint16_t gLastPushRegs[MAX_PUSH_REGS];
+static uint8_t gLastPushRegCount = 0;
+static uint8_t gLastPushSlaveId = 0;
+static unsigned long gLastPushMs = 0;
+
 // ============= Phase 2: 랜덤 UNO ID 시스템 =============
 // 부팅 시 자동으로 랜덤 ID 생성 (0~7)
 // 사용자 설정 불필요, 모든 UNO에 동일한 펌웨어 업로드 가능!
@@ -561,6 +600,7 @@ void readADS1115(SensorData* sensor);
 void readDS18B20(SensorData* sensor);
 void sendI2CSensorData(SensorData* sensor, uint16_t startAddr, uint16_t regCount);
 void sendModbusSensorData(SensorData* sensor, uint16_t startAddr, uint16_t regCount);
+void transmitToMega(const uint8_t* frame, uint8_t len);
 static void refreshModbusSensor(SensorData* sensor);
 void parseModbusData(SensorData* sensor);
 
@@ -1107,19 +1147,57 @@ bool isI2CSensor(SensorType type) {
 }
 
 // Modbus 센서의 레지스터 개수 반환
-uint16_t getModbusRegisterCount(SensorType type) {
-  switch(type) {
-    case SENSOR_SOIL: return 8;
-    case SENSOR_WIND_DIRECTION: return 2;
-    case SENSOR_WIND_SPEED: return 1;
-    case SENSOR_RAIN_SNOW: return 10;
-    case SENSOR_TEMP_HUMID: return 2;
-    case SENSOR_PRESSURE: return 2;
-    case SENSOR_FLOW: return 2;
-    case SENSOR_RELAY: return 1;
-    case SENSOR_ENERGY_METER: return 5;
-    default: return 2; // 기본값
+// ============= 타입별 푸시 프로파일 (레지스터 수 / 예외 보고 데드밴드) =============
+// deadband는 전송 레지스터의 원시 단위 (스케일 적용 후 값), 0 = 값이 바뀌면 항상 전송
+// 레지스터 8번 이후는 0으로 취급. maxSilenceS마다 변화가 없어도 전송 (Mega 생존 판단/캐시 TTL용)
+struct SensorTypeProfile {
+  uint8_t type;
+  uint8_t regCount;
+  uint8_t maxSilenceS;
+  uint16_t deadband[8];
+};
+
+static const SensorTypeProfile SENSOR_TYPE_PROFILES[] PROGMEM = {
+  // 습도%, 온도×10(0.1°C), EC uS/cm(0.02dS/m), pH×10, N, P, K (mg/kg), 상태
+  { SENSOR_SOIL,           8, 10, { 1, 1, 20, 1, 5, 5, 5, 0 } },
+  { SENSOR_WIND_DIRECTION, 2, 10, { 0, 5 } },                    // 기어, 각도(5°)
+  { SENSOR_WIND_SPEED,     1, 10, { 2 } },
+  { SENSOR_RAIN_SNOW,     10, 10, { 0, 0, 0, 2, 2, 5 } },         // 강우/강설 플래그는 즉시
+  { SENSOR_TEMP_HUMID,     2, 10, { 1, 1 } },
+  { SENSOR_PRESSURE,       2, 10, { 1, 1 } },
+  { SENSOR_FLOW,           2, 10, { 1, 0 } },
+  { SENSOR_RELAY,          1, 10, { 0 } },
+  { SENSOR_ENERGY_METER,   5, 10, { 1, 1, 1, 1, 1 } },
+  { SENSOR_SHT20,          2, 10, { 10, 50 } },                   // 0.1°C, 0.5%RH (×100)
+  { SENSOR_SCD41,          2, 10, { 10 } },                       // 10 ppm
+  { SENSOR_TSL2591,        2, 10, { 10 } },                       // 10 lux
+  { SENSOR_BH1750,         2, 10, { 10 } },
+  { SENSOR_ADS1115,        2, 10, { 5, 2 } },                     // pH 0.05, EC 0.02 dS/m (×100)
+  { SENSOR_DS18B20,        2, 10, { 10 } },                       // 0.1°C (×100)
+};
+#define SENSOR_TYPE_PROFILE_COUNT (sizeof(SENSOR_TYPE_PROFILES) / sizeof(SENSOR_TYPE_PROFILES[0]))
+
+static const SensorTypeProfile* findSensorTypeProfile(SensorType type) {
+  for (uint8_t i = 0; i < SENSOR_TYPE_PROFILE_COUNT; i++) {
+    if (pgm_read_byte(&SENSOR_TYPE_PROFILES[i].type) == (uint8_t)type) return &SENSOR_TYPE_PROFILES[i];
   }
+  return nullptr;
+}
+
+uint16_t getModbusRegisterCount(SensorType type) {
+  const SensorTypeProfile* p = findSensorTypeProfile(type);
+  return p ? pgm_read_byte(&p->regCount) : 2; // 기본값
+}
+
+uint16_t getPushDeadband(SensorType type, uint8_t reg) {
+  const SensorTypeProfile* p = findSensorTypeProfile(type);
+  if (!p || reg >= 8) return 0;
+  return pgm_read_word(&p->deadband[reg]);
+}
+
+uint32_t getPushMaxSilenceMs(SensorType type) {
+  const SensorTypeProfile* p = findSensorTypeProfile(type);
+  return (uint32_t)(p ? pgm_read_byte(&p->maxSilenceS) : PUSH_DEFAULT_MAX_SILENCE_S) * 1000UL;
 }
 
 // ============= Phase 1: 타입 코드 매핑 함수 =============
@@ -1637,14 +1715,17 @@ bool sendModbusRequest(uint8_t slaveAddr, uint8_t functionCode,
   RS485_SENS_RX();
   delayMicroseconds(RS485_INTERCHAR_US);
   
-  // 응답 수신
+  // 응답 수신 (CRC는 바이트 도착 시 누적)
   uint32_t startTime = millis();
   responseLen = 0;
   uint8_t expectedLen = 0;
+  uint16_t rxCrc = CRC16_MODBUS_INIT;
   
   while (millis() - startTime < timeout) {
     while (modbusSensorSerial.available()) {
-      response[responseLen++] = modbusSensorSerial.read();
+      uint8_t b = modbusSensorSerial.read();
+      response[responseLen++] = b;
+      rxCrc = crc16Update(rxCrc, b);
       
       if (responseLen == 3) {
         uint8_t byteCount = response[2];
@@ -1661,24 +1742,12 @@ bool sendModbusRequest(uint8_t slaveAddr, uint8_t functionCode,
 RX_DONE:
   if (responseLen < 5) return false;
   
-  uint16_t receivedCRC = (response[responseLen - 1] << 8) | response[responseLen - 2];
-  uint16_t calculatedCRC = calcCRC16(response, responseLen - 2);
-  return (receivedCRC == calculatedCRC);
+  // CRC 포함 전체 누적 → 정상 프레임은 잔여값 0
+  return (rxCrc == CRC16_MODBUS_RESIDUE);
 }
 
 uint16_t calcCRC16(const uint8_t* buf, uint8_t len) {
-  uint16_t crc = 0xFFFF;
-  for (uint8_t i = 0; i < len; i++) {
-    crc ^= buf[i];
-    for (uint8_t j = 0; j < 8; j++) {
-      if (crc & 0x0001) {
-        crc = (crc >> 1) ^ 0xA001;
-      } else {
-        crc >>= 1;
-      }
-    }
-  }
-  return crc;
+  return crc16Block(buf, len);
 }
 
 // ============= Modbus RTU 응답 생성 =============
@@ -1718,12 +1787,24 @@ void sendModbusResponse(uint8_t slaveId, uint8_t functionCode, uint8_t* data, ui
   response[responseLen++] = crc & 0xFF;
   response[responseLen++] = (crc >> 8) & 0xFF;
   
-  // RS485 전송 (Mega 통신용) - 송수신 시퀀스
+  // TDMA 푸시: 슬롯이 올 때까지 보관
+  if (gPushDeferred) {
+    if (responseLen <= sizeof(gPushFrame)) {
+      memcpy(gPushFrame, response, responseLen);
+      gPushFrameLen = responseLen;
+    }
+    return;
+  }
+  transmitToMega(response, responseLen);
+}
+
+// RS485 전송 (Mega 통신용) - 송수신 시퀀스
+void transmitToMega(const uint8_t* frame, uint8_t len) {
   RS485_MEGA_TX();
   delayMicroseconds(RS485_TURNAROUND_US);
   
-  for (uint8_t i = 0; i < responseLen; i++) {
-    Serial.write(response[i]);
+  for (uint8_t i = 0; i < len; i++) {
+    Serial.write(frame[i]);
   }
   Serial.flush();
   
@@ -1732,6 +1813,102 @@ void sendModbusResponse(uint8_t slaveId, uint8_t functionCode, uint8_t* data, ui
   delayMicroseconds(RS485_INTERCHAR_US);
 }
 
+// ============= TDMA 동기/슬롯 송신 =============
+// accurate: 비콘 바이트를 지연 없이 읽었는지 (센서 읽기 등으로 loop가 막혔으면 시각 기준으로 쓰지 않음)
+void onTdmaBeacon(const uint8_t* frame, unsigned long rxMs, bool accurate) {
+  uint16_t slotMs = ((uint16_t)frame[2] << 8) | frame[3];
+  uint8_t slotCount = frame[4];
+  if (slotMs < 20 || slotMs > 1000 || slotCount < 3 || slotCount > 16) return;
+  gTdma.lastBeaconMs = rxMs;
+  if (!accurate && gTdma.synced && gTdma.slotMs == slotMs && gTdma.slotCount == slotCount) return;
+  gTdma.epochMs = rxMs;
+  gTdma.slotMs = slotMs;
+  gTdma.slotCount = slotCount;
+  gTdma.seq = frame[5];
+  gTdma.synced = true;
+}
+
+static bool tdmaActive() {
+  if (!gTdma.synced) return false;
+  if (gUnoId == 0 || gUnoId >= gTdma.slotCount - 1) return false;  // 마지막 슬롯은 Mega 전용
+  uint32_t cycleMs = (uint32_t)gTdma.slotMs * gTdma.slotCount;
+  if (millis() - gTdma.lastBeaconMs >= cycleMs * TDMA_SYNC_LOSS_CYCLES) {
+    gTdma.synced = false;
+    gPushFrameLen = 0;
+    return false;
+  }
+  return true;
+}
+
+// 현재 센서 값으로 푸시 프레임 생성 (송신은 하지 않음)
+static void buildPushFrame() {
+  SensorData* s = &sensors[0];
+  gPushDeferred = true;
+  if (isI2CSensor(s->type)) {
+    sendI2CSensorData(s, 0, 2); // 내부에서 최신값 읽고 [T,H] 2레지스터로 응답 프레임 생성
+  } else {
+    sendModbusSensorData(s, 0, getModbusRegisterCount(s->type));
+  }
+  gPushDeferred = false;
+}
+
+// 새로 만든 푸시 프레임을 보낼 가치가 있는지 (마지막 전송 대비 데드밴드 초과 또는 무전송 시간 만료)
+static bool pushFrameChanged() {
+#if PUSH_REPORT_BY_EXCEPTION
+  SensorType type = sensors[0].type;
+  uint8_t regCount = gPushFrame[2] / 2;
+  if (gLastPushRegCount == 0 || regCount != gLastPushRegCount) return true;
+  if (gPushFrame[0] != gLastPushSlaveId) return true;  // ID 재할당
+  if (millis() - gLastPushMs >= getPushMaxSilenceMs(type)) return true;
+  for (uint8_t k = 0; k < regCount; k++) {
+    uint16_t v = ((uint16_t)gPushFrame[3 + k * 2] << 8) | gPushFrame[4 + k * 2];
+    uint16_t diff = v > gLastPushRegs[k] ? v - gLastPushRegs[k] : gLastPushRegs[k] - v;
+    uint16_t band = getPushDeadband(type, k);
+    if (band == 0 ? diff != 0 : diff >= band) return true;
+  }
+  return false;
+#else
+  return true;
+#endif
+}
+
+// 푸시 프레임 송신 + 데드밴드 기준값 갱신
+static void sendPushFrame() {
+  transmitToMega(gPushFrame, gPushFrameLen);
+  uint8_t regCount = gPushFrame[2] / 2;
+  if (regCount > MAX_PUSH_REGS) regCount = MAX_PUSH_REGS;
+  for (uint8_t k = 0; k < regCount; k++) {
+    gLastPushRegs[k] = ((uint16_t)gPushFrame[3 + k * 2] << 8) | gPushFrame[4 + k * 2];
+  }
+  gLastPushRegCount = regCount;
+  gLastPushSlaveId = gPushFrame[0];
+  gLastPushMs = millis();
+  gPushFrameLen = 0;
+}
+
+// 자기 슬롯 이전에 프레임을 준비하고, 슬롯 시작 ~ (끝 - 보호구간) 사이에서만 송신
+static void pushInTdmaSlot() {
+  uint32_t cycleMs = (uint32_t)gTdma.slotMs * gTdma.slotCount;
+  unsigned long elapsed = millis() - gTdma.epochMs;
+  uint8_t cycle = (uint8_t)(gTdma.seq + elapsed / cycleMs);  // 비콘을 놓쳐도 사이클 번호 유지
+  uint16_t pos = (uint16_t)(elapsed % cycleMs);
+  uint16_t slotStart = (uint16_t)gUnoId * gTdma.slotMs;
+  if (cycle == gPushLastCycle) return;
+
+  if (gPushFrameLen == 0 && pos < slotStart) {
+    buildPushFrame();
+    if (gPushFrameLen > 0 && !pushFrameChanged()) {
+      gPushFrameLen = 0;        // 변화 없음: 이번 사이클 슬롯은 비워 둠
+      gPushLastCycle = cycle;
+      return;
+    }
+  }
+  if (gPushFrameLen > 0 && pos >= slotStart && pos < slotStart + gTdma.slotMs - TDMA_TX_GUARD_MS) {
+    sendPushFrame();
+    gPushLastCycle = cycle;
+  }
+}
+
 // Modbus 예외 응답 전송 (함수코드|0x80, 예외코드 1바이트)
 static void sendModbusException(uint8_t slaveId, uint8_t functionCode, uint8_t exceptionCode) {
   uint8_t data[1] = { exceptionCode };
@@ -2123,64 +2300,83 @@ void sendModbusSensorData(SensorData* sensor, uint16_t startAddr, uint16_t regCo
 }
 
 // ============= Modbus RTU 요청 처리 (Mega에서 받은 요청) =============
+// Mega → UNO 요청 길이 (CRC 포함): FC03/비콘 8B, FC 0x11 4B, 그 외 0 (요청 아님)
+#define MODBUS_RX_WINDOW 8
+static uint8_t modbusRequestLength(uint8_t functionCode) {
+  if (functionCode == MODBUS_FUNCTION_READ || functionCode == TDMA_SYNC_FC) return 8;
+  if (functionCode == 0x11) return 4;
+  return 0;
+}
+
+// 수신 창 끝 len바이트가 CRC 정상인 요청 프레임이면 시작 위치, 아니면 nullptr
+static const uint8_t* modbusWindowRequest(const uint8_t* win, uint8_t count, uint8_t len) {
+  if (count < len) return nullptr;
+  const uint8_t* frame = win + MODBUS_RX_WINDOW - len;
+  if (modbusRequestLength(frame[1]) != len || crc16Block(frame, len) != CRC16_MODBUS_RESIDUE) return nullptr;
+  return frame;
+}
+
 void handleModbusRequest() {
-  static uint8_t rxBuffer[256];
-  static uint8_t rxIndex = 0;
-  static unsigned long lastByteTime = 0;
+  // 길이 기반 프레이밍: 마지막 8바이트 창 끝에서 요청 프레임을 찾음
+  // 마스터는 비콘/응답 직후 t3.5(~2ms)만 쉬고 다음 프레임을 보내고, 루프 지연으로 여러 프레임이
+  // 한 번에 읽힐 수 있어 무음 구간으로는 경계를 알 수 없음 (다른 UNO 응답/푸시도 같은 버스에 섞임)
+  static uint8_t rxWindow[MODBUS_RX_WINDOW];
+  static uint8_t rxCount = 0;                 // 창에 유효한 바이트 수
+  static unsigned long lastCallTime = 0;
   unsigned long currentTime = millis();
-  
-  // 바이트 수신 (Mega로부터)
+  unsigned long callGap = currentTime - lastCallTime;
+  lastCallTime = currentTime;
+  // 이번 호출에서 읽은 바이트를 늦게 읽었는지 (TDMA 비콘 시각 정확도)
+  bool rxLate = callGap > TDMA_BEACON_MAX_LATENCY_MS;
+
   while (Serial.available()) {
-    if (rxIndex < sizeof(rxBuffer)) {
-      rxBuffer[rxIndex++] = Serial.read();
-      lastByteTime = currentTime;
-    }
-  }
-  
-  // 프레임 완성 체크 (3.5 문자 시간 = 약 7ms @ 4800bps)
-  if (rxIndex >= 8 && (currentTime - lastByteTime) >= 10) {
-    // CRC 검증
-    uint16_t receivedCRC = (rxBuffer[rxIndex - 1] << 8) | rxBuffer[rxIndex - 2];
-    uint16_t calculatedCRC = calcCRC16(rxBuffer, rxIndex - 2);
-    
-    if (receivedCRC == calculatedCRC) {
+    memmove(rxWindow, rxWindow + 1, MODBUS_RX_WINDOW - 1);
+    rxWindow[MODBUS_RX_WINDOW - 1] = (uint8_t)Serial.read();
+    if (rxCount < MODBUS_RX_WINDOW) rxCount++;
+
+    const uint8_t* rxBuffer = modbusWindowRequest(rxWindow, rxCount, 8);
+    if (!rxBuffer) rxBuffer = modbusWindowRequest(rxWindow, rxCount, 4);
+    if (!rxBuffer) continue;
+    // 처리한 프레임 바이트가 다음 창에 다시 걸리지 않도록 비움
+    rxCount = 0;
+
 #if ENABLE_DEBUG
-      // 디버그: 수신 프레임 요약 (디버그 때만 출력)
-      Serial.print(F("[UNO][RX a=")); Serial.print(rxBuffer[0]); Serial.print(F(" fc=")); Serial.print(rxBuffer[1], HEX); Serial.println(F("]"));
+    // 디버그: 수신 프레임 요약 (디버그 때만 출력)
+    Serial.print(F("[UNO][RX a=")); Serial.print(rxBuffer[0]); Serial.print(F(" fc=")); Serial.print(rxBuffer[1], HEX); Serial.println(F("]"));
 #endif
-      uint8_t slaveId = rxBuffer[0];
-      uint8_t functionCode = rxBuffer[1];
-      
-      // 읽기 요청 처리 (0x03)
-      if (functionCode == MODBUS_FUNCTION_READ) {
-        uint16_t startAddr = (rxBuffer[2] << 8) | rxBuffer[3];
-        uint16_t regCount = (rxBuffer[4] << 8) | rxBuffer[5];
-        
-        // 🔥 요청된 slaveId가 현재 Combined ID와 일치하는지 확인 (gUnoId 업데이트 반영)
-        uint8_t currentCombinedId = (sensorCount > 0) ? getMegaTypeCode(sensors[0].type) : 0;
-        if (slaveId == currentCombinedId || slaveId == sensors[0].slaveId) {
-          // 요청된 센서의 데이터 전송
-          sendSensorDataForSlave(slaveId, startAddr, regCount);
-        }
-      } else if (functionCode == 0x11) {
-        // Modbus Report Slave ID (간단한 하트비트 응답)
-        // 데이터: [idLen][idBytes...] 형식의 단순 페이로드로 응답
-        uint8_t currentCombinedId = (sensorCount > 0) ? getMegaTypeCode(sensors[0].type) : 0;
-        if (sensorCount > 0 && (slaveId == currentCombinedId || slaveId == sensors[0].slaveId)) {
-          const char* id = "UNO_SHT20";
-          uint8_t payload[32];
-          uint8_t n = 0;
-          uint8_t idLen = (uint8_t)strlen(id);
-          payload[n++] = idLen;
-          for (uint8_t i = 0; i < idLen && n < sizeof(payload); i++) payload[n++] = (uint8_t)id[i];
-          sendModbusResponse(slaveId, 0x11, payload, n);
-          gHelloDone = true;
-        }
+    uint8_t slaveId = rxBuffer[0];
+    uint8_t functionCode = rxBuffer[1];
+
+    // TDMA 동기 비콘 (브로드캐스트, 응답 없음)
+    if (slaveId == 0x00 && functionCode == TDMA_SYNC_FC) {
+      onTdmaBeacon(rxBuffer, currentTime, !rxLate);
+    }
+    // 읽기 요청 처리 (0x03)
+    else if (functionCode == MODBUS_FUNCTION_READ) {
+      uint16_t startAddr = (rxBuffer[2] << 8) | rxBuffer[3];
+      uint16_t regCount = (rxBuffer[4] << 8) | rxBuffer[5];
+
+      // 🔥 요청된 slaveId가 현재 Combined ID와 일치하는지 확인 (gUnoId 업데이트 반영)
+      uint8_t currentCombinedId = (sensorCount > 0) ? getMegaTypeCode(sensors[0].type) : 0;
+      if (slaveId == currentCombinedId || slaveId == sensors[0].slaveId) {
+        // 요청된 센서의 데이터 전송
+        sendSensorDataForSlave(slaveId, startAddr, regCount);
+      }
+    } else if (functionCode == 0x11) {
+      // Modbus Report Slave ID (간단한 하트비트 응답)
+      // 데이터: [idLen][idBytes...] 형식의 단순 페이로드로 응답
+      uint8_t currentCombinedId = (sensorCount > 0) ? getMegaTypeCode(sensors[0].type) : 0;
+      if (sensorCount > 0 && (slaveId == currentCombinedId || slaveId == sensors[0].slaveId)) {
+        const char* id = "UNO_SHT20";
+        uint8_t payload[32];
+        uint8_t n = 0;
+        uint8_t idLen = (uint8_t)strlen(id);
+        payload[n++] = idLen;
+        for (uint8_t i = 0; i < idLen && n < sizeof(payload); i++) payload[n++] = (uint8_t)id[i];
+        sendModbusResponse(slaveId, 0x11, payload, n);
+        gHelloDone = true;
       }
     }
-    
-    // 버퍼 초기화
-    rxIndex = 0;
   }
 
   // ASCII 핸드셰이크 처리: MEGA_SENS_ACK / MEGA_SENS_REQ_ADDR
@@ -2350,18 +2546,16 @@ void loop() {
   }
 
   // 주기적 푸시: 현재 센서 값을 Modbus RTU 형식으로 Mega에 전송
-  {
+  // TDMA 동기 시 자기 슬롯에서만, 미동기 시 기존 3초 자유 주기
+  if (sensorCount > 0) {
     static unsigned long lastPush = 0;
-    if (millis() - lastPush >= 3000) {
+    if (tdmaActive()) {
+      pushInTdmaSlot();
+    } else if (millis() - lastPush >= LEGACY_PUSH_INTERVAL_MS) {
       lastPush = millis();
-      if (sensorCount > 0) {
-        SensorData* s = &sensors[0];
-        if (isI2CSensor(s->type)) {
-          sendI2CSensorData(s, 0, 2); // 내부에서 최신값 읽고 [T,H] 2레지스터로 응답 프레임 생성
-        } else {
-          sendModbusSensorData(s, 0, getModbusRegisterCount(s->type));
-        }
-      }
+      buildPushFrame();
+      if (gPushFrameLen > 0 && pushFrameChanged()) sendPushFrame();
+      gPushFrameLen = 0;
     }
   }
 
@@ -0,0 +1,190 @@
+// ============= Modbus CRC16 구현 비교 마이크로벤치마크 (호스트 전용) =============
+// 빌드/실행 (PC):
+//   g++ -O2 -std=c++11 -o crc16_bench main/bench/crc16_bench.cpp && ./crc16_bench
+//
+// 비교 대상
+//   1) bitwise   : 기존 calcCRC16() (비트 단위 8회 루프)
+//   2) table256  : 기존 calculateCRC16() (PROGMEM 256엔트리, 512B 플래시)
+//   3) nibble16  : 16엔트리 니블 테이블 2회 조회 (32B 플래시)
+//   4) avrlibc   : avr-libc _crc16_update() 어셈블리를 C로 옮긴 것 (테이블 없음)
+//
+// 호스트 ns/byte는 참고용이며, 판단 기준은 AVR 사이클 모델(avr-gcc -Os 출력 기준 명령어 수)
+//   - lpm 3, 분기 taken 2 / not taken 1, 나머지 ALU/mov 1 사이클
+//   - bitwise는 데이터 의존 분기가 있어 실제 입력 비트로 사이클을 누적
+// 결과 요약 (16MHz ATmega2560/328P, 25바이트 푸시 프레임 기준):
+//   bitwise ≈ 72 cyc/B, table256 ≈ 18 (512B), nibble16 ≈ 35 (32B), avrlibc = 23 (테이블 0B)
+//   → 공용 모듈(ModbusCRC.h)은 AVR에서 _crc16_update() 사용
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+// ---------- 1) bitwise ----------
+static uint16_t crcBitwise(uint16_t crc, uint8_t data, uint32_t *cycles)
+{
+  crc ^= data;
+  if (cycles) *cycles += 4;                 // eor + 루프 카운터 초기화
+  for (uint8_t i = 0; i < 8; i++) {
+    if (crc & 0x0001) {
+      crc = (crc >> 1) ^ 0xA001;
+      if (cycles) *cycles += 1 + 2 + 2 + 2 + 3;  // sbrs, lsr/ror, eor x2, rjmp, dec/brne
+    } else {
+      crc >>= 1;
+      if (cycles) *cycles += 2 + 2 + 3;          // sbrs skip, lsr/ror, dec/brne
+    }
+  }
+  return crc;
+}
+
+// ---------- 2) table256 ----------
+static uint16_t crcTable256[256];
+
+static void buildTable256()
+{
+  for (uint16_t i = 0; i < 256; i++) {
+    uint16_t c = i;
+    for (uint8_t j = 0; j < 8; j++) c = (c & 1) ? (c >> 1) ^ 0xA001 : (c >> 1);
+    crcTable256[i] = c;
+  }
+}
+
+static uint16_t crcTable(uint16_t crc, uint8_t data, uint32_t *cycles)
+{
+  crc = (crc >> 8) ^ crcTable256[(crc ^ data) & 0xFF];
+  // eor 1, 인덱스*2 + 베이스 주소 5, lpm x2 6, 상위바이트 이동 2, eor x2 2, mov 2
+  if (cycles) *cycles += 18;
+  return crc;
+}
+
+// ---------- 3) nibble16 ----------
+static uint16_t crcNibbleTable[16];
+
+static void buildNibbleTable()
+{
+  for (uint16_t i = 0; i < 16; i++) {
+    uint16_t c = i;
+    for (uint8_t j = 0; j < 4; j++) c = (c & 1) ? (c >> 1) ^ 0xA001 : (c >> 1);
+    crcNibbleTable[i] = c;
+  }
+}
+
+static uint16_t crcNibble(uint16_t crc, uint8_t data, uint32_t *cycles)
+{
+  crc ^= data;
+  crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+  crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+  // eor 1 + 2 x (andi 1, 주소 계산 4, lpm x2 6, 16비트 >>4 (swap/andi/eor) 4, eor x2 2)
+  if (cycles) *cycles += 1 + 2 * 17;
+  return crc;
+}
+
+// ---------- 4) avr-libc _crc16_update (명령어 단위 이식) ----------
+static uint16_t crcAvrLibc(uint16_t crc, uint8_t data, uint32_t *cycles)
+{
+  uint8_t lo = crc & 0xFF, hi = crc >> 8;
+  uint8_t t, r0, c, nc;
+
+  lo ^= data;                          // eor  A0, data
+  t = lo;                              // mov  t, A0
+  t = (uint8_t)((t << 4) | (t >> 4));  // swap t
+  t ^= lo;                             // eor  t, A0
+  r0 = t;                              // mov  r0, t
+  t >>= 2;                             // lsr  t ; lsr t
+  t ^= r0;                             // eor  t, r0
+  r0 = t;                              // mov  r0, t
+  t >>= 1;                             // lsr  t
+  t ^= r0;                             // eor  t, r0
+  t &= 0x07;                           // andi t, 0x07
+  r0 = lo;                             // mov  r0, A0
+  lo = hi;                             // mov  A0, B0
+  c = t & 1; t >>= 1;                                      // lsr  t
+  nc = r0 & 1; r0 = (uint8_t)((r0 >> 1) | (c << 7)); c = nc; // ror  r0
+  t = (uint8_t)((t >> 1) | (c << 7));                      // ror  t
+  hi = r0;                             // mov  B0, r0
+  lo ^= t;                             // eor  A0, t
+  c = r0 & 1; r0 >>= 1;                // lsr  r0
+  t = (uint8_t)((t >> 1) | (c << 7));  // ror  t
+  hi ^= r0;                            // eor  B0, r0
+  lo ^= t;                             // eor  A0, t
+
+  if (cycles) *cycles += 23;           // 단일 사이클 명령 23개, 분기 없음
+  return (uint16_t)((hi << 8) | lo);
+}
+
+typedef uint16_t (*CrcStep)(uint16_t, uint8_t, uint32_t *);
+
+struct Variant {
+  const char *name;
+  CrcStep step;
+  unsigned tableBytes;
+};
+
+static uint16_t runBlock(CrcStep step, const uint8_t *buf, size_t len, uint32_t *cycles)
+{
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) crc = step(crc, buf[i], cycles);
+  return crc;
+}
+
+int main()
+{
+  buildTable256();
+  buildNibbleTable();
+
+  const Variant variants[] = {
+    { "bitwise",  crcBitwise, 0 },
+    { "table256", crcTable,   512 },
+    { "nibble16", crcNibble,  32 },
+    { "avrlibc",  crcAvrLibc, 0 },
+  };
+  const size_t variantCount = sizeof(variants) / sizeof(variants[0]);
+
+  // 1) 정합성: 모든 (crc, byte) 조합에서 bitwise와 동일해야 함
+  for (size_t v = 1; v < variantCount; v++) {
+    for (uint32_t crc = 0; crc <= 0xFFFF; crc++) {
+      for (uint16_t b = 0; b < 256; b++) {
+        if (variants[v].step((uint16_t)crc, (uint8_t)b, nullptr) != crcBitwise((uint16_t)crc, (uint8_t)b, nullptr)) {
+          printf("MISMATCH %s crc=0x%04X byte=0x%02X\n", variants[v].name, (unsigned)crc, b);
+          return 1;
+        }
+      }
+    }
+  }
+  const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  printf("check(\"123456789\") = 0x%04X (Modbus 표준값 0x4B37)\n",
+         runBlock(crcAvrLibc, check, sizeof(check), nullptr));
+
+  // 2) 스트리밍 잔여값: CRC 포함 전체 누적 시 0
+  uint8_t frame[8] = { 0x35, 0x03, 0x04, 0x09, 0xC4, 0x13, 0x88 };
+  uint16_t crc = runBlock(crcAvrLibc, frame, 6, nullptr);
+  frame[6] = crc & 0xFF;
+  frame[7] = crc >> 8;
+  printf("residue(frame+crc) = 0x%04X\n\n", runBlock(crcAvrLibc, frame, 8, nullptr));
+
+  // 3) 성능: 의사난수 버퍼 (센서 값처럼 비트 분포가 고른 데이터)
+  static uint8_t buf[1 << 20];
+  uint32_t seed = 0x12345678;
+  for (size_t i = 0; i < sizeof(buf); i++) {
+    seed = seed * 1103515245u + 12345u;
+    buf[i] = (uint8_t)(seed >> 16);
+  }
+
+  printf("%-10s %12s %14s %18s %12s\n", "variant", "host ns/B", "AVR cyc/B", "25B frame @16MHz", "table bytes");
+  for (size_t v = 0; v < variantCount; v++) {
+    uint32_t cycles = 0;
+    runBlock(variants[v].step, buf, 4096, &cycles);
+    double cycPerByte = (double)cycles / 4096.0;
+
+    volatile uint16_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < 8; rep++) sink ^= runBlock(variants[v].step, buf, sizeof(buf), nullptr);
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (8.0 * sizeof(buf));
+    (void)sink;
+
+    printf("%-10s %12.2f %14.1f %15.1f us %12u\n",
+           variants[v].name, ns, cycPerByte, cycPerByte * 25.0 / 16.0, variants[v].tableBytes);
+  }
+  return 0;
+}
@@ -45,7 +45,7 @@ void setup()
     // nutCycle 초기화는 이제 UNO에서 수행
     initUnoSensorRequest(); // UNO 센서 요청 시스템 초기화
     initUnoStatusRequest(); // UNO 상태 요청 시스템 초기화
-    initSerial3Manager(); // Serial3 통신 관리자 초기화
+    initSerial3Executor(); // Serial3 명령 큐/실행기 초기화
     // RS485 제어 채널(Serial3) 초기화 - 상태머신에서 Modbus 초기화를 스킵하므로 여기서 초기화
     pinMode(RS485_CONTROL_DE_RE_PIN, OUTPUT);
     digitalWrite(RS485_CONTROL_DE_RE_PIN, LOW); // 수신 기본
@@ -103,6 +103,7 @@ void loop()
         break;
     case STATE_NETWORK_RECOVERY:
         handleNetworkRecovery();
+        pollOfflineSensors(currentTime);
         break;
     }
     
@@ -244,14 +245,30 @@ void handleNormalOperation()
         startUnoSensorRequest();
     }
     
-    // 우노 센서 응답 처리 (Non-blocking)
-    updateUnoSensorRequest();
-    // 우노 상태 응답 처리 (Non-blocking)
-    updateUnoStatusRequest();
+    // Serial3 명령 큐 실행 - 제어/NPN/센서·상태 요청 송신 및 응답 처리 (Non-blocking)
+    serial3ExecutorPoll();
+    // NPN 채널 쓰기 배치 창 만료 시 FC16 송출
+    npnBatchPoll();
     // 제어용 UNO 존재 감지 (IDLE시에만 비간섭 읽기)
     pollUnoControlHandshake();
+    // Serial1 Modbus 마스터 트랜잭션 진행 (Non-blocking)
+    modbusMasterPoll();
+    // 센서 버스 백그라운드 탐색 진행
+    pollUnoDiscovery();
     // 센서용 UNO(Serial1) 푸시 프레임 수집 (등록/스캔 없이)
     pollUnoPushFrames();
+
+    // Serial1 프레임 손실 통계 / 센서 레지스트리·캐시·업링크 / Serial3 명령 큐 / 링크 텔레메트리 (60초마다)
+    static unsigned long lastFramerStatsPrint = 0;
+    if (currentTime - lastFramerStatsPrint >= 60000) {
+        lastFramerStatsPrint = currentTime;
+        printPushFramerStats();
+        printModbusRegistryUsage();
+        printModbusCacheStats();
+        printSensorUplinkStats();
+        printSerial3QueueStats();
+        publishModbusLinkTelemetry();
+    }
     
     // UNO 상태 요청 (30초마다, nutCycle 상태 전송용)
     static unsigned long lastUnoStatusRequest = 0;
@@ -260,19 +277,8 @@ void handleNormalOperation()
         startUnoStatusRequest();
     }
 
-    // 센서 상태 모니터링 (UNO가 모든 센서를 담당하므로 주석처리)
-    // static unsigned long lastSensorHealthCheck = 0;
-    // if (currentTime - lastSensorHealthCheck >= 10000) {
-    //     lastSensorHealthCheck = currentTime;
-    //     checkSensorHealth();
-    // }
-
-    // 센서 헬스체크 (UNO가 모든 센서를 담당하므로 주석처리)
-    // static unsigned long lastHealthCheck = 0;
-    // if (currentTime - lastHealthCheck >= 15000) {
-    //     lastHealthCheck = currentTime;
-    //     performHealthCheck();
-    // }
+    // 1초 샘플은 MQTT 연결과 무관하게 링에 적재 (전송 주기마다 배치로 전송)
+    sampleUnifiedSensorData(currentTime);
 
     if (currentTime - lastSensorRead > SENSOR_INTERVAL)
     {
@@ -280,25 +286,15 @@ void handleNormalOperation()
 
         if (modbusSensorsReady) // I2C 센서는 Modbus로 통합됨
         {
-            // UNO 센서 요청이 진행 중이면 완료 대기
-            if (unoRequestState != UNO_IDLE) {
-                unsigned long waitStart = millis();
-                while (unoRequestState != UNO_IDLE && (millis() - waitStart) < 5000) {
-                    updateUnoSensorRequest();
-                    delay(10);
-                }
-                if (unoRequestState != UNO_IDLE) {
-                    unoRequestState = UNO_IDLE;
-                    serial3Owner = SERIAL3_IDLE;
-                }
-            }
-            
             sendUnifiedSensorData();
             // 30초마다 버킷 리셋하여 탈착/변화 반영
             resetUnoBucketsIfExpired();
         }
     }
 
+    // 오프라인 동안 EEPROM에 보관한 샘플 재전송 (라이브 전송이 성공한 뒤, 스로틀)
+    replaySensorBacklog();
+
     handleWeb();
 
     // updateUnoSensorData();
@@ -311,360 +307,48 @@ void handleNormalOperation()
 
 // UNO 제어 명령 큐 처리 (modbusHandler.cpp에서 정의됨)
 
-void sendUnifiedSensorData()
+// 제어용 UNO(Serial3)의 ADS1115 데이터는 Modbus ADS1115가 없을 때만 사용
+const UnoSensorData *uplinkUnoSensorData()
 {
-    if (!mqttConnected)
-        return;
-
-    uint8_t payload[512];  // 🔥 버퍼 크기 증가 (256 → 512)
-    uint16_t payloadSize = 0;
-    uint8_t currentSensorId = 0;  // 🔥 순차적 센서 ID 할당
-
-    // 🔥 채널 카운터 초기화 (동종 센서에 대해 채널 번호 순차 할당)
-    // 인덱스: 0=SHT20, 1=조도, 2=ADS1115, 3=SCD41, 4=DS18B20
-    // 인덱스: 5=MODBUS_SHT20, 6=MODBUS_SCD41, 7=MODBUS_TSL2591, 8=MODBUS_BH1750, 9=MODBUS_ADS1115, 10=MODBUS_DS18B20
-    uint8_t globalChannelCounters[11] = {0}; // 11개 타입 지원 (0~10)
-
-    // 🔥 실제 활성 센서 개수 계산
-    uint8_t activeSensors = 0;
-    for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-        if (modbusSensors[i].active) activeSensors++;
-    }
-    // 제어용 UNO(Serial3)의 ADS1115 데이터를 사용할 경우만 +1
-    if (!isModbusSensorFound(MODBUS_ADS1115) && unoSensorData.isValid) {
-        activeSensors += 1;
-    }
-    
-
-    // 센서 개수 계산 완료
-
-    // Header (8 bytes)
-    payload[payloadSize++] = 0x01;
-    payload[payloadSize++] = 0x03;
-    payload[payloadSize++] = (uint8_t)(millis() >> 24);
-    payload[payloadSize++] = (uint8_t)(millis() >> 16);
-    payload[payloadSize++] = (uint8_t)(millis() >> 8);
-    payload[payloadSize++] = (uint8_t)(millis());
-    payload[payloadSize++] = activeSensors;  // 🔥 실제 활성 센서 개수
-    payload[payloadSize++] = 0x00;
-
-    // I2C 규격과 동일 포맷으로 각 타입 인코딩
-    for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-        if (!modbusSensors[i].active) continue;
-
-        payload[payloadSize++] = currentSensorId++;
-        // 백엔드 호환 매핑: MODBUS_* (21~26) → 기존 I2C/디지털 타입
-        uint8_t mappedType = modbusSensors[i].type;
-        if (mappedType == MODBUS_SHT20)      mappedType = 1; // SHT20
-        else if (mappedType == MODBUS_SCD41) mappedType = 4; // CO2 (SCD30 호환 타입 사용)
-        else if (mappedType == MODBUS_TSL2591) mappedType = 2; // 조도는 통합 타입(2)
-        else if (mappedType == MODBUS_BH1750)  mappedType = 2; // BH1750
-        else if (mappedType == MODBUS_ADS1115) mappedType = 3; // ADS1115
-        else if (mappedType == MODBUS_DS18B20) mappedType = 5; // DS18B20
-        payload[payloadSize++] = mappedType;
-        payload[payloadSize++] = modbusSensors[i].slaveId;
-        
-        // 🔥 Combined ID에서 UNO_ID 추출하여 CH로 사용
-        // Combined ID: 하위 5비트=타입코드, 상위 3비트=UNO_ID (1~6)
-        uint8_t typeCode = 0;
-        uint8_t unoId = 0;
-        splitCombinedId(modbusSensors[i].slaveId, &typeCode, &unoId);
-        
-        // UNO_ID가 0이면 순차 할당 (레거시 호환)
-        uint8_t ch = unoId;
-        if (ch == 0) {
-            // UNO_ID가 없는 경우 순차 할당 (호환성)
-            uint8_t counterIdx = 255;
-            switch (mappedType) {
-                case 1: counterIdx = 0; break; // SHT20
-                case 2: counterIdx = 1; break; // 조도
-                case 3: counterIdx = 2; break; // ADS1115
-                case 4: counterIdx = 3; break; // SCD41
-                case 5: counterIdx = 4; break; // DS18B20
-                default: break;
-            }
-            if (counterIdx < sizeof(globalChannelCounters)) {
-                globalChannelCounters[counterIdx]++;
-                ch = globalChannelCounters[counterIdx];
-            }
-        }
-        payload[payloadSize++] = ch;
-
-        switch (modbusSensors[i].type)
-        {
-        case MODBUS_SCD41: {
-            uint16_t co2_int = modbusSensors[i].registers[0];
-            payload[payloadSize++] = co2_int >> 8;
-            payload[payloadSize++] = co2_int & 0xFF;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            break;
-        }
-        case MODBUS_SHT20: {
-            uint16_t temp_int = modbusSensors[i].registers[0]; // ×100
-            uint16_t humid_int = modbusSensors[i].registers[1]; // ×100
-            payload[payloadSize++] = temp_int >> 8;
-            payload[payloadSize++] = temp_int & 0xFF;
-            payload[payloadSize++] = humid_int >> 8;
-            payload[payloadSize++] = humid_int & 0xFF;
-            break;
-        }
-        case MODBUS_TSL2591: {
-            uint16_t lux_int = modbusSensors[i].registers[0]; // ×10
-            payload[payloadSize++] = lux_int >> 8;
-            payload[payloadSize++] = lux_int & 0xFF;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            break;
-        }
-        case MODBUS_BH1750: {
-            uint16_t lux_int = modbusSensors[i].registers[0]; // ×10
-            payload[payloadSize++] = lux_int >> 8;
-            payload[payloadSize++] = lux_int & 0xFF;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            break;
-        }
-        case MODBUS_DS18B20: {
-            uint16_t t_int = modbusSensors[i].registers[0]; // ×100
-            payload[payloadSize++] = t_int >> 8;
-            payload[payloadSize++] = t_int & 0xFF;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            break;
-        }
-        case MODBUS_SOIL_SENSOR: { // MODBUS_SOIL_SENSOR = 19 (토양센서 - 8개 레지스터)
-            // ✅ UNO 전송: r0=습도, r1=온도, r2=EC, r3=pH, r4=N, r5=P, r6=K, r7=상태
-            // ✅ 4개 값 모두 전송: 습도, 온도, EC, pH
-            uint16_t soilHumi = modbusSensors[i].registers[0];  // 습도
-            uint16_t soilTemp = modbusSensors[i].registers[1];  // 온도
-            uint16_t soilEC = modbusSensors[i].registers[2];    // EC
-            uint16_t soilPH = modbusSensors[i].registers[3];    // pH
-            payload[payloadSize++] = soilHumi >> 8;
-            payload[payloadSize++] = soilHumi & 0xFF;
-            payload[payloadSize++] = soilTemp >> 8;
-            payload[payloadSize++] = soilTemp & 0xFF;
-            payload[payloadSize++] = soilEC >> 8;   // EC 상위 바이트
-            payload[payloadSize++] = soilEC & 0xFF; // EC 하위 바이트
-            payload[payloadSize++] = soilPH >> 8;   // pH 상위 바이트
-            payload[payloadSize++] = soilPH & 0xFF; // pH 하위 바이트
-            // ✅ 토양센서는 이미 8바이트를 전송했으므로 reserved 필드 추가하지 않음
-            goto skip_reserved; // reserved 필드 추가 건너뛰기
-        }
-        case 16: { // MODBUS_WIND_DIRECTION (풍향 센서)
-            uint16_t gear = modbusSensors[i].registers[0];  // 기어값 (0~7)
-            uint16_t degree = modbusSensors[i].registers[1]; // 각도 (0~360)
-            payload[payloadSize++] = gear >> 8;
-            payload[payloadSize++] = gear & 0xFF;
-            payload[payloadSize++] = degree >> 8;
-            payload[payloadSize++] = degree & 0xFF;
-            break;
-        }
-        case 17: { // MODBUS_WIND_SPEED (풍속 센서)
-            uint16_t speed = modbusSensors[i].registers[0];  // 풍속 (×10)
-            payload[payloadSize++] = speed >> 8;
-            payload[payloadSize++] = speed & 0xFF;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            break;
-        }
-        case 18: { // MODBUS_RAIN_SNOW (강우/강설 센서 - 10개 레지스터)
-            // UNO 전송: r0=강우, r1=강설, r2=예약, r3=온도, r4=습도, r5~r9=수분레벨 1~5
-            // 백엔드 형식: value1 = (강수상태 4비트 << 12) | (수분레벨 12비트)
-            //             value2 = (온도바이트 8비트 << 8) | (습도 8비트)
-            
-            uint16_t rainfall = modbusSensors[i].registers[0];
-            uint16_t snowfall = modbusSensors[i].registers[1];
-            uint16_t temperature = modbusSensors[i].registers[3];  // 온도 (×10 스케일 또는 원시값)
-            uint16_t humidity = modbusSensors[i].registers[4];     // 습도 (0-100% 또는 ×10 스케일)
-            
-            // 강수 상태 판단: rainfall > 0이면 강우(1), snowfall > 0이면 강설(2), 둘 다 0이면 건조(0)
-            uint8_t precipStatus = 0;
-            if (snowfall > 0) {
-                precipStatus = 2;  // 강설
-            } else if (rainfall > 0) {
-                precipStatus = 1;  // 강우
-            } else {
-                precipStatus = 0;  // 건조
-            }
-            
-            // 수분 레벨 계산: r5~r9의 평균 또는 합계 사용 (0-4095 범위)
-            uint32_t moistureSum = 0;
-            uint8_t moistureCount = 0;
-            for (int j = 5; j <= 9 && j < 10; j++) {
-                moistureSum += modbusSensors[i].registers[j];
-                moistureCount++;
-            }
-            uint16_t moistureLevel = (moistureCount > 0) ? (moistureSum / moistureCount) : 0;
-            if (moistureLevel > 4095) moistureLevel = 4095;  // 12비트 최대값 제한
-            
-            // value1 인코딩: 상위 4비트 = 강수 상태, 하위 12비트 = 수분 레벨
-            uint16_t value1 = ((precipStatus & 0x0F) << 12) | (moistureLevel & 0x0FFF);
-            
-            // 온도 변환: 온도가 ×10 스케일로 전송됨 (예: 25.0°C = 250)
-            // 백엔드는 tempByte - 40 형식이므로, 온도를 0~255 범위로 변환 (실제 온도 + 40)
-            // 온도 범위: -40°C ~ 215°C → 0 ~ 255 바이트
-            int16_t tempC = (int16_t)temperature;
-            // ×10 스케일로 전송되므로 나누기 10 (예: 250 → 25.0°C)
-            tempC = tempC / 10;
-            // 범위 제한: -40°C ~ 215°C
-            if (tempC < -40) tempC = -40;
-            if (tempC > 215) tempC = 215;
-            uint8_t tempByte = (uint8_t)(tempC + 40);  // -40~215 → 0~255
-            
-            // 습도 변환: 0-100% 범위로 정규화
-            uint8_t humidityByte = (uint8_t)humidity;
-            if (humidityByte > 100) {
-                if (humidityByte > 1000) humidityByte = humidityByte / 10;  // ×10 스케일이면 나누기
-                else humidityByte = 100;  // 최대 100%로 제한
-            }
-            
-            // value2 인코딩: 상위 8비트 = 온도 바이트, 하위 8비트 = 습도
-            uint16_t value2 = ((uint16_t)tempByte << 8) | humidityByte;
-            
-            // 백엔드 형식으로 전송
-            payload[payloadSize++] = value1 >> 8;
-            payload[payloadSize++] = value1 & 0xFF;
-            payload[payloadSize++] = value2 >> 8;
-            payload[payloadSize++] = value2 & 0xFF;
-            break;
-        }
-        default: {
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-            break;
-        }
-        }
-
-        skip_reserved:
-        // ✅ 토양센서는 이미 reserved 필드를 포함하여 전송했으므로 추가하지 않음
-        if (modbusSensors[i].type != MODBUS_SOIL_SENSOR) {
-            payload[payloadSize++] = 0x00;
-            payload[payloadSize++] = 0x00;
-        }
-    }
+    return (!isModbusSensorFound(MODBUS_ADS1115) && unoSensorData.isValid) ? &unoSensorData : nullptr;
+}
 
-    // 우노 센서 데이터 추가 (제어용 UNO의 ADS1115 경로)
-    if (!isModbusSensorFound(MODBUS_ADS1115) && unoSensorData.isValid) {
-        // UNO 센서 처리
-        payload[payloadSize++] = currentSensorId++;  // 🔥 순차적 ID 할당
-        payload[payloadSize++] = 3; // 우노 센서 타입 (SENSOR_ADS1115 = 3)
-        payload[payloadSize++] = 0; // 채널 번호
-        payload[payloadSize++] = 0x01; // 활성상태
-
-        // pH, EC, 수온 데이터 인코딩
-        uint16_t ph_int = (uint16_t)constrain(unoSensorData.ph * 100, 0, 1400);
-        uint16_t ec_int = (uint16_t)constrain(unoSensorData.ec * 100, 0, 65535);  // dS/m × 100
-        uint16_t water_temp_int = (uint16_t)constrain(unoSensorData.waterTemp * 100, 0, 10000);
-
-        payload[payloadSize++] = ph_int >> 8;
-        payload[payloadSize++] = ph_int & 0xFF;
-        payload[payloadSize++] = ec_int >> 8;
-        payload[payloadSize++] = ec_int & 0xFF;
-
-        // 수온 데이터 추가 (reserved1, reserved2에 저장)
-        payload[payloadSize++] = water_temp_int >> 8;
-        payload[payloadSize++] = water_temp_int & 0xFF;
-
-         // UNO 센서 데이터 처리 완료
-    }
+// 센서 샘플 적재 + EEPROM 스필 진행 (정상 동작/네트워크 복구 공용)
+void sampleUnifiedSensorData(unsigned long currentTime)
+{
+    static unsigned long lastSensorSample = 0;
 
-    // Modbus 센서 데이터 (활성 센서만 처리)
-    // 호환을 위해 원시 타입 기준으로도 CH를 순차 할당
-    // 인덱스: 5=MODBUS_SHT20, 6=MODBUS_SCD41, 7=MODBUS_TSL2591, 8=MODBUS_BH1750, 9=MODBUS_ADS1115, 10=MODBUS_DS18B20
-    // ✅ 토양센서는 위의 switch-case에서 이미 처리되므로 여기서는 제외
-    for (uint8_t i = 0; i < modbusSlaveCount; i++)
+    pollSensorSpill();
+    if (modbusSensorsReady && currentTime - lastSensorSample >= SENSOR_SAMPLE_INTERVAL_MS)
     {
-        if (!modbusSensors[i].active)
-            continue;
-        
-        // ✅ 토양센서는 위의 switch-case에서 이미 처리되었으므로 제외
-        if (modbusSensors[i].type == MODBUS_SOIL_SENSOR)
-            continue;
-
-        // Modbus 센서 처리
-
-        payload[payloadSize++] = currentSensorId++;  // 🔥 순차적 ID 할당
-        payload[payloadSize++] = modbusSensors[i].type;
-        payload[payloadSize++] = modbusSensors[i].slaveId;
-        
-        // 🔥 Combined ID에서 UNO_ID 추출하여 CH로 사용
-        // Combined ID: 하위 5비트=타입코드, 상위 3비트=UNO_ID (1~6)
-        uint8_t typeCodeRaw = 0;
-        uint8_t unoIdRaw = 0;
-        splitCombinedId(modbusSensors[i].slaveId, &typeCodeRaw, &unoIdRaw);
-        
-        // UNO_ID가 0이면 순차 할당 (레거시 호환)
-        uint8_t chRaw = unoIdRaw;
-        if (chRaw == 0) {
-            // UNO_ID가 없는 경우 순차 할당 (호환성)
-            uint8_t counterIdx = 255;
-            switch (modbusSensors[i].type) {
-                case MODBUS_SHT20:    counterIdx = 5; break;
-                case MODBUS_SCD41:    counterIdx = 6; break;
-                case MODBUS_TSL2591:  counterIdx = 7; break;
-                case MODBUS_BH1750:   counterIdx = 8; break;
-                case MODBUS_ADS1115:  counterIdx = 9; break;
-                case MODBUS_DS18B20:  counterIdx = 10; break;
-                default: break;
-            }
-            if (counterIdx < sizeof(globalChannelCounters)) {
-                globalChannelCounters[counterIdx]++;
-                chRaw = globalChannelCounters[counterIdx];
-            }
-        }
-        payload[payloadSize++] = chRaw;
-
-        // UNO가 모든 센서 읽기를 담당하므로 registers에서 직접 사용
-        // UNO로부터 받은 Modbus RTU 데이터는 modbusSensors[i].registers[]에 저장되어 있음
-        uint16_t value1 = modbusSensors[i].registers[0];
-        uint16_t value2 = modbusSensors[i].registers[1];
-        
-        payload[payloadSize++] = value1 >> 8;
-        payload[payloadSize++] = value1 & 0xFF;
-        payload[payloadSize++] = value2 >> 8;
-        payload[payloadSize++] = value2 & 0xFF;
-        payload[payloadSize++] = 0x00;
-        payload[payloadSize++] = 0x00;
-        payload[payloadSize++] = 0x00;
-        payload[payloadSize++] = 0x00;
+        lastSensorSample = currentTime;
+        sampleSensorPayload(uplinkUnoSensorData());
     }
+}
 
+// 네트워크 복구 중에도 센서 버스 수집과 샘플 적재는 계속 (복구 후 링/백로그로 전송)
+void pollOfflineSensors(unsigned long currentTime)
+{
+    if (!modbusSensorsReady)
+        return;
 
+    modbusMasterPoll();
+    pollUnoDiscovery();
+    pollUnoPushFrames();
+    sampleUnifiedSensorData(currentTime);
+}
 
-    // 🔥 최종 검증
-    uint8_t actualProcessedSensors = currentSensorId;
-    // 센서 수 검증 완료
-
-    // CRC 계산
-    // uint16_t crc = calcCRC16(payload, payloadSize);
-    // payload[payloadSize++] = crc & 0xFF;
-    // payload[payloadSize++] = crc >> 8;
+void sendUnifiedSensorData()
+{
+    if (!mqttConnected)
+        return;
 
-    // 바이너리 전송
-    String unifiedTopic = "sensors/modbus/";
-    unifiedTopic += DEVICE_ID;
-    
-    // 페이로드 전송 준비 완료
-    
-    bool publishResult = mqttClient.publish(unifiedTopic.c_str(), payload, payloadSize);
-    
-    if (publishResult) {
-        // 센서 데이터 전송 완료
-    } else {
+    // 샘플 링 + 꼬리 키프레임(v2)/델타(v3) 배치, 형식은 modbusHandler.h 참고 - 버퍼 없이 스트리밍
+    if (!publishSensorPayload(uplinkUnoSensorData())) {
         Serial.println(F("❌ 센서 데이터 전송 실패"));
     }
-
-    // 센서 데이터 전송 완료
 }
 
-
-
-
-
-
 bool connectMQTT()
 {
     if (mqttClient.connected())
@@ -675,6 +359,7 @@ bool connectMQTT()
     String clientId = String(DEVICE_ID) + "_" + String(millis());
     mqttClient.setServer(serverHost, mqttPort);
     mqttClient.setCallback(mqttCallback);
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
 
     if (mqttClient.connect(clientId.c_str()))
     {
@@ -708,7 +393,7 @@ bool connectMQTT()
 
 void mqttCallback(char *topic, byte *payload, unsigned int length)
 {
-    char jsonBuffer[512];
+    char jsonBuffer[MQTT_RX_PAYLOAD_MAX];
     if (length >= sizeof(jsonBuffer))
         length = sizeof(jsonBuffer) - 1;
 
@@ -754,16 +439,21 @@ void handleModbusCommand(const char* jsonCStr)
     
     Serial.println(F("✅ JSON 파싱 성공"));
 
-    uint8_t slaveId = doc["slave_id"];
     uint8_t functionCode = doc["function_code"];
-    uint16_t address = doc["address"];
-    uint16_t value = doc["value"] | 0;
-    String commandId = doc["command_id"] | "";
 
-    // 응답에 포함할 추가 정보 미리 저장 (doc.clear() 전에)
-    bool hasNpnCommand = doc.containsKey("npn_command");
-    String npnCommand = hasNpnCommand ? String((const char *)doc["npn_command"]) : "";
-    uint8_t npnChannel = hasNpnCommand ? doc["channel"] | 0 : 0;
+    // 응답에 포함할 정보 미리 저장 - 비동기 명령은 완료 콜백이 이 값으로 응답을 발행
+    CommandReply reply;
+    memset(&reply, 0, sizeof(reply));
+    strncpy(reply.commandId, doc["command_id"] | "", COMMAND_ID_MAX);
+    reply.slaveId = doc["slave_id"];
+    reply.functionCode = functionCode;
+    reply.address = doc["address"];
+    reply.value = doc["value"] | 0;
+    if (doc.containsKey("npn_command"))
+    {
+        strncpy(reply.npnCommand, doc["npn_command"] | "", sizeof(reply.npnCommand) - 1);
+        reply.npnChannel = doc["channel"] | 0;
+    }
 
     bool success = false;
     String response = "";
@@ -777,7 +467,9 @@ void handleModbusCommand(const char* jsonCStr)
         Serial.print(npnCmd);
         Serial.print(F(", 채널: "));
         Serial.println(channel);
-        success = handleNPNCommand(npnCmd, channel, response);
+        // 큐 적재 성공 시 응답은 완료 콜백에서 발행
+        success = handleNPNCommand(npnCmd, channel, reply, response);
+        if (success) return;
     }
     // UNO 명령 처리 (kind 기반으로 통일)
     else if (doc.containsKey("kind") && String((const char *)doc["kind"]) == "UNO_MODULE")
@@ -792,11 +484,8 @@ void handleModbusCommand(const char* jsonCStr)
         }
         Serial.println();
         
-        // command_id를 전역 변수에 저장 (sendUnoAckToServer에서 사용)
-        extern String currentUnoCommandId;
-        currentUnoCommandId = commandId;
-        
-        success = handleUNOCommand(unoCmd, channel, response);
+        // command_id는 완료 컨텍스트에 실려 ACK 콜백의 sendUnoAckToServer()까지 전달
+        success = handleUNOCommand(unoCmd, channel, reply, response);
 
         // UNO 명령은 sendUnoAckToServer()에서 ACK를 보내므로 여기서는 응답하지 않음
         // (중복 응답 방지)
@@ -805,20 +494,32 @@ void handleModbusCommand(const char* jsonCStr)
        // 🔥 다중 릴레이 명령 처리
        else if (doc.containsKey("kind") && String((const char *)doc["kind"]) == "MULTI_RELAY")
        {
-           String action = String((const char *)doc["action"]);
-           JsonArray channels = doc["channels"];
-           
-           Serial.print(F("🔥 다중 릴레이 명령: "));
-           Serial.print(action);
-           Serial.print(F(", 채널: ["));
-           for (int i = 0; i < channels.size(); i++) {
-               Serial.print(channels[i].as<int>());
-               if (i < channels.size() - 1) Serial.print(F(", "));
+           // 장면 전환: {"on":[...], "off":[...]} → 한 프레임으로 동시 적용
+           if (doc.containsKey("on") || doc.containsKey("off"))
+           {
+               JsonArray onChannels = doc["on"];
+               JsonArray offChannels = doc["off"];
+               Serial.println(F("🔥 다중 릴레이 장면 전환"));
+               success = handleRelaySceneCommand(onChannels, offChannels, reply, response);
            }
-           Serial.println(F("]"));
-           
-           success = handleMultiRelayCommand(action, channels, response);
-           return;
+           else
+           {
+               String action = String((const char *)doc["action"]);
+               JsonArray channels = doc["channels"];
+
+               Serial.print(F("🔥 다중 릴레이 명령: "));
+               Serial.print(action);
+               Serial.print(F(", 채널: ["));
+               for (int i = 0; i < channels.size(); i++) {
+                   Serial.print(channels[i].as<int>());
+                   if (i < channels.size() - 1) Serial.print(F(", "));
+               }
+               Serial.println(F("]"));
+
+               success = handleMultiRelayCommand(action, channels, reply, response);
+           }
+           // 큐 적재 성공 시 응답은 완료 콜백에서 발행, 즉시 실패는 아래에서 응답
+           if (success) return;
        }
        // 🔥 NPN 다중 제어 명령 처리
        else if (doc.containsKey("kind") && String((const char *)doc["kind"]) == "MULTI_NPN")
@@ -849,6 +550,13 @@ void handleModbusCommand(const char* jsonCStr)
            }
            return;
        }
+    // 릴레이 상태 조회 - Mega 섀도 상태로 응답 (Serial3 송신 없음)
+    else if (doc.containsKey("kind") && String((const char *)doc["kind"]) == "RELAY_STATE")
+    {
+        success = publishRelayShadow(reply);
+        if (success) return;
+        response = "Relay state publish failed";
+    }
     // 새로운 백엔드 형식 처리 (kind + command)
     else if (doc.containsKey("kind") && doc.containsKey("command"))
     {
@@ -856,7 +564,8 @@ void handleModbusCommand(const char* jsonCStr)
         String kind = doc["kind"];
         String command = doc["command"];
         uint8_t channel = doc["channel"] | 0;
-        success = handleKindCommand(kind, command, channel, response);
+        success = handleKindCommand(kind, command, channel, reply, response);
+        if (success) return;
     }
     // Modbus 센싱 명령 처리
     else
@@ -876,33 +585,9 @@ void handleModbusCommand(const char* jsonCStr)
             break;
         }
     }
-    // MQTT 응답 전송 (기존 doc 재사용하여 메모리 절약)
-    doc.clear();
-    doc["command_id"] = commandId;
-    doc["device_id"] = DEVICE_ID;
-    doc["slave_id"] = slaveId;
-    doc["function_code"] = functionCode;
-    doc["address"] = address;
-    doc["value"] = value;
-    doc["success"] = success;
-    doc["response"] = response;
-    doc["timestamp"] = millis();
-    doc["is_command_response"] = true;
-
-    // npn_command 정보 추가 (미리 저장해둔 값 사용)
-    if (hasNpnCommand)
-    {
-        doc["npn_command"] = npnCommand;
-        doc["channel"] = npnChannel;
-        doc["device_type"] = "NPN_MODULE";
-    }
+    // MQTT 응답 전송 (즉시 완료/거부된 명령)
+    publishCommandResponse(reply, success, response.c_str());
 
-    String responseJson;
-    serializeJson(doc, responseJson);
-
-    String responseTopic = "modbus/command-responses/" + String(DEVICE_ID);
-    mqttClient.publish(responseTopic.c_str(), responseJson.c_str());
-
-    while (RS485_SENSING_SERIAL.available())
-        RS485_SENSING_SERIAL.read();
+    // 명령 처리 중 쌓인 Serial1 바이트는 푸시 프레이머로 (버리지 않고 손실/재동기 통계에 반영)
+    pollUnoPushFrames();
 }
\ No newline at end of file
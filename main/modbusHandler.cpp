@@ -2,7 +2,10 @@
 #define NPN_HW_PRESENT 0   // 0: NPN 모듈 없음 (드라이런), 1: 실제 모듈 있음
 #include "Config.h"
 #include "modbusHandler.h"
+#include "ModbusCRC.h"
+#include "UnoLink.h"
 #include <math.h>  // fabsf, sqrtf
+#include <EEPROM.h>  // 센서 샘플 오프라인 스필
 // CMD 및 ACK 정의는 modbusHandler.h로 이동됨
 // RS485 타이밍 상수도 modbusHandler.h로 이동됨
 
@@ -31,6 +34,150 @@ void splitCombinedId(uint8_t combinedId, uint8_t* typeCode, uint8_t* unoId) {
 // ============= 전역 변수 정의 =============
 ModbusSlave modbusSensors[MAX_MODBUS_SLAVES];
 uint8_t modbusSlaveCount = 0;
+uint16_t modbusRegistryDropped = 0;
+
+// Combined ID(0~255) → modbusSensors 인덱스 + 1 (0 = 미등록, 전역 0 초기화 그대로 사용)
+static uint8_t modbusSlotById[256];
+
+// 타입별 레지스터 풀 (등록 순서대로 앞에서부터 할당, clearModbusRegistry()에서 일괄 반환)
+static uint16_t modbusRegPool[MODBUS_REG_POOL_SIZE];
+static uint8_t modbusRegPoolUsed = 0;
+
+// ============= 센서 타입 디스크립터 (PROGMEM) =============
+struct ModbusTypeDesc {
+  uint8_t type;
+  uint8_t regCount;
+  const char *name;      // PROGMEM 문자열
+  uint8_t uplinkType;    // 업링크 레코드 타입 (백엔드 타입 코드)
+  uint8_t uplinkValues;  // 업링크 값 개수 (SENSOR_UPLINK_MAX_VALUES 이하)
+  uint8_t uplinkCodec;   // UPLINK_CODEC_*
+};
+
+// 업링크 값 구성 방식
+#define UPLINK_CODEC_REGS  0  // 레지스터 0..n-1 그대로
+#define UPLINK_CODEC_RAIN  1  // 강수 상태/수분 레벨, 온도/습도 바이트로 묶은 2값
+
+static const char MB_NAME_TEMP_HUMID[] PROGMEM = "MODBUS_T_H";
+static const char MB_NAME_PRESSURE[] PROGMEM = "PRESSURE";
+static const char MB_NAME_FLOW[] PROGMEM = "FLOW";
+static const char MB_NAME_RELAY[] PROGMEM = "RELAY";
+static const char MB_NAME_ENERGY[] PROGMEM = "ENERGY";
+static const char MB_NAME_WIND_DIR[] PROGMEM = "WIND_DIR";
+static const char MB_NAME_WIND_SPD[] PROGMEM = "WIND_SPD";
+static const char MB_NAME_RAIN[] PROGMEM = "RAIN";
+static const char MB_NAME_SOIL[] PROGMEM = "SOIL";
+static const char MB_NAME_SHT20[] PROGMEM = "SHT20";
+static const char MB_NAME_SCD41[] PROGMEM = "SCD41";
+static const char MB_NAME_TSL2591[] PROGMEM = "TSL2591";
+static const char MB_NAME_BH1750[] PROGMEM = "BH1750";
+static const char MB_NAME_ADS1115[] PROGMEM = "ADS1115";
+static const char MB_NAME_DS18B20[] PROGMEM = "DS18B20";
+static const char MB_NAME_UNKNOWN[] PROGMEM = "UNKNOWN";
+
+// regCount: 전송 포맷이 읽는 최대 레지스터 인덱스 + 1 (최소 2: value1/value2)
+// uplinkType: I2C 통합 센서(21~26)는 기존 I2C 타입 코드로 매핑 (SCD41은 SCD30 호환 4)
+static const ModbusTypeDesc MODBUS_TYPE_DESCS[] PROGMEM = {
+  { MODBUS_TEMP_HUMID,     2,  MB_NAME_TEMP_HUMID, MODBUS_TEMP_HUMID,     2, UPLINK_CODEC_REGS },
+  { MODBUS_PRESSURE,       2,  MB_NAME_PRESSURE,   MODBUS_PRESSURE,       2, UPLINK_CODEC_REGS },
+  { MODBUS_FLOW,           2,  MB_NAME_FLOW,       MODBUS_FLOW,           2, UPLINK_CODEC_REGS },
+  { MODBUS_RELAY,          2,  MB_NAME_RELAY,      MODBUS_RELAY,          2, UPLINK_CODEC_REGS },
+  { MODBUS_ENERGY_METER,   5,  MB_NAME_ENERGY,     MODBUS_ENERGY_METER,   2, UPLINK_CODEC_REGS },
+  { MODBUS_WIND_DIRECTION, 2,  MB_NAME_WIND_DIR,   MODBUS_WIND_DIRECTION, 2, UPLINK_CODEC_REGS },  // 기어, 각도
+  { MODBUS_WIND_SPEED,     2,  MB_NAME_WIND_SPD,   MODBUS_WIND_SPEED,     1, UPLINK_CODEC_REGS },  // 풍속 ×10
+  { MODBUS_RAIN_SNOW,      10, MB_NAME_RAIN,       MODBUS_RAIN_SNOW,      2, UPLINK_CODEC_RAIN },
+  { MODBUS_SOIL_SENSOR,    8,  MB_NAME_SOIL,       MODBUS_SOIL_SENSOR,    4, UPLINK_CODEC_REGS },  // 습도, 온도, EC, pH
+  { MODBUS_SHT20,          2,  MB_NAME_SHT20,      1,                     2, UPLINK_CODEC_REGS },  // 온도/습도 ×100
+  { MODBUS_SCD41,          2,  MB_NAME_SCD41,      4,                     1, UPLINK_CODEC_REGS },  // CO2 ppm
+  { MODBUS_TSL2591,        2,  MB_NAME_TSL2591,    2,                     1, UPLINK_CODEC_REGS },  // 조도
+  { MODBUS_BH1750,         2,  MB_NAME_BH1750,     2,                     1, UPLINK_CODEC_REGS },  // 조도
+  { MODBUS_ADS1115,        3,  MB_NAME_ADS1115,    3,                     3, UPLINK_CODEC_REGS },  // pH, EC, 수온 ×100
+  { MODBUS_DS18B20,        2,  MB_NAME_DS18B20,    5,                     1, UPLINK_CODEC_REGS },  // 온도 ×100
+};
+#define MODBUS_TYPE_DESC_COUNT (sizeof(MODBUS_TYPE_DESCS) / sizeof(MODBUS_TYPE_DESCS[0]))
+
+static int8_t findModbusTypeDesc(uint8_t type)
+{
+  for (uint8_t i = 0; i < MODBUS_TYPE_DESC_COUNT; i++) {
+    if (pgm_read_byte(&MODBUS_TYPE_DESCS[i].type) == type) return i;
+  }
+  return -1;
+}
+
+uint8_t modbusTypeRegCount(uint8_t type)
+{
+  int8_t d = findModbusTypeDesc(type);
+  return d >= 0 ? pgm_read_byte(&MODBUS_TYPE_DESCS[d].regCount) : 2;
+}
+
+const __FlashStringHelper *modbusTypeName(uint8_t type)
+{
+  int8_t d = findModbusTypeDesc(type);
+  const char *p = d >= 0 ? (const char *)pgm_read_ptr(&MODBUS_TYPE_DESCS[d].name) : MB_NAME_UNKNOWN;
+  return reinterpret_cast<const __FlashStringHelper *>(p);
+}
+
+uint16_t modbusReg(uint8_t idx, uint8_t k)
+{
+  const ModbusSlave &s = modbusSensors[idx];
+  return k < s.regCount ? modbusRegPool[s.regOffset + k] : 0;
+}
+
+// 레지스터 0부터 n개 기록 = 캐시 갱신 (푸시/폴링/탐색 응답 모두 이 경로를 거침)
+void modbusSetRegs(uint8_t idx, const uint16_t *regs, uint8_t n)
+{
+  ModbusSlave &s = modbusSensors[idx];
+  if (n > s.regCount) n = s.regCount;
+  if (n == 0) return;
+  memcpy(&modbusRegPool[s.regOffset], regs, n * sizeof(uint16_t));
+  s.regsValid = true;
+  s.regStampMs = (uint16_t)millis();
+}
+
+// ============= 레지스터 캐시 =============
+ModbusCacheStats modbusCacheStats = {0, 0, 0};
+uint16_t modbusCacheTtlMs = MODBUS_CACHE_TTL_MS;
+
+bool modbusRegsFresh(uint8_t idx, uint16_t maxAgeMs)
+{
+  ModbusSlave &s = modbusSensors[idx];
+  if (!s.regsValid || maxAgeMs == 0) return false;
+  if (maxAgeMs > MODBUS_CACHE_TTL_MAX) maxAgeMs = MODBUS_CACHE_TTL_MAX;
+  if ((uint16_t)((uint16_t)millis() - s.regStampMs) < maxAgeMs) return true;
+  s.regsValid = false;  // 만료 즉시 해제 → 16비트 시각이 랩돼도 다시 신선해 보이지 않음
+  return false;
+}
+
+void modbusInvalidateRegs(uint8_t idx)
+{
+  modbusSensors[idx].regsValid = false;
+}
+
+void printModbusCacheStats()
+{
+  const ModbusCacheStats &st = modbusCacheStats;
+  Serial.print(F("🗂 레지스터 캐시: 적중 ")); Serial.print(st.hits);
+  Serial.print(F(", 버스 ")); Serial.print(st.misses);
+  Serial.print(F(", 합류 ")); Serial.print(st.coalesced);
+  uint32_t total = st.hits + st.misses + st.coalesced;
+  if (total) {
+    Serial.print(F(" (절감 "));
+    Serial.print((st.hits + st.coalesced) * 100UL / total);
+    Serial.print(F("%)"));
+  }
+  Serial.print(F(", TTL ")); Serial.print(modbusCacheTtlMs); Serial.println(F("ms"));
+}
+
+void printModbusSensorName(uint8_t idx)
+{
+  uint8_t typeCode = 0;
+  uint8_t unoId = 0;
+  splitCombinedId(modbusSensors[idx].slaveId, &typeCode, &unoId);
+  Serial.print(modbusTypeName(modbusSensors[idx].type));
+  Serial.print(F("_T"));
+  Serial.print(typeCode);
+  Serial.print(F("_U"));
+  Serial.print(unoId);
+}
 
 // ============= RS485 제어 함수들 (센싱용) =============
 void handleModbusInitialization()
@@ -62,6 +209,7 @@ void handleModbusInitialization()
     pinMode(RS485_SENSING_DE_RE_PIN, OUTPUT);
     digitalWrite(RS485_SENSING_DE_RE_PIN, LOW);  // 초기 상태: 수신 모드
     RS485_SENSING_SERIAL.begin(RS485_SENSING);
+    initModbusMaster();
 
     pinMode(RS485_CONTROL_DE_RE_PIN, OUTPUT);
     digitalWrite(RS485_CONTROL_DE_RE_PIN, HIGH);
@@ -73,6 +221,9 @@ void handleModbusInitialization()
     assignUnoIdsByPulses();
     
     delay(500);
+
+    // 할당된 UNO 센서 탐색 (큐 적재만, 정상 운영 루프에서 백그라운드 진행)
+    scanAllUnoSensors();
     
     currentState = STATE_MQTT_INIT;
     stateChangeTime = millis();
@@ -300,394 +451,588 @@ void assignUnoIdsByPulses() {
   // 모든 핀을 INPUT(Hi-Z)로 해제
   enrollPinsReleaseInput();
 }
-// ============= Modbus 센서 스캔 (UNO가 담당하므로 주석처리) =============
-/*
-void scanModbusSensors()
+
+// void setRS485SensingTransmitMode() {
+//   digitalWrite(RS485_SENSING_DE_RE_PIN, HIGH);
+//   delayMicroseconds(50);
+// }
+
+// void setRS485SensingReceiveMode() {
+//   digitalWrite(RS485_SENSING_DE_RE_PIN, LOW);
+//   delayMicroseconds(50);
+// }
+
+// 공용 CRC 모듈(ModbusCRC.h) 래퍼 - 송신 프레임 생성 등 버퍼 단위 계산용
+// 수신 측은 바이트 도착 시 crc16Update()로 누적하고 잔여값 0으로 검증
+uint16_t calcCRC16(const uint8_t *buf, uint8_t len)
 {
-  Serial.println(F("🔍 Modbus 센서 스캔 시작..."));
-  modbusSlaveCount = 0;
-  
-  // 각 센서 타입별로 범위 스캔
-  for (uint8_t rangeIdx = 0; rangeIdx < SENSOR_RANGE_COUNT; rangeIdx++)
-  {
-    const SensorAddressRange& range = SENSOR_RANGES[rangeIdx];
-    Serial.print(F("🔍 "));
-    Serial.print(range.typeName);
-    Serial.print(F(" 스캔 (주소 "));
-    Serial.print(range.startAddr);
-    Serial.print(F("-"));
-    Serial.print(range.endAddr);
-    Serial.println(F(")..."));
-    
-    uint8_t foundCount = 0;
-    
-    // 해당 범위 내의 모든 주소 스캔
-    for (uint8_t slaveId = range.startAddr; slaveId <= range.endAddr && modbusSlaveCount < MAX_MODBUS_SLAVES; slaveId++)
-    {
-      Serial.print(F("  주소 "));
-      Serial.print(slaveId);
-      Serial.print(F(" 확인... "));
-      
-      // 센서 타입별로 다른 테스트 레지스터 수 사용
-      uint16_t testData[10];
-      bool found = false;
-      
-      // 스캔 속도 개선: 재시도 횟수 감소, 지연 시간 단축
-      for (int attempt = 0; attempt < 2; attempt++)
-      {
-        if (readModbusRegisters(slaveId, 0, range.testRegCount, testData))
-        {
-          found = true;
-          break;
-        }
-        delay(50); // 200ms → 50ms로 단축
-      }
-      
-      if (found)
-      {
-        modbusSensors[modbusSlaveCount].slaveId = slaveId;
-        modbusSensors[modbusSlaveCount].type = range.type;
-        modbusSensors[modbusSlaveCount].active = true;
-        modbusSensors[modbusSlaveCount].lastRead = 0;
-        modbusSensors[modbusSlaveCount].name = String(range.typeName) + "_" + String(slaveId);
-        modbusSlaveCount++;
-        foundCount++;
-        Serial.print(F("✅ 발견 (타입: "));
-        Serial.print(range.type);
-        Serial.println(F(")"));
-      }
-      else
-      {
-        Serial.println(F("❌ 응답 없음"));
-      }
-      delay(100);
-    }
-    
-    Serial.print(F("  "));
-    Serial.print(range.typeName);
-    Serial.print(F(" 총 "));
-    Serial.print(foundCount);
-    Serial.println(F("개 발견"));
-  }
-  
-  modbusSensorsReady = (modbusSlaveCount > 0);
-  Serial.println(F(""));
-  Serial.println(F("📊 Modbus 센서 스캔 완료"));
-  Serial.print(F("총 Modbus 장치 "));
-  Serial.print(modbusSlaveCount);
-  Serial.print(F("개 발견 (최대 "));
-  Serial.print(MAX_MODBUS_SLAVES);
-  Serial.println(F("개 지원)"));
-  
-  // 발견된 센서 목록 출력 (타입별로 그룹화)
-  Serial.println(F("📋 발견된 센서 목록:"));
-  for (uint8_t rangeIdx = 0; rangeIdx < SENSOR_RANGE_COUNT; rangeIdx++)
-  {
-    const SensorAddressRange& range = SENSOR_RANGES[rangeIdx];
-    bool hasSensors = false;
-    
-    for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-      if (modbusSensors[i].type == range.type) {
-        if (!hasSensors) {
-          Serial.print(F("  "));
-          Serial.print(range.typeName);
-          Serial.print(F(" (주소 범위: "));
-          Serial.print(range.startAddr);
-          Serial.print(F("-"));
-          Serial.print(range.endAddr);
-          Serial.println(F("):"));
-          hasSensors = true;
-        }
-        Serial.print(F("    - "));
-        Serial.print(modbusSensors[i].name);
-        Serial.print(F(" (주소: "));
-        Serial.print(modbusSensors[i].slaveId);
-        Serial.println(F(")"));
-      }
-    }
-  }
-  Serial.println(F(""));
+  return crc16Block(buf, len);
+}
+
+// ============= Non-blocking Modbus RTU 마스터 엔진 (Serial1, 센서 전용 UNO와 통신) =============
+// 기존 sendModbusRequest()는 응답 대기 동안 loop() 전체(MQTT, 웹, Serial3)를 멈췄음
+// - 요청은 링 큐에 적재하고 modbusMasterPoll()이 상태를 한 단계씩 진행
+// - DE/RE 해제는 USART1 TX Complete 인터럽트에서 수행 (flush() + 고정 가드 대기 제거)
+// - 응답 종료는 기대 길이 도달 또는 t3.5 무음으로 판정, 완료 시 콜백 호출
+// 주의: TXC 플래그를 ISR이 소비하므로 RS485_SENSING_SERIAL.flush()를 호출하면 안 됨
+struct ModbusMasterRequest {
+  uint8_t frame[8];          // [addr][fc][regHi][regLo][cntHi][cntLo][crcLo][crcHi]
+  uint16_t timeoutMs;        // TX 완료 후 첫 응답까지 허용 시간
+  ModbusDoneCallback cb;
+  void* ctx;
+};
+
+enum ModbusMasterState {
+  MB_STATE_IDLE,      // 큐 대기
+  MB_STATE_TX_GUARD,  // DE 활성화 후 송신 전 가드
+  MB_STATE_TX,        // 송신 중 (TXC ISR 대기)
+  MB_STATE_RX         // 응답 수신 중
+};
+
+static ModbusMasterRequest mbQueue[MODBUS_MASTER_QUEUE_SIZE];
+static uint8_t mbHead = 0;
+static uint8_t mbCount = 0;
+static ModbusMasterState mbState = MB_STATE_IDLE;
+
+static uint8_t mbRx[MODBUS_MASTER_RX_MAX];
+static uint8_t mbRxLen = 0;
+static uint8_t mbExpectedLen = 0;
+static uint16_t mbRxCrc = CRC16_MODBUS_INIT;  // 수신 바이트마다 누적 (정상 프레임은 잔여값 0)
+static unsigned long mbStateUs = 0;      // 현재 상태 진입 시각 (us)
+static unsigned long mbLastRxUs = 0;     // 마지막 바이트 수신 시각 (us)
+static unsigned long mbRxStartMs = 0;    // 응답 대기 시작 시각 (ms)
+static unsigned long mbBusIdleUs = 0;    // 직전 트랜잭션 종료 시각 (프레임 간 t3.5 보장)
+static uint16_t mbLastRttMs = 0;         // 직전 트랜잭션 응답 시간 (TX 완료 → 프레임 종료)
+static volatile bool mbTxDone = false;
+static const uint8_t* mbTxFrame = nullptr; // 송신 중 프레임 (큐 머리 또는 비콘)
+static bool mbTxBeacon = false;          // 응답 없는 비콘 송신 중
+static bool mbTdmaWaiting = false;       // 마스터 슬롯을 기다리는 중
+
+// ---- TDMA 비콘/마스터 슬롯 ----
+TdmaStats tdmaStats = {0, 0, 0};
+static unsigned long tdmaEpochMs = 0;    // 직전 비콘 송신 완료 시각 = 사이클 시작
+static bool tdmaStarted = false;
+static uint8_t tdmaSeq = 0;
+static uint8_t tdmaBeacon[8];
+static unsigned long tdmaSlotSeenMs[TDMA_SLOT_COUNT];  // UNO 슬롯별 마지막 푸시 수신 시각
+static uint8_t tdmaSlotSeenMask = 0;
+
+static uint16_t tdmaCyclePos()
+{
+  return (uint16_t)((millis() - tdmaEpochMs) % TDMA_CYCLE_MS);
 }
-*/
 
-// UNO가 모든 센서 읽기를 담당하므로 주석처리
-/*
-bool readModbusRegisters(uint8_t slaveAddr, uint16_t startAddr, uint16_t count, uint16_t *data)
+static bool tdmaBeaconDue()
 {
-  uint8_t response[50];
-  uint8_t respLen;
-  
-  if (sendModbusRequest(slaveAddr, 0x03, startAddr, count, response, respLen))
-  {
-    for (uint16_t i = 0; i < count && i < 10; i++)
-    {
-      data[i] = (response[3 + i * 2] << 8) | response[4 + i * 2];
-    }
-    return true;
-  }
+#if TDMA_ENABLED
+  return !tdmaStarted || millis() - tdmaEpochMs >= TDMA_CYCLE_MS;
+#else
   return false;
+#endif
 }
-*/
-// UNO가 모든 센서 읽기를 담당하므로 주석처리
-/*
-bool sendModbusRequest(uint8_t slaveAddr, uint8_t functionCode, 
-  uint16_t startReg, uint16_t regCount, 
-  uint8_t *response, uint8_t &responseLen, 
-  uint16_t timeout)
+
+// 슬롯 0/마지막 슬롯, 그리고 최근 푸시가 없는 UNO 슬롯은 마스터가 사용 가능
+static bool tdmaSlotFreeForMaster(uint8_t slot)
 {
-uint8_t request[8];
-request[0] = slaveAddr;
-request[1] = functionCode;
-request[2] = highByte(startReg);
-request[3] = lowByte(startReg);
-request[4] = highByte(regCount);
-request[5] = lowByte(regCount);
+  if (slot == 0 || slot >= TDMA_SLOT_COUNT - 1) return true;
+  if (!(tdmaSlotSeenMask & (1 << slot))) return true;
+  return millis() - tdmaSlotSeenMs[slot] >= (unsigned long)TDMA_CYCLE_MS * TDMA_SLOT_IDLE_CYCLES;
+}
 
-uint16_t crc = calcCRC16(request, 6);
-request[6] = lowByte(crc);
-request[7] = highByte(crc);
+// 지금 시작하는 마스터 트랜잭션이 쓸 수 있는 남은 시간 (사용 중인 UNO 슬롯이면 0)
+static uint16_t tdmaMasterWindowMs()
+{
+#if TDMA_ENABLED
+  uint16_t pos = tdmaCyclePos();
+  uint8_t slot = pos / TDMA_SLOT_MS;
+  if (!tdmaSlotFreeForMaster(slot)) return 0;
+  while (slot + 1 < TDMA_SLOT_COUNT && tdmaSlotFreeForMaster(slot + 1)) slot++;
+  uint16_t end = (uint16_t)(slot + 1) * TDMA_SLOT_MS;  // 마지막 슬롯이면 다음 비콘 전까지
+  return end - pos > TDMA_GUARD_MS ? end - pos - TDMA_GUARD_MS : 0;
+#else
+  return 0xFFFF;
+#endif
+}
 
-// ── (1) 수신버퍼 비우기
-while (RS485_SENSING_SERIAL.available()) RS485_SENSING_SERIAL.read();
+static void tdmaBuildBeacon()
+{
+  tdmaBeacon[0] = 0x00;  // 브로드캐스트
+  tdmaBeacon[1] = TDMA_SYNC_FC;
+  tdmaBeacon[2] = highByte(TDMA_SLOT_MS);
+  tdmaBeacon[3] = lowByte(TDMA_SLOT_MS);
+  tdmaBeacon[4] = TDMA_SLOT_COUNT;
+  tdmaBeacon[5] = tdmaSeq++;
+  crc16Append(tdmaBeacon, 6);
+}
 
-// ── (2) 송신 모드 + 가드
-RS485_SENS_TX();
-delayMicroseconds(RS485_TURNAROUND_US);
+// 푸시 프레임이 보낸 UNO의 슬롯 안에서 도착했는지 확인
+static void tdmaCheckPushSlot(uint8_t unoId)
+{
+#if TDMA_ENABLED
+  if (!tdmaStarted || unoId == 0 || unoId >= TDMA_SLOT_COUNT - 1) return;
+  tdmaSlotSeenMs[unoId] = millis();
+  tdmaSlotSeenMask |= (1 << unoId);
+  if (tdmaCyclePos() / TDMA_SLOT_MS != unoId) tdmaStats.offSlotFrames++;
+#else
+  (void)unoId;
+#endif
+}
 
-// ── (3) 프레임 전송 + 선로 비움
-RS485_SENSING_SERIAL.write(request, sizeof(request));
-RS485_SENSING_SERIAL.flush();
+// 마지막 바이트가 시프트 레지스터를 빠져나가면 즉시 수신 모드로 전환
+ISR(USART1_TX_vect)
+{
+  UCSR1B &= ~_BV(TXCIE1);
+  RS485_SENS_RX();
+  mbTxDone = true;
+}
 
-// ── (4) flush 후 가드 + 수신 모드
-delayMicroseconds(RS485_TURNAROUND_US);
-RS485_SENS_RX();
-// (선택) 1 char 정도 추가 여유
-delayMicroseconds(RS485_INTERCHAR_US);
+void initModbusMaster()
+{
+  UCSR1B &= ~_BV(TXCIE1);
+  mbHead = 0;
+  mbCount = 0;
+  mbState = MB_STATE_IDLE;
+  mbTxDone = false;
+  mbTxBeacon = false;
+  tdmaStarted = false;  // 첫 poll에서 바로 비콘 송신
+  mbBusIdleUs = micros();
+  RS485_SENS_RX();
+}
 
-// ── (5) 응답 수신
-uint32_t startTime = millis();
-responseLen = 0;
+bool modbusMasterBusy()
+{
+  return mbState != MB_STATE_IDLE;
+}
 
-// 기대 길이: [addr][fc][byteCount][data...][crcLo][crcHi]
-// byteCount는 3바이트 이후 등장 → 최소 5바이트 수신 전엔 판단 불가
-uint8_t expectedLen = 0;
+// ============= 응답 시간 추정 =============
+RttEstimator modbusBusRtt = {0, 0};  // 미등록 주소/신규 슬레이브 초기값용 버스 전체 추정
 
-while (millis() - startTime < timeout) {
-while (RS485_SENSING_SERIAL.available()) {
-response[responseLen++] = RS485_SENSING_SERIAL.read();
+void rttSample(RttEstimator& e, uint16_t rttMs)
+{
+  if (rttMs == 0) rttMs = 1;  // srtt8 == 0은 "샘플 없음" 표시
+  if (e.srtt8 == 0) {
+    e.srtt8 = rttMs << 3;     // SRTT = R
+    e.rttvar4 = rttMs << 1;   // RTTVAR = R/2
+    return;
+  }
+  int16_t err = (int16_t)rttMs - (int16_t)(e.srtt8 >> 3);
+  e.srtt8 += err;                              // SRTT += err/8
+  if (err < 0) err = -err;
+  e.rttvar4 += err - (int16_t)(e.rttvar4 >> 2); // RTTVAR += (|err| - RTTVAR)/4
+}
 
-if (responseLen == 3) {
-uint8_t byteCount = response[2];
-expectedLen = (uint8_t)(byteCount + 5);
+uint16_t rttTimeoutMs(const RttEstimator& e, uint8_t backoff)
+{
+  uint32_t rto = e.srtt8 ? (uint32_t)(e.srtt8 >> 3) + e.rttvar4 : MODBUS_RTO_INIT_MS;
+  if (rto < MODBUS_RTO_MIN_MS) rto = MODBUS_RTO_MIN_MS;
+  if (backoff > 3) backoff = 3;
+  rto <<= backoff;
+  return rto > MODBUS_RTO_MAX_MS ? MODBUS_RTO_MAX_MS : (uint16_t)rto;
 }
-if (expectedLen && responseLen >= expectedLen) {
-// 충분히 받았음
-goto RX_DONE;
+
+uint16_t modbusRtoForSlave(uint8_t slaveAddr)
+{
+  int idx = findModbusSensor(slaveAddr);
+  if (idx < 0) return rttTimeoutMs(modbusBusRtt, 0);
+  return rttTimeoutMs(modbusSensors[idx].rtt, modbusSensors[idx].consecutiveFailures);
 }
-if (responseLen >= 250) goto RX_DONE; // 안전 상한
+
+// 트랜잭션 결과로 슬레이브 링크 상태 갱신 (응답이 있었으면 예외/CRC 오류도 RTT 샘플로 사용)
+static void mbUpdateLinkStats(uint8_t slaveAddr, ModbusResult result)
+{
+  int idx = findModbusSensor(slaveAddr);
+  if (result != MB_RESULT_TIMEOUT) {
+    rttSample(modbusBusRtt, mbLastRttMs);
+    if (idx < 0) return;
+    ModbusSlave& s = modbusSensors[idx];
+    rttSample(s.rtt, mbLastRttMs);
+    s.consecutiveFailures = 0;
+    s.isOnline = true;
+    s.lastSeenTick = modbusNowTick();
+    return;
+  }
+  if (idx < 0) return;
+  ModbusSlave& s = modbusSensors[idx];
+  if (s.consecutiveFailures < 31) s.consecutiveFailures++;
+  if (s.consecutiveFailures == MODBUS_OFFLINE_FAILURES && s.isOnline) {
+    s.isOnline = false;
+    s.regsValid = false;  // 오프라인 센서 값은 캐시로 내주지 않음
+    Serial.print(F("❌ 센서 ")); Serial.print(slaveAddr);
+    Serial.print(F(" 오프라인 (연속 타임아웃, RTO="));
+    Serial.print(modbusRtoForSlave(slaveAddr));
+    Serial.println(F("ms)"));
+  }
 }
-// (짧게 양보)
-delayMicroseconds(100);
+
+uint16_t modbusMasterLastRttMs()
+{
+  return mbLastRttMs;
 }
 
-RX_DONE:
-if (responseLen < 5) return false;
+// ---- 요청 합류 (coalescing) ----
+// 큐 슬롯 하나에 여러 콜백을 연결: 응답 1회로 모두 완료
+struct ModbusCoalesceWaiter {
+  uint8_t slot;  // mbQueue 인덱스 + 1, 0 = 미사용
+  ModbusDoneCallback cb;
+  void* ctx;
+};
+static ModbusCoalesceWaiter mbWaiters[MODBUS_COALESCE_MAX];
+static uint8_t mbWaiterCount = 0;
+
+static uint16_t mbFrameWord(const uint8_t* frame, uint8_t pos)
+{
+  return ((uint16_t)frame[pos] << 8) | frame[pos + 1];
+}
 
-uint16_t receivedCRC   = (response[responseLen - 1] << 8) | response[responseLen - 2];
-uint16_t calculatedCRC = calcCRC16(response, responseLen - 2);
-return (receivedCRC == calculatedCRC);
+// 같은 주소/시작 레지스터의 대기 중 FC 0x03 요청을 찾아 합류 (필요하면 아직 송신 전인 요청의 개수를 확장)
+static bool mbTryCoalesce(uint8_t slaveAddr, uint16_t startReg, uint16_t regCount,
+                          ModbusDoneCallback cb, void* ctx)
+{
+  if (mbWaiterCount >= MODBUS_COALESCE_MAX) return false;
+  for (uint8_t k = 0; k < mbCount; k++) {
+    uint8_t slot = (mbHead + k) % MODBUS_MASTER_QUEUE_SIZE;
+    ModbusMasterRequest& rq = mbQueue[slot];
+    if (rq.frame[0] != slaveAddr || rq.frame[1] != 0x03) continue;
+    if (mbFrameWord(rq.frame, 2) != startReg) continue;
+    if (mbFrameWord(rq.frame, 4) < regCount) {
+      bool sent = (k == 0 && mbState != MB_STATE_IDLE);
+      if (sent || (uint16_t)(3 + regCount * 2 + 2) > MODBUS_MASTER_RX_MAX) continue;
+      rq.frame[4] = highByte(regCount);
+      rq.frame[5] = lowByte(regCount);
+      crc16Append(rq.frame, 6);
+    }
+    for (uint8_t w = 0; w < MODBUS_COALESCE_MAX; w++) {
+      if (mbWaiters[w].slot != 0) continue;
+      mbWaiters[w].slot = slot + 1;
+      mbWaiters[w].cb = cb;
+      mbWaiters[w].ctx = ctx;
+      mbWaiterCount++;
+      modbusCacheStats.coalesced++;
+      return true;
+    }
+    return false;
+  }
+  return false;
 }
-*/
 
+bool modbusMasterSubmit(uint8_t slaveAddr, uint8_t functionCode,
+                        uint16_t startReg, uint16_t regCount,
+                        uint16_t timeoutMs, ModbusDoneCallback cb, void* ctx)
+{
+  if (functionCode == 0x03 && mbTryCoalesce(slaveAddr, startReg, regCount, cb, ctx)) return true;
+  if (mbCount >= MODBUS_MASTER_QUEUE_SIZE) return false;
+
+  ModbusMasterRequest& rq = mbQueue[(mbHead + mbCount) % MODBUS_MASTER_QUEUE_SIZE];
+  rq.frame[0] = slaveAddr;
+  rq.frame[1] = functionCode;
+  rq.frame[2] = highByte(startReg);
+  rq.frame[3] = lowByte(startReg);
+  rq.frame[4] = highByte(regCount);
+  rq.frame[5] = lowByte(regCount);
+  crc16Append(rq.frame, 6);
+  rq.timeoutMs = timeoutMs;
+  rq.cb = cb;
+  rq.ctx = ctx;
+  mbCount++;
+  return true;
+}
 
-// void setRS485SensingTransmitMode() {
-//   digitalWrite(RS485_SENSING_DE_RE_PIN, HIGH);
-//   delayMicroseconds(50);
-// }
+static ModbusResult mbValidateResponse(const ModbusMasterRequest& rq)
+{
+  if (mbRxLen < 5) return MB_RESULT_BAD_FRAME;
+  if (mbRxCrc != CRC16_MODBUS_RESIDUE) return MB_RESULT_CRC_ERROR;
+  if (mbRx[0] != rq.frame[0]) return MB_RESULT_BAD_FRAME;
+  if (mbRx[1] & 0x80) return MB_RESULT_EXCEPTION;
+  if (mbRx[1] != rq.frame[1]) return MB_RESULT_BAD_FRAME;
+  return MB_RESULT_OK;
+}
 
-// void setRS485SensingReceiveMode() {
-//   digitalWrite(RS485_SENSING_DE_RE_PIN, LOW);
-//   delayMicroseconds(50);
-// }
+// 정상 FC 0x03 응답(시작 레지스터 0)은 등록된 슬레이브의 레지스터 캐시에 기록
+static void mbCacheStore(const uint8_t* req, ModbusResult result)
+{
+  if (result != MB_RESULT_OK || req[1] != 0x03 || mbFrameWord(req, 2) != 0) return;
+  int idx = findModbusSensor(req[0]);
+  if (idx < 0) return;
+  uint16_t regs[MODBUS_PUSH_MAX_REGS];
+  uint8_t n = mbRx[2] / 2;
+  if (n > MODBUS_PUSH_MAX_REGS) n = MODBUS_PUSH_MAX_REGS;
+  for (uint8_t k = 0; k < n; k++) regs[k] = mbFrameWord(mbRx, 3 + k * 2);
+  modbusSetRegs(idx, regs, n);
+}
 
-uint16_t calcCRC16(const uint8_t *buf, uint8_t len)
+// 큐에서 제거 후 콜백 호출 (콜백 안에서 다음 요청 제출 가능)
+static void mbFinish(ModbusResult result)
 {
-  uint16_t crc = 0xFFFF;
-  for (uint8_t i = 0; i < len; i++)
-  {
-    crc ^= buf[i];
-    for (uint8_t j = 0; j < 8; j++)
-    {
-      if (crc & 0x0001)
-      {
-        crc = (crc >> 1) ^ 0xA001;
-      }
-      else
-      {
-        crc >>= 1;
-      }
-    }
+  ModbusDoneCallback cb = mbQueue[mbHead].cb;
+  void* ctx = mbQueue[mbHead].ctx;
+  uint8_t slaveAddr = mbQueue[mbHead].frame[0];
+  uint8_t slot = mbHead;
+
+  // 합류한 대기자는 꺼내 두고 슬롯 해제 (콜백 안의 재제출이 같은 슬롯을 쓸 수 있음)
+  ModbusCoalesceWaiter waiters[MODBUS_COALESCE_MAX];
+  uint8_t waiterCount = 0;
+  for (uint8_t w = 0; w < MODBUS_COALESCE_MAX && mbWaiterCount; w++) {
+    if (mbWaiters[w].slot != slot + 1) continue;
+    waiters[waiterCount++] = mbWaiters[w];
+    mbWaiters[w].slot = 0;
+    mbWaiterCount--;
+  }
+  mbCacheStore(mbQueue[slot].frame, result);
+
+  mbHead = (mbHead + 1) % MODBUS_MASTER_QUEUE_SIZE;
+  mbCount--;
+  mbState = MB_STATE_IDLE;
+  mbBusIdleUs = micros();
+  mbLastRttMs = (uint16_t)(millis() - mbRxStartMs);
+  mbUpdateLinkStats(slaveAddr, result);
+
+#if SCAN_DEBUG
+  Serial.print(F("[MB] done result=")); Serial.print((uint8_t)result);
+  Serial.print(F(" len=")); Serial.println(mbRxLen);
+#endif
+  if (cb) cb(result, mbRx, mbRxLen, ctx);
+  for (uint8_t w = 0; w < waiterCount; w++) {
+    if (waiters[w].cb) waiters[w].cb(result, mbRx, mbRxLen, waiters[w].ctx);
   }
-  return crc;
 }
 
-// ============= Serial1(Modbus RTU) 마스터 함수 (센서 전용 UNO와 통신) =============
-bool sendModbusRequest(uint8_t slaveAddr, uint8_t functionCode,
-                       uint16_t startReg, uint16_t regCount,
-                       uint8_t *response, uint8_t &responseLen,
-                       uint16_t timeout)
+void modbusMasterPoll()
 {
-  
-  uint8_t request[8];
-  request[0] = slaveAddr;
-  request[1] = functionCode;
-  request[2] = highByte(startReg);
-  request[3] = lowByte(startReg);
-  request[4] = highByte(regCount);
-  request[5] = lowByte(regCount);
-
-  uint16_t crc = calcCRC16(request, 6);
-  request[6] = lowByte(crc);
-  request[7] = highByte(crc);
-
-  // 수신버퍼 비우기
-  while (RS485_SENSING_SERIAL.available()) RS485_SENSING_SERIAL.read();
-
-  // 송신 모드 전환 + 가드
-  RS485_SENS_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
+  switch (mbState) {
+    case MB_STATE_IDLE: {
+      // 수신 잔여 바이트(푸시 프레임)는 pollUnoPushFrames()가 먼저 소비하도록 양보
+      if (RS485_SENSING_SERIAL.available()) return;
+      if (micros() - mbBusIdleUs < MODBUS_T35_US) return;
+      if (tdmaBeaconDue()) {
+        tdmaBuildBeacon();
+        mbTxFrame = tdmaBeacon;
+        mbTxBeacon = true;
+        RS485_SENS_TX();
+        mbStateUs = micros();
+        mbState = MB_STATE_TX_GUARD;
+        return;
+      }
+      if (mbCount == 0) return;
+      // 자동 타임아웃은 송신 시점의 학습값으로 확정
+      ModbusMasterRequest& rq = mbQueue[mbHead];
+      uint16_t timeoutMs = rq.timeoutMs == MODBUS_TIMEOUT_AUTO ? modbusRtoForSlave(rq.frame[0]) : rq.timeoutMs;
+      // 응답 대기가 UNO 푸시 슬롯을 침범하지 않도록 마스터 슬롯 남은 시간으로 제한
+      uint16_t windowMs = tdmaMasterWindowMs();
+      if (windowMs < MODBUS_RTO_MIN_MS) {
+        if (!mbTdmaWaiting) tdmaStats.deferred++;  // 대기 구간마다 1회 집계
+        mbTdmaWaiting = true;
+        return;
+      }
+      mbTdmaWaiting = false;
+      rq.timeoutMs = timeoutMs < windowMs ? timeoutMs : windowMs;
+      mbTxFrame = rq.frame;
+      mbTxBeacon = false;
+      RS485_SENS_TX();
+      mbStateUs = micros();
+      mbState = MB_STATE_TX_GUARD;
+      return;
+    }
 
-  // 전송
-  RS485_SENSING_SERIAL.write(request, sizeof(request));
+    case MB_STATE_TX_GUARD:
+      if (micros() - mbStateUs < RS485_TURNAROUND_US) return;
+      mbTxDone = false;
+      RS485_SENSING_SERIAL.write(mbTxFrame, 8);
+      UCSR1B |= _BV(TXCIE1);
 #if SCAN_DEBUG
-  Serial.print(F("[SCAN][TX a=")); Serial.print(slaveAddr); Serial.print(F(" fc=")); Serial.print(functionCode, HEX); Serial.print(F("] "));
-  for (uint8_t i=0;i<sizeof(request);i++){ Serial.print(F("0x")); Serial.print(request[i], HEX); Serial.print(F(" ")); }
-  Serial.println();
+      Serial.print(F("[SCAN][TX a=")); Serial.print(mbTxFrame[0]); Serial.print(F(" fc=")); Serial.print(mbTxFrame[1], HEX); Serial.println(F("]"));
 #endif
-  RS485_SENSING_SERIAL.flush();
-
-  // 수신 모드 전환 + 가드
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_SENS_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+      mbStateUs = micros();
+      mbState = MB_STATE_TX;
+      return;
 
-  // 응답 수신
-  uint32_t startTime = millis();
-  responseLen = 0;
-  uint8_t expectedLen = 0;
+    case MB_STATE_TX:
+      if (!mbTxDone) {
+        // ISR 누락 대비: 8바이트 @57600bps ≈ 1.4ms, 20ms 지나면 강제 전환
+        if (micros() - mbStateUs < 20000UL) return;
+        UCSR1B &= ~_BV(TXCIE1);
+        RS485_SENS_RX();
+      }
+      if (mbTxBeacon) {
+        // 비콘은 응답 없음: 송신 완료 시각이 UNO 측 사이클 기준점
+        mbTxBeacon = false;
+        tdmaEpochMs = millis();
+        tdmaStarted = true;
+        tdmaStats.beacons++;
+        mbBusIdleUs = micros();
+        mbState = MB_STATE_IDLE;
+        return;
+      }
+      mbRxLen = 0;
+      mbExpectedLen = 0;
+      mbRxCrc = CRC16_MODBUS_INIT;
+      mbRxStartMs = millis();
+      mbLastRxUs = micros();
+      mbState = MB_STATE_RX;
+      // fall through
+
+    case MB_STATE_RX: {
+      while (RS485_SENSING_SERIAL.available()) {
+        uint8_t b = RS485_SENSING_SERIAL.read();
+        if (mbRxLen < sizeof(mbRx)) {
+          mbRx[mbRxLen++] = b;
+          mbRxCrc = crc16Update(mbRxCrc, b);
+        }
+        mbLastRxUs = micros();
+        if (mbRxLen == 3) {
+          // 예외 응답: [addr][fc|0x80][code][crc2], 0x03/0x11: [addr][fc][byteCount][data...][crc2]
+          if (mbRx[1] & 0x80) mbExpectedLen = 5;
+          else if (mbRx[1] == 0x03 || mbRx[1] == 0x11) mbExpectedLen = (uint8_t)(mbRx[2] + 5);
+        }
+        if (mbExpectedLen && mbRxLen >= mbExpectedLen) {
+          mbFinish(mbValidateResponse(mbQueue[mbHead]));
+          return;
+        }
+      }
 
-  while (millis() - startTime < timeout)
-  {
-    while (RS485_SENSING_SERIAL.available())
-    {
-      response[responseLen++] = RS485_SENSING_SERIAL.read();
-      if (responseLen == 3)
-      {
-        uint8_t byteCount = response[2];
-        expectedLen = (uint8_t)(byteCount + 5);
+      if (mbRxLen > 0) {
+        // 기대 길이를 모르는 응답은 t3.5 무음으로 프레임 종료 판정
+        if (micros() - mbLastRxUs >= MODBUS_T35_US) mbFinish(mbValidateResponse(mbQueue[mbHead]));
+      } else if (millis() - mbRxStartMs >= mbQueue[mbHead].timeoutMs) {
+        mbFinish(MB_RESULT_TIMEOUT);
       }
-      if (expectedLen && responseLen >= expectedLen) goto RX_DONE;
-      if (responseLen >= 250) goto RX_DONE;
+      return;
     }
-    delayMicroseconds(100);
   }
+}
 
-RX_DONE:
-#if SCAN_DEBUG
-  Serial.print(F("[SCAN][RX len=")); Serial.print(responseLen); Serial.print(F("] "));
-  for (uint8_t i=0;i<responseLen;i++){ Serial.print(F("0x")); Serial.print(response[i], HEX); Serial.print(F(" ")); }
-  Serial.println();
-#endif
-  if (responseLen < 5) { 
-#if SCAN_DEBUG
-    Serial.println(F("[SCAN] RX too short")); 
-#endif
-    return false; 
+// 응답 프레임에서 레지스터 추출 (FC 0x03)
+static uint8_t extractRegisters(const uint8_t* frame, uint8_t len, uint16_t* regs, uint8_t maxRegs)
+{
+  uint8_t regCount = frame[2] / 2;
+  if (regCount > maxRegs) regCount = maxRegs;
+  if ((uint8_t)(3 + regCount * 2) > len) return 0;
+  for (uint8_t i = 0; i < regCount; i++) {
+    regs[i] = (frame[3 + i * 2] << 8) | frame[4 + i * 2];
   }
-  {
-    uint16_t receivedCRC   = (response[responseLen - 1] << 8) | response[responseLen - 2];
-    uint16_t calculatedCRC = calcCRC16(response, responseLen - 2);
-    bool ok = (receivedCRC == calculatedCRC);
-    
-#if SCAN_DEBUG
-    Serial.print(F("[SCAN] CRC rx=")); Serial.print(receivedCRC, HEX); Serial.print(F(" calc=")); Serial.print(calculatedCRC, HEX); Serial.print(F(" -> "));
-    Serial.println(ok ? F("OK") : F("FAIL"));
-#endif
-    return ok;
+  return regCount;
+}
+
+// ============= 주소 범위 스캔 (UNO 래핑 포함) =============
+// Phase 2: Combined ID를 고려한 센서 추가 함수
+static void addDiscoveredSensor(uint8_t combinedId, modbusSensorType type)
+{
+  // Phase 2: 중복 방지 (Combined ID로 비교)
+  if (modbusSlotById[combinedId] != 0) return;
+  uint8_t regCount = modbusTypeRegCount(type);
+  if (modbusSlaveCount >= MAX_MODBUS_SLAVES || modbusRegPoolUsed + regCount > MODBUS_REG_POOL_SIZE) {
+    modbusRegistryDropped++;
+    Serial.print(F("⚠️ 센서 레지스트리 가득 참 - Combined ID "));
+    Serial.print(combinedId);
+    Serial.print(F(" 등록 불가 (센서 "));
+    Serial.print(modbusSlaveCount);
+    Serial.print(F("/"));
+    Serial.print(MAX_MODBUS_SLAVES);
+    Serial.print(F(", 레지스터 "));
+    Serial.print(modbusRegPoolUsed);
+    Serial.print(F("/"));
+    Serial.print(MODBUS_REG_POOL_SIZE);
+    Serial.println(F(")"));
+    return;
   }
+
+  ModbusSlave &s = modbusSensors[modbusSlaveCount];
+  s.slaveId = combinedId;  // Combined ID 저장 (이름은 printModbusSensorName()으로 출력)
+  s.type = type;
+  s.regOffset = modbusRegPoolUsed;
+  s.regCount = regCount;
+  s.active = true;
+  s.isOnline = true;
+  s.consecutiveFailures = 0;
+  s.regsValid = false;
+  s.lastSeenTick = modbusNowTick();
+  s.regStampMs = 0;
+  s.rtt = modbusBusRtt;  // 버스 전체 추정값에서 시작
+  memset(&modbusRegPool[modbusRegPoolUsed], 0, regCount * sizeof(uint16_t));
+  modbusRegPoolUsed += regCount;
+  modbusSlaveCount++;
+  modbusSlotById[combinedId] = modbusSlaveCount;
 }
 
-bool readModbusRegisters(uint8_t slaveAddr, uint16_t startAddr, uint16_t count, uint16_t *data)
+int findModbusSensor(uint8_t combinedId)
 {
-  uint8_t response[50];
-  uint8_t respLen;
-  if (sendModbusRequest(slaveAddr, 0x03, startAddr, count, response, respLen, 300))
-  {
-    // 기본 검증: 주소/예외코드
-    if (respLen < 5) return false;
-    if (response[0] != slaveAddr) return false;
-    if (response[1] & 0x80) return false; // 예외 응답
-    
-    for (uint16_t i = 0; i < count && i < 10; i++)
-    {
-      data[i] = (response[3 + i * 2] << 8) | response[4 + i * 2];
-    }
-    return true;
+  uint8_t slot = modbusSlotById[combinedId];
+  return slot ? (int)slot - 1 : -1;
+}
+
+void clearModbusRegistry()
+{
+  modbusSlaveCount = 0;
+  modbusRegPoolUsed = 0;
+  memset(modbusSlotById, 0, sizeof(modbusSlotById));
+}
+
+void printModbusRegistryUsage()
+{
+  uint16_t fixedBytes = sizeof(modbusSensors) + sizeof(modbusSlotById) + sizeof(modbusRegPool);
+  Serial.print(F("📐 센서 레지스트리: "));
+  Serial.print(modbusSlaveCount);
+  Serial.print(F("/"));
+  Serial.print(MAX_MODBUS_SLAVES);
+  Serial.print(F("개, 레코드 "));
+  Serial.print(sizeof(ModbusSlave));
+  Serial.print(F("B, 레지스터 풀 "));
+  Serial.print(modbusRegPoolUsed);
+  Serial.print(F("/"));
+  Serial.print(MODBUS_REG_POOL_SIZE);
+  if (modbusSlaveCount > 0) {
+    Serial.print(F(", 센서당 "));
+    Serial.print((float)(sizeof(ModbusSlave) * modbusSlaveCount + modbusRegPoolUsed * sizeof(uint16_t)) / modbusSlaveCount, 1);
+    Serial.print(F("B"));
   }
-  return false;
+  Serial.print(F(", 고정 할당 "));
+  Serial.print(fixedBytes);
+  Serial.println(F("B (힙 0B)"));
 }
 
 // 디버그: 센서 전용 UNO(SHT20)에서 주기적으로 TEMP/HUMID 읽기
-void debugPollSHT20FromUno(uint8_t slaveAddr)
+static void onSHT20DebugPoll(ModbusResult result, const uint8_t* frame, uint8_t len, void* ctx)
 {
-  static unsigned long lastPoll = 0;
-  unsigned long now = millis();
-  if (now - lastPoll < 5000) return; // 5초 주기
-  lastPoll = now;
-
+  uint8_t slaveAddr = (uint8_t)(uintptr_t)ctx;
   uint16_t regs[2];
-  if (readModbusRegisters(slaveAddr, 0, 2, regs))
-  {
-    float tempC = regs[0] / 100.0f;
-    float humid = regs[1] / 100.0f;
-    Serial.print(F("Serial1 UNO SHT20 → T="));
-    Serial.print(tempC, 2);
-    Serial.print(F("°C, H="));
-    Serial.print(humid, 2);
-    Serial.println(F("%"));
-
-    // 센서 테이블 업데이트 및 활성화 표시
-    bool updated = false;
-    for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-      if (modbusSensors[i].slaveId == slaveAddr && modbusSensors[i].type == MODBUS_SHT20) {
-        modbusSensors[i].registers[0] = regs[0]; // temp * 100
-        modbusSensors[i].registers[1] = regs[1]; // humid * 100
-        modbusSensors[i].active = true;
-        modbusSensors[i].isOnline = true;
-        modbusSensors[i].lastResponse = millis();
-        updated = true;
-        break;
-      }
-    }
-    if (!updated && modbusSlaveCount < MAX_MODBUS_SLAVES) {
-      modbusSensors[modbusSlaveCount].slaveId = slaveAddr;
-      modbusSensors[modbusSlaveCount].type = MODBUS_SHT20;
-      modbusSensors[modbusSlaveCount].active = true;
-      modbusSensors[modbusSlaveCount].registers[0] = regs[0];
-      modbusSensors[modbusSlaveCount].registers[1] = regs[1];
-      modbusSensors[modbusSlaveCount].name = String("SHT20_") + String(slaveAddr);
-      modbusSensors[modbusSlaveCount].isOnline = true;
-      modbusSensors[modbusSlaveCount].lastResponse = millis();
-      modbusSlaveCount++;
-    }
-    modbusSensorsReady = (modbusSlaveCount > 0);
-  }
-  else
+  if (result != MB_RESULT_OK || extractRegisters(frame, len, regs, 2) < 2)
   {
     Serial.println(F("Serial1 UNO SHT20 읽기 실패"));
     // 링크 점검: 하트비트 시도
     unoHeartbeat(slaveAddr);
+    return;
+  }
+
+  float tempC = regs[0] / 100.0f;
+  float humid = regs[1] / 100.0f;
+  Serial.print(F("Serial1 UNO SHT20 → T="));
+  Serial.print(tempC, 2);
+  Serial.print(F("°C, H="));
+  Serial.print(humid, 2);
+  Serial.println(F("%"));
+
+  // 센서 테이블 업데이트 및 활성화 표시
+  int idx = findModbusSensor(slaveAddr);
+  if (idx < 0) {
+    addDiscoveredSensor(slaveAddr, MODBUS_SHT20);
+    idx = findModbusSensor(slaveAddr);
+  }
+  if (idx >= 0) {
+    modbusSetRegs(idx, regs, 2); // temp * 100, humid * 100
+    modbusSensors[idx].active = true;
+    modbusSensors[idx].isOnline = true;
+    modbusSensors[idx].lastSeenTick = modbusNowTick();
   }
+  modbusSensorsReady = (modbusSlaveCount > 0);
+}
+
+void debugPollSHT20FromUno(uint8_t slaveAddr)
+{
+  static unsigned long lastPoll = 0;
+  unsigned long now = millis();
+  if (now - lastPoll < 5000) return; // 5초 주기
+  lastPoll = now;
+
+  modbusMasterSubmit(slaveAddr, 0x03, 0, 2, MODBUS_TIMEOUT_AUTO, onSHT20DebugPoll, (void*)(uintptr_t)slaveAddr);
 }
 
 // 순환 폴링: 지정한 주소 구간을 라운드로빈으로 읽음
@@ -699,119 +1044,252 @@ void debugPollSHT20Cycle(uint8_t startAddr, uint8_t endAddr)
   current = (current >= endAddr) ? startAddr : (uint8_t)(current + 1);
 }
 
-bool unoHeartbeat(uint8_t slaveAddr)
+static void onHeartbeatDone(ModbusResult result, const uint8_t* frame, uint8_t len, void* ctx)
 {
-  uint8_t resp[32];
-  uint8_t respLen = 0;
-  bool ok = sendModbusRequest(slaveAddr, 0x11, 0, 0, resp, respLen, 300);
-  if (!ok)
+  (void)ctx;
+  if (result == MB_RESULT_TIMEOUT)
   {
     Serial.println(F("HB fail (no response)"));
-    return false;
+    return;
   }
-  if (respLen >= 5 && resp[1] == 0x11)
+  if (result == MB_RESULT_OK && len >= 5)
   {
-    uint8_t byteCount = resp[2];
+    uint8_t byteCount = frame[2];
     Serial.print(F("HB ok: "));
     Serial.print(byteCount);
     Serial.print(F(" bytes: "));
-    for (uint8_t i=0; i<byteCount && (3+i)<respLen-2; i++) Serial.write(resp[3+i]);
+    for (uint8_t i=0; i<byteCount && (3+i)<len-2; i++) Serial.write(frame[3+i]);
     Serial.println();
-    return true;
+    return;
   }
   Serial.println(F("HB fail (malformed)"));
-  return false;
 }
 
-// ============= 주소 범위 스캔 (UNO 래핑 포함) =============
-// Phase 2: Combined ID를 고려한 센서 추가 함수
-static void addDiscoveredSensor(uint8_t combinedId, modbusSensorType type, const char* typeName)
+// 하트비트 요청을 큐에 적재 (결과는 콜백에서 출력)
+bool unoHeartbeat(uint8_t slaveAddr)
 {
-  if (modbusSlaveCount >= MAX_MODBUS_SLAVES) return;
-  // Phase 2: 중복 방지 (Combined ID로 비교)
-  for (uint8_t i=0;i<modbusSlaveCount;i++) if (modbusSensors[i].slaveId == combinedId) return;
-  
-  // Phase 2: Combined ID 분리하여 이름에 UNO_ID 포함
-  uint8_t typeCode = 0;
-  uint8_t unoId = 0;
-  splitCombinedId(combinedId, &typeCode, &unoId);
-  
-  modbusSensors[modbusSlaveCount].slaveId = combinedId;  // Combined ID 저장
-  modbusSensors[modbusSlaveCount].type = type;
-  modbusSensors[modbusSlaveCount].active = true;
-  modbusSensors[modbusSlaveCount].lastRead = 0;
-  // Phase 2: 이름에 타입 코드와 UNO_ID 모두 포함
-  modbusSensors[modbusSlaveCount].name = String(typeName) + "_T" + String(typeCode) + "_U" + String(unoId);
-  modbusSensors[modbusSlaveCount].isOnline = true;
-  modbusSensors[modbusSlaveCount].lastResponse = millis();
-  modbusSensors[modbusSlaveCount].consecutiveFailures = 0;
-  modbusSlaveCount++;
+  return modbusMasterSubmit(slaveAddr, 0x11, 0, 0, MODBUS_TIMEOUT_AUTO, onHeartbeatDone, nullptr);
 }
 
-void scanAllUnoSensors()
-{
-  Serial.println(F("🔍 UNO 래핑 센서 스캔 시작..."));
-  modbusSlaveCount = 0;
-  // 스캔 전 버퍼 드레인 (ASCII/잔여 프레임 제거)
-  unsigned long t0 = millis();
-  while (RS485_SENSING_SERIAL.available() && (millis()-t0) < 50) RS485_SENSING_SERIAL.read();
+// ============= 백그라운드 버스 탐색 (UNO 래핑 센서) =============
+// 기존: 30개 주소를 하나씩 FC03(300ms) → FC 0x11(400ms) 순차 확인, 최악 20초 이상
+// - 후보: Combined ID(UNO 1~6 × 푸시 타입 코드), 옵션으로 레거시 물리 주소 범위
+// - 푸시 프레임으로 이미 등록된 주소는 건너뜀
+// - 엔진 큐에 DISCOVERY_WINDOW개까지 미리 적재해 프로브 사이 공백 제거
+// - 프로브 타임아웃은 관측 RTT로 적응 (무응답 주소 비용 = 타임아웃)
+// - FC 0x11 보조 확인은 무언가 응답했지만 깨진 경우에만 수행 (무응답은 부재로 판단)
+#define DISCOVERY_WINDOW          3
+#define DISCOVERY_UNO_MAX         6     // D38~D43 펄스로 할당되는 UNO ID 1~6
+#define DISCOVERY_TIMEOUT_INIT_MS 60
+#define DISCOVERY_TIMEOUT_MIN_MS  20
+#define DISCOVERY_TIMEOUT_MAX_MS  300
+
+static const uint8_t DISCOVERY_TYPE_CODES[] = {
+  MODBUS_SHT20, MODBUS_SCD41, MODBUS_TSL2591, MODBUS_BH1750, MODBUS_ADS1115, MODBUS_DS18B20,
+  MODBUS_SOIL_SENSOR, MODBUS_WIND_DIRECTION, MODBUS_WIND_SPEED, MODBUS_RAIN_SNOW
+};
+#define DISCOVERY_TYPE_COUNT     (sizeof(DISCOVERY_TYPE_CODES) / sizeof(DISCOVERY_TYPE_CODES[0]))
+#define DISCOVERY_COMBINED_COUNT (DISCOVERY_UNO_MAX * DISCOVERY_TYPE_COUNT)
 
-  struct Range { modbusSensorType type; uint8_t s; uint8_t e; uint8_t testRegs; const char* name; };
-  const Range ranges[] = {
 #if SCAN_LEGACY_MODBUS_RANGES
-    { MODBUS_SOIL_SENSOR,    SOIL_SENSOR_START,    SOIL_SENSOR_END,    8,  "SOIL" },
-    { MODBUS_WIND_DIRECTION, WIND_DIR_START,       WIND_DIR_END,       2,  "WIND_DIR" },
-    { MODBUS_WIND_SPEED,     WIND_SPEED_START,     WIND_SPEED_END,     1,  "WIND_SPEED" },
-    { MODBUS_RAIN_SNOW,      RAIN_SNOW_START,      RAIN_SNOW_END,      10, "RAIN" },
-    { MODBUS_TEMP_HUMID,     TEMP_HUMID_START,     TEMP_HUMID_END,     2,  "MODBUS_T_H" },
-    { MODBUS_PRESSURE,       PRESSURE_START,       PRESSURE_END,       2,  "PRESSURE" },
-    { MODBUS_FLOW,           FLOW_START,           FLOW_END,           2,  "FLOW" },
-    { MODBUS_RELAY,          RELAY_START,          RELAY_END,          1,  "RELAY" },
-    { MODBUS_ENERGY_METER,   ENERGY_METER_START,   ENERGY_METER_END,   5,  "ENERGY" },
+struct UnoScanRange { modbusSensorType type; uint8_t s; uint8_t e; };
+static const UnoScanRange UNO_SCAN_RANGES[] = {
+  { MODBUS_SOIL_SENSOR,    SOIL_SENSOR_START,    SOIL_SENSOR_END },
+  { MODBUS_WIND_DIRECTION, WIND_DIR_START,       WIND_DIR_END },
+  { MODBUS_WIND_SPEED,     WIND_SPEED_START,     WIND_SPEED_END },
+  { MODBUS_RAIN_SNOW,      RAIN_SNOW_START,      RAIN_SNOW_END },
+  { MODBUS_TEMP_HUMID,     TEMP_HUMID_START,     TEMP_HUMID_END },
+  { MODBUS_PRESSURE,       PRESSURE_START,       PRESSURE_END },
+  { MODBUS_FLOW,           FLOW_START,           FLOW_END },
+  { MODBUS_RELAY,          RELAY_START,          RELAY_END },
+  { MODBUS_ENERGY_METER,   ENERGY_METER_START,   ENERGY_METER_END }
+};
+#define UNO_SCAN_RANGE_COUNT (sizeof(UNO_SCAN_RANGES) / sizeof(UNO_SCAN_RANGES[0]))
 #endif
-    // UNO가 래핑한 I2C 범위만 기본 스캔
-    { MODBUS_SHT20,          SHT20_START,          SHT20_END,          2,  "SHT20" },
-    { MODBUS_SCD41,          SCD41_START,          SCD41_END,          1,  "SCD41" },
-    { MODBUS_TSL2591,        TSL2591_START,        TSL2591_END,        1,  "TSL2591" },
-    { MODBUS_BH1750,         BH1750_START,         BH1750_END,         1,  "BH1750" },
-    { MODBUS_ADS1115,        ADS1115_START,        ADS1115_END,        3,  "ADS1115" },
-    { MODBUS_DS18B20,        DS18B20_START,        DS18B20_END,        1,  "DS18B20" }
-  };
 
-  for (const auto &rg : ranges) {
-    Serial.print(F("  ▶ 스캔: ")); Serial.print(rg.name); Serial.print(F(" [")); Serial.print(rg.s); Serial.print(F("-")); Serial.print(rg.e); Serial.println(F("]"));
-    for (uint8_t addr = rg.s; addr <= rg.e && modbusSlaveCount < MAX_MODBUS_SLAVES; addr++) {
-      uint16_t dataBuf[10];
-      bool ok = readModbusRegisters(addr, 0, rg.testRegs, dataBuf);
-      if (ok) {
-        addDiscoveredSensor(addr, rg.type, rg.name);
-        // 초기 데이터 저장(앞의 두 레지스터만)
-        modbusSensors[modbusSlaveCount-1].registers[0] = dataBuf[0];
-        modbusSensors[modbusSlaveCount-1].registers[1] = dataBuf[1];
-        Serial.print(F("    ✅ 발견 @")); Serial.println(addr);
-      } else {
-        // 보조 탐지: FC 0x11(Report Slave ID) 시도
-        uint8_t hbResp[64]; uint8_t hbLen = 0;
-        bool hbOk = sendModbusRequest(addr, 0x11, 0, 0, hbResp, hbLen, 400);
-        if (hbOk && hbLen >= 5 && hbResp[0] == addr && (hbResp[1] == 0x11) && !(hbResp[1] & 0x80)) {
-          Serial.print(F("    🔎 HB 응답 감지 @")); Serial.println(addr);
-          addDiscoveredSensor(addr, rg.type, rg.name);
-          // HB로 존재 확인 시 즉시 데이터 1회 읽어 등록
-          if (readModbusRegisters(addr, 0, rg.testRegs, dataBuf)) {
-            modbusSensors[modbusSlaveCount-1].registers[0] = dataBuf[0];
-            modbusSensors[modbusSlaveCount-1].registers[1] = dataBuf[1];
-          }
-        }
-      }
-      delay(30);
+static bool discRunning = false;
+static uint8_t discCursor = 0;        // 다음 후보 인덱스
+static uint8_t discOutstanding = 0;   // 엔진 큐에 올라간 프로브 수
+static uint8_t discProbes = 0;
+static uint8_t discSkipped = 0;
+static uint8_t discFound = 0;
+static uint16_t discRttMs = 0;        // 관측 RTT (감쇠 최대값)
+static uint16_t discTimeoutMs = DISCOVERY_TIMEOUT_INIT_MS;
+static unsigned long discStartMs = 0;
+
+// i번째 후보 주소/타입 (끝이면 false)
+static bool discoveryCandidate(uint8_t i, uint8_t* addr, modbusSensorType* type)
+{
+  if (i < DISCOVERY_COMBINED_COUNT) {
+    uint8_t typeCode = DISCOVERY_TYPE_CODES[i % DISCOVERY_TYPE_COUNT];
+    *addr = makeCombinedId(typeCode, i / DISCOVERY_TYPE_COUNT + 1);
+    *type = (modbusSensorType)typeCode;
+    return true;
+  }
+#if SCAN_LEGACY_MODBUS_RANGES
+  i -= DISCOVERY_COMBINED_COUNT;
+  for (uint8_t r = 0; r < UNO_SCAN_RANGE_COUNT; r++) {
+    uint8_t n = UNO_SCAN_RANGES[r].e - UNO_SCAN_RANGES[r].s + 1;
+    if (i < n) {
+      *addr = UNO_SCAN_RANGES[r].s + i;
+      *type = UNO_SCAN_RANGES[r].type;
+      return true;
     }
+    i -= n;
   }
+#endif
+  return false;
+}
 
+// 관측 RTT의 2배 + 여유, 오래된 최대값은 1/8씩 감쇠
+static void discoveryObserveRtt(uint16_t rttMs)
+{
+  discRttMs -= discRttMs >> 3;
+  if (rttMs > discRttMs) discRttMs = rttMs;
+  uint16_t t = discRttMs * 2 + 10;
+  if (t < DISCOVERY_TIMEOUT_MIN_MS) t = DISCOVERY_TIMEOUT_MIN_MS;
+  if (t > DISCOVERY_TIMEOUT_MAX_MS) t = DISCOVERY_TIMEOUT_MAX_MS;
+  discTimeoutMs = t;
+}
+
+static void discoveryRegister(uint8_t addr, modbusSensorType type, const uint8_t* frame, uint8_t len)
+{
+  if (findModbusSensor(addr) >= 0) return;  // 탐색 중 푸시 프레임으로 먼저 등록됨
+  addDiscoveredSensor(addr, type);
+  int idx = findModbusSensor(addr);
+  if (idx < 0) return;
+  discFound++;
+  if (frame) {
+    uint16_t regs[10];
+    uint8_t n = extractRegisters(frame, len, regs, 10);
+    modbusSetRegs(idx, regs, n);
+  }
+  Serial.print(F("    ✅ 발견 @")); Serial.print(addr);
+  Serial.print(F(" ")); printModbusSensorName(idx);
+  Serial.print(F(" RTT=")); Serial.print(modbusMasterLastRttMs()); Serial.println(F("ms"));
+}
+
+static void discoveryFill();
+
+static void onDiscoveryHeartbeat(ModbusResult result, const uint8_t* frame, uint8_t len, void* ctx)
+{
+  (void)frame; (void)len;
+  uint16_t packed = (uint16_t)(uintptr_t)ctx;
+  discOutstanding--;
+  if (result == MB_RESULT_OK) {
+    discoveryObserveRtt(modbusMasterLastRttMs());
+    Serial.print(F("    🔎 HB 응답 감지 @")); Serial.println(packed & 0xFF);
+    discoveryRegister(packed & 0xFF, (modbusSensorType)(packed >> 8), nullptr, 0);
+  }
+  discoveryFill();
+}
+
+static void onDiscoveryProbe(ModbusResult result, const uint8_t* frame, uint8_t len, void* ctx)
+{
+  uint16_t packed = (uint16_t)(uintptr_t)ctx;
+  uint8_t addr = packed & 0xFF;
+  discOutstanding--;
+  if (result == MB_RESULT_OK) {
+    discoveryObserveRtt(modbusMasterLastRttMs());
+    discoveryRegister(addr, (modbusSensorType)(packed >> 8), frame, len);
+  } else if (result != MB_RESULT_TIMEOUT) {
+    // 응답은 있었지만 깨짐: FC 0x11(Report Slave ID)로 존재만 확인
+    if (modbusMasterSubmit(addr, 0x11, 0, 0, DISCOVERY_TIMEOUT_MAX_MS, onDiscoveryHeartbeat, ctx)) {
+      discOutstanding++;
+    }
+  }
+  discoveryFill();
+}
+
+static void discoveryFinish()
+{
+  discRunning = false;
   modbusSensorsReady = (modbusSlaveCount > 0);
-  Serial.print(F("📊 발견된 장치 수: ")); Serial.println(modbusSlaveCount);
+  Serial.print(F("📊 버스 탐색 완료: 발견 ")); Serial.print(discFound);
+  Serial.print(F(", 건너뜀(푸시 등록) ")); Serial.print(discSkipped);
+  Serial.print(F(", 프로브 ")); Serial.print(discProbes);
+  Serial.print(F(", 소요 ")); Serial.print(millis() - discStartMs);
+  Serial.print(F("ms, 최종 타임아웃 ")); Serial.print(discTimeoutMs);
+  Serial.println(F("ms"));
+  printModbusRegistryUsage();
+}
+
+// 윈도우가 찰 때까지 다음 후보를 엔진 큐에 적재
+static void discoveryFill()
+{
+  if (!discRunning) return;
+  while (discOutstanding < DISCOVERY_WINDOW && modbusSlaveCount < MAX_MODBUS_SLAVES) {
+    uint8_t addr;
+    modbusSensorType type;
+    if (!discoveryCandidate(discCursor, &addr, &type)) break;
+    if (findModbusSensor(addr) >= 0) {
+      discSkipped++;
+      discCursor++;
+      continue;
+    }
+    uint8_t regCount = modbusTypeRegCount(type);
+    uint16_t packed = addr | ((uint16_t)type << 8);
+    if (!modbusMasterSubmit(addr, 0x03, 0, regCount, discTimeoutMs, onDiscoveryProbe, (void*)(uintptr_t)packed)) {
+      break;  // 엔진 큐 포화: pollUnoDiscovery()에서 재시도
+    }
+    discOutstanding++;
+    discProbes++;
+    discCursor++;
+  }
+
+  uint8_t addr;
+  modbusSensorType type;
+  bool exhausted = !discoveryCandidate(discCursor, &addr, &type) || modbusSlaveCount >= MAX_MODBUS_SLAVES;
+  if (exhausted && discOutstanding == 0) discoveryFinish();
+}
+
+// 탐색 시작만 수행하고 즉시 반환. 진행은 modbusMasterPoll() 콜백과 pollUnoDiscovery()에서 처리
+// 기존 등록(푸시 프레임 포함)은 유지하며 없는 주소만 찾음
+void scanAllUnoSensors()
+{
+  if (discRunning) return;
+  Serial.println(F("🔍 UNO 래핑 센서 백그라운드 탐색 시작..."));
+  discRunning = true;
+  discCursor = 0;
+  discOutstanding = 0;
+  discProbes = 0;
+  discSkipped = 0;
+  discFound = 0;
+  discRttMs = 0;
+  discTimeoutMs = DISCOVERY_TIMEOUT_INIT_MS;
+  discStartMs = millis();
+  discoveryFill();
+}
+
+void pollUnoDiscovery()
+{
+  if (discRunning && discOutstanding < DISCOVERY_WINDOW) discoveryFill();
+}
+
+bool isUnoScanRunning()
+{
+  return discRunning;
 }
 
 // 주기적으로 발견된 UNO 센서 값을 갱신 (간단 폴링)
+static void onRefreshRead(ModbusResult result, const uint8_t* frame, uint8_t len, void* ctx)
+{
+  uint8_t i = (uint8_t)(uintptr_t)ctx;
+  if (result != MB_RESULT_OK || i >= modbusSlaveCount) return;
+
+  uint16_t regs[10];
+  uint8_t n = extractRegisters(frame, len, regs, 10);
+  modbusSetRegs(i, regs, n);
+  modbusSensors[i].isOnline = true;
+  modbusSensors[i].lastSeenTick = modbusNowTick();
+  // 간단 값 로그 (SHT20 우선)
+  if (modbusSensors[i].type == MODBUS_SHT20 && n >= 2) {
+    float t = regs[0] / 100.0f;
+    float h = regs[1] / 100.0f;
+    Serial.print(F("🌡 SHT20@")); Serial.print(modbusSensors[i].slaveId); Serial.print(F(" T=")); Serial.print(t,2); Serial.print(F(" H=")); Serial.println(h,2);
+  }
+}
+
 void refreshUnoWrappedSensors()
 {
   static unsigned long lastRefresh = 0;
@@ -821,6 +1299,12 @@ void refreshUnoWrappedSensors()
 
   for (uint8_t i = 0; i < modbusSlaveCount; i++) {
     if (!modbusSensors[i].active) continue;
+    // 푸시 프레임으로 이미 신선한 값이 있으면 버스 왕복 생략
+    if (modbusRegsFresh(i, modbusCacheTtlMs)) {
+      modbusCacheStats.hits++;
+      continue;
+    }
+    modbusCacheStats.misses++;
     uint8_t addr = modbusSensors[i].slaveId;
     uint8_t regsToRead = 2;
     switch (modbusSensors[i].type) {
@@ -832,534 +1316,1102 @@ void refreshUnoWrappedSensors()
       case MODBUS_DS18B20: regsToRead = 1; break;
       default: regsToRead = 2; break;
     }
-    uint16_t regs[10];
-    if (readModbusRegisters(addr, 0, regsToRead, regs)) {
-      for (uint8_t k=0;k<regsToRead && k<10;k++) modbusSensors[i].registers[k] = regs[k];
-      modbusSensors[i].isOnline = true;
-      modbusSensors[i].lastResponse = now;
-      // 간단 값 로그 (SHT20 우선)
-      if (modbusSensors[i].type == MODBUS_SHT20) {
-        float t = regs[0] / 100.0f;
-        float h = regs[1] / 100.0f;
-        Serial.print(F("🌡 SHT20@")); Serial.print(addr); Serial.print(F(" T=")); Serial.print(t,2); Serial.print(F(" H=")); Serial.println(h,2);
+    // 큐 포화 시 남은 센서는 다음 주기에 갱신
+    if (!modbusMasterSubmit(addr, 0x03, 0, regsToRead, MODBUS_TIMEOUT_AUTO, onRefreshRead, (void*)(uintptr_t)i)) break;
+  }
+}
+
+// ==== UNO 자발 푸시 프레임 수집 ====
+// ============= UNO 푸시 프레임 헌팅 프레이머 =============
+// buf[2](바이트 수)를 바로 신뢰하지 않고 주소/FC/길이 타당성을 먼저 확인
+// CRC 실패·비정상 헤더 시 1바이트씩 밀며 다음 프레임 시작점을 탐색 (뒤따르는 정상 프레임 보존)
+ModbusPushFramerStats pushFramerStats = {0, 0, 0, 0, 0};
+
+static uint8_t pushBuf[MODBUS_PUSH_BUF_SIZE];
+static uint8_t pushLen = 0;
+static uint16_t pushCrc = CRC16_MODBUS_INIT;  // pushBuf[0..pushCrcLen) 누적 CRC
+static uint8_t pushCrcLen = 0;
+
+// Sensor_UNO가 보내는 타입 코드 (Combined ID 하위 5비트)
+static bool isKnownPushTypeCode(uint8_t typeCode)
+{
+  return (typeCode >= 16 && typeCode <= 19) || (typeCode >= 21 && typeCode <= 26);
+}
+
+// 헤더 3바이트가 푸시 프레임으로 그럴듯한지 (길이 필드를 믿기 전 검사)
+static bool isPlausiblePushHeader(uint8_t addr, uint8_t fc, uint8_t byteCount)
+{
+  if (fc != 0x03) return false;
+  if (byteCount == 0 || (byteCount & 0x01) || byteCount > MODBUS_PUSH_MAX_REGS * 2) return false;
+  return isKnownPushTypeCode(addr & 0x1F);
+}
+
+// 앞에서 n바이트 버림 (CRC는 남은 바이트로 다시 누적)
+static void pushFramerDrop(uint8_t n)
+{
+  if (n > pushLen) n = pushLen;
+  uint8_t remain = pushLen - n;
+  if (remain > 0) {
+    memmove(pushBuf, pushBuf + n, remain);
+  }
+  pushLen = remain;
+  pushCrc = CRC16_MODBUS_INIT;
+  pushCrcLen = 0;
+}
+
+static void handleUnoPushFrame(const uint8_t *frame, uint8_t frameLen)
+{
+  uint8_t addr = frame[0];
+  uint8_t byteCount = frame[2];
+
+  uint8_t typeCode = 0;
+  uint8_t unoId = 0;
+  splitCombinedId(addr, &typeCode, &unoId);
+  tdmaCheckPushSlot(unoId);
+
+#if SCAN_DEBUG
+  Serial.print(F("📦 Combined ID 수신: "));
+  Serial.print(addr);
+  Serial.print(F(" → 타입="));
+  Serial.print(typeCode);
+  Serial.print(F(", UNO_ID="));
+  Serial.println(unoId);
+#endif
+
+  // 푸시 타입 코드는 modbusSensorType 값과 동일 (헤더 검사에서 이미 확인됨)
+  modbusSensorType t = (modbusSensorType)typeCode;
+  const __FlashStringHelper *name = modbusTypeName(typeCode);
+
+  int idx = findModbusSensor(addr);
+  if (idx == -1) {
+    addDiscoveredSensor(addr, t);
+    idx = findModbusSensor(addr);
+  }
+  if (idx >= 0) {
+    uint8_t regCount = byteCount / 2;
+    uint16_t regs[MODBUS_PUSH_MAX_REGS];
+    for (uint8_t k = 0; k < regCount; k++) {
+      regs[k] = (frame[3 + k * 2] << 8) | frame[4 + k * 2];
+    }
+    modbusSetRegs(idx, regs, regCount);
+    modbusSensors[idx].isOnline = true;
+    modbusSensors[idx].lastSeenTick = modbusNowTick();
+    modbusSensorsReady = (modbusSlaveCount > 0);
+
+    Serial.print(F("📦 [Serial1] Combined_ID="));
+    Serial.print(addr);
+    Serial.print(F(" (타입="));
+    Serial.print(typeCode);
+    Serial.print(F(", UNO_ID="));
+    Serial.print(unoId);
+    Serial.print(F(") 센서="));
+    Serial.print(name);
+    Serial.print(F(" FC=0x03 BC="));
+    Serial.print(byteCount);
+    Serial.print(F(" CRC_OK"));
+
+    Serial.print(F(" RAW["));
+    for (uint8_t i = 0; i < frameLen && i < 20; i++) {
+      Serial.print(F("0x"));
+      if (frame[i] < 0x10) Serial.print(F("0"));
+      Serial.print(frame[i], HEX);
+      if (i < frameLen - 1) Serial.print(F(" "));
+    }
+    Serial.print(F("]"));
+
+    Serial.print(F(" 값:"));
+    switch (t) {
+      case MODBUS_SHT20: {
+        if (regCount >= 2) {
+          float temp = modbusReg(idx, 0) / 100.0f;
+          float humid = modbusReg(idx, 1) / 100.0f;
+          Serial.print(F(" T=")); Serial.print(temp, 2); Serial.print(F("°C"));
+          Serial.print(F(" H=")); Serial.print(humid, 2); Serial.print(F("%"));
+        }
+        break;
+      }
+      case MODBUS_SCD41: {
+        if (regCount >= 1) {
+          uint16_t co2 = modbusReg(idx, 0);
+          Serial.print(F(" CO2=")); Serial.print(co2); Serial.print(F("ppm"));
+        }
+        break;
+      }
+      case MODBUS_TSL2591:
+      case MODBUS_BH1750: {
+        if (regCount >= 1) {
+          float lux = modbusReg(idx, 0) / 10.0f;
+          Serial.print(F(" LUX=")); Serial.print(lux, 1);
+        }
+        break;
+      }
+      case MODBUS_ADS1115: {
+        if (regCount >= 3) {
+          float ph = modbusReg(idx, 0) / 100.0f;
+          float ec = modbusReg(idx, 1) / 100.0f;
+          float wt = modbusReg(idx, 2) / 100.0f;
+          Serial.print(F(" pH=")); Serial.print(ph, 2);
+          Serial.print(F(" EC=")); Serial.print(ec, 2); Serial.print(F("dS/m"));
+          Serial.print(F(" WT=")); Serial.print(wt, 1); Serial.print(F("°C"));
+        }
+        break;
+      }
+      case MODBUS_DS18B20: {
+        if (regCount >= 1) {
+          float temp = modbusReg(idx, 0) / 100.0f;
+          Serial.print(F(" T=")); Serial.print(temp, 2); Serial.print(F("°C"));
+        }
+        break;
+      }
+      case MODBUS_SOIL_SENSOR: {
+        if (regCount >= 4) {
+          Serial.print(F(" r0=")); Serial.print(modbusReg(idx, 0)); // 습도
+          Serial.print(F(" r1=")); Serial.print(modbusReg(idx, 1)); // 온도
+          Serial.print(F(" r2=")); Serial.print(modbusReg(idx, 2)); // EC
+          Serial.print(F(" r3=")); Serial.print(modbusReg(idx, 3)); // pH
+        } else {
+          Serial.print(F(" r0=")); Serial.print(modbusReg(idx, 0));
+          if (regCount >= 2) {
+            Serial.print(F(" r1=")); Serial.print(modbusReg(idx, 1));
+          }
+        }
+        break;
+      }
+      default: {
+        Serial.print(F(" r0=")); Serial.print(modbusReg(idx, 0));
+        if (regCount >= 2) {
+          Serial.print(F(" r1=")); Serial.print(modbusReg(idx, 1));
+        }
+        break;
       }
     }
+    Serial.println();
+  }
+}
+
+// 버퍼에서 가능한 만큼 프레임 추출
+static void pushFramerScan()
+{
+  while (pushLen >= 3) {
+    if (!isPlausiblePushHeader(pushBuf[0], pushBuf[1], pushBuf[2])) {
+      pushFramerStats.resyncShifts++;
+      pushFramerDrop(1);
+      continue;
+    }
+
+    uint8_t frameLen = pushBuf[2] + 5;
+    // 도착한 바이트만 프레임 경계까지 누적 → 프레임 완성 시 재계산 없이 잔여값만 비교
+    while (pushCrcLen < pushLen && pushCrcLen < frameLen) pushCrc = crc16Update(pushCrc, pushBuf[pushCrcLen++]);
+    if (pushLen < frameLen) return;
+
+    if (pushCrc == CRC16_MODBUS_RESIDUE) {
+      pushFramerStats.framesOk++;
+      handleUnoPushFrame(pushBuf, frameLen);
+      pushFramerDrop(frameLen);
+    } else {
+      pushFramerStats.crcFail++;
+      pushFramerStats.resyncShifts++;
+#if SCAN_DEBUG
+      Serial.print(F("❌ [Serial1] CRC 오류: addr="));
+      Serial.print(pushBuf[0]);
+      Serial.print(F(" residue=0x"));
+      Serial.print(pushCrc, HEX);
+      Serial.print(F(" RAW["));
+      for (uint8_t i = 0; i < frameLen; i++) {
+        Serial.print(F("0x"));
+        if (pushBuf[i] < 0x10) Serial.print(F("0"));
+        Serial.print(pushBuf[i], HEX);
+        if (i < frameLen - 1) Serial.print(F(" "));
+      }
+      Serial.println(F("] → 1바이트 재동기"));
+#endif
+      pushFramerDrop(1);
+    }
   }
 }
 
-// ==== UNO 자발 푸시 프레임 수집 ====
 void pollUnoPushFrames()
 {
-  static uint8_t buf[256];
-  static uint8_t len = 0;
   static unsigned long lastByte = 0;
   static unsigned long lastDebugPrint = 0;
 
+  // 마스터 트랜잭션 진행 중에는 응답 바이트를 엔진이 소유
+  if (modbusMasterBusy()) return;
+
   while (RS485_SENSING_SERIAL.available()) {
     uint8_t byte = RS485_SENSING_SERIAL.read();
     
     // 디버그: 첫 바이트 수신 시 로그 (10초마다)
-    if (len == 0 && (millis() - lastDebugPrint >= 10000)) {
+    if (pushLen == 0 && (millis() - lastDebugPrint >= 10000)) {
       Serial.print(F("📥 [Serial1] 첫 바이트 수신: 0x"));
       if (byte < 0x10) Serial.print(F("0"));
       Serial.println(byte, HEX);
       lastDebugPrint = millis();
     }
 
-    if (len < sizeof(buf)) {
-      buf[len++] = byte;
-    } else {
-      Serial.println(F("⚠️ Serial1 입력 버퍼 초과 - 리셋"));
-      len = 0;
-      continue;
+    // 헤더 검사로 프레임 길이가 제한되므로 정상 동작에서는 넘치지 않음
+    // 넘치면 전체 리셋 대신 가장 오래된 바이트만 버림
+    if (pushLen >= sizeof(pushBuf)) {
+      pushFramerStats.overflow++;
+      pushFramerDrop(1);
     }
+    pushBuf[pushLen++] = byte;
     lastByte = millis();
 
-    while (len >= 3) {
-      uint8_t byteCount = buf[2];
-      uint16_t frameLen = (uint16_t)byteCount + 5;
-      if (len < frameLen) {
-        break;
-      }
+    pushFramerScan();
+  }
 
-      uint16_t rxCrc = (buf[frameLen - 1] << 8) | buf[frameLen - 2];
-      uint16_t calc = calcCRC16(buf, frameLen - 2);
+  // 프레임 중간 무음(20ms): 미완성 프레임의 길이 필드가 깨졌을 수 있으므로
+  // 한 바이트씩 밀며 남은 바이트 안의 완성 프레임을 찾고 나머지는 폐기
+  if (pushLen > 0 && (millis() - lastByte) > 20) {
+    pushFramerStats.timeoutFlush++;
+    while (pushLen > 0) {
+      pushFramerStats.resyncShifts++;
+      pushFramerDrop(1);
+      pushFramerScan();
+    }
+  }
+}
 
-      if (rxCrc == calc && frameLen >= 5) {
-        uint8_t addr = buf[0];
-        uint8_t fc = buf[1];
-        const uint8_t* payload = &buf[3];
+// NPN 모듈(Serial3, 단일 슬레이브) 응답 시간 추정 - 송수신은 NPN 제어 함수에서 갱신
+static RttEstimator npnRtt = {0, 0};
+static uint8_t npnTimeouts = 0;  // 연속 타임아웃 (RTO 백오프 지수)
 
-        // Modbus Read (FC=0x03) 프레임만 처리
-        if (fc == 0x03) {
-          uint8_t typeCode = 0;
-          uint8_t unoId = 0;
-          splitCombinedId(addr, &typeCode, &unoId);
+// ============= 링크 텔레메트리 (modbus/heartbeat) =============
+// 센서 수에 비례해 커지므로 버퍼 없이 스트리밍: 1차로 길이만 세고 2차로 전송
+class CountingPrint : public Print {
+public:
+  size_t count = 0;
+  size_t write(uint8_t) override { count++; return 1; }
+};
 
-#if SCAN_DEBUG
-          Serial.print(F("📦 Combined ID 수신: "));
-          Serial.print(addr);
-          Serial.print(F(" → 타입="));
-          Serial.print(typeCode);
-          Serial.print(F(", UNO_ID="));
-          Serial.println(unoId);
-#endif
+static void printLinkJson(Print& out, const RttEstimator& e, uint8_t backoff)
+{
+  out.print(F("\"srtt\":")); out.print(rttSrttMs(e));
+  out.print(F(",\"rttvar\":")); out.print(rttVarMs(e));
+  out.print(F(",\"rto\":")); out.print(rttTimeoutMs(e, backoff));
+}
 
-          modbusSensorType t = MODBUS_SHT20;
-          const char* name = "UNKNOWN";
-
-          switch (typeCode) {
-            case 21: t = MODBUS_SHT20;    name = "SHT20";    break;
-            case 22: t = MODBUS_SCD41;    name = "SCD41";    break;
-            case 23: t = MODBUS_TSL2591;  name = "TSL2591";  break;
-            case 24: t = MODBUS_BH1750;   name = "BH1750";   break;
-            case 25: t = MODBUS_ADS1115;  name = "ADS1115";  break;
-            case 26: t = MODBUS_DS18B20;  name = "DS18B20";  break;
-            case 19: t = MODBUS_SOIL_SENSOR;     name = "SOIL";     break;
-            case 16: t = MODBUS_WIND_DIRECTION;  name = "WIND_DIR"; break;
-            case 17: t = MODBUS_WIND_SPEED;      name = "WIND_SPD"; break;
-            case 18: t = MODBUS_RAIN_SNOW;       name = "RAIN";     break;
-            default:
-              Serial.print(F("⚠️ Unknown type code: "));
-              Serial.println(typeCode);
-              break;
-          }
+static void writeLinkTelemetry(Print& out)
+{
+  const ModbusPushFramerStats& st = pushFramerStats;
+  out.print(F("{\"device_status\":\"online\",\"sensor_count\":")); out.print(modbusSlaveCount);
+  out.print(F(",\"uptime_s\":")); out.print(millis() / 1000);
+  out.print(F(",\"framer\":{\"ok\":")); out.print(st.framesOk);
+  out.print(F(",\"crc\":")); out.print(st.crcFail);
+  out.print(F(",\"ovf\":")); out.print(st.overflow);
+  out.print(F(",\"to\":")); out.print(st.timeoutFlush);
+  out.print(F(",\"shift\":")); out.print(st.resyncShifts);
+  out.print(F("},\"cache\":{\"hit\":")); out.print(modbusCacheStats.hits);
+  out.print(F(",\"miss\":")); out.print(modbusCacheStats.misses);
+  out.print(F(",\"coal\":")); out.print(modbusCacheStats.coalesced);
+  out.print(F("},\"bus\":{")); printLinkJson(out, modbusBusRtt, 0);
+  out.print(F("},\"npn\":{")); printLinkJson(out, npnRtt, npnTimeouts);
+  out.print(F(",\"fail\":")); out.print(npnTimeouts);
+  out.print(F("},\"slaves\":["));
+  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
+    const ModbusSlave& s = modbusSensors[i];
+    if (i) out.print(',');
+    out.print(F("{\"id\":")); out.print(s.slaveId);
+    out.print(','); printLinkJson(out, s.rtt, s.consecutiveFailures);
+    out.print(F(",\"online\":")); out.print(s.isOnline ? 1 : 0);
+    out.print(F(",\"fail\":")); out.print(s.consecutiveFailures);
+    out.print(F(",\"age_s\":")); out.print(modbusSensorAgeTicks(i));
+    out.print('}');
+  }
+  out.print(F("]}"));
+}
 
-          int idx = -1;
-          for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-            if (modbusSensors[i].slaveId == addr) {
-              idx = i;
-              break;
-            }
-          }
-          if (idx == -1 && modbusSlaveCount < MAX_MODBUS_SLAVES) {
-            addDiscoveredSensor(addr, t, name);
-            idx = modbusSlaveCount - 1;
-          }
-          if (idx >= 0) {
-            uint8_t regCount = byteCount / 2;
-            for (uint8_t k = 0; k < regCount && k < 10; k++) {
-              modbusSensors[idx].registers[k] = (buf[3 + k * 2] << 8) | buf[4 + k * 2];
-            }
-            modbusSensors[idx].isOnline = true;
-            modbusSensors[idx].lastResponse = millis();
-            modbusSensorsReady = (modbusSlaveCount > 0);
-
-            Serial.print(F("📦 [Serial1] Combined_ID="));
-            Serial.print(addr);
-            Serial.print(F(" (타입="));
-            Serial.print(typeCode);
-            Serial.print(F(", UNO_ID="));
-            Serial.print(unoId);
-            Serial.print(F(") 센서="));
-            Serial.print(name);
-            Serial.print(F(" FC=0x03 BC="));
-            Serial.print(byteCount);
-            Serial.print(F(" CRC_OK"));
-
-            Serial.print(F(" RAW["));
-            for (uint8_t i = 0; i < frameLen && i < 20; i++) {
-              Serial.print(F("0x"));
-              if (buf[i] < 0x10) Serial.print(F("0"));
-              Serial.print(buf[i], HEX);
-              if (i < frameLen - 1) Serial.print(F(" "));
-            }
-            Serial.print(F("]"));
-
-            Serial.print(F(" 값:"));
-            switch (t) {
-              case MODBUS_SHT20: {
-                if (regCount >= 2) {
-                  float temp = modbusSensors[idx].registers[0] / 100.0f;
-                  float humid = modbusSensors[idx].registers[1] / 100.0f;
-                  Serial.print(F(" T=")); Serial.print(temp, 2); Serial.print(F("°C"));
-                  Serial.print(F(" H=")); Serial.print(humid, 2); Serial.print(F("%"));
-                }
-                break;
-              }
-              case MODBUS_SCD41: {
-                if (regCount >= 1) {
-                  uint16_t co2 = modbusSensors[idx].registers[0];
-                  Serial.print(F(" CO2=")); Serial.print(co2); Serial.print(F("ppm"));
-                }
-                break;
-              }
-              case MODBUS_TSL2591:
-              case MODBUS_BH1750: {
-                if (regCount >= 1) {
-                  float lux = modbusSensors[idx].registers[0] / 10.0f;
-                  Serial.print(F(" LUX=")); Serial.print(lux, 1);
-                }
-                break;
-              }
-              case MODBUS_ADS1115: {
-                if (regCount >= 3) {
-                  float ph = modbusSensors[idx].registers[0] / 100.0f;
-                  float ec = modbusSensors[idx].registers[1] / 100.0f;
-                  float wt = modbusSensors[idx].registers[2] / 100.0f;
-                  Serial.print(F(" pH=")); Serial.print(ph, 2);
-                  Serial.print(F(" EC=")); Serial.print(ec, 2); Serial.print(F("dS/m"));
-                  Serial.print(F(" WT=")); Serial.print(wt, 1); Serial.print(F("°C"));
-                }
-                break;
-              }
-              case MODBUS_DS18B20: {
-                if (regCount >= 1) {
-                  float temp = modbusSensors[idx].registers[0] / 100.0f;
-                  Serial.print(F(" T=")); Serial.print(temp, 2); Serial.print(F("°C"));
-                }
-                break;
-              }
-              case MODBUS_SOIL_SENSOR: {
-                if (regCount >= 4) {
-                  Serial.print(F(" r0=")); Serial.print(modbusSensors[idx].registers[0]); // 습도
-                  Serial.print(F(" r1=")); Serial.print(modbusSensors[idx].registers[1]); // 온도
-                  Serial.print(F(" r2=")); Serial.print(modbusSensors[idx].registers[2]); // EC
-                  Serial.print(F(" r3=")); Serial.print(modbusSensors[idx].registers[3]); // pH
-                } else {
-                  Serial.print(F(" r0=")); Serial.print(modbusSensors[idx].registers[0]);
-                  if (regCount >= 2) {
-                    Serial.print(F(" r1=")); Serial.print(modbusSensors[idx].registers[1]);
-                  }
-                }
-                break;
-              }
-              default: {
-                Serial.print(F(" r0=")); Serial.print(modbusSensors[idx].registers[0]);
-                if (regCount >= 2) {
-                  Serial.print(F(" r1=")); Serial.print(modbusSensors[idx].registers[1]);
-                }
-                break;
-              }
-            }
-            Serial.println();
-          }
-        } else {
-          Serial.print(F("ℹ️ [Serial1] 알 수 없는 FC 0x"));
-          Serial.print(fc, HEX);
-          Serial.println(F(" 무시"));
-        }
-      } else {
-        Serial.print(F("❌ [Serial1] CRC 오류: addr="));
-        Serial.print(buf[0]);
-        Serial.print(F(" rxCRC=0x"));
-        Serial.print(rxCrc, HEX);
-        Serial.print(F(" calcCRC=0x"));
-        Serial.print(calc, HEX);
-        Serial.print(F(" RAW["));
-        for (uint8_t i = 0; i < frameLen && i < 20; i++) {
-          Serial.print(F("0x"));
-          if (buf[i] < 0x10) Serial.print(F("0"));
-          Serial.print(buf[i], HEX);
-          if (i < frameLen - 1) Serial.print(F(" "));
-        }
-        Serial.println(F("]"));
-      }
+bool publishModbusLinkTelemetry()
+{
+  if (!mqttConnected) return false;
+
+  char topic[64];
+  snprintf_P(topic, sizeof(topic), PSTR("modbus/heartbeat/%s"), DEVICE_ID);
+
+  CountingPrint counter;
+  writeLinkTelemetry(counter);
+  if (!mqttClient.beginPublish(topic, counter.count, false)) return false;
+  writeLinkTelemetry(mqttClient);
+  return mqttClient.endPublish() == 1;
+}
+
+// ============= 센서 업링크 페이로드 (sensors/modbus, 키프레임 v2 / 델타 v3) =============
+SensorUplinkStats sensorUplinkStats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// 강우/강설 센서 레지스터 → 백엔드 2값
+// r0=강우, r1=강설, r3=온도(×10), r4=습도, r5~r9=수분 레벨 1~5
+// value1 = (강수 상태 4비트 << 12) | 수분 레벨 12비트, value2 = (온도+40 << 8) | 습도
+static void packRainSnow(uint8_t idx, uint16_t *vals)
+{
+  uint16_t rainfall = modbusReg(idx, 0);
+  uint16_t snowfall = modbusReg(idx, 1);
+  uint16_t temperature = modbusReg(idx, 3);
+  uint16_t humidity = modbusReg(idx, 4);
+
+  // 강수 상태: 0=건조, 1=강우, 2=강설 (강설 우선)
+  uint8_t precipStatus = 0;
+  if (snowfall > 0) precipStatus = 2;
+  else if (rainfall > 0) precipStatus = 1;
+
+  // 수분 레벨: r5~r9 평균 (12비트 제한)
+  uint32_t moistureSum = 0;
+  for (uint8_t j = 5; j <= 9; j++) moistureSum += modbusReg(idx, j);
+  uint16_t moistureLevel = moistureSum / 5;
+  if (moistureLevel > 4095) moistureLevel = 4095;
+
+  // 온도: ×10 → °C, -40~215 범위를 0~255 바이트로
+  int16_t tempC = (int16_t)temperature / 10;
+  if (tempC < -40) tempC = -40;
+  if (tempC > 215) tempC = 215;
+
+  // 습도: ×10 스케일이면 나누고 0~100%로 제한
+  if (humidity > 1000) humidity /= 10;
+  if (humidity > 100) humidity = 100;
+
+  vals[0] = ((uint16_t)(precipStatus & 0x0F) << 12) | (moistureLevel & 0x0FFF);
+  vals[1] = ((uint16_t)(tempC + 40) << 8) | (uint8_t)humidity;
+}
+
+// 레코드 값 하나 (레지스트리 순서 + 마지막에 제어용 UNO)
+struct UplinkRecord {
+  uint8_t type;
+  uint8_t slaveId;
+  uint8_t ch;
+  uint8_t n;
+  uint16_t vals[SENSOR_UPLINK_MAX_VALUES];
+};
+
+struct UplinkCursor {
+  uint8_t next;           // 다음 레지스트리 인덱스
+  bool unoDone;
+  uint8_t chCounters[5];  // UNO_ID 없는 센서(레거시)의 타입 1~5별 순차 CH
+};
+
+// 다음 레코드 구성, 더 없으면 false
+static bool uplinkNextRecord(UplinkCursor &c, const UnoSensorData *uno, UplinkRecord &r)
+{
+  while (c.next < modbusSlaveCount) {
+    uint8_t i = c.next++;
+    const ModbusSlave &s = modbusSensors[i];
+    if (!s.active) continue;
+
+    // 디스크립터에 없는 타입은 원시 타입 + 레지스터 2개
+    uint8_t codec = UPLINK_CODEC_REGS;
+    r.type = s.type;
+    r.n = 2;
+    int8_t d = findModbusTypeDesc(s.type);
+    if (d >= 0) {
+      r.type = pgm_read_byte(&MODBUS_TYPE_DESCS[d].uplinkType);
+      r.n = pgm_read_byte(&MODBUS_TYPE_DESCS[d].uplinkValues);
+      codec = pgm_read_byte(&MODBUS_TYPE_DESCS[d].uplinkCodec);
+    }
+
+    if (codec == UPLINK_CODEC_RAIN) packRainSnow(i, r.vals);
+    else for (uint8_t k = 0; k < r.n; k++) r.vals[k] = modbusReg(i, k);
+
+    // CH = Combined ID의 UNO_ID (없으면 타입별 순차 할당)
+    uint8_t typeCode = 0;
+    r.slaveId = s.slaveId;
+    splitCombinedId(s.slaveId, &typeCode, &r.ch);
+    if (r.ch == 0 && r.type >= 1 && r.type <= 5) r.ch = ++c.chCounters[r.type - 1];
+    return true;
+  }
+
+  // 제어용 UNO(Serial3)의 pH/EC/수온 - ADS1115 타입, CH 1
+  if (uno && !c.unoDone) {
+    c.unoDone = true;
+    r.type = 3;
+    r.slaveId = 0;
+    r.ch = 1;
+    r.n = 3;
+    r.vals[0] = (uint16_t)constrain(uno->ph * 100, 0, 1400);
+    r.vals[1] = (uint16_t)constrain(uno->ec * 100, 0, 65535);  // dS/m × 100
+    r.vals[2] = (uint16_t)constrain(uno->waterTemp * 100, 0, 10000);
+    return true;
+  }
+  return false;
+}
+
+static void uplinkWriteHeader(Print &out, uint32_t stampMs, uint8_t records, uint8_t schema)
+{
+  uint8_t head[SENSOR_UPLINK_HEADER_BYTES] = {
+    0x01, 0x03,
+    (uint8_t)(stampMs >> 24), (uint8_t)(stampMs >> 16), (uint8_t)(stampMs >> 8), (uint8_t)stampMs,
+    records, schema
+  };
+  out.write(head, sizeof(head));
+}
+
+// 마지막으로 전송에 성공한 키프레임 (델타 기준)
+// - keyStampMs == 0이면 기준 없음 → 다음 전송은 키프레임
+// - 레코드 식별은 순서 + Combined ID (레지스트리가 바뀌면 새 키프레임)
+static uint32_t uplinkKeyStampMs = 0;
+static uint8_t uplinkKeyRecords = 0;
+static uint8_t uplinkKeyIds[SENSOR_UPLINK_MAX_RECORDS];
+static uint8_t uplinkKeyCounts[SENSOR_UPLINK_MAX_RECORDS];
+static uint16_t uplinkKeyVals[SENSOR_UPLINK_MAX_RECORDS][SENSOR_UPLINK_MAX_VALUES];
+static uint8_t uplinkBatchesSinceKey = 0;
+
+// 키프레임 (스키마 v2 그대로): 헤더 + 전체 레코드, 기록한 레코드 수 반환
+// 같은 stampMs/records로 두 번 호출하면 같은 바이트열 (1차 CountingPrint, 2차 mqttClient)
+static uint8_t writeSensorKeyframe(Print &out, uint32_t stampMs, uint8_t records, const UnoSensorData *uno)
+{
+  uplinkWriteHeader(out, stampMs, records, SENSOR_UPLINK_SCHEMA);
+
+  UplinkCursor c;
+  memset(&c, 0, sizeof(c));
+  UplinkRecord r;
+  uint8_t written = 0;
+  while (uplinkNextRecord(c, uno, r)) {
+    // 레코드 단위로 write - 이더넷 드라이버 호출 횟수 절감
+    uint8_t rec[SENSOR_UPLINK_RECORD_HEADER + SENSOR_UPLINK_MAX_VALUES * 2];
+    uint8_t len = 0;
+    rec[len++] = r.type;
+    rec[len++] = r.slaveId;
+    rec[len++] = r.ch;
+    rec[len++] = r.n;
+    for (uint8_t k = 0; k < r.n; k++) {
+      rec[len++] = r.vals[k] >> 8;
+      rec[len++] = r.vals[k] & 0xFF;
+    }
+    out.write(rec, len);
+    written++;
+  }
+  return written;
+}
+
+// zig-zag + LEB128 varint (|차이| < 64 → 1바이트, < 8192 → 2바이트, 그 외 3바이트)
+static uint8_t uplinkPutDelta(uint8_t *p, int16_t delta)
+{
+  uint16_t z = ((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+  uint8_t len = 0;
+  while (z >= 0x80) {
+    p[len++] = (uint8_t)(z | 0x80);
+    z >>= 7;
+  }
+  p[len++] = (uint8_t)z;
+  return len;
+}
+
+// 델타 프레임 (스키마 v3): 헤더 + [키프레임 millis 4B][키프레임 레코드 수] + 바뀐 레코드만
+// 레코드: [키프레임 내 순번][값 마스크] + 마스크 비트마다 (현재값 - 키프레임값) varint
+// 레이아웃이 키프레임과 다르면 layoutOk = false (호출부가 키프레임으로 전환)
+static uint8_t writeSensorDelta(Print &out, uint32_t stampMs, uint8_t changed, const UnoSensorData *uno, bool &layoutOk)
+{
+  uplinkWriteHeader(out, stampMs, changed, SENSOR_UPLINK_SCHEMA_DELTA);
+  uint8_t ref[5] = {
+    (uint8_t)(uplinkKeyStampMs >> 24), (uint8_t)(uplinkKeyStampMs >> 16),
+    (uint8_t)(uplinkKeyStampMs >> 8), (uint8_t)uplinkKeyStampMs,
+    uplinkKeyRecords
+  };
+  out.write(ref, sizeof(ref));
+
+  UplinkCursor c;
+  memset(&c, 0, sizeof(c));
+  UplinkRecord r;
+  uint8_t idx = 0;
+  uint8_t written = 0;
+  layoutOk = true;
+  while (uplinkNextRecord(c, uno, r)) {
+    if (idx >= uplinkKeyRecords || uplinkKeyIds[idx] != r.slaveId || uplinkKeyCounts[idx] != r.n) {
+      layoutOk = false;
+      break;
+    }
+    uint8_t rec[2 + SENSOR_UPLINK_MAX_VALUES * 3];
+    uint8_t len = 2;
+    uint8_t mask = 0;
+    for (uint8_t k = 0; k < r.n; k++) {
+      if (r.vals[k] == uplinkKeyVals[idx][k]) continue;
+      mask |= 1 << k;
+      len += uplinkPutDelta(&rec[len], (int16_t)(r.vals[k] - uplinkKeyVals[idx][k]));
+    }
+    if (mask) {
+      rec[0] = idx;
+      rec[1] = mask;
+      out.write(rec, len);
+      written++;
+    }
+    idx++;
+  }
+  if (idx != uplinkKeyRecords) layoutOk = false;
+  return written;
+}
+
+// ---- 샘플 링: [길이][델타 프레임] 항목을 오래된 순으로 보관 ----
+// 가득 차면 가장 오래된 샘플부터 버림 (전송 실패 시에도 남은 샘플은 다음 배치에 포함)
+static uint8_t uplinkRing[SENSOR_SAMPLE_RING_BYTES];
+static uint16_t uplinkRingHead = 0;  // 가장 오래된 항목 시작
+static uint16_t uplinkRingUsed = 0;  // 길이 바이트 포함
+static uint8_t uplinkRingFrames = 0;
+static bool uplinkKeyDue = false;    // 델타로 표현할 수 없는 변화 → 다음 배치에 키프레임
+static bool uplinkLiveOk = false;    // 직전 라이브 배치 전송 성공 (백로그 재전송 조건)
+
+class UplinkRingPrint : public Print {
+public:
+  size_t write(uint8_t b) override {
+    uplinkRing[(uplinkRingHead + uplinkRingUsed) % SENSOR_SAMPLE_RING_BYTES] = b;
+    uplinkRingUsed++;
+    return 1;
+  }
+};
+
+static void uplinkRingDropOldest()
+{
+  uint8_t len = uplinkRing[uplinkRingHead];
+  uplinkRingHead = (uplinkRingHead + 1 + len) % SENSOR_SAMPLE_RING_BYTES;
+  uplinkRingUsed -= 1 + len;
+  uplinkRingFrames--;
+}
+
+// 링의 프레임 바이트만 (길이 바이트 제외) 순서대로 출력 - 랩 경계에서 최대 2번 write
+static void uplinkRingWriteFrames(Print &out)
+{
+  uint16_t pos = uplinkRingHead;
+  for (uint8_t f = 0; f < uplinkRingFrames; f++) {
+    uint8_t len = uplinkRing[pos];
+    pos = (pos + 1) % SENSOR_SAMPLE_RING_BYTES;
+    uint16_t first = SENSOR_SAMPLE_RING_BYTES - pos;
+    if (first > len) first = len;
+    out.write(&uplinkRing[pos], first);
+    if (len > first) out.write(uplinkRing, len - first);
+    pos = (pos + len) % SENSOR_SAMPLE_RING_BYTES;
+  }
+}
+
+// ---- 오프라인 스필: 링에서 밀려나는 샘플을 SENSOR_SPILL_INTERVAL_MS 간격으로 EEPROM에 보관 ----
+// 항목 형식은 링과 같음 ([길이][프레임]), 가득 차면 오래된 항목부터 버림
+// 인덱스는 SRAM에만 둠 - 스탬프가 부팅 기준 millis라 재부팅 후 백로그는 버림
+// EEPROM 쓰기는 바이트당 ~3.3ms라 스테이징 후 pollSensorSpill()에서 준비될 때마다 1바이트씩
+static uint16_t spillHead = 0;
+static uint16_t spillUsed = 0;   // 기록 완료된 항목만 (길이 바이트 포함)
+static uint16_t spillFrames = 0;
+static uint8_t spillStage[1 + SENSOR_SAMPLE_FRAME_MAX];
+static uint8_t spillStageLen = 0;  // 0이면 기록 중인 항목 없음
+static uint8_t spillStagePos = 0;
+static uint32_t spillLastStampMs = 0;
+static bool spillHasLast = false;
+
+static uint8_t spillRead(uint16_t pos)
+{
+  return EEPROM.read(SENSOR_SPILL_EEPROM_BASE + pos % SENSOR_SPILL_EEPROM_BYTES);
+}
+
+static void spillDropOldest()
+{
+  uint8_t len = spillRead(spillHead);
+  spillHead = (spillHead + 1 + len) % SENSOR_SPILL_EEPROM_BYTES;
+  spillUsed -= 1 + len;
+  spillFrames--;
+}
+
+// 링의 가장 오래된 항목을 스필하거나 버림
+static void uplinkRingEvictOldest()
+{
+  SensorUplinkStats &st = sensorUplinkStats;
+  uint8_t len = uplinkRing[uplinkRingHead];
+  uint32_t stampMs = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    stampMs = (stampMs << 8) | uplinkRing[(uplinkRingHead + 3 + i) % SENSOR_SAMPLE_RING_BYTES];
+  }
+
+  if (spillStageLen == 0 && (!spillHasLast || stampMs - spillLastStampMs >= SENSOR_SPILL_INTERVAL_MS)) {
+    for (uint16_t i = 0; i <= len; i++) {
+      spillStage[i] = uplinkRing[(uplinkRingHead + i) % SENSOR_SAMPLE_RING_BYTES];
+    }
+    while (SENSOR_SPILL_EEPROM_BYTES - spillUsed < len + 1) {
+      spillDropOldest();
+      st.dropped++;
+    }
+    spillStageLen = len + 1;
+    spillStagePos = 0;
+    spillLastStampMs = stampMs;
+    spillHasLast = true;
+    st.spilled++;
+  } else {
+    st.dropped++;
+  }
+  uplinkRingDropOldest();
+}
+
+// 매 루프: 스테이징된 항목을 EEPROM에 1바이트씩 기록 (EEPROM이 바쁘면 다음 루프로)
+// 기록 위치 = 백로그 끝 (재전송이 앞에서 소비해도 head + used는 그대로)
+void pollSensorSpill()
+{
+  if (spillStagePos >= spillStageLen || !eeprom_is_ready()) return;
+  uint16_t pos = spillHead + spillUsed + spillStagePos;
+  EEPROM.update(SENSOR_SPILL_EEPROM_BASE + pos % SENSOR_SPILL_EEPROM_BYTES, spillStage[spillStagePos]);
+  if (++spillStagePos == spillStageLen) {
+    spillUsed += spillStageLen;
+    spillFrames++;
+    spillStageLen = 0;
+    spillStagePos = 0;
+  }
+}
+
+// 전송에 성공한 키프레임을 델타 기준으로 보관 (전송 직후라 레지스터 값은 그대로)
+static void uplinkSnapshotKey(uint32_t stampMs, const UnoSensorData *uno)
+{
+  UplinkCursor c;
+  memset(&c, 0, sizeof(c));
+  UplinkRecord r;
+  uint8_t n = 0;
+  while (n < SENSOR_UPLINK_MAX_RECORDS && uplinkNextRecord(c, uno, r)) {
+    uplinkKeyIds[n] = r.slaveId;
+    uplinkKeyCounts[n] = r.n;
+    memcpy(uplinkKeyVals[n], r.vals, r.n * sizeof(uint16_t));
+    n++;
+  }
+  uplinkKeyRecords = n;
+  uplinkKeyStampMs = stampMs;
+}
+
+static uint32_t uplinkStampMs()
+{
+  uint32_t stampMs = millis();
+  return stampMs ? stampMs : 1;  // 0은 "기준 없음" 표시
+}
+
+// SENSOR_SAMPLE_INTERVAL_MS마다: 현재 값을 키프레임 기준 델타로 링에 적재
+// - 온라인에서 기준 키프레임을 기다리는 중(첫 전송 전, 레이아웃 변경)이면 적재하지 않음
+//   (다음 배치의 꼬리 키프레임이 현재 값을 담음)
+// - 오프라인이면 키프레임(v2) 자체를 샘플로 적재 - 기준 없이 복원 가능
+void sampleSensorPayload(const UnoSensorData *uno)
+{
+  bool deltaOk = SENSOR_UPLINK_KEYFRAME_EVERY != 0 && uplinkKeyStampMs != 0 && !uplinkKeyDue;
+  if (!deltaOk && mqttConnected) return;
+
+  uint32_t stampMs = uplinkStampMs();
+  CountingPrint keyCounter;
+  uint8_t records = writeSensorKeyframe(keyCounter, stampMs, 0, uno);
+  CountingPrint deltaCounter;
+  uint8_t changed = 0;
+  bool layoutOk = false;
+  if (deltaOk) {
+    changed = writeSensorDelta(deltaCounter, stampMs, 0, uno, layoutOk);
+    deltaOk = layoutOk && deltaCounter.count < keyCounter.count && deltaCounter.count <= SENSOR_SAMPLE_FRAME_MAX;
+    if (!deltaOk) {
+      uplinkKeyDue = true;
+      if (mqttConnected) return;
+    }
+  }
 
-      if (frameLen > len) frameLen = len;
-      uint8_t remain = len - frameLen;
-      if (remain > 0) {
-        memmove(buf, buf + frameLen, remain);
+  SensorUplinkStats &st = sensorUplinkStats;
+  uint16_t len = deltaOk ? deltaCounter.count : keyCounter.count;
+  if (len > SENSOR_SAMPLE_FRAME_MAX) {
+    st.dropped++;
+    return;
+  }
+  while (SENSOR_SAMPLE_RING_BYTES - uplinkRingUsed < len + 1) {
+    uplinkRingEvictOldest();
+  }
+  UplinkRingPrint ring;
+  ring.write((uint8_t)len);
+  if (deltaOk) writeSensorDelta(ring, stampMs, changed, uno, layoutOk);
+  else writeSensorKeyframe(ring, stampMs, records, uno);
+  uplinkRingFrames++;
+  st.samples++;
+  st.rawBytes += keyCounter.count;
+}
+
+// 배치 전송: 링의 샘플(오래된 순) + 필요하면 마지막에 현재 상태 프레임
+// - 키프레임 차례(SENSOR_UPLINK_KEYFRAME_EVERY 배치마다, 기준 없음, 레이아웃 변경)면 키프레임을 끝에 붙임
+//   (앞선 델타는 이전 키프레임 기준이므로 백엔드가 순서대로 적용한 뒤 기준을 교체)
+// - 링이 비었으면 현재 델타 1개 (하트비트 겸용)
+// 버퍼 없이 스트리밍: 1차로 길이만 세고 2차로 전송
+bool publishSensorPayload(const UnoSensorData *uno)
+{
+  if (!mqttConnected) return false;
+
+  char topic[48];
+  snprintf_P(topic, sizeof(topic), PSTR("sensors/modbus/%s"), DEVICE_ID);
+
+  uint32_t stampMs = uplinkStampMs();
+  CountingPrint keyCounter;
+  uint8_t records = writeSensorKeyframe(keyCounter, stampMs, 0, uno);
+
+  bool tailKey = SENSOR_UPLINK_KEYFRAME_EVERY == 0 || uplinkKeyStampMs == 0 || uplinkKeyDue ||
+                 uplinkBatchesSinceKey >= SENSOR_UPLINK_KEYFRAME_EVERY - 1;
+  bool tailDelta = false;
+  uint8_t changed = 0;
+  CountingPrint deltaCounter;
+  if (!tailKey && uplinkRingFrames == 0) {
+    bool layoutOk = false;
+    changed = writeSensorDelta(deltaCounter, stampMs, 0, uno, layoutOk);
+    tailDelta = layoutOk && deltaCounter.count < keyCounter.count;
+    tailKey = !tailDelta;
+  }
+
+  uint16_t tailBytes = tailKey ? keyCounter.count : (tailDelta ? deltaCounter.count : 0);
+  uint16_t total = (uplinkRingUsed - uplinkRingFrames) + tailBytes;
+  uint8_t frames = uplinkRingFrames + (tailBytes ? 1 : 0);
+
+  SensorUplinkStats &st = sensorUplinkStats;
+  st.lastBytes = total;
+  st.lastFrames = frames;
+  if (total > st.maxBytes) st.maxBytes = total;
+
+  bool ok = mqttClient.beginPublish(topic, total, false);
+  if (ok) {
+    uplinkRingWriteFrames(mqttClient);
+    if (tailKey) writeSensorKeyframe(mqttClient, stampMs, records, uno);
+    else if (tailDelta) {
+      bool layoutOk;
+      writeSensorDelta(mqttClient, stampMs, changed, uno, layoutOk);
+    }
+    ok = mqttClient.endPublish() == 1;
+  }
+  if (!ok) {
+    // 링은 유지 (가득 차면 오래된 샘플부터 스필/버림), 기준 키프레임도 그대로
+    st.failures++;
+    uplinkLiveOk = false;
+    return false;
+  }
+  uplinkLiveOk = true;
+
+  st.publishes++;
+  st.sentBytes += total;
+  st.deltas += uplinkRingFrames + (tailDelta ? 1 : 0);
+  if (tailBytes) st.rawBytes += keyCounter.count;
+  uplinkRingHead = 0;
+  uplinkRingUsed = 0;
+  uplinkRingFrames = 0;
+
+  if (tailKey) {
+    st.keyframes++;
+    uplinkBatchesSinceKey = 0;
+    uplinkKeyDue = false;
+    if (records <= SENSOR_UPLINK_MAX_RECORDS) uplinkSnapshotKey(stampMs, uno);
+    else uplinkKeyStampMs = 0;
+  } else {
+    uplinkBatchesSinceKey++;
+  }
+  return true;
+}
+
+// 재연결 후 EEPROM 백로그를 SENSOR_REPLAY_INTERVAL_MS마다 최대 SENSOR_REPLAY_MAX_BYTES씩 재전송
+// - 직전 라이브 전송이 성공했을 때만 (라이브 배치가 우선, 실패하면 백로그는 그대로)
+// - 끝에 레코드 0개 v2 헤더(앵커)로 현재 millis 전달 → 백엔드가 원래 시각 계산, 이력으로만 저장
+void replaySensorBacklog()
+{
+  static uint32_t lastReplayMs = 0;
+  if (!mqttConnected || !uplinkLiveOk || spillFrames == 0) return;
+  uint32_t now = millis();
+  if (now - lastReplayMs < SENSOR_REPLAY_INTERVAL_MS) return;
+  lastReplayMs = now;
+
+  // 오래된 순으로 한도까지 (최소 1개)
+  uint16_t frames = 0, bytes = 0, entries = 0;
+  uint16_t pos = spillHead;
+  while (frames < spillFrames) {
+    uint8_t len = spillRead(pos);
+    if (frames && bytes + len > SENSOR_REPLAY_MAX_BYTES) break;
+    bytes += len;
+    entries += 1 + len;
+    pos = (pos + 1 + len) % SENSOR_SPILL_EEPROM_BYTES;
+    frames++;
+  }
+
+  char topic[48];
+  snprintf_P(topic, sizeof(topic), PSTR("sensors/modbus/%s"), DEVICE_ID);
+  uint16_t total = bytes + SENSOR_UPLINK_HEADER_BYTES;
+
+  SensorUplinkStats &st = sensorUplinkStats;
+  bool ok = mqttClient.beginPublish(topic, total, false);
+  if (ok) {
+    uint8_t chunk[32];
+    pos = spillHead;
+    for (uint16_t f = 0; f < frames; f++) {
+      uint8_t len = spillRead(pos++);
+      while (len) {
+        uint8_t n = len < sizeof(chunk) ? len : sizeof(chunk);
+        for (uint8_t i = 0; i < n; i++) chunk[i] = spillRead(pos++);
+        mqttClient.write(chunk, n);
+        len -= n;
       }
-      len = remain;
     }
+    uplinkWriteHeader(mqttClient, uplinkStampMs(), 0, SENSOR_UPLINK_SCHEMA);
+    ok = mqttClient.endPublish() == 1;
   }
+  if (!ok) {
+    st.failures++;
+    return;
+  }
+
+  spillHead = (spillHead + entries) % SENSOR_SPILL_EEPROM_BYTES;
+  spillUsed -= entries;
+  spillFrames -= frames;
+  st.replayed += frames;
+  st.sentBytes += total;
+}
+
+void printSensorUplinkStats()
+{
+  const SensorUplinkStats &st = sensorUplinkStats;
+  Serial.print(F("📤 센서 업링크: 최근 ")); Serial.print(st.lastBytes);
+  Serial.print(F("B/")); Serial.print(st.lastFrames); Serial.print(F("프레임"));
+  Serial.print(F(", 최대 ")); Serial.print(st.maxBytes);
+  Serial.print(F("B, 샘플 ")); Serial.print(st.samples);
+  Serial.print(F(" (링 ")); Serial.print(uplinkRingFrames);
+  Serial.print(F("개/")); Serial.print(uplinkRingUsed);
+  Serial.print(F("B, 버림 ")); Serial.print(st.dropped);
+  Serial.print(F("), 스필 ")); Serial.print(st.spilled);
+  Serial.print(F(" (백로그 ")); Serial.print(spillFrames);
+  Serial.print(F("개/")); Serial.print(spillUsed);
+  Serial.print(F("B, 재전송 ")); Serial.print(st.replayed);
+  Serial.print(F("), 키프레임 ")); Serial.print(st.keyframes);
+  Serial.print(F(", 델타 ")); Serial.print(st.deltas);
+  if (st.rawBytes) {
+    Serial.print(F(" (전체 대비 "));
+    Serial.print((float)st.sentBytes * 100 / st.rawBytes, 0);
+    Serial.print(F("%)"));
+  }
+  Serial.print(F(", 전송 ")); Serial.print(st.publishes);
+  Serial.print(F(", 실패 ")); Serial.println(st.failures);
+}
+
+void printPushFramerStats()
+{
+  const ModbusPushFramerStats &st = pushFramerStats;
+  uint32_t lost = st.crcFail + st.overflow + st.timeoutFlush;
+  Serial.print(F("📊 [Serial1] 푸시 프레임 OK="));
+  Serial.print(st.framesOk);
+  Serial.print(F(" CRC실패="));
+  Serial.print(st.crcFail);
+  Serial.print(F(" 오버플로="));
+  Serial.print(st.overflow);
+  Serial.print(F(" 타임아웃폐기="));
+  Serial.print(st.timeoutFlush);
+  Serial.print(F(" 재동기시프트="));
+  Serial.print(st.resyncShifts);
+  if (st.framesOk + lost > 0) {
+    Serial.print(F(" 손실률="));
+    Serial.print(100.0f * lost / (float)(st.framesOk + lost), 2);
+    Serial.print(F("%"));
+  }
+  Serial.println();
+#if TDMA_ENABLED
+  Serial.print(F("🕒 [Serial1] TDMA 비콘="));
+  Serial.print(tdmaStats.beacons);
+  Serial.print(F(" 슬롯외프레임="));
+  Serial.print(tdmaStats.offSlotFrames);
+  Serial.print(F(" 요청대기="));
+  Serial.print(tdmaStats.deferred);
+  Serial.print(F(" (슬롯 "));
+  Serial.print(TDMA_SLOT_MS);
+  Serial.print(F("ms x "));
+  Serial.print(TDMA_SLOT_COUNT);
+  Serial.println(F(")"));
+#endif
+}
+
+void resetUnoBucketsIfExpired()
+{
+  // 버킷 리셋 기능 제거 (초기 할당만 사용하므로 불필요)
+  // 필요 시 별도 구현
+}
+
+// Phase1-Legacy: // ============= 제어용 UNO(Serial3) 존재 감지 및 활성화 토글 =============
+bool unoControlPresent = false;
+
+static int8_t s3LinkReceive();
+
+void pollUnoControlHandshake()
+{
+  // 실행기가 비어 있을 때만 (응답 대기 중 바이트는 실행기가 같은 프레이머로 소비)
+  if (serial3ExecutorBusy()) return;
+  s3LinkReceive();
+}
+// ============= RS485 제어 함수들 (Serial3 제어용-UNO and NPN)=============
+
+// ============= 릴레이 섀도 상태 =============
+RelayShadow unoRelayShadow = {0};
+RelayShadow npnRelayShadow = {0};
 
-  if (len > 0 && (millis() - lastByte) > 20) {
-    len = 0;
-  }
+#define UNO_RELAY_ALL     ((uint16_t)((1UL << UNO_RELAY_CHANNELS) - 1))
+#define NPN_RELAY_ALL     ((uint16_t)((1UL << TOTAL_NPN_CHANNELS) - 1))
+#define UNO_EC_RELAY_MASK 0x0030   // EC 밸브 2개 (채널 4, 5)
+#define UNO_BED_RELAY_MASK 0x000F  // 베드 A~D (채널 0~3, CMD_BED_ON 파라미터 비트와 동일)
+
+static uint8_t relayBitCount(uint16_t v)
+{
+  uint8_t n = 0;
+  for (; v; v &= v - 1) n++;
+  return n;
 }
 
-void resetUnoBucketsIfExpired()
+// 큐 적재 시 호출 - 완료 전까지 해당 채널은 필터 대상에서 제외
+static void relayShadowSubmit(RelayShadow &sh, uint16_t mask)
 {
-  // 버킷 리셋 기능 제거 (초기 할당만 사용하므로 불필요)
-  // 필요 시 별도 구현
+  sh.pending |= mask;
+  if (sh.inflight < 255) sh.inflight++;
 }
 
-// Phase 1: Legacy - bool unoSensingPresent = false;
-// Phase 1: Legacy - unsigned long lastUnoSensingHelloMs = 0;
-// Phase 1: Legacy - 완전히 제거됨
-// static bool waitingUnoAddr = false;
-// static unsigned long waitingUnoAddrUntil = 0;
-
-// Phase 1: 레거시 UNO_ADDR 헬스체크 방식 - 더 이상 사용하지 않음
-// Phase1-Legacy: // pollUnoPushFrames()가 타입 코드로 직접 인식하므로 불필요
-// Phase1-Legacy: void pollUnoSensingHandshake()
-// Phase1-Legacy: {
-// Phase1-Legacy:   // Phase 1: 비활성화됨 - pollUnoPushFrames() 사용
-// Phase1-Legacy:   return;
-// Phase1-Legacy:   // Serial1(센서용) 라인이 비어 있지 않다면 라인 기반으로 토큰 감지
-// Phase1-Legacy:   if (!RS485_SENSING_SERIAL.available()) return;
-// Phase1-Legacy: 
-// Phase1-Legacy:   static char hbBuf[32];
-// Phase1-Legacy:   static uint8_t hbLen = 0;
-// Phase1-Legacy: 
-// Phase1-Legacy:   while (RS485_SENSING_SERIAL.available())
-// Phase1-Legacy:   {
-// Phase1-Legacy:     char c = (char)RS485_SENSING_SERIAL.read();
-// Phase1-Legacy:     if (c == '\n' || hbLen >= sizeof(hbBuf)-1)
-// Phase1-Legacy:     {
-// Phase1-Legacy:       hbBuf[hbLen] = '\0';
-// Phase1-Legacy:       if (hbLen > 0)
-// Phase1-Legacy:       {
-// Phase1-Legacy:         if (strstr(hbBuf, UNO_SENSING_HELLO) != NULL)
-// Phase1-Legacy:         {
-// Phase1-Legacy:           unsigned long now = millis();
-// Phase1-Legacy:           // 디바운스: 최초 감지 또는 30초 지난 경우만 처리
-// Phase1-Legacy:           if (!unoSensingPresent || (now - lastUnoSensingHelloMs) > 30000) {
-// Phase1-Legacy:             unoSensingPresent = true;
-// Phase1-Legacy:             lastUnoSensingHelloMs = now;
-// Phase1-Legacy:             Serial.println(F("✅ 센서용 UNO 감지됨 - 응답 후 스캔 갱신"));
-// Phase1-Legacy:             // 응답 전송
-// Phase1-Legacy:             RS485_SENS_TX();
-// Phase1-Legacy:             delayMicroseconds(RS485_TURNAROUND_US);
-// Phase1-Legacy:             const char ack[] = "MEGA_SENS_ACK\n";
-// Phase1-Legacy:             for (size_t i=0;i<sizeof(ack)-1;i++) RS485_SENSING_SERIAL.write((uint8_t)ack[i]);
-// Phase1-Legacy:             const char req[] = "MEGA_SENS_REQ_ADDR\n";
-// Phase1-Legacy:             for (size_t i=0;i<sizeof(req)-1;i++) RS485_SENSING_SERIAL.write((uint8_t)req[i]);
-// Phase1-Legacy:             RS485_SENSING_SERIAL.flush();
-// Phase1-Legacy:             delayMicroseconds(RS485_TURNAROUND_US);
-// Phase1-Legacy:             RS485_SENS_RX();
-// Phase1-Legacy:             // 주소 응답 대기 상태 진입 (2초)
-// Phase1-Legacy:             waitingUnoAddr = true;
-// Phase1-Legacy:             waitingUnoAddrUntil = millis() + 2000;
-// Phase1-Legacy:           }
-// Phase1-Legacy:         }
-// Phase1-Legacy:         else if (strstr(hbBuf, UNO_SENSING_ADDR_PREFIX) == hbBuf) {
-// Phase1-Legacy:           // 형식: UNO_ADDR:<num>
-// Phase1-Legacy:           uint8_t addr = (uint8_t)atoi(hbBuf + strlen(UNO_SENSING_ADDR_PREFIX));
-// Phase1-Legacy:           if (addr >= SHT20_START && addr <= DS18B20_END) {
-// Phase1-Legacy:             // 타입 추정
-// Phase1-Legacy:             modbusSensorType t = MODBUS_SHT20;
-// Phase1-Legacy:             const char* name = "SHT20";
-// Phase1-Legacy:             if (addr >= SHT20_START && addr <= SHT20_END) { t = MODBUS_SHT20; name = "SHT20"; }
-// Phase1-Legacy:             else if (addr >= SCD41_START && addr <= SCD41_END) { t = MODBUS_SCD41; name = "SCD41"; }
-// Phase1-Legacy:             else if (addr >= TSL2591_START && addr <= TSL2591_END) { t = MODBUS_TSL2591; name = "TSL2591"; }
-// Phase1-Legacy:             else if (addr >= BH1750_START && addr <= BH1750_END) { t = MODBUS_BH1750; name = "BH1750"; }
-// Phase1-Legacy:             else if (addr >= ADS1115_START && addr <= ADS1115_END) { t = MODBUS_ADS1115; name = "ADS1115"; }
-// Phase1-Legacy:             else if (addr >= DS18B20_START && addr <= DS18B20_END) { t = MODBUS_DS18B20; name = "DS18B20"; }
-// Phase1-Legacy:             addDiscoveredSensor(addr, t, name);
-// Phase1-Legacy:             // 즉시 1회 읽기 시도
-// Phase1-Legacy:             uint16_t regs[3];
-// Phase1-Legacy:             uint8_t cnt = (t==MODBUS_SHT20)?2:(t==MODBUS_ADS1115?3:1);
-// Phase1-Legacy:             if (readModbusRegisters(addr, 0, cnt, regs)) {
-// Phase1-Legacy:               for (uint8_t k=0;k<cnt;k++) modbusSensors[modbusSlaveCount-1].registers[k] = regs[k];
-// Phase1-Legacy:             }
-// Phase1-Legacy:             waitingUnoAddr = false;
-// Phase1-Legacy:             Serial.print(F("📝 등록: addr=")); Serial.print(addr); Serial.print(F(" type=")); Serial.println(name);
-// Phase1-Legacy:           }
-// Phase1-Legacy:         }
-// Phase1-Legacy:       }
-// Phase1-Legacy:       hbLen = 0;
-// Phase1-Legacy:     }
-// Phase1-Legacy:     else
-// Phase1-Legacy:     {
-// Phase1-Legacy:       hbBuf[hbLen++] = c;
-// Phase1-Legacy:     }
-// Phase1-Legacy:   }
-// Phase1-Legacy: 
-// Phase1-Legacy:   // Phase 1: 레거시 코드 제거됨
-// Phase1-Legacy: }
-// Phase1-Legacy: 
-// Phase1-Legacy: // ============= 제어용 UNO(Serial3) 존재 감지 및 활성화 토글 =============
-bool unoControlPresent = false;
+// 완료 콜백에서 호출 (제출한 명령마다 한 번)
+// unknown: 적용 여부를 알 수 없는 실패 (타임아웃/에코 오류) - 해당 채널을 미확인으로
+// toggle: 성공 시 반전 (미확인 채널은 미확인 유지)
+static void relayShadowDone(RelayShadow &sh, bool ok, bool unknown,
+                            uint16_t setMask, uint16_t clearMask, uint16_t toggleMask)
+{
+  if (ok) {
+    sh.state = ((sh.state | setMask) & ~clearMask) ^ toggleMask;
+    sh.known |= setMask | clearMask;
+    sh.confirmedMs = millis();
+  } else if (unknown) {
+    sh.known &= ~(setMask | clearMask | toggleMask);
+  }
+  if (sh.inflight > 0 && --sh.inflight == 0) sh.pending = 0;
+}
 
-void pollUnoControlHandshake()
+uint16_t relayShadowSatisfied(const RelayShadow &sh, uint16_t setMask, uint16_t clearMask)
 {
-  // Serial3이 비어 있고 IDLE일 때만 비간섭 읽기
-  if (serial3Owner != SERIAL3_IDLE) return;
-  if (!RS485_CONTROL_SERIAL.available()) return;
+  if (sh.autonomous || millis() - sh.confirmedMs > RELAY_SHADOW_TRUST_MS) return 0;
+  uint16_t trusted = sh.known & ~sh.pending;
+  return trusted & ((setMask & sh.state) | (clearMask & ~sh.state));
+}
 
-  static char hbBuf[32];
-  static uint8_t hbLen = 0;
+bool relayShadowGet(const RelayShadow &sh, uint8_t channel, bool *on)
+{
+  if (channel >= 16) return false;
+  uint16_t bit = (uint16_t)1 << channel;
+  if (!(sh.known & bit)) return false;
+  *on = (sh.state & bit) != 0;
+  return true;
+}
 
-  while (RS485_CONTROL_SERIAL.available())
-  {
-    char c = (char)RS485_CONTROL_SERIAL.read();
-    if (c == '\n' || hbLen >= sizeof(hbBuf)-1)
-    {
-      hbBuf[hbLen] = '\0';
-      if (hbLen > 0)
-      {
-        if (strstr(hbBuf, UNO_CONTROL_HELLO) != NULL)
-        {
-          if (!unoControlPresent)
-          {
-            unoControlPresent = true;
-            Serial.println(F("✅ 제어용 UNO 감지됨 - Serial3 센서 요청 활성화"));
-          }
-        }
-      }
-      hbLen = 0; // 라인 리셋
-    }
-    else
-    {
-      hbBuf[hbLen++] = c;
-    }
+// UNO 상태 보고 반영: 실제 핀 상태로 전체 교정 (실행기는 한 번에 한 건 - 보고 시점에 실행 중인 명령 없음)
+static void unoRelayShadowReport(uint16_t relayBits, bool autonomous)
+{
+  RelayShadow &sh = unoRelayShadow;
+  relayBits &= UNO_RELAY_ALL;
+  uint16_t diff = (sh.state ^ relayBits) & sh.known;
+  if (diff) {
+    sh.mismatches += relayBitCount(diff);
+    Serial.print(F("🔄 UNO 릴레이 섀도 교정: 0x"));
+    Serial.print(sh.state & sh.known, HEX);
+    Serial.print(F(" → 0x"));
+    Serial.print(relayBits, HEX);
+    Serial.println(autonomous ? F(" (nutCycle 동작 중)") : F(""));
   }
+  sh.state = relayBits;
+  sh.known = UNO_RELAY_ALL;
+  sh.autonomous = autonomous;
+  sh.confirmedMs = millis();
 }
-// UNO가 모든 센서 읽기를 담당하므로 주석처리
-/*
-bool readSoilSensor(uint8_t slaveAddr, SoilData *soilData)
+
+// UNO 단순 명령이 바꾸는 채널 (Command_UNO processRS485Command()와 동일)
+static void unoRelayEffect(uint8_t type, uint8_t param, uint16_t &setMask, uint16_t &clearMask, uint16_t &toggleMask)
 {
-  // NPK가 reg 5,6,7에 있으므로 8개 읽기 (0~7)
-  uint16_t data[8];
-  if (readModbusRegisters(slaveAddr, 0, 8, data))
-  {
-    // 습도/온도: 기존 유지 (센서가 U16×10)
-    soilData->humidity    = data[0] / 10.0f;
-    soilData->temperature = data[1] / 10.0f;
-
-    // === EC ===
-    // reg2=w0, reg3=w1
-    const uint16_t w0 = data[2];
-    const uint16_t w1 = data[3];
-    float ec_raw_uScm = parseEC_uScm_from_w0w1(w0, w1);
-    float ec_corr_uScm = ecCalibrate_uScm(ec_raw_uScm);
-
-    // KS 단위( dS/m )로 저장: μS/cm ÷ 1000
-    soilData->EC = ec_corr_uScm / 1000.0f;
-
-    // === pH (기존 로직 유지) ===
-    // 센서 주소 8 기준: pH RAW는 reg 0x0004, 스케일 U16×100
-    const float ph_raw = data[4] / 100.0f;
-    float ph_corr = phCalibrate(ph_raw);
-    if (ph_corr < 0.0f)  ph_corr = 0.0f;
-    if (ph_corr > 14.5f) ph_corr = 14.5f;
-    soilData->pH = ph_corr;
-
-    // === NPK ===
-    soilData->nitrogen    = data[5];
-    soilData->phosphorus  = data[6];
-    soilData->potassium   = data[7];
-
-    soilData->isValid     = true;
-
-#if 0 // 디버깅: EC/P H 모두 확인
-    Serial.print(F("[SOIL] EC_RAW="));  Serial.print(ec_raw_uScm, 3); Serial.print(F(" μS/cm"));
-    Serial.print(F(" -> EC_CORR="));    Serial.print(ec_corr_uScm, 1); Serial.print(F(" μS/cm ("));
-    Serial.print(soilData->EC, 3); Serial.print(F(" dS/m)"));
-    Serial.print(F(" | w0=")); Serial.print(w0); Serial.print(F(" w1=")); Serial.print(w1);
-    Serial.print(F(" | pH_raw=")); Serial.print(ph_raw, 3);
-    Serial.print(F(" -> pH_corr=")); Serial.println(ph_corr, 3);
-#endif
-    return true;
+  setMask = clearMask = toggleMask = 0;
+  uint16_t bit = (param < UNO_RELAY_CHANNELS) ? ((uint16_t)1 << param) : 0;
+  switch (type) {
+    case CMD_ON:       setMask = bit; break;
+    case CMD_OFF:      clearMask = bit; break;
+    case CMD_TOGGLE:   toggleMask = bit; break;
+    case CMD_EC_PULSE: toggleMask = UNO_EC_RELAY_MASK; break;
+    case CMD_EC_OFF:   clearMask = UNO_EC_RELAY_MASK; break;
+    case CMD_BED_ON:   setMask = param & UNO_BED_RELAY_MASK; break;
+    case CMD_RESET:
+    case CMD_ALLOFF:   clearMask = UNO_RELAY_ALL; break;
   }
-  soilData->isValid = false;
-  return false;
 }
-*/
-
 
+static void unoShadowSubmit(uint8_t type, uint8_t param)
+{
+  uint16_t s, c, t;
+  unoRelayEffect(type, param, s, c, t);
+  if (s | c | t) relayShadowSubmit(unoRelayShadow, s | c | t);
+}
 
-// UNO가 모든 센서 읽기를 담당하므로 주석처리
-/*
-bool readWindDirection(uint8_t slaveAddr, uint16_t *gearValue, uint16_t *degreeValue)
+// LINK 실패: 타임아웃(len 0)만 적용 여부 불명, ACK_ERROR/취소는 미적용
+static void unoShadowDone(uint8_t type, uint8_t param, bool ok, const uint8_t *resp, uint16_t len)
 {
-  uint16_t data[2];
-  if (readModbusRegisters(slaveAddr, 0, 2, data))
-  {
-    *gearValue = data[0];
-    *degreeValue = data[1];
-    return true;
-  }
-  return false;
+  uint16_t s, c, t;
+  unoRelayEffect(type, param, s, c, t);
+  if (s | c | t) relayShadowDone(unoRelayShadow, ok, resp != nullptr && len == 0, s, c, t);
 }
 
-bool readWindSpeed(uint8_t slaveAddr, uint16_t *rawSpeed)
+// NPN 단일 레지스터 명령이 바꾸는 채널 (0x0100 ON, 0x0200 OFF, 0x0800 전체 OFF)
+static void npnRelayEffect(uint8_t channel, uint16_t command, uint16_t &setMask, uint16_t &clearMask)
 {
-  uint16_t data[1];
-  if (readModbusRegisters(slaveAddr, 0, 1, data))
-  {
-    *rawSpeed = data[0];
-    return true;
-  }
-  return false;
+  uint16_t bit = (channel < TOTAL_NPN_CHANNELS) ? ((uint16_t)1 << channel) : 0;
+  setMask = (command == 0x0100) ? bit : 0;
+  clearMask = (command == 0x0200) ? bit : (command == 0x0800) ? NPN_RELAY_ALL : 0;
 }
 
-bool readRainSnowSensor(uint8_t slaveAddr, uint16_t *rainFlag, uint16_t *snowFlag,
-                        float *temperature, uint16_t *humidity, uint16_t *moistureLevel)
+static void printRelayShadowJson(Print &out, const RelayShadow &sh, uint8_t channels)
 {
-  uint16_t data[10];
-  if (readModbusRegisters(slaveAddr, 0, 10, data))
-  {
-    *rainFlag = data[0];
-    *snowFlag = data[1];
-    *temperature = data[3] / 10.0;
-    *humidity = data[4];
-    *moistureLevel = data[5];
-    return true;
+  out.print(F("{\"relays\":["));
+  for (uint8_t i = 0; i < channels; i++) {
+    bool on;
+    if (i) out.print(',');
+    if (relayShadowGet(sh, i, &on)) out.print(on ? 1 : 0);
+    else out.print(F("-1"));
   }
-  return false;
+  out.print(F("],\"pending\":")); out.print(sh.pending);
+  out.print(F(",\"auto\":")); out.print(sh.autonomous ? 1 : 0);
+  out.print(F(",\"age_s\":"));
+  if (sh.known) out.print((millis() - sh.confirmedMs) / 1000);
+  else out.print(F("null"));
+  out.print(F(",\"skip\":")); out.print(sh.skipped);
+  out.print(F(",\"fix\":")); out.print(sh.mismatches);
+  out.print('}');
 }
 
-uint8_t getPrecipitationStatus(uint16_t rainFlag, uint16_t snowFlag)
+static void writeRelayShadow(Print &out, const char *commandId)
 {
-  if (snowFlag > 0)
-    return 2;
-  else if (rainFlag > 0)
-    return 1;
-  else
-    return 0;
+  out.print(F("{\"command_id\":\"")); out.print(commandId);
+  out.print(F("\",\"device_id\":\"")); out.print(DEVICE_ID);
+  out.print(F("\",\"kind\":\"RELAY_STATE\",\"success\":true,\"is_command_response\":true,\"timestamp\":"));
+  out.print(millis());
+  out.print(F(",\"uno\":")); printRelayShadowJson(out, unoRelayShadow, UNO_RELAY_CHANNELS);
+  out.print(F(",\"npn\":")); printRelayShadowJson(out, npnRelayShadow, TOTAL_NPN_CHANNELS);
+  out.print('}');
 }
-*/
 
-// ============= RS485 제어 함수들 (Serial3 제어용-UNO and NPN)=============
-// CRC16 테이블 (NPN 제어용)
-const uint16_t PROGMEM crc_table[256] = {
-    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
-    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
-    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
-    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
-    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
-    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
-    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
-    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
-    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
-    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
-    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
-    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
-    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
-    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
-    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
-    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
-    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
-    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
-    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
-    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
-    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
-    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
-    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
-    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
-    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
-    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
-    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
-    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
-    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
-    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
-    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
-    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040};
+// 섀도만 읽어 응답 - Serial3 송신 없음
+bool publishRelayShadow(const CommandReply &reply)
+{
+  if (!mqttConnected) return false;
+
+  char topic[64];
+  snprintf_P(topic, sizeof(topic), PSTR("modbus/command-responses/%s"), DEVICE_ID);
+
+  CountingPrint counter;
+  writeRelayShadow(counter, reply.commandId);
+  if (!mqttClient.beginPublish(topic, counter.count, false)) return false;
+  writeRelayShadow(mqttClient, reply.commandId);
+  return mqttClient.endPublish() == 1;
+}
 
 // ============= NPN 모듈 제어 함수들 =============
-bool sendNPNModbusCommand(uint8_t *command, uint8_t length, uint16_t timeout = 300)
+static uint16_t npnTimeoutMs()
 {
-  // 안전 장치: 비정상적으로 큰 타임아웃 값이 들어오는 것을 방지
-  if (timeout > 2000) timeout = 2000;
+  return rttTimeoutMs(npnRtt, npnTimeouts);
+}
 
-  // NPN 명령 - Modbus RTU 응답 대기 포함
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
+static void npnLinkResult(bool responded, unsigned long startTime)
+{
+  if (responded) {
+    rttSample(npnRtt, (uint16_t)(millis() - startTime));
+    npnTimeouts = 0;
+  } else if (npnTimeouts < 255) {
+    npnTimeouts++;
+  }
+}
 
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write(command, length);
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+// NPN Modbus 명령 구성 (8바이트 에코 응답, CRC 검증) + 전송 프레임 디버그 출력
+static void npnBuildCommand(Serial3Command &cmd, const uint8_t *command, uint8_t length, uint16_t timeout)
+{
+  memset(&cmd, 0, sizeof(cmd));
+  memcpy(cmd.frame, command, length);
+  cmd.frameLen = length;
+  cmd.resp = S3_RESP_MODBUS8;
+  cmd.npn = 1;
+  // 안전 장치: 비정상적으로 큰 타임아웃 값이 들어오는 것을 방지
+  if (timeout != MODBUS_TIMEOUT_AUTO && timeout > 2000) timeout = 2000;
+  cmd.timeoutMs = timeout;
 
-  // 전송된 프레임 디버그 출력
   Serial.print(F("📤 NPN 전송: "));
   for (int i = 0; i < length; i++)
   {
@@ -1369,84 +2421,139 @@ bool sendNPNModbusCommand(uint8_t *command, uint8_t length, uint16_t timeout = 3
     Serial.print(F(" "));
   }
   Serial.println();
+}
 
-  // Modbus RTU 응답 대기 (Write Single Register는 8바이트 응답)
-  uint8_t response[8];
-  uint8_t responseLen = 0;
-  unsigned long startTime = millis();
-  unsigned long endTime = startTime + timeout;
-
-  // millis() 오버플로우 안전한 타임아웃 체크
-  while ((long)(millis() - endTime) < 0)
+static void npnLogResult(bool ok, const uint8_t *response, uint8_t responseLen)
+{
+  if (ok)
   {
-    while (RS485_CONTROL_SERIAL.available() && responseLen < sizeof(response))
-    {
-      response[responseLen++] = RS485_CONTROL_SERIAL.read();
-    }
-    
-    // Modbus RTU Write Single Register 응답은 정확히 8바이트
-    if (responseLen >= 8)
+    Serial.print(F("📥 NPN 응답 수신: "));
+    for (int i = 0; i < responseLen; i++)
     {
-      // CRC 검증
-      uint16_t receivedCRC = (response[7] << 8) | response[6];
-      uint16_t calculatedCRC = calculateCRC16(response, 6);
-      
-      if (receivedCRC == calculatedCRC)
-      {
-        Serial.print(F("📥 NPN 응답 수신: "));
-        for (int i = 0; i < responseLen; i++)
-        {
-          Serial.print(F("0x"));
-          if (response[i] < 0x10) Serial.print(F("0"));
-          Serial.print(response[i], HEX);
-          Serial.print(F(" "));
-        }
-        Serial.println(F("✅"));
-        return true;
-      }
-      else
-      {
-        Serial.print(F("❌ NPN CRC 오류: rx=0x"));
-        Serial.print(receivedCRC, HEX);
-        Serial.print(F(" calc=0x"));
-        Serial.println(calculatedCRC, HEX);
-        return false;
-      }
+      Serial.print(F("0x"));
+      if (response[i] < 0x10) Serial.print(F("0"));
+      Serial.print(response[i], HEX);
+      Serial.print(F(" "));
     }
-    
-    // UNO 명령과 동일하게 delay(1) 사용 (CPU 독점 방지)
-    delay(1);
+    Serial.println(F("✅"));
+  }
+  else if (responseLen == 5 && (response[1] & 0x80))
+  {
+    Serial.print(F("❌ NPN 예외 응답: FC=0x"));
+    Serial.print(response[1] & 0x7F, HEX);
+    Serial.print(F(" 코드="));
+    Serial.println(response[2]);
+  }
+  else if (responseLen >= 8)
+  {
+    Serial.print(F("❌ NPN CRC 오류: rx=0x"));
+    Serial.print(((uint16_t)response[7] << 8) | response[6], HEX);
+    Serial.print(F(" calc=0x"));
+    Serial.println(calcCRC16(response, 6), HEX);
+  }
+  else if (response == nullptr)
+  {
+    Serial.println(F("🛑 NPN 명령 취소 (안전 정지)"));
+  }
+  else
+  {
+    Serial.print(F("⏱ NPN 응답 타임아웃 (수신: "));
+    Serial.print(responseLen);
+    Serial.println(F(" 바이트)"));
   }
+}
 
-  // 타임아웃
-  Serial.print(F("⏱ NPN 응답 타임아웃 (수신: "));
-  Serial.print(responseLen);
-  Serial.println(F(" 바이트)"));
-  return false;
+// 실패했지만 모듈에 적용됐을 수 있음 (타임아웃/에코 CRC 오류). 취소/예외 응답은 미적용
+static bool npnFailUnknown(const uint8_t *resp, uint16_t len)
+{
+  return resp != nullptr && !(len == 5 && (resp[1] & 0x80));
 }
 
+// 비동기: 큐 적재만 하고 반환, 결과는 cb (cb 안에서 npnLogResult 호출)
+static bool npnSubmit(Serial3Class cls, const uint8_t *frame, Serial3DoneCallback cb, void *ctx)
+{
+  Serial3Command cmd;
+  npnBuildCommand(cmd, frame, 8, MODBUS_TIMEOUT_AUTO);
+  cmd.cb = cb;
+  cmd.ctx = ctx;
+  return serial3Submit(cls, cmd);
+}
 
-bool controlSingleNPNRelay(uint8_t channel, uint16_t command)
+// 원시 프레임은 결과 상태를 해석하지 않음 - 완료 후 NPN 섀도 전체를 미확인으로
+static void onNpnRawDone(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  npnLogResult(ok, resp, (uint8_t)len);
+  npnRelayShadow.known = 0;
+}
+
+bool sendNPNModbusCommand(uint8_t *command, uint8_t length, uint16_t timeout)
+{
+  if (length > S3_FRAME_MAX) return false;
+  Serial3Command cmd;
+  npnBuildCommand(cmd, command, length, timeout);
+  cmd.cb = onNpnRawDone;
+  return serial3Submit(S3_CLASS_NPN, cmd);
+}
+
+
+static void npnBuildRelayFrame(uint8_t *frame, uint8_t channel, uint16_t command)
 {
-    uint8_t frame[8];
-    
   frame[0] = NPN_SLAVE_ADDRESS; // 0x01 (NPN 전용)
   frame[1] = 0x06;              // Modbus Write Single Register
   frame[2] = 0x00;              // High address
   frame[3] = channel;           // Low address (channel)
-    frame[4] = (command >> 8) & 0xFF;
-    frame[5] = command & 0xFF;
-    
-    uint16_t crc = calculateCRC16(frame, 6);
-    frame[6] = crc & 0xFF;
-    frame[7] = (crc >> 8) & 0xFF;
-    
-    return sendNPNModbusCommand(frame, 8);
+  frame[4] = (command >> 8) & 0xFF;
+  frame[5] = command & 0xFF;
+
+  uint16_t crc = calcCRC16(frame, 6);
+  frame[6] = crc & 0xFF;
+  frame[7] = (crc >> 8) & 0xFF;
+}
+
+static bool npnBatchAdd(uint16_t setMask, uint16_t clearMask, int8_t waiter);
+static void npnBatchCancel();
+
+// 안전 정지: 모으는 중인 배치는 전송하지 않고 실패 처리, 대기 중인 NPN 명령은 실행기가 폐기
+// cb는 완료 시 relayShadowDone(전체 OFF)을 호출해야 함
+static bool npnSubmitAllOff(Serial3DoneCallback cb, void *ctx)
+{
+  npnBatchCancel();
+  uint8_t frame[8];
+  npnBuildRelayFrame(frame, 0, 0x0800);
+  if (!npnSubmit(S3_CLASS_SAFETY, frame, cb, ctx)) return false;
+  relayShadowSubmit(npnRelayShadow, NPN_RELAY_ALL);
+  return true;
+}
+
+// 전체 OFF 완료 (ctx 없음, 결과는 로그)
+static void onNpnAllOffDone(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  npnLogResult(ok, resp, (uint8_t)len);
+  relayShadowDone(npnRelayShadow, ok, npnFailUnknown(resp, len), 0, NPN_RELAY_ALL, 0);
+}
+
+// 큐 적재 여부 반환 (결과는 로그). ON/OFF는 배치 창에 모여 다른 채널 변경과 한 번에 전송
+bool controlSingleNPNRelay(uint8_t channel, uint16_t command)
+{
+    if (command == 0x0800) return allNPNChannelsOff();
+
+    uint16_t setMask, clearMask;
+    npnRelayEffect(channel, command, setMask, clearMask);
+    if ((setMask | clearMask) == 0) {
+        uint8_t frame[8];
+        npnBuildRelayFrame(frame, channel, command);
+        return sendNPNModbusCommand(frame, 8);
+    }
+    if (relayShadowSatisfied(npnRelayShadow, setMask, clearMask) == (setMask | clearMask)) {
+        npnRelayShadow.skipped++;
+        return true;
+    }
+    return npnBatchAdd(setMask, clearMask, -1);
 }
 
 bool allNPNChannelsOff()
 {
-    return controlSingleNPNRelay(0, 0x0800);
+    return npnSubmitAllOff(onNpnAllOffDone, nullptr);
 }
 
 bool npnChannelOn(uint8_t channel)
@@ -1467,16 +2574,6 @@ bool npnChannelOff(uint8_t channel)
   return false;
 }
 
-uint16_t calculateCRC16(uint8_t *data, uint8_t length)
-{
-    uint16_t crc = 0xFFFF;
-  for (uint8_t i = 0; i < length; i++)
-  {
-        crc = (crc >> 8) ^ pgm_read_word(&crc_table[(crc ^ data[i]) & 0xFF]);
-    }
-    return crc;
-}
-
 // ============= UNO 제어 함수들 =============
 void unoStart()
 {
@@ -1514,154 +2611,157 @@ void unoChannelOff(uint8_t channel)
   unoChannelOffImmediate(channel);
 }
 
-// 🔥 중요 제어 명령 (즉시 처리 - 콜백 방식)
-bool waitForUnoAck(unsigned long timeoutMs = 1000)
-{
-  unsigned long startTime = millis();
+// ============= 비동기 제어 명령 완료 컨텍스트 =============
+// 큐에 올린 UNO/NPN 명령의 command_id를 완료 콜백까지 보관 (빈 슬롯 = CTRL_ACK_FREE)
+enum ControlAckKind : uint8_t {
+  CTRL_ACK_FREE,
+  CTRL_ACK_UNO,
+  CTRL_ACK_NPN
+};
 
-  while (millis() - startTime < timeoutMs)
-  {
-    if (RS485_CONTROL_SERIAL.available() >= 1)
-    {
-      uint8_t ack = RS485_CONTROL_SERIAL.read();
-      Serial.println(ack, HEX);
+struct ControlAck {
+  uint8_t kind;
+  uint16_t op;       // UNO: CMD_ON/CMD_OFF, NPN: 레지스터 값 (0x0100 ON, 0x0200 OFF, 0x0800 ALL_OFF)
+  uint8_t channel;
+  uint8_t seq;       // UNO 프레임 순번 (ACK 에코와 대조)
+  CommandReply reply;
+};
 
-      if (ack == ACK_OK)
-      {
-        return true; // 성공 - 즉시 반환
-      }
-      else if (ack == ACK_ERROR)
-      {
-        return false; // 실패 - 즉시 반환
-      }
-    }
-    delay(1);
+static ControlAck controlAcks[CONTROL_ACK_SLOTS];
+
+static ControlAck *controlAckAlloc(uint8_t kind, uint16_t op, uint8_t channel)
+{
+  for (uint8_t i = 0; i < CONTROL_ACK_SLOTS; i++) {
+    ControlAck &a = controlAcks[i];
+    if (a.kind != CTRL_ACK_FREE) continue;
+    memset(&a, 0, sizeof(a));
+    a.kind = kind;
+    a.op = op;
+    a.channel = channel;
+    return &a;
   }
-  // 타임아웃 발생 시에만 메시지 출력
-  return false; // 타임아웃
+  Serial.println(F("⚠️ 제어 명령 완료 컨텍스트 부족 - 명령 거부"));
+  return nullptr;
 }
 
-void unoChannelOnImmediate(uint8_t channel)
+// ============= UNO 제어 명령 (Serial3 실행기 경유) =============
+// 모든 요청/응답은 UnoLink.h 링크 프레임 (SYNC + TYPE + SEQ + LEN + 페이로드 + CRC16)
+// UNO는 모든 요청에 같은 SEQ로 응답 → 늦게 도착한 이전 명령의 응답을 다음 명령 결과로 오인하지 않음
+
+static uint8_t unoSeq = 0;
+
+// 1~255 순환 (0은 UNO 자발 알림용)
+static uint8_t unoNextSeq()
 {
-  // ========== 프로토콜: CMD_ON(0x23) + CHANNEL(1) + \n(0x0A) = 3바이트 ==========
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-  
-  // 송신 시퀀스
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  // 명령 전송
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_ON);
-  RS485_CONTROL_SERIAL.write((uint8_t)channel);
-  RS485_CONTROL_SERIAL.write('\n');
-  RS485_CONTROL_SERIAL.flush();
-  
-  // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  // 수신 모드 전환
-  RS485_CTRL_RX();
+  if (++unoSeq == 0) unoSeq = 1;
+  return unoSeq;
+}
 
-  // ACK 수신 대기 (타임아웃: 20ms - 테스트 코드와 동일)
-  unsigned long startTime = millis();
-  bool ackReceived = false;
-  
-  while (millis() - startTime < 20) {
-    if (RS485_CONTROL_SERIAL.available()) {
-      uint8_t ackCode = RS485_CONTROL_SERIAL.read();
-      if (ackCode == ACK_OK) {
-        ackReceived = true;
-        break;
-      } else if (ackCode == ACK_ERROR) {
-        break; // 명시적 에러
-      }
-    }
-    delay(1);
-  }
+// 짧은 페이로드 명령 (S3_FRAME_MAX 안에 프레임 전체) - 응답 대기 TYPE은 respCode
+static void unoBuildCommand(Serial3Command &cmd, uint8_t type, const uint8_t *payload, uint8_t len,
+                            uint8_t respCode, uint16_t timeoutMs)
+{
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.seq = unoNextSeq();
+  cmd.frameLen = ulinkEncode(cmd.frame, type, cmd.seq, payload, len);
+  cmd.resp = S3_RESP_LINK;
+  cmd.respCode = respCode;
+  cmd.timeoutMs = timeoutMs;
+}
 
-  // 결과 처리
-  if (ackReceived) {
-    Serial.print(F("✅ CH"));
-    Serial.print(channel);
-    Serial.println(F(" ON"));
-    sendUnoAckToServer("ON", channel, true);
-  } else {
-    Serial.print(F("❌ CH"));
-    Serial.print(channel);
-    Serial.println(F(" ON (타임아웃)"));
-    sendUnoAckToServer("ON", channel, false);
-  }
+// 결과를 쓰지 않는 명령의 실패 기록 + 섀도 반영 (ctx: TYPE | 파라미터 << 8)
+static void onUnoSimpleAck(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  uint16_t tag = (uint16_t)(uintptr_t)ctx;
+  unoShadowDone((uint8_t)tag, (uint8_t)(tag >> 8), ok, resp, len);
+  if (ok || resp == nullptr) return;
+  Serial.print(F("❌ UNO 명령 0x"));
+  Serial.print((uint8_t)tag, HEX);
+  Serial.println(len > 0 ? F(" 실패 (ACK_ERROR)") : F(" 실패 (타임아웃)"));
 }
 
-void unoChannelOffImmediate(uint8_t channel)
+// 큐에만 올리고 반환 (송신은 serial3ExecutorPoll()), ACK는 실패 시 로그만
+static bool unoSubmitSimple(Serial3Class cls, uint8_t type, const uint8_t *payload, uint8_t len, uint8_t retries = 0)
 {
-  // ========== 프로토콜: CMD_OFF(0x24) + CHANNEL(1) + \n(0x0A) = 3바이트 ==========
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-  
-  // 송신 시퀀스
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  // 명령 전송
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_OFF);
-  RS485_CONTROL_SERIAL.write((uint8_t)channel);
-  RS485_CONTROL_SERIAL.write('\n');
-  RS485_CONTROL_SERIAL.flush();
-  
-  // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  // 수신 모드 전환
-  RS485_CTRL_RX();
+  uint8_t param = len ? payload[0] : 0;
+  Serial3Command cmd;
+  unoBuildCommand(cmd, type, payload, len, ACK_OK, S3_ACK_TIMEOUT_MS);
+  cmd.retries = retries;
+  cmd.cb = onUnoSimpleAck;
+  cmd.ctx = (void *)(uintptr_t)(type | ((uint16_t)param << 8));
+  if (!serial3Submit(cls, cmd)) return false;
+  unoShadowSubmit(type, param);
+  return true;
+}
 
-  // ACK 수신 대기 (타임아웃: 20ms - 테스트 코드와 동일)
-  unsigned long startTime = millis();
-  bool ackReceived = false;
-  
-  while (millis() - startTime < 20) {
-    if (RS485_CONTROL_SERIAL.available()) {
-      uint8_t ackCode = RS485_CONTROL_SERIAL.read();
-      if (ackCode == ACK_OK) {
-        ackReceived = true;
-        break;
-      } else if (ackCode == ACK_ERROR) {
-        break; // 명시적 에러
-      }
-    }
-    delay(1);
-  }
+// 단일 릴레이 ON/OFF 완료: ACK(S3_ACK_TIMEOUT_MS 이내) 결과를 요청의 command_id로 서버에 전달
+static void onUnoChannelAck(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  ControlAck *a = (ControlAck *)ctx;
+  const char *label = (a->op == CMD_ON) ? "ON" : "OFF";
+  unoShadowDone((uint8_t)a->op, a->channel, ok, resp, len);
+
+  Serial.print(ok ? F("✅ CH") : F("❌ CH"));
+  Serial.print(a->channel);
+  Serial.print(F(" "));
+  Serial.print(label);
+  Serial.print(F(" seq="));
+  Serial.print(a->seq);
+  if (ok) Serial.println();
+  else if (resp == nullptr) Serial.println(F(" (취소)"));
+  else if (len > 0) Serial.println(F(" (ACK_ERROR)"));
+  else Serial.println(F(" (타임아웃)"));
+  sendUnoAckToServer(label, a->channel, ok, a->reply.commandId);
+  a->kind = CTRL_ACK_FREE;
+}
 
-  // 결과 처리
-  if (ackReceived) {
-    Serial.print(F("✅ CH"));
-    Serial.print(channel);
-    Serial.println(F(" OFF"));
-    sendUnoAckToServer("OFF", channel, true);
-  } else {
-    Serial.print(F("❌ CH"));
+// 큐 적재 후 즉시 반환 - 완료 컨텍스트(순번 ↔ command_id)는 ACK 콜백까지 유지
+static void unoChannelCommandImmediate(uint8_t code, uint8_t channel, const char *commandId)
+{
+  // 이미 같은 상태면 버스 송신 없이 성공 응답
+  uint16_t bit = (channel < UNO_RELAY_CHANNELS) ? ((uint16_t)1 << channel) : 0;
+  if (bit && relayShadowSatisfied(unoRelayShadow, code == CMD_ON ? bit : 0, code == CMD_OFF ? bit : 0)) {
+    unoRelayShadow.skipped++;
+    Serial.print(F("⏭ CH"));
     Serial.print(channel);
-    Serial.println(F(" OFF (타임아웃)"));
-    sendUnoAckToServer("OFF", channel, false);
+    Serial.println(code == CMD_ON ? F(" 이미 ON - 송신 생략") : F(" 이미 OFF - 송신 생략"));
+    sendUnoAckToServer(code == CMD_ON ? "ON" : "OFF", channel, true, commandId);
+    return;
+  }
+
+  ControlAck *a = controlAckAlloc(CTRL_ACK_UNO, code, channel);
+  if (!a) {
+    sendUnoAckToServer(code == CMD_ON ? "ON" : "OFF", channel, false, commandId);
+    return;
+  }
+  if (commandId) strncpy(a->reply.commandId, commandId, COMMAND_ID_MAX);
+
+  Serial3Command cmd;
+  unoBuildCommand(cmd, code, &channel, 1, ACK_OK, S3_ACK_TIMEOUT_MS);
+  a->seq = cmd.seq;
+  cmd.cb = onUnoChannelAck;
+  cmd.ctx = a;
+  unoShadowSubmit(code, channel);  // 큐 포화 시에도 아래 콜백이 완료 처리
+  if (!serial3Submit(S3_CLASS_RELAY, cmd)) {
+    onUnoChannelAck(false, nullptr, 0, a);  // 큐 포화 - 즉시 실패 보고
   }
 }
 
+void unoChannelOnImmediate(uint8_t channel, const char *commandId)
+{
+  unoChannelCommandImmediate(CMD_ON, channel, commandId);
+}
+
+void unoChannelOffImmediate(uint8_t channel, const char *commandId)
+{
+  unoChannelCommandImmediate(CMD_OFF, channel, commandId);
+}
+
 void togglePulseImmediate(int pinIndex)
 {
   // UNO 제어 - 단순화된 버전 (빠른 테스트용)
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_TOGGLE);
-  RS485_CONTROL_SERIAL.write((uint8_t)pinIndex);
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+  uint8_t ch = (uint8_t)pinIndex;
+  unoSubmitSimple(S3_CLASS_RELAY, CMD_TOGGLE, &ch, 1);
 
   Serial.print(F("⚡ TOGGLE Pin "));
   Serial.println(pinIndex);
@@ -1670,52 +2770,20 @@ void togglePulseImmediate(int pinIndex)
 // 양액 핀 전용 함수 (단순화된 버전)
 void togglePulseFast(int pinIndex)
 {
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_TOGGLE);
-  RS485_CONTROL_SERIAL.write((uint8_t)pinIndex);
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+  uint8_t ch = (uint8_t)pinIndex;
+  unoSubmitSimple(S3_CLASS_RELAY, CMD_TOGGLE, &ch, 1);
 }
 
 // EC 펄스 전용 함수 (고수준 - 단일 명령으로 2개 릴레이 동시 제어)
 void toggleECPulseFast()
 {
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_EC_PULSE);
-  RS485_CONTROL_SERIAL.write((uint8_t)0x00); // 파라미터 (사용하지 않음)
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+  unoSubmitSimple(S3_CLASS_RELAY, CMD_EC_PULSE, nullptr, 0);
 }
 
 // EC OFF 전용 함수 (고수준 - 단일 명령으로 2개 릴레이 동시 제어)
 void ecOffFast()
 {
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_EC_OFF);
-  RS485_CONTROL_SERIAL.write((uint8_t)0x00); // 파라미터 (사용하지 않음)
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+  unoSubmitSimple(S3_CLASS_RELAY, CMD_EC_OFF, nullptr, 0);
 }
 
 // 베드 ON 전용 함수 (고수준 - 단일 명령으로 4개 릴레이 동시 제어)
@@ -1724,50 +2792,252 @@ void bedOnFast(uint8_t bedMask)
   Serial.print(F("🛏️ bedOnFast 호출 - bedMask: 0x"));
   Serial.println(bedMask, HEX);
 
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
+  if (unoSubmitSimple(S3_CLASS_RELAY, CMD_BED_ON, &bedMask, 1)) {
+    Serial.println(F("📤 베드 ON 명령 큐 적재"));
+  }
+}
 
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_BED_ON);
-  RS485_CONTROL_SERIAL.write((uint8_t)bedMask);
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+void resetUnoImmediate()
+{
+  unoSubmitSimple(S3_CLASS_RELAY, CMD_RESET, nullptr, 0);
+}
+
+void allOffUnoImmediate()
+{
+  // 안전 정지: 대기 중인 UNO 릴레이 명령을 폐기하고 최우선 송신 (ACK 실패 시 최대 2회 재송신)
+  unoSubmitSimple(S3_CLASS_SAFETY, CMD_ALLOFF, nullptr, 0, 2);
+}
+
+// ============= NPN 채널 쓰기 배치 (FC16 Write Multiple Registers) =============
+// 창(NPN_BATCH_WINDOW_MS) 안에 들어온 채널 변경을 모아 연속 레지스터 구간마다 한 트랜잭션으로 전송
+// - 레지스터 = 채널, 값 = 0x0100 ON / 0x0200 OFF (FC06 단일 쓰기와 같은 명령 값)
+// - 같은 창에서 같은 채널을 다시 바꾸면 마지막 요청만 전송
+// - 변경 채널 사이의 채널은 섀도에서 확인된 상태를 다시 써서 한 구간으로 합침 (미확인이면 구간 분리)
+// - 채널 하나짜리 구간은 FC06 (8바이트)
+// - 이전 배치가 끝나기 전에는 계속 모음 (NPN 큐에는 한 배치의 구간만)
+enum NpnBatchState : uint8_t {
+  NPN_BATCH_FREE,
+  NPN_BATCH_OPEN,   // 변경 수집 중
+  NPN_BATCH_SENT    // 구간 명령 큐 적재, 완료 대기
+};
+
+struct NpnBatch {
+  uint16_t setMask;       // ON으로 쓸 채널
+  uint16_t clearMask;     // OFF로 쓸 채널
+  uint16_t waiters;       // 완료 응답을 기다리는 ControlAck 슬롯 비트
+  uint16_t okMask;        // 성공한 구간의 요청 채널
+  uint16_t unknownMask;   // 적용 여부를 모르는 구간의 요청 채널
+  uint8_t runsLeft;       // 완료 대기 중인 구간 수
+  uint8_t state;
+  unsigned long openedMs;
+  uint8_t body[TOTAL_NPN_CHANNELS * 2 + NPN_BATCH_MAX_RUNS * 2];  // 구간별 레지스터 값 + CRC (전송 완료까지 유지)
+};
+
+static NpnBatch npnBatches[NPN_BATCH_SLOTS];
+
+static void npnReplyText(char *text, uint8_t size, bool ok, uint16_t op, uint8_t channel)
+{
+  if (op == 0x0800) {
+    strcpy(text, ok ? "All NPN channels turned OFF" : "All NPN channels OFF failed");
+  } else {
+    snprintf(text, size, ok ? "NPN Channel %u turned %s" : "NPN Channel %u %s failed",
+             channel, op == 0x0100 ? "ON" : "OFF");
+  }
+}
+
+// 모든 구간 완료 (또는 취소): 섀도 반영 후 묶인 요청마다 응답
+static void npnBatchComplete(NpnBatch &b)
+{
+  npnRelayShadow.known &= ~b.unknownMask;
+  relayShadowDone(npnRelayShadow, b.okMask != 0, false, b.setMask & b.okMask, b.clearMask & b.okMask, 0);
+
+  for (uint8_t i = 0; i < CONTROL_ACK_SLOTS; i++) {
+    if (!(b.waiters & ((uint16_t)1 << i))) continue;
+    ControlAck &a = controlAcks[i];
+    bool ok = (b.okMask & ((uint16_t)1 << a.channel)) != 0;
+    char text[40];
+    npnReplyText(text, sizeof(text), ok, a.op, a.channel);
+    publishCommandResponse(a.reply, ok, text);
+    a.kind = CTRL_ACK_FREE;
+  }
+
+  Serial.print(F("📦 NPN 배치 완료 on=0x"));
+  Serial.print(b.setMask, HEX);
+  Serial.print(F(" off=0x"));
+  Serial.print(b.clearMask, HEX);
+  Serial.print(F(" 성공=0x"));
+  Serial.println(b.okMask, HEX);
+  b.state = NPN_BATCH_FREE;
+}
+
+// ctx: 하위 12비트 = 구간의 요청 채널, 상위 4비트 = 배치 슬롯
+static void onNpnBatchRun(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  uint16_t tag = (uint16_t)(uintptr_t)ctx;
+  NpnBatch &b = npnBatches[tag >> 12];
+  uint16_t runMask = tag & 0x0FFF;
+
+  npnLogResult(ok, resp, (uint8_t)len);
+  if (ok) b.okMask |= runMask;
+  else if (npnFailUnknown(resp, len)) b.unknownMask |= runMask;
+  if (b.runsLeft > 0 && --b.runsLeft == 0) npnBatchComplete(b);
+}
+
+// 구간 [first, last] 한 건 큐 적재. 본문은 b.body + *bodyPos에 기록
+static bool npnBatchSubmitRun(NpnBatch &b, uint8_t slot, uint8_t first, uint8_t last, uint8_t &bodyPos)
+{
+  uint16_t change = b.setMask | b.clearMask;
+  uint16_t runMask = 0;
+  Serial3Command cmd;
+  memset(&cmd, 0, sizeof(cmd));
+
+  if (first == last) {
+    npnBuildRelayFrame(cmd.frame, first, (b.setMask >> first) & 1 ? 0x0100 : 0x0200);
+    cmd.frameLen = 8;
+    runMask = (uint16_t)1 << first;
+  } else {
+    uint8_t qty = last - first + 1;
+    cmd.frame[0] = NPN_SLAVE_ADDRESS;
+    cmd.frame[1] = 0x10;            // Write Multiple Registers
+    cmd.frame[2] = 0x00;
+    cmd.frame[3] = first;           // 시작 레지스터 = 채널
+    cmd.frame[4] = 0x00;
+    cmd.frame[5] = qty;
+    cmd.frame[6] = qty * 2;         // 바이트 수
+    cmd.frameLen = 7;
+
+    uint8_t *body = b.body + bodyPos;
+    for (uint8_t ch = first; ch <= last; ch++) {
+      uint16_t bit = (uint16_t)1 << ch;
+      bool on = (change & bit) ? (b.setMask & bit) != 0 : (npnRelayShadow.state & bit) != 0;
+      runMask |= change & bit;
+      body[(ch - first) * 2] = on ? 0x01 : 0x02;
+      body[(ch - first) * 2 + 1] = 0x00;
+    }
+    uint16_t crc = crc16Block(body, qty * 2, crc16Block(cmd.frame, 7));
+    body[qty * 2] = (uint8_t)(crc & 0xFF);
+    body[qty * 2 + 1] = (uint8_t)(crc >> 8);
+    cmd.body = body;
+    cmd.bodyLen = qty * 2 + 2;
+    bodyPos += cmd.bodyLen;
+  }
+
+  cmd.resp = S3_RESP_MODBUS8;     // 응답: FC06 에코 / FC16 주소+수량 에코 모두 8바이트
+  cmd.npn = 1;
+  cmd.timeoutMs = MODBUS_TIMEOUT_AUTO;
+  cmd.cb = onNpnBatchRun;
+  cmd.ctx = (void *)(uintptr_t)(runMask | ((uint16_t)slot << 12));
+
+  Serial.print(F("📤 NPN 배치 구간 CH"));
+  Serial.print(first);
+  Serial.print(F("~"));
+  Serial.print(last);
+  Serial.println(first == last ? F(" (FC06)") : F(" (FC16)"));
+
+  if (serial3Submit(S3_CLASS_NPN, cmd)) return true;
+  Serial.println(F("❌ NPN 배치 구간 큐 포화"));
+  return false;
+}
+
+static void npnBatchFlush(uint8_t slot)
+{
+  NpnBatch &b = npnBatches[slot];
+  uint16_t change = b.setMask | b.clearMask;
+  // 다시 써도 되는 채널: 확인 상태이고 대기 명령이 없음 (이 배치의 채널은 change에 포함)
+  uint16_t fill = npnRelayShadow.known & ~npnRelayShadow.pending;
+  uint8_t bodyPos = 0;
+
+  b.state = NPN_BATCH_SENT;
+  b.runsLeft = 0;
+  b.okMask = 0;
+  b.unknownMask = 0;
+
+  uint8_t ch = 0;
+  while (ch < TOTAL_NPN_CHANNELS) {
+    if (!(change & ((uint16_t)1 << ch))) {
+      ch++;
+      continue;
+    }
+    uint8_t last = ch;
+    for (uint8_t k = ch + 1; k < TOTAL_NPN_CHANNELS; k++) {
+      uint16_t bit = (uint16_t)1 << k;
+      if (change & bit) last = k;
+      else if (!(fill & bit)) break;
+    }
+    if (npnBatchSubmitRun(b, slot, ch, last, bodyPos)) b.runsLeft++;
+    ch = last + 1;
+  }
+  if (b.runsLeft == 0) npnBatchComplete(b);
+}
 
-  Serial.println(F("📤 베드 ON 명령 전송 완료"));
+// 변경 합류 (waiter: ControlAck 슬롯, 없으면 -1). 모으는 배치가 없으면 새로 염
+static bool npnBatchAdd(uint16_t setMask, uint16_t clearMask, int8_t waiter)
+{
+  NpnBatch *b = nullptr;
+  for (uint8_t i = 0; i < NPN_BATCH_SLOTS && !b; i++) {
+    if (npnBatches[i].state == NPN_BATCH_OPEN) b = &npnBatches[i];
+  }
+  for (uint8_t i = 0; i < NPN_BATCH_SLOTS && !b; i++) {
+    if (npnBatches[i].state != NPN_BATCH_FREE) continue;
+    b = &npnBatches[i];
+    memset(b, 0, sizeof(*b));
+    b->state = NPN_BATCH_OPEN;
+    b->openedMs = millis();
+    relayShadowSubmit(npnRelayShadow, 0);   // 섀도 완료 대기는 배치당 한 건
+  }
+  if (!b) {
+    Serial.println(F("⚠️ NPN 배치 슬롯 부족 - 명령 거부"));
+    return false;
+  }
+
+  b->setMask = (b->setMask & ~clearMask) | setMask;
+  b->clearMask = (b->clearMask & ~setMask) | clearMask;
+  if (waiter >= 0) b->waiters |= (uint16_t)1 << waiter;
+  npnRelayShadow.pending |= setMask | clearMask;
+  return true;
 }
 
-void resetUnoImmediate()
+static void npnBatchCancel()
 {
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_RESET);
-  RS485_CONTROL_SERIAL.write((uint8_t)0x00); // 파라미터 없음
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+  for (uint8_t i = 0; i < NPN_BATCH_SLOTS; i++) {
+    NpnBatch &b = npnBatches[i];
+    if (b.state != NPN_BATCH_OPEN) continue;
+    Serial.println(F("🛑 NPN 배치 취소 (안전 정지)"));
+    b.okMask = 0;
+    b.unknownMask = 0;
+    npnBatchComplete(b);
+  }
 }
 
-void allOffUnoImmediate()
+void npnBatchPoll()
 {
-  // 송신 시퀀스 (가드 포함)
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_ALLOFF);
-  RS485_CONTROL_SERIAL.write((uint8_t)0x00); // 파라미터 없음
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
+  for (uint8_t i = 0; i < NPN_BATCH_SLOTS; i++) {
+    if (npnBatches[i].state == NPN_BATCH_SENT) return;
+  }
+  for (uint8_t i = 0; i < NPN_BATCH_SLOTS; i++) {
+    NpnBatch &b = npnBatches[i];
+    if (b.state == NPN_BATCH_OPEN && millis() - b.openedMs >= NPN_BATCH_WINDOW_MS) {
+      npnBatchFlush(i);
+      return;
+    }
+  }
 }
 
 // ============= 통합 제어 함수들 =============
-bool handleNPNCommand(const String &command, uint8_t channel, String &response)
+// NPN 전체 OFF 완료: 요청 필드를 되돌려 modbus/command-responses로 응답
+static void onNpnCommandDone(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  ControlAck *a = (ControlAck *)ctx;
+  npnLogResult(ok, resp, (uint8_t)len);
+  relayShadowDone(npnRelayShadow, ok, npnFailUnknown(resp, len), 0, NPN_RELAY_ALL, 0);
+
+  char text[40];
+  npnReplyText(text, sizeof(text), ok, a->op, a->channel);
+  publishCommandResponse(a->reply, ok, text);
+  a->kind = CTRL_ACK_FREE;
+}
+
+bool handleNPNCommand(const String &command, uint8_t channel, const CommandReply &reply, String &response)
 {
   Serial.println(F("➡ handleNPNCommand 진입"));
 #if NPN_HW_PRESENT == 0
@@ -1780,66 +3050,88 @@ bool handleNPNCommand(const String &command, uint8_t channel, String &response)
   if (command == "ON")
   {
     response = "NPN Channel " + String(channel) + " turned ON (DRY RUN)";
-    return true;
   }
   else if (command == "OFF")
   {
     response = "NPN Channel " + String(channel) + " turned OFF (DRY RUN)";
-    return true;
   }
   else if (command == "ALL_OFF")
   {
     response = "All NPN channels turned OFF (DRY RUN)";
-    return true;
   }
   else
   {
     response = "Invalid NPN command (DRY RUN): " + command;
     return false;
   }
+  publishCommandResponse(reply, true, response.c_str());
+  return true;
 #endif
 
-  bool success = false;
-
-  if (command == "ON")
+  uint16_t op;
+  if (command == "ALL_OFF")
   {
-    success = npnChannelOn(channel);
-    if (success) {
-      response = "NPN Channel " + String(channel) + " turned ON";
-    } else {
-      response = "NPN Channel " + String(channel) + " ON failed";
-    }
-    return success;
+    op = 0x0800;
+    channel = 0;
   }
-  else if (command == "OFF")
+  else if (command == "ON" || command == "OFF")
   {
-    success = npnChannelOff(channel);
-    if (success) {
-      response = "NPN Channel " + String(channel) + " turned OFF";
-    } else {
-      response = "NPN Channel " + String(channel) + " OFF failed";
+    op = (command == "ON") ? 0x0100 : 0x0200;
+    if (channel >= TOTAL_NPN_CHANNELS)
+    {
+      response = "NPN Channel " + String(channel) + " " + command + " failed";
+      return false;
     }
-    return success;
   }
-  else if (command == "ALL_OFF")
+  else
   {
-    success = allNPNChannelsOff();
-    if (success) {
-      response = "All NPN channels turned OFF";
-    } else {
-      response = "All NPN channels OFF failed";
-    }
-    return success;
+    response = "Invalid NPN command: " + command;
+    return false;
+  }
+
+  uint16_t setMask, clearMask;
+  npnRelayEffect(channel, op, setMask, clearMask);
+  if (op != 0x0800 && relayShadowSatisfied(npnRelayShadow, setMask, clearMask) == (setMask | clearMask))
+  {
+    // 이미 같은 상태 - 버스 송신 없이 성공 응답
+    npnRelayShadow.skipped++;
+    Serial.println(F("⏭ NPN 채널 이미 목표 상태 - 송신 생략"));
+    char text[40];
+    npnReplyText(text, sizeof(text), true, op, channel);
+    publishCommandResponse(reply, true, text);
+    return true;
+  }
+
+  // 큐 적재 후 즉시 반환 - 응답은 완료 시 onNpnCommandDone() / npnBatchComplete()
+  ControlAck *a = controlAckAlloc(CTRL_ACK_NPN, op, channel);
+  if (!a)
+  {
+    response = "NPN command rejected (busy)";
+    return false;
+  }
+  a->reply = reply;
+
+  bool queued;
+  if (op == 0x0800)
+  {
+    queued = npnSubmitAllOff(onNpnCommandDone, a);
   }
   else
   {
-    response = "Invalid NPN command: " + command;
+    queued = npnBatchAdd(setMask, clearMask, (int8_t)(a - controlAcks));
+  }
+  if (!queued)
+  {
+    a->kind = CTRL_ACK_FREE;
+    response = "NPN command rejected (queue full)";
     return false;
   }
+  response = "NPN command queued";
+  return true;
 }
 
 
-bool handleUNOCommand(const String &command, int channel, String &response)
+bool handleUNOCommand(const String &command, int channel, const CommandReply &reply, String &response)
 {
     String ucmd = command;
     ucmd.toUpperCase();
@@ -1870,13 +3162,13 @@ bool handleUNOCommand(const String &command, int channel, String &response)
     }
   else if (ucmd == "ON" && channel >= 0)
   {
-    unoChannelOnImmediate(channel); // 콜백 방식으로 변경
+    unoChannelOnImmediate(channel, reply.commandId); // 결과는 ACK 콜백에서 서버로 전달
         response = String("UNO_ON") + channel;
         return true;
     }
   else if (ucmd == "OFF" && channel >= 0)
   {
-    unoChannelOffImmediate(channel); // 콜백 방식으로 변경
+    unoChannelOffImmediate(channel, reply.commandId); // 결과는 ACK 콜백에서 서버로 전달
         response = String("UNO_OFF") + channel;
         return true;
     }
@@ -1887,11 +3179,12 @@ bool handleUNOCommand(const String &command, int channel, String &response)
     }
 }
 
-bool handleKindCommand(const String &kind, const String &command, uint8_t channel, String &response)
+bool handleKindCommand(const String &kind, const String &command, uint8_t channel,
+                       const CommandReply &reply, String &response)
 {
   if (kind == "NPN_MODULE")
   {
-        return handleNPNCommand(command, channel, response);
+        return handleNPNCommand(command, channel, reply, response);
     }
   else
   {
@@ -1900,55 +3193,6 @@ bool handleKindCommand(const String &kind, const String &command, uint8_t channe
     }
 }
 
-// 우노에서 센서 데이터 수신하는 함수
-bool requestUnoSensorData()
-{
-  // 송신 모드로 전환
-  digitalWrite(RS485_CONTROL_DE_RE_PIN, HIGH);
-  delay(50); // 송신 모드 전환 대기
-
-  // RS485 제어 라인을 통해 우노에 센서 요청
-  RS485_CONTROL_SERIAL.println("UNO_SENSOR_REQUEST");
-  RS485_CONTROL_SERIAL.flush(); // 전송 완료 대기
-  delay(100);                   // 전송 완료 대기
-
-  // 수신 모드로 전환
-  digitalWrite(RS485_CONTROL_DE_RE_PIN, LOW);
-  delay(50); // 수신 모드 전환 대기
-
-  // 응답 대기 (타임아웃 15초, SoftwareSerial 고려)
-  unsigned long timeout = millis() + 15000;
-  String response = "";
-  
-  // UNO가 응답할 시간을 충분히 주기 위해 추가 대기
-  delay(500); // SoftwareSerial을 위한 충분한 대기시간
-
-  while (millis() < timeout)
-  {
-    if (RS485_CONTROL_SERIAL.available())
-    {
-          char c = RS485_CONTROL_SERIAL.read();
-      if (c == '\n')
-      {
-              break;
-          }
-          response += c;
-      }
-    delay(20); // SoftwareSerial을 위한 더 긴 지연
-  }
-  
-  if (response.length() == 0)
-  {
-      unoSensorData.isValid = false;
-      return false;
-  }
-
-  Serial.print(F("📥 UNO 센서: "));
-  Serial.println(response);
-  
-  return parseUnoSensorData(response);
-}
-
 bool parseUnoSensorData(const String &data)
 {
   // 예상 형식: "PH:7.25,EC:1.5,TEMP:24.3"
@@ -2026,117 +3270,357 @@ bool isUnoSensorDataValid()
          (millis() - unoSensorData.lastUpdate) < 300000; // 5분
 }
 
-// ============= Serial3 통신 관리 시스템 =============
+// ============= Serial3 제어 버스 명령 큐 (우선순위 + 단일 실행기) =============
+// 기존 Serial3Owner 점유 방식은 쿨다운/5초 강제 해제에 의존했고 일부 호출부는 점유 없이 직접 송신해
+// MQTT 릴레이 명령 연속 수신 시 백그라운드 센서 요청과 충돌했음
+// - 클래스별 링 큐는 하나의 풀을 고정 구간으로 나눠 사용 (SAFETY | RELAY | NPN | POLL)
+// - 실행 중 명령은 큐에서 꺼낸 사본 (안전 정지 폐기와 무관하게 완료까지 진행)
+static const uint8_t S3_DEPTH[S3_CLASS_COUNT] = {
+  S3_DEPTH_SAFETY, S3_DEPTH_RELAY, S3_DEPTH_NPN, S3_DEPTH_POLL
+};
+static const uint8_t S3_BASE[S3_CLASS_COUNT] = {
+  0, S3_DEPTH_SAFETY, S3_DEPTH_SAFETY + S3_DEPTH_RELAY, S3_DEPTH_SAFETY + S3_DEPTH_RELAY + S3_DEPTH_NPN
+};
+#define S3_POOL_SIZE (S3_DEPTH_SAFETY + S3_DEPTH_RELAY + S3_DEPTH_NPN + S3_DEPTH_POLL)
 
-// Serial3 관리 시스템 변수
-Serial3Owner serial3Owner = SERIAL3_IDLE;
-unsigned long serial3LastUsed = 0;
-unsigned long serial3CooldownTime = 20; // 20ms 쿨다운
+enum Serial3ExecState {
+  S3_STATE_IDLE,    // 큐 대기
+  S3_STATE_READY,   // 명령 적재, 버스 간격 대기
+  S3_STATE_TX,      // 송신 버퍼 비우는 중 (DE 유지)
+  S3_STATE_WAIT     // 응답 수신 중
+};
 
-void initSerial3Manager()
+static Serial3Command s3Pool[S3_POOL_SIZE];
+static uint8_t s3Head[S3_CLASS_COUNT];
+static uint8_t s3Count[S3_CLASS_COUNT];
+static Serial3ExecState s3State = S3_STATE_IDLE;
+static Serial3Command s3Cur;
+static uint16_t s3CurTimeoutMs = 0;
+static unsigned long s3TxStartMs = 0;    // 송신 시작 시각 (TXC 대기 상한)
+static volatile bool s3TxDone = false;   // USART3 TXC ISR이 DE 해제 후 설정
+static unsigned long s3TxDoneMs = 0;     // 송신 완료 시각 (응답 타임아웃 기준)
+static unsigned long s3BusIdleMs = 0;    // 직전 트랜잭션 종료 시각
+static uint8_t s3GapMs = 0;              // 다음 송신 전 최소 간격
+static uint8_t s3Rx[1 + ULINK_PAYLOAD_MAX];  // LINK: TYPE + 페이로드 / MODBUS8: 원시 바이트
+static uint16_t s3RxLen = 0;
+static ULinkParser s3Link;               // UNO 링크 프레이머 (실행기 / IDLE 헬로 수신 공용)
+static unsigned long s3LinkByteMs = 0;   // 마지막 수신 바이트 시각 (프레임 중간 무음 판정)
+
+Serial3Stats serial3Stats;
+
+static Serial3Command& s3Slot(uint8_t cls, uint8_t i)
 {
-  serial3Owner = SERIAL3_IDLE;
-  serial3LastUsed = 0;
-  serial3CooldownTime = 5; // 5ms 쿨다운 (더 단축)
+  return s3Pool[S3_BASE[cls] + (s3Head[cls] + i) % S3_DEPTH[cls]];
 }
 
-bool requestSerial3Access(Serial3Owner requester)
+void initSerial3Executor()
 {
-  unsigned long currentTime = millis();
+  UCSR3B &= ~_BV(TXCIE3);
+  s3TxDone = false;
+  memset(s3Head, 0, sizeof(s3Head));
+  memset(s3Count, 0, sizeof(s3Count));
+  memset(&serial3Stats, 0, sizeof(serial3Stats));
+  s3State = S3_STATE_IDLE;
+  s3BusIdleMs = millis();
+  s3GapMs = 0;
+  memset(&s3Link, 0, sizeof(s3Link));
+  ulinkReset(s3Link);
+}
 
-  // 쿨다운 시간 체크 (단축)
-  if (currentTime - serial3LastUsed < serial3CooldownTime)
-  {
-    return false; // 아직 쿨다운 중
+bool serial3ExecutorBusy()
+{
+  if (s3State != S3_STATE_IDLE) return true;
+  for (uint8_t c = 0; c < S3_CLASS_COUNT; c++) {
+    if (s3Count[c]) return true;
   }
+  return false;
+}
 
-  // 타임아웃 체크 (5초 이상 사용 중이면 강제 해제)
-  if (serial3Owner != SERIAL3_IDLE && (currentTime - serial3LastUsed) > 5000)
-  {
-    Serial.println(F("⚠️ Serial3 타임아웃 - 강제 해제"));
-    serial3Owner = SERIAL3_IDLE;
+// 안전 정지: 같은 대상의 대기 중인 일반 제어 명령을 큐에서 빼고 실패로 완료
+static void s3PurgeControl(bool npn)
+{
+  Serial3DoneCallback cbs[S3_DEPTH_RELAY + S3_DEPTH_NPN];
+  void* ctxs[S3_DEPTH_RELAY + S3_DEPTH_NPN];
+  uint8_t n = 0;
+
+  for (uint8_t cls = S3_CLASS_RELAY; cls <= S3_CLASS_NPN; cls++) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < s3Count[cls]; i++) {
+      Serial3Command& c = s3Slot(cls, i);
+      if (c.npn == npn) {
+        cbs[n] = c.cb;
+        ctxs[n] = c.ctx;
+        n++;
+      } else {
+        if (kept != i) s3Slot(cls, kept) = c;
+        kept++;
+      }
+    }
+    s3Count[cls] = kept;
+  }
+  if (n == 0) return;
+
+  serial3Stats.purged += n;
+  Serial.print(F("🛑 안전 정지 - 대기 명령 폐기: "));
+  Serial.println(n);
+  // 큐 정리 후 콜백 (콜백 안의 재제출이 정리 중인 구간을 건드리지 않도록)
+  for (uint8_t i = 0; i < n; i++) {
+    if (cbs[i]) cbs[i](false, nullptr, 0, ctxs[i]);
   }
+}
 
-  // 우선순위 기반 접근 제어
-  if (serial3Owner != SERIAL3_IDLE)
-  {
-    // 현재 사용자와 같은 경우만 허용
-    if (serial3Owner == requester)
-    {
-      serial3LastUsed = currentTime;
-      return true;
-    }
+bool serial3Submit(Serial3Class cls, const Serial3Command& cmd)
+{
+  if (cls >= S3_CLASS_COUNT || cmd.frameLen == 0 || cmd.frameLen > S3_FRAME_MAX) return false;
+  if (cls == S3_CLASS_SAFETY) s3PurgeControl(cmd.npn);
+  if (s3Count[cls] >= S3_DEPTH[cls]) {
+    serial3Stats.dropped[cls]++;
+    Serial.print(F("⚠️ Serial3 큐 포화 - 명령 버림 (class "));
+    Serial.print((uint8_t)cls);
+    Serial.println(F(")"));
+    return false;
+  }
+  s3Slot(cls, s3Count[cls]) = cmd;
+  s3Count[cls]++;
+  serial3Stats.submitted[cls]++;
+  if (s3Count[cls] > serial3Stats.peakDepth[cls]) serial3Stats.peakDepth[cls] = s3Count[cls];
+  return true;
+}
 
-    // 우선순위 체크
-    int currentPriority = getPriority(serial3Owner);
-    int requestPriority = getPriority(requester);
+// 가장 높은 클래스의 머리 명령을 꺼내 실행 대상으로 적재
+static bool s3Dequeue()
+{
+  for (uint8_t cls = 0; cls < S3_CLASS_COUNT; cls++) {
+    if (s3Count[cls] == 0) continue;
+    s3Cur = s3Slot(cls, 0);
+    s3Head[cls] = (s3Head[cls] + 1) % S3_DEPTH[cls];
+    s3Count[cls]--;
+    s3State = S3_STATE_READY;
+    return true;
+  }
+  return false;
+}
 
-    if (requestPriority >= currentPriority)
-    {
-      return false; // 현재 사용자가 더 높은 우선순위
-    }
+// UNO 링크 프레임 1건 처리: 대기 중인 요청의 응답이면 1(성공)/-1(실패), 그 외(헬로/늦은 응답)는 0
+static int8_t s3HandleLinkFrame(const uint8_t *frame)
+{
+  uint8_t type = ulinkType(frame);
+  if (!unoControlPresent) {
+    unoControlPresent = true;
+    Serial.println(F("✅ 제어용 UNO 감지됨 - Serial3 센서 요청 활성화"));
+  }
+  if (type == ULINK_HELLO) return 0;
+
+  if (s3State != S3_STATE_WAIT || s3Cur.resp != S3_RESP_LINK || ulinkSeq(frame) != s3Cur.seq) {
+    serial3Stats.staleAcks++;
+    Serial.print(F("⚠️ 늦은 UNO 응답 무시 type=0x"));
+    Serial.print(type, HEX);
+    Serial.print(F(" seq="));
+    Serial.println(ulinkSeq(frame));
+    return 0;
+  }
+
+  uint8_t len = ulinkLen(frame);
+  s3Rx[0] = type;
+  memcpy(s3Rx + 1, ulinkPayload(frame), len);
+  s3RxLen = 1 + len;
+  return (type == s3Cur.respCode) ? 1 : -1;
+}
 
-    // 더 높은 우선순위 요청이면 현재 사용자 강제 해제
-    Serial.print(F("🔄 Serial3 강제 해제: "));
-    Serial.print(serial3Owner);
-    Serial.print(F(" -> "));
-    Serial.println(requester);
+// 링크 프레이머에 쌓인 완성 프레임 배분. 대기 중인 요청이 끝나면 즉시 결과 반환 (남은 바이트는 다음 호출)
+static int8_t s3LinkDispatch(bool stale)
+{
+  uint8_t n;
+  while ((n = stale ? ulinkFlushStale(s3Link) : ulinkScan(s3Link)) != 0) {
+    int8_t r = s3HandleLinkFrame(s3Link.buf);
+    ulinkDrop(s3Link, n);
+    if (r != 0) return r;
   }
+  return 0;
+}
 
-  // 접근 허용
-  serial3Owner = requester;
-  serial3LastUsed = currentTime;
-  return true;
+// Serial3 수신 바이트를 링크 프레이머로: 1/-1 = 대기 중인 요청 완료, 0 = 진행 중
+static int8_t s3LinkReceive()
+{
+  while (RS485_CONTROL_SERIAL.available()) {
+    ulinkFeed(s3Link, RS485_CONTROL_SERIAL.read());
+    s3LinkByteMs = millis();
+    int8_t r = s3LinkDispatch(false);
+    if (r != 0) return r;
+  }
+  // 프레임 중간 무음: 미완성 앞부분을 버리고 남은 바이트에서 재탐색
+  if (s3Link.len > 0 && millis() - s3LinkByteMs >= ULINK_GAP_MS) return s3LinkDispatch(true);
+  return 0;
 }
 
-int getPriority(Serial3Owner owner)
+static void s3Transmit()
 {
-  switch (owner)
-  {
-  case SERIAL3_UNO_CONTROL:
-    return PRIORITY_UNO_CONTROL;
-  case SERIAL3_NPN:
-    return PRIORITY_NPN;
-  case SERIAL3_UNO_SENSOR:
-    return PRIORITY_UNO_SENSOR;
-  default:
-    return 999; // IDLE은 최저 우선순위
+  // 직전 트랜잭션의 늦은 응답/헬로 프레임을 먼저 처리 (폐기하지 않고 통계/존재 감지에 반영)
+  s3LinkReceive();
+
+  RS485_CTRL_TX();
+  delayMicroseconds(RS485_TURNAROUND_US);
+  s3TxDone = false;
+  RS485_CONTROL_SERIAL.write(s3Cur.frame, s3Cur.frameLen);
+  if (s3Cur.body && s3Cur.bodyLen) RS485_CONTROL_SERIAL.write(s3Cur.body, s3Cur.bodyLen);
+  // flush() 대기 없이 반환 - DE 해제는 TXC ISR (HardwareSerial이 바이트마다 TXC를 지우므로 TXC = 전체 송신 완료)
+  UCSR3B |= _BV(TXCIE3);
+  s3TxStartMs = millis();
+}
+
+// 마지막 바이트 정지 비트가 나가면 즉시 수신 모드로 전환 (Serial1 USART1_TX_vect와 동일)
+// loop 지연과 무관하게 Command_UNO 응답 간격(RS485_REPLY_GAP_US) 안에 DE를 놓음
+ISR(USART3_TX_vect)
+{
+  UCSR3B &= ~_BV(TXCIE3);
+  RS485_CTRL_RX();
+  s3TxDone = true;
+}
+
+// 송신 완료 → 응답 타임아웃 시작 (ISR 누락 시에만 여기서 DE 해제)
+static void s3EndTransmit()
+{
+  if (!s3TxDone) {
+    UCSR3B &= ~_BV(TXCIE3);
+    RS485_CTRL_RX();
   }
+
+  s3RxLen = 0;
+  s3TxDoneMs = millis();
+  s3CurTimeoutMs = s3Cur.timeoutMs;
+  if (s3CurTimeoutMs == MODBUS_TIMEOUT_AUTO && s3Cur.npn) s3CurTimeoutMs = npnTimeoutMs();
 }
 
-void releaseSerial3Access()
+// 수신 바이트 처리: 1 = 성공, -1 = 실패, 0 = 진행 중
+// NPN 예외 응답 수신 여부 (슬레이브는 살아 있음 - 재시도 무의미)
+static bool s3IsException()
 {
-  serial3Owner = SERIAL3_IDLE;
-  serial3LastUsed = millis();
+  if (s3Cur.resp != S3_RESP_MODBUS8 || s3RxLen != 5 || !(s3Rx[1] & 0x80)) return false;
+  uint16_t exceptionCRC = ((uint16_t)s3Rx[4] << 8) | s3Rx[3];
+  return exceptionCRC == calcCRC16(s3Rx, 3);
 }
 
-bool isSerial3Available()
+static int8_t s3ReceiveStep()
 {
-  return serial3Owner == SERIAL3_IDLE &&
-         (millis() - serial3LastUsed) >= serial3CooldownTime;
+  // UNO: 링크 프레임 단위 (SEQ/TYPE 대조는 s3HandleLinkFrame)
+  if (s3Cur.resp == S3_RESP_LINK) return s3LinkReceive();
+
+  // NPN: Modbus 에코 8바이트
+  while (RS485_CONTROL_SERIAL.available()) {
+    uint8_t b = RS485_CONTROL_SERIAL.read();
+    if (s3RxLen < 8) s3Rx[s3RxLen++] = b;
+
+    // 예외 응답 [주소][FC|0x80][코드][CRC] - 나머지 3바이트를 기다리지 않고 실패
+    if (s3IsException()) return -1;
+    if (s3RxLen < 8) continue;
+
+    uint16_t receivedCRC = ((uint16_t)s3Rx[7] << 8) | s3Rx[6];
+    return (receivedCRC == calcCRC16(s3Rx, 6)) ? 1 : -1;
+  }
+  return 0;
 }
 
-bool isSerial3AvailableFor(Serial3Owner requester)
+static void s3Finish(bool ok)
 {
-  unsigned long currentTime = millis();
+  bool exception = !ok && s3IsException();
+  if (s3Cur.npn && s3Cur.resp == S3_RESP_MODBUS8) npnLinkResult(s3RxLen >= 8 || exception, s3TxDoneMs);
+
+  s3BusIdleMs = millis();
+  if (!ok && !exception && s3Cur.retries > 0) {
+    s3Cur.retries--;
+    serial3Stats.retries++;
+    s3GapMs = S3_RETRY_GAP_MS;
+    s3State = S3_STATE_READY;
+    Serial.print(F("🔄 Serial3 재시도 (남은 횟수 "));
+    Serial.print(s3Cur.retries);
+    Serial.println(F(")"));
+    return;
+  }
 
-  // 쿨다운 시간 체크
-  if (currentTime - serial3LastUsed < serial3CooldownTime)
-  {
-    return false;
+  s3GapMs = S3_BUS_GAP_MS;
+  s3State = S3_STATE_IDLE;
+  if (!s3Cur.cb) return;
+  s3Cur.cb(ok, s3Rx, s3RxLen, s3Cur.ctx);
+}
+
+void serial3ExecutorPoll()
+{
+  if (s3State == S3_STATE_IDLE && !s3Dequeue()) return;
+
+  if (s3State == S3_STATE_READY) {
+    if (millis() - s3BusIdleMs < s3GapMs) return;
+    s3Transmit();
+    s3State = S3_STATE_TX;
+    return;
   }
 
-  // IDLE 상태이거나 같은 사용자
-  if (serial3Owner == SERIAL3_IDLE || serial3Owner == requester)
-  {
-    return true;
+  if (s3State == S3_STATE_TX) {
+    if (!s3TxDone && millis() - s3TxStartMs < S3_TX_GUARD_MS) return;
+    s3EndTransmit();
+    if (s3Cur.resp == S3_RESP_NONE) {
+      s3Finish(true);
+      return;
+    }
+    s3State = S3_STATE_WAIT;
+    return;
+  }
+
+  int8_t r = s3ReceiveStep();
+  if (r == 0) {
+    if (millis() - s3TxDoneMs < s3CurTimeoutMs) return;
+    serial3Stats.timeouts++;
+    r = -1;
   }
+  s3Finish(r > 0);
+}
 
-  // 우선순위 체크 - 요청자가 더 높은 우선순위인지 확인
-  int currentPriority = getPriority(serial3Owner);
-  int requestPriority = getPriority(requester);
+static void printSerial3ClassStats(const __FlashStringHelper* label, uint8_t cls)
+{
+  Serial.print(label);
+  Serial.print(serial3Stats.submitted[cls]);
+  Serial.print(F("/"));
+  Serial.print(serial3Stats.dropped[cls]);
+  Serial.print(F("/"));
+  Serial.print(serial3Stats.peakDepth[cls]);
+}
 
-  return requestPriority < currentPriority; // 낮은 숫자가 높은 우선순위
+void printSerial3QueueStats()
+{
+  Serial.print(F("📊 [Serial3] 명령 큐 (제출/버림/최대깊이)"));
+  printSerial3ClassStats(F(" SAFETY="), S3_CLASS_SAFETY);
+  printSerial3ClassStats(F(" RELAY="), S3_CLASS_RELAY);
+  printSerial3ClassStats(F(" NPN="), S3_CLASS_NPN);
+  printSerial3ClassStats(F(" POLL="), S3_CLASS_POLL);
+  Serial.print(F(" 정지폐기="));
+  Serial.print(serial3Stats.purged);
+  Serial.print(F(" 타임아웃="));
+  Serial.print(serial3Stats.timeouts);
+  Serial.print(F(" 재시도="));
+  Serial.print(serial3Stats.retries);
+  Serial.print(F(" 늦은응답="));
+  Serial.println(serial3Stats.staleAcks);
+  Serial.print(F("📊 [Serial3] UNO 링크 프레임 정상="));
+  Serial.print(s3Link.stats.framesOk);
+  Serial.print(F(" CRC실패="));
+  Serial.print(s3Link.stats.crcFail);
+  Serial.print(F(" 재동기="));
+  Serial.print(s3Link.stats.resyncShifts);
+  Serial.print(F(" 무음폐기="));
+  Serial.print(s3Link.stats.staleFlush);
+  Serial.print(F(" 넘침="));
+  Serial.println(s3Link.stats.overflow);
+  Serial.print(F("📊 [Serial3] 릴레이 섀도 UNO=0x"));
+  Serial.print(unoRelayShadow.state, HEX);
+  Serial.print(F("/0x"));
+  Serial.print(unoRelayShadow.known, HEX);
+  Serial.print(F(" NPN=0x"));
+  Serial.print(npnRelayShadow.state, HEX);
+  Serial.print(F("/0x"));
+  Serial.print(npnRelayShadow.known, HEX);
+  Serial.print(F(" (상태/확인) 생략="));
+  Serial.print(unoRelayShadow.skipped + npnRelayShadow.skipped);
+  Serial.print(F(" 교정="));
+  Serial.println(unoRelayShadow.mismatches);
 }
 
 // ============= Non-blocking 센서 요청 시스템 =============
@@ -2144,19 +3628,17 @@ bool isSerial3AvailableFor(Serial3Owner requester)
 // Non-blocking 센서 요청 시스템 변수
 UnoRequestState unoRequestState = UNO_IDLE;
 unsigned long unoRequestStartTime = 0;
-String unoResponseBuffer = "";
 
 // Non-blocking 상태 요청 시스템 변수
 UnoRequestState unoStatusRequestState = UNO_IDLE;
 unsigned long unoStatusRequestStartTime = 0;
-String unoStatusResponseBuffer = "";
 
 // UNO 상태 데이터 구조
 struct UnoNutrientStatus {
   int8_t cycle;
   uint8_t status;
   bool time_received;
-  String current_time;
+  char current_time[6];   // "HH:MM"
   bool in_range;
   bool cycle_started_today;
   uint8_t relays[10];
@@ -2177,146 +3659,78 @@ UnoNutrientStatus unoNutrientStatus = {0};
 void initUnoSensorRequest()
 {
   unoRequestState = UNO_IDLE;
-  unoResponseBuffer = "";
 }
 
-void startUnoSensorRequest()
+// resp: ACK_SENSOR_DATA(0x82) + pH_H + pH_L + EC_H + EC_L + TEMP_H + TEMP_L + RESERVED = 8바이트
+static void onUnoSensorResponse(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
 {
-  // 제어용 UNO 존재하기 전에는 요청 비활성화
-  if (!unoControlPresent) return;
-  if (unoRequestState != UNO_IDLE)
+  unoRequestState = UNO_IDLE;
+  if (ok && len < 8)
   {
-    // 10초 이상 요청 중이면 강제 초기화
-    if (millis() - unoRequestStartTime > 10000)
-    {
-      unoRequestState = UNO_IDLE;
-      serial3Owner = SERIAL3_IDLE;
-      unoResponseBuffer = "";
-    }
-    else
-    {
-      return; // 이미 요청 중이면 무시
-    }
+    Serial.print(F("❌ SENSOR 응답 길이 오류: "));
+    Serial.println(len);
+    unoSensorData.isValid = false;
+    return;
   }
-
-  // Serial3 접근 요청 (최저 우선순위) - 제어 명령 우선
-  if (!requestSerial3Access(SERIAL3_UNO_SENSOR))
+  if (!ok)
   {
-    // UNO 센서 요청은 제어 명령이 없을 때만 처리
-    if (serial3Owner == SERIAL3_IDLE && (millis() - serial3LastUsed) > 5000)
-    { // 2초 → 5초로 증가
-      serial3Owner = SERIAL3_UNO_SENSOR;
-      serial3LastUsed = millis();
+    if (len > 0 && resp[0] != ACK_SENSOR_DATA)
+    {
+      Serial.print(F("❌ SENSOR 응답 오류: 0x"));
+      Serial.println(resp[0], HEX);
     }
     else
     {
-      return;
+      Serial.println(F("⏱ SENSOR 응답 타임아웃"));
     }
+    unoSensorData.isValid = false;
+    return;
   }
 
-  unoRequestState = UNO_SENDING;
-  unoRequestStartTime = millis();
-  unoResponseBuffer = "";
-
-  // ========== 프로토콜: CMD_SENSOR_REQUEST(0x25) + PARAM(0x00) = 2바이트 (no \n) ==========
-  Serial.println(F("📤 SENSOR 요청"));
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_SENSOR_REQUEST);
-  RS485_CONTROL_SERIAL.write((uint8_t)0x00); // 파라미터 없음
-  RS485_CONTROL_SERIAL.flush();
-  
-  // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  // 수신 모드 전환
-  RS485_CTRL_RX();
-
-  unoRequestState = UNO_WAITING;
+  // 데이터 변환
+  uint16_t ph_int = (resp[1] << 8) | resp[2];
+  uint16_t ec_int = (resp[3] << 8) | resp[4];
+  uint16_t temp_int = (resp[5] << 8) | resp[6];
+
+  // float로 변환
+  unoSensorData.ph = ph_int / 100.0f;            // pH * 100 → pH
+  unoSensorData.ec = (ec_int * 10.0f) / 1000.0f; // (EC/10) * 10 / 1000 → dS/m
+  unoSensorData.waterTemp = temp_int / 10.0f;    // TEMP * 10 → TEMP
+  unoSensorData.isValid = true;
+
+  Serial.print(F("📥 SENSOR: pH="));
+  Serial.print(unoSensorData.ph, 2);
+  Serial.print(F(", EC="));
+  Serial.print(unoSensorData.ec, 3);
+  Serial.print(F("dS/m, TEMP="));
+  Serial.print(unoSensorData.waterTemp, 1);
+  Serial.println(F("°C"));
 }
 
-bool updateUnoSensorRequest()
+void startUnoSensorRequest()
 {
-  switch (unoRequestState)
-  {
-  case UNO_IDLE:
-    return false; // 요청 중이 아님
+  // 제어용 UNO 존재하기 전에는 요청 비활성화
+  if (!unoControlPresent) return;
+  // 이미 요청 중이면 무시 (실행기가 타임아웃을 보장하므로 강제 초기화 불필요)
+  if (unoRequestState != UNO_IDLE) return;
 
-  case UNO_SENDING:
-    // 전송 중 (이미 startUnoSensorRequest에서 처리됨)
-    return true;
+  // ========== 링크 프레임: CMD_SENSOR_REQUEST(0x25), 페이로드 없음 → ACK_SENSOR_DATA 7바이트 ==========
+  // 최저 우선순위 - 제어 명령이 모두 처리된 뒤 송신
+  Serial3Command cmd;
+  unoBuildCommand(cmd, CMD_SENSOR_REQUEST, nullptr, 0, ACK_SENSOR_DATA, S3_SENSOR_TIMEOUT_MS);
+  cmd.cb = onUnoSensorResponse;
+  if (!serial3Submit(S3_CLASS_POLL, cmd)) return;
 
-  case UNO_WAITING:
-  case UNO_RECEIVING:
-    // 바이트 기반 응답 수신 중
-    if (RS485_CONTROL_SERIAL.available() >= 8)
-    { // 센서 데이터 8바이트 대기
-      uint8_t responseCode = RS485_CONTROL_SERIAL.read();
-
-      if (responseCode == ACK_SENSOR_DATA)
-      {
-        // ========== 프로토콜: ACK_SENSOR_DATA(0x82) + pH_H + pH_L + EC_H + EC_L + TEMP_H + TEMP_L + RESERVED = 8바이트 ==========
-        uint8_t ph_high = RS485_CONTROL_SERIAL.read();
-        uint8_t ph_low = RS485_CONTROL_SERIAL.read();
-        uint8_t ec_high = RS485_CONTROL_SERIAL.read();
-        uint8_t ec_low = RS485_CONTROL_SERIAL.read();
-        uint8_t temp_high = RS485_CONTROL_SERIAL.read();
-        uint8_t temp_low = RS485_CONTROL_SERIAL.read();
-        uint8_t reserved = RS485_CONTROL_SERIAL.read();
-
-        // 데이터 변환
-        uint16_t ph_int = (ph_high << 8) | ph_low;
-        uint16_t ec_int = (ec_high << 8) | ec_low;
-        uint16_t temp_int = (temp_high << 8) | temp_low;
-
-        // float로 변환
-        unoSensorData.ph = ph_int / 100.0f;            // pH * 100 → pH
-        unoSensorData.ec = (ec_int * 10.0f) / 1000.0f; // (EC/10) * 10 / 1000 → dS/m
-        unoSensorData.waterTemp = temp_int / 10.0f;    // TEMP * 10 → TEMP
-        unoSensorData.isValid = true;
-
-        Serial.print(F("📥 SENSOR: pH="));
-        Serial.print(unoSensorData.ph, 2);
-        Serial.print(F(", EC="));
-        Serial.print(unoSensorData.ec, 3);
-        Serial.print(F("dS/m, TEMP="));
-        Serial.print(unoSensorData.waterTemp, 1);
-        Serial.println(F("°C"));
-
-        // 응답 완료
-        unoRequestState = UNO_IDLE;
-        releaseSerial3Access(); // Serial3 접근 해제
-
-        return false; // 요청 완료
-      }
-      else
-      {
-        Serial.print(F("❌ SENSOR 응답 오류: 0x"));
-        Serial.println(responseCode, HEX);
-        unoRequestState = UNO_IDLE;
-        releaseSerial3Access();
-        unoSensorData.isValid = false;
-        return false;
-      }
-    }
-    else
-    {
-      // 타임아웃 체크
-      if (millis() - unoRequestStartTime > 10000)
-      { // 10초 타임아웃
-        Serial.println(F("⏱ SENSOR 응답 타임아웃"));
-        unoRequestState = UNO_IDLE;
-        releaseSerial3Access();
-        unoSensorData.isValid = false;
-        return false;
-      }
+  Serial.println(F("📤 SENSOR 요청"));
+  unoRequestState = UNO_WAITING;
+  unoRequestStartTime = millis();
 }
-    return true; // 아직 처리 중
 
-  default:
-    unoRequestState = UNO_IDLE;
-    return false;
-  }
+// 요청이 진행 중이면 true (응답 처리는 실행기 콜백에서 수행)
+bool updateUnoSensorRequest()
+{
+  serial3ExecutorPoll();
+  return unoRequestState != UNO_IDLE;
 }
 
 // ============= Non-blocking 상태 요청 시스템 =============
@@ -2324,211 +3738,101 @@ bool updateUnoSensorRequest()
 void initUnoStatusRequest()
 {
   unoStatusRequestState = UNO_IDLE;
-  unoStatusResponseBuffer = "";
   unoNutrientStatus.isValid = false;
 }
 
-void startUnoStatusRequest()
+// ACK_STATUS_BIN(0x84) + 21바이트 페이로드 - Command_UNO sendNutrientStatus()와 동일한 배치
+static void onUnoStatusResponse(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
 {
-  // 제어용 UNO 존재하기 전에는 요청 비활성화
-  if (!unoControlPresent) return;
-  if (unoStatusRequestState != UNO_IDLE)
+  unoStatusRequestState = UNO_IDLE;
+  if (!ok)
   {
-    // 10초 이상 요청 중이면 강제 초기화
-    if (millis() - unoStatusRequestStartTime > 10000)
+    if (len > 0)
     {
-      unoStatusRequestState = UNO_IDLE;
-      serial3Owner = SERIAL3_IDLE;
-      unoStatusResponseBuffer = "";
+      Serial.print(F("❌ STATUS 응답 오류: 0x"));
+      Serial.println(resp[0], HEX);
     }
     else
     {
-      return; // 이미 요청 중이면 무시
+      Serial.println(F("⏱ STATUS 응답 타임아웃"));
     }
+    unoNutrientStatus.isValid = false;
+    return;
   }
 
-  // Serial3 접근 요청 (최저 우선순위) - 제어 명령 우선
-  if (!requestSerial3Access(SERIAL3_UNO_SENSOR))
+  // 무결성은 링크 CRC가 보장 - 길이/버전만 확인
+  if (len != 1 + UNO_STATUS_PAYLOAD_LEN || resp[1] != UNO_STATUS_FRAME_VER)
   {
-    // UNO 상태 요청은 제어 명령이 없을 때만 처리
-    if (serial3Owner == SERIAL3_IDLE && (millis() - serial3LastUsed) > 5000)
-    {
-      serial3Owner = SERIAL3_UNO_SENSOR;
-      serial3LastUsed = millis();
-    }
-    else
-    {
-      return;
-    }
+    Serial.print(F("❌ STATUS 길이/버전 오류 (len="));
+    Serial.print(len);
+    Serial.print(F(" ver="));
+    Serial.print(resp[1]);
+    Serial.println(F(")"));
+    unoNutrientStatus.isValid = false;
+    return;
   }
 
-  unoStatusRequestState = UNO_SENDING;
-  unoStatusRequestStartTime = millis();
-  unoStatusResponseBuffer = "";
-
-  // ========== 프로토콜: CMD_STATUS_REQUEST(0x33) + PARAM(0x00) = 2바이트 (no \n) ==========
-  Serial.println(F("📤 STATUS 요청"));
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CONTROL_SERIAL.write((uint8_t)CMD_STATUS_REQUEST);
-  RS485_CONTROL_SERIAL.write((uint8_t)0x00); // 파라미터 없음
-  RS485_CONTROL_SERIAL.flush();
-  
-  // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  // 수신 모드 전환
-  RS485_CTRL_RX();
-
-  unoStatusRequestState = UNO_WAITING;
-}
+  unoNutrientStatus.cycle = (int8_t)resp[2];
+  unoNutrientStatus.status = resp[3];
+  uint8_t flags = resp[4];
+  unoNutrientStatus.time_received = (flags & UNO_STATUS_F_TIME) != 0;
+  unoNutrientStatus.in_range = (flags & UNO_STATUS_F_IN_RANGE) != 0;
+  unoNutrientStatus.cycle_started_today = (flags & UNO_STATUS_F_STARTED) != 0;
+  snprintf_P(unoNutrientStatus.current_time, sizeof(unoNutrientStatus.current_time), PSTR("%02u:%02u"),
+             resp[5] % 24, resp[6] % 60);
+
+  // 릴레이 비트맵 (채널 0 = bit0)
+  uint16_t relayBits = ((uint16_t)resp[7] << 8) | resp[8];
+  for (uint8_t i = 0; i < 10; i++) {
+    unoNutrientStatus.relays[i] = (relayBits >> i) & 0x01;
+  }
+  // 섀도 교정 - nutCycle 동작 중이면 UNO가 스스로 릴레이를 바꾸므로 중복 필터 중지
+  unoRelayShadowReport(relayBits, unoNutrientStatus.status != 0 || unoNutrientStatus.cycle >= 0);
 
-bool updateUnoStatusRequest()
-{
-  switch (unoStatusRequestState)
-  {
-  case UNO_IDLE:
-    return false; // 요청 중이 아님
+  // 타이머 정보
+  unoNutrientStatus.rm = resp[9];
+  unoNutrientStatus.rs = resp[10];
+  unoNutrientStatus.rh = resp[11];
+  unoNutrientStatus.rm_wait = resp[12];
+  unoNutrientStatus.rs_wait = resp[13];
 
-  case UNO_SENDING:
-    // 전송 중 (이미 startUnoStatusRequest에서 처리됨)
-    return true;
+  // 센서 데이터: pH×100, EC(μS/cm), 수온×10 (부호 있음)
+  unoNutrientStatus.ph = (((uint16_t)resp[14] << 8) | resp[15]) / 100.0f;
+  unoNutrientStatus.ec = (((uint16_t)resp[16] << 8) | resp[17]) / 1000.0f;  // μS/cm → dS/m
+  unoNutrientStatus.temp = (int16_t)(((uint16_t)resp[18] << 8) | resp[19]) / 10.0f;
 
-  case UNO_WAITING:
-  case UNO_RECEIVING:
-    // 길이 기반 프로토콜 응답 수신: ACK_STATUS_DATA(0x83) + LEN_H(1) + LEN_L(1) + JSON(N)
-    if (RS485_CONTROL_SERIAL.available() >= 3)
-    {
-      uint8_t responseCode = RS485_CONTROL_SERIAL.read();
-      
-      if (responseCode == ACK_STATUS_DATA)
-      {
-        // 길이 헤더 읽기 (2바이트, big-endian)
-        uint8_t lenHigh = RS485_CONTROL_SERIAL.read();
-        uint8_t lenLow = RS485_CONTROL_SERIAL.read();
-        uint16_t jsonLen = (lenHigh << 8) | lenLow;
-        if (jsonLen > 255) jsonLen = 255; // 최대 길이 제한
-        
-        // JSON 데이터 읽기 (타임아웃: 2초로 증가)
-        char jsonStr[256] = {0};
-        uint16_t received = 0;
-        unsigned long startTime = millis();
-        while (millis() - startTime < 2000 && received < jsonLen) {
-          while (RS485_CONTROL_SERIAL.available() && received < jsonLen) {
-            jsonStr[received++] = RS485_CONTROL_SERIAL.read();
-          }
-          if (received < jsonLen) {
-            delay(2); // 데이터 대기 시간 증가
-          }
-        }
-        
-        if (received == jsonLen) {
-          jsonStr[jsonLen] = '\0';
-          
-          // 디버깅: 수신된 JSON 길이 출력
-          Serial.print(F("📥 STATUS JSON 수신: "));
-          Serial.print(received);
-          Serial.print(F("B"));
-          if (received < 50) {
-            Serial.print(F(" ["));
-            Serial.print(jsonStr);
-            Serial.print(F("]"));
-          }
-          Serial.println();
-          
-          // JSON 파싱
-          StaticJsonDocument<256> doc;
-          DeserializationError error = deserializeJson(doc, jsonStr);
-          
-          if (!error) {
-            // 상태 데이터 저장
-            unoNutrientStatus.cycle = doc["cycle"] | -1;
-            unoNutrientStatus.status = doc["status"] | 0;
-            unoNutrientStatus.time_received = doc["time_received"] | 0;
-            unoNutrientStatus.current_time = doc["current_time"].as<String>();
-            unoNutrientStatus.in_range = doc["in_range"] | 0;
-            unoNutrientStatus.cycle_started_today = doc["cycle_started_today"] | 0;
-            
-            // 릴레이 상태
-            if (doc.containsKey("relays") && doc["relays"].is<JsonArray>()) {
-              JsonArray relays = doc["relays"];
-              for (uint8_t i = 0; i < 10 && i < relays.size(); i++) {
-                unoNutrientStatus.relays[i] = relays[i] | 0;
-              }
-            }
-            
-            // 타이머 정보
-            unoNutrientStatus.rm = doc["rm"] | 0;
-            unoNutrientStatus.rs = doc["rs"] | 0;
-            unoNutrientStatus.rh = doc["rh"] | 0;
-            unoNutrientStatus.rm_wait = doc["rm_wait"] | 0;
-            unoNutrientStatus.rs_wait = doc["rs_wait"] | 0;
-            
-            // 센서 데이터
-            if (doc.containsKey("sensors")) {
-              JsonObject sensors = doc["sensors"];
-              unoNutrientStatus.ph = sensors["ph"] | 0.0f;
-              unoNutrientStatus.ec = sensors["ec"] | 0.0f;
-              unoNutrientStatus.temp = sensors["temp"] | 0.0f;
-            }
-            
-            unoNutrientStatus.isValid = true;
-            unoNutrientStatus.lastUpdate = millis();
-            
-            Serial.println(F("📥 STATUS 수신 완료"));
-            
-            // 서버로 즉시 전송
-            sendStatusToMQTT();
-          } else {
-            Serial.print(F("❌ STATUS JSON 파싱 오류: "));
-            Serial.println(error.f_str());
-            unoNutrientStatus.isValid = false;
-          }
-        } else {
-          Serial.print(F("❌ STATUS JSON 불완전: "));
-          Serial.print(received);
-          Serial.print(F("/"));
-          Serial.print(jsonLen);
-          Serial.print(F("B (타임아웃: "));
-          Serial.print(millis() - startTime);
-          Serial.println(F("ms)"));
-          unoNutrientStatus.isValid = false;
-        }
-        
-        // 응답 완료
-        unoStatusRequestState = UNO_IDLE;
-        releaseSerial3Access(); // Serial3 접근 해제
-        
-        return false; // 요청 완료
-      }
-      else
-      {
-        Serial.print(F("❌ STATUS 응답 오류: 0x"));
-        Serial.println(responseCode, HEX);
-        unoStatusRequestState = UNO_IDLE;
-        releaseSerial3Access();
-        unoNutrientStatus.isValid = false;
-        return false;
-      }
-    }
-    else
-    {
-      // 타임아웃 체크
-      if (millis() - unoStatusRequestStartTime > 10000)
-      { // 10초 타임아웃
-        Serial.println(F("⏱ STATUS 응답 타임아웃"));
-        unoStatusRequestState = UNO_IDLE;
-        releaseSerial3Access();
-        unoNutrientStatus.isValid = false;
-        return false;
-      }
-    }
-    return true; // 아직 처리 중
+  unoNutrientStatus.isValid = true;
+  unoNutrientStatus.lastUpdate = millis();
 
-  default:
-    unoStatusRequestState = UNO_IDLE;
-    return false;
-  }
+  Serial.println(F("📥 STATUS 수신 완료"));
+
+  // 서버로 즉시 전송
+  sendStatusToMQTT();
+}
+
+void startUnoStatusRequest()
+{
+  // 제어용 UNO 존재하기 전에는 요청 비활성화
+  if (!unoControlPresent) return;
+  // 이미 요청 중이면 무시 (실행기가 타임아웃을 보장하므로 강제 초기화 불필요)
+  if (unoStatusRequestState != UNO_IDLE) return;
+
+  // ========== 링크 프레임: CMD_STATUS_REQUEST(0x33), 페이로드 없음 → ACK_STATUS_BIN 21바이트 ==========
+  Serial3Command cmd;
+  unoBuildCommand(cmd, CMD_STATUS_REQUEST, nullptr, 0, ACK_STATUS_BIN, S3_STATUS_TIMEOUT_MS);
+  cmd.cb = onUnoStatusResponse;
+  if (!serial3Submit(S3_CLASS_POLL, cmd)) return;
+
+  Serial.println(F("📤 STATUS 요청"));
+  unoStatusRequestState = UNO_WAITING;
+  unoStatusRequestStartTime = millis();
+}
+
+// 요청이 진행 중이면 true (응답 처리는 실행기 콜백에서 수행)
+bool updateUnoStatusRequest()
+{
+  serial3ExecutorPoll();
+  return unoStatusRequestState != UNO_IDLE;
 }
 
 // ============= UNO 상태 기반 서버 전송 함수 =============
@@ -2573,18 +3877,16 @@ bool sendStatusToMQTT()
   sensors["ec"] = unoNutrientStatus.ec;
   sensors["temp"] = unoNutrientStatus.temp;
   
-  // String 객체 제거: char 배열 사용 (메모리 최적화)
-  char statusJson[400] = {0};
-  size_t jsonLen = serializeJson(statusDoc, statusJson, sizeof(statusJson));
-  if (jsonLen >= sizeof(statusJson)) {
-    jsonLen = sizeof(statusJson) - 1; // null 문자 공간 확보
-  }
-  
   // 토픽도 char 배열로 구성 (String 제거)
   char statusTopic[64] = {0};
   snprintf_P(statusTopic, sizeof(statusTopic), PSTR("nutrient/status/%s"), DEVICE_ID);
   
-  bool published = mqttClient.publish(statusTopic, statusJson);
+  // 직렬화 버퍼 없이 스트리밍 (PubSubClient 버퍼보다 긴 문서도 전송)
+  bool published = mqttClient.beginPublish(statusTopic, measureJson(statusDoc), false);
+  if (published) {
+    serializeJson(statusDoc, mqttClient);
+    published = mqttClient.endPublish() == 1;
+  }
   
   if (published) {
     Serial.println(F("📡 STATUS 서버 전송 완료"));
@@ -2597,9 +3899,6 @@ bool sendStatusToMQTT()
 
 // ============= UNO ACK 서버 전달 함수 =============
 
-// 전역 변수: 현재 처리 중인 UNO 명령의 command_id
-String currentUnoCommandId = "";
-
 void sendUnoAckToServer(const char* command, uint8_t channel, bool success, const char* commandId) {
   // MQTT로 서버에 ACK 전달
   if (mqttClient.connected()) {
@@ -2607,17 +3906,9 @@ void sendUnoAckToServer(const char* command, uint8_t channel, bool success, cons
     
     // JSON 응답 생성
     String response = "{";
-    // command_id 우선순위: 파라미터 > 전역 변수 > 생성
-    const char* finalCommandId = nullptr;
-    if (commandId && strlen(commandId) > 0) {
-      finalCommandId = commandId;
-    } else if (currentUnoCommandId.length() > 0) {
-      finalCommandId = currentUnoCommandId.c_str();
-    }
-    
-    if (finalCommandId) {
-      // 서버가 보낸 원래 command_id 사용
-      response += "\"command_id\":\"" + String(finalCommandId) + "\",";
+    if (commandId && commandId[0]) {
+      // 서버가 보낸 원래 command_id 사용 (완료 컨텍스트가 보관한 값)
+      response += "\"command_id\":\"" + String(commandId) + "\",";
     } else {
       // command_id가 없으면 생성 (하위 호환성)
       response += "\"command_id\":\"uno_ack_" + String(millis()) + "\",";
@@ -2633,582 +3924,509 @@ void sendUnoAckToServer(const char* command, uint8_t channel, bool success, cons
     Serial.println(response);
     
     mqttClient.publish(topic.c_str(), response.c_str());
-    
-    // command_id 사용 후 초기화
-    currentUnoCommandId = "";
   } else {
     Serial.println(F("❌ MQTT 연결 없음 - ACK 전달 실패"));
   }
 }
 
-// UNO로 nutCycle 설정 전달 함수
-void sendNutrientConfigToUno(const char* jsonConfig) {
-  // ========== 프로토콜: CMD_NUTCYCLE_CONFIG(0x32) + LEN_H(1) + LEN_L(1) + JSON(N) ==========
-  
-  // JSON 파싱하여 STOP 명령인지 확인
-  StaticJsonDocument<128> doc;
-  bool isStopCommand = false;
-  if (deserializeJson(doc, jsonConfig) == DeserializationError::Ok) {
-    if (doc.containsKey("cmd")) {
-      String cmd = doc["cmd"].as<String>();
-      cmd.toUpperCase();
-      isStopCommand = (cmd == "STOP");
-    }
-  }
-  
-  size_t jsonLen = strlen(jsonConfig);
-  if (jsonLen > 256) jsonLen = 256; // 최대 길이 제한
-  
-  // 재시도 횟수 설정 (STOP 명령은 최대 3회, 일반 명령은 1회)
-  uint8_t maxRetries = isStopCommand ? 3 : 1;
-  bool success = false;
-  
-  for (uint8_t retry = 0; retry < maxRetries; retry++) {
-    if (retry > 0) {
-      Serial.print(F("🔄 재시도 "));
-      Serial.print(retry);
-      Serial.print(F("/"));
-      Serial.print(maxRetries - 1);
-      Serial.println();
-      delay(100); // 재시도 전 대기
-    }
-    
-    while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-    
-    Serial.print(F("📤 JSON 전송: "));
-    Serial.print(jsonLen);
-    Serial.println(F("B"));
-    
-    // 송신 시퀀스
-    RS485_CTRL_TX();
-    delayMicroseconds(RS485_TURNAROUND_US);
-    
-    // 명령 코드 전송
-    RS485_CONTROL_SERIAL.write((uint8_t)0x32); // CMD_NUTCYCLE_CONFIG
-    
-    // 길이 헤더 전송 (2바이트, big-endian)
-    RS485_CONTROL_SERIAL.write((uint8_t)((jsonLen >> 8) & 0xFF)); // 상위 바이트
-    RS485_CONTROL_SERIAL.write((uint8_t)(jsonLen & 0xFF));       // 하위 바이트
-    
-    // JSON 데이터 전송 (바이너리, \n 없음)
-    for (size_t i = 0; i < jsonLen; i++) {
-      RS485_CONTROL_SERIAL.write((uint8_t)jsonConfig[i]);
-    }
-    RS485_CONTROL_SERIAL.flush();
-    
-    // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-    delayMicroseconds(RS485_TURNAROUND_US);
-    
-    // 수신 모드 전환
-    RS485_CTRL_RX();
-    
-    // ACK 수신 대기 (타임아웃: 500ms)
-    unsigned long startTime = millis();
-    bool ackReceived = false;
-    bool ackError = false;
-    
-    while (millis() - startTime < 500) {
-      if (RS485_CONTROL_SERIAL.available()) {
-        uint8_t ackCode = RS485_CONTROL_SERIAL.read();
-        if (ackCode == ACK_OK) {
-          ackReceived = true;
-          success = true;
-          break;
-        } else if (ackCode == ACK_ERROR) {
-          ackError = true;
-          break; // 명시적 에러
-        }
-      }
-      delay(1);
-    }
-    
-    if (ackReceived) {
-      if (isStopCommand && retry > 0) {
-        Serial.print(F("✅ STOP 명령 전달 성공 (재시도 "));
-        Serial.print(retry);
-        Serial.println(F("회)"));
-      } else {
-        Serial.println(F("✅ nutCycle 설정 전달 성공"));
-      }
-      break; // 성공 시 루프 종료
-    } else {
-      // ACK를 못 받은 경우 (타임아웃 또는 ACK_ERROR)
-      if (ackError) {
-        if (isStopCommand && retry < maxRetries - 1) {
-          Serial.println(F("❌ ACK_ERROR - 재시도 예정"));
-        } else {
-          Serial.println(F("❌ nutCycle 설정 전달 실패 (ACK_ERROR)"));
-          if (!isStopCommand) break; // 일반 명령은 ACK_ERROR 시 즉시 종료
-        }
-      } else {
-        // 타임아웃
-        if (retry < maxRetries - 1) {
-          Serial.println(F("❌ 타임아웃 - 재시도 예정"));
-        } else {
-          Serial.println(F("❌ nutCycle 설정 전달 실패 (타임아웃)"));
-        }
-      }
-    }
+void publishCommandResponse(const CommandReply& reply, bool success, const char* response)
+{
+  StaticJsonDocument<256> doc;
+  doc["command_id"] = reply.commandId;
+  doc["device_id"] = DEVICE_ID;
+  doc["slave_id"] = reply.slaveId;
+  doc["function_code"] = reply.functionCode;
+  doc["address"] = reply.address;
+  doc["value"] = reply.value;
+  doc["success"] = success;
+  doc["response"] = response;
+  doc["timestamp"] = millis();
+  doc["is_command_response"] = true;
+
+  // npn_command 형식 요청이면 명령 정보 추가
+  if (reply.npnCommand[0])
+  {
+    doc["npn_command"] = reply.npnCommand;
+    doc["channel"] = reply.npnChannel;
+    doc["device_type"] = "NPN_MODULE";
   }
+
+  char responseTopic[64];
+  snprintf_P(responseTopic, sizeof(responseTopic), PSTR("modbus/command-responses/%s"), DEVICE_ID);
+  if (!mqttClient.beginPublish(responseTopic, measureJson(doc), false)) return;
+  serializeJson(doc, mqttClient);
+  mqttClient.endPublish();
 }
 
-// ============= 센서 상태 모니터링 함수들 (UNO가 담당하므로 주석처리) =============
-/*
-// 센서 상태 업데이트
-void updateSensorStatus(uint8_t slaveId, bool success) {
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (modbusSensors[i].slaveId == slaveId) {
-      if (success) {
-        modbusSensors[i].isOnline = true;
-        modbusSensors[i].lastResponse = millis();
-        modbusSensors[i].consecutiveFailures = 0;
-        Serial.print(F("✅ 센서 "));
-        Serial.print(slaveId);
-        Serial.println(F(" 온라인"));
-      } else {
-        modbusSensors[i].consecutiveFailures++;
-        if (modbusSensors[i].consecutiveFailures >= 3) {
-          modbusSensors[i].isOnline = false;
-          Serial.print(F("❌ 센서 "));
-          Serial.print(slaveId);
-          Serial.println(F(" 오프라인 (3회 연속 실패)"));
-        }
-      }
-      break;
-    }
+// nutCycle 명령 종류 (종류별 응답 정보 / 대기 슬롯)
+enum NutConfigKind : uint8_t {
+  NUT_KIND_CONFIG,   // 설정/스케줄/START (사용자 명령)
+  NUT_KIND_TIME,     // TIME_SYNC (백엔드 자동 전송 - 같은 토픽)
+  NUT_KIND_STOP,
+  NUT_KIND_COUNT
+};
+
+// 전달 중 도착한 설정 (종류별 1건, 최신 우선 - 밀려난 설정은 실패 응답)
+struct NutrientPending {
+  uint8_t tlv[NUT_TLV_MAX];
+  uint8_t len;   // 0 = 비어 있음
+  CommandReply reply;
+};
+
+// nutCycle 설정 본문 버퍼: TLV + 링크 CRC (큐 적재 ~ 송신 완료까지 유지)
+// - 전달 중인 설정은 하나: 그동안 도착한 일반 설정은 대기 슬롯에 두었다가 완료 콜백에서 제출
+//   (시각 동기는 별도 슬롯 - 주기적 TIME_SYNC가 사용자 설정을 밀어내지 않도록)
+// - STOP은 항상 버퍼를 차지 (대기 중인 일반 설정은 안전 정지 클래스 제출 시 큐에서 폐기되고,
+//   이미 송신된 설정은 재송신이 없으므로 본문을 다시 읽지 않음)
+static uint8_t nutrientConfigBuf[NUT_TLV_MAX + 2];
+static uint8_t nutrientConfigGen = 0;   // 버퍼를 소유한 명령 세대 (이전 명령의 완료가 버퍼를 풀지 않도록)
+static bool nutrientConfigBusy = false;
+static uint8_t nutrientConfigKind = NUT_KIND_CONFIG;
+static CommandReply nutrientReplies[NUT_KIND_COUNT];   // 제출된 명령의 응답 정보 (STOP이 전달 중인 설정을 앞지를 수 있어 종류별)
+static NutrientPending nutrientPending[NUT_KIND_STOP];  // STOP은 대기하지 않음
+
+static void nutrientSubmitPending();
+
+// command_id 없는 요청(백엔드 자동 TIME_SYNC)은 응답 생략
+static void nutrientReply(const CommandReply &reply, bool ok, const char *text)
+{
+  if (reply.commandId[0]) publishCommandResponse(reply, ok, text);
+}
+
+static void onNutrientConfigAck(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  uint16_t tag = (uint16_t)(uintptr_t)ctx;   // 하위 바이트: 세대, 상위 바이트: 종류
+  uint8_t kind = (uint8_t)(tag >> 8);
+  bool isStop = kind == NUT_KIND_STOP;
+  bool current = (uint8_t)tag == nutrientConfigGen;
+  if (current) nutrientConfigBusy = false;
+
+  // STOP은 UNO에서 전체 릴레이 OFF, 그 외 설정은 사이클을 시작할 수 있음 (다음 상태 보고까지 필터 중지)
+  if (isStop) relayShadowDone(unoRelayShadow, ok, resp != nullptr && len == 0, 0, UNO_RELAY_ALL, 0);
+  if (ok) unoRelayShadow.autonomous = !isStop;
+
+  const char *text;
+  if (ok) {
+    Serial.println(isStop ? F("✅ STOP 명령 전달 성공") : F("✅ nutCycle 설정 전달 성공"));
+    text = isStop ? "nutCycle STOP delivered" : "nutCycle config delivered";
+  } else if (resp == nullptr) {
+    Serial.println(F("🛑 nutCycle 설정 취소 (STOP 우선)"));
+    text = "nutCycle config cancelled by STOP";
+  } else if (len > 0) {
+    Serial.println(F("❌ nutCycle 설정 전달 실패 (ACK_ERROR - CRC/검증 오류)"));
+    text = "nutCycle config rejected by UNO";
+  } else {
+    Serial.println(F("❌ nutCycle 설정 전달 실패 (타임아웃)"));
+    text = "nutCycle config timeout";
   }
+  nutrientReply(nutrientReplies[kind], ok, text);
+
+  // 버퍼가 풀렸으면 대기 중인 설정 제출 (STOP 제출 중 폐기된 설정은 세대가 달라 건너뜀)
+  if (current) nutrientSubmitPending();
 }
 
-// 센서 온라인 상태 확인
-bool isSensorOnline(uint8_t slaveId) {
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (modbusSensors[i].slaveId == slaveId) {
-      return modbusSensors[i].isOnline;
-    }
+// ============= nutCycle TLV 컴파일 =============
+struct NutTlvWriter {
+  uint8_t *buf;
+  uint8_t len;
+  bool ok;   // 범위 오류 또는 버퍼 초과 시 false
+};
+
+static uint8_t *nutTlvOpen(NutTlvWriter &w, uint8_t tag, uint8_t vlen)
+{
+  if (!w.ok || w.len + 2 + vlen > NUT_TLV_MAX) {
+    w.ok = false;
+    return nullptr;
   }
-  return false;
+  w.buf[w.len++] = tag;
+  w.buf[w.len++] = vlen;
+  uint8_t *v = w.buf + w.len;
+  w.len += vlen;
+  return v;
 }
 
-// 센서 헬스체크 수행
-void performHealthCheck() {
-  static unsigned long lastHealthCheck = 0;
-  unsigned long currentTime = millis();
-  
-  // 30초마다 헬스체크 수행
-  if (currentTime - lastHealthCheck < 30000) {
+// 키가 있으면 범위 검사 후 f32 TLV 추가
+static void nutTlvFloat(NutTlvWriter &w, JsonObject obj, const char *key, uint8_t tag, float lo, float hi)
+{
+  if (!obj.containsKey(key)) return;
+  float f = obj[key].as<float>();
+  if (!(f >= lo && f <= hi)) {   // NaN 포함
+    Serial.print(F("❌ nutCycle 설정 범위 오류: "));
+    Serial.println(key);
+    w.ok = false;
     return;
   }
-  lastHealthCheck = currentTime;
-  
-  Serial.println(F("🔍 센서 헬스체크 시작"));
-  
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (!modbusSensors[i].active) continue;
-    
-    // 간단한 읽기 요청으로 센서 상태 확인
-    uint16_t testData[2];
-    bool success = readModbusRegisters(modbusSensors[i].slaveId, 0, 2, testData);
-    
-    updateSensorStatus(modbusSensors[i].slaveId, success);
-    
-    if (success) {
-      Serial.print(F("✅ 센서 "));
-      Serial.print(modbusSensors[i].slaveId);
-      Serial.print(F(" ("));
-      Serial.print(modbusSensors[i].name);
-      Serial.println(F(") 정상"));
-    } else {
-      Serial.print(F("❌ 센서 "));
-      Serial.print(modbusSensors[i].slaveId);
-      Serial.print(F(" ("));
-      Serial.print(modbusSensors[i].name);
-      Serial.println(F(") 응답 없음"));
-    }
-    
-    delay(100); // 센서 간 간격
+  uint8_t *v = nutTlvOpen(w, tag, 4);
+  if (v) memcpy(v, &f, 4);
+}
+
+static void nutTlvU8(NutTlvWriter &w, JsonObject obj, const char *key, uint8_t tag, int hi)
+{
+  if (!obj.containsKey(key)) return;
+  int n = obj[key].as<int>();
+  if (n < 0 || n > hi) {
+    Serial.print(F("❌ nutCycle 설정 범위 오류: "));
+    Serial.println(key);
+    w.ok = false;
+    return;
   }
-  
-  Serial.println(F("🔍 센서 헬스체크 완료"));
+  uint8_t *v = nutTlvOpen(w, tag, 1);
+  if (v) v[0] = (uint8_t)n;
 }
 
-// 센서 실패 카운트 리셋
-void resetSensorFailureCount(uint8_t slaveId) {
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (modbusSensors[i].slaveId == slaveId) {
-      modbusSensors[i].consecutiveFailures = 0;
-      break;
+// MQTT JSON → TLV. 반환: TLV 길이 (0 = 거부), kind: NutConfigKind, reply: 사용자 명령이면 command_id("id")
+static uint8_t compileNutrientConfig(const char *jsonConfig, uint8_t *out, uint8_t &kind, CommandReply &reply)
+{
+  kind = NUT_KIND_CONFIG;
+  StaticJsonDocument<384> doc;
+  DeserializationError error = deserializeJson(doc, jsonConfig);
+  if (error) {
+    Serial.print(F("❌ nutCycle JSON 파싱 오류: "));
+    Serial.println(error.c_str());
+    return 0;
+  }
+
+  NutTlvWriter w = {out, 0, true};
+  const char *command = doc["cmd"] | "";
+
+  if (strcasecmp_P(command, PSTR("TIME_SYNC")) == 0) {
+    kind = NUT_KIND_TIME;
+    // "YYYY-MM-DD HH:MM:SS" → 연(2) 월 일 시 분 초
+    int y, mo, d, h, mi, s;
+    const char *timeStr = doc["time"] | "";
+    if (sscanf(timeStr, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &s) != 6 ||
+        mo < 1 || mo > 12 || d < 1 || d > 31 || h < 0 || h > 23 || mi < 0 || mi > 59 || s < 0 || s > 59) {
+      Serial.println(F("❌ TIME_SYNC 시간 형식 오류"));
+      return 0;
     }
+    uint8_t *v = nutTlvOpen(w, NUT_TAG_TIME, 7);
+    v[0] = (uint8_t)(y >> 8);
+    v[1] = (uint8_t)(y & 0xFF);
+    v[2] = mo;
+    v[3] = d;
+    v[4] = h;
+    v[5] = mi;
+    v[6] = s;
+    return w.len;
+  }
+
+  strncpy(reply.commandId, doc["id"] | "", COMMAND_ID_MAX);
+  if (strcasecmp_P(command, PSTR("STOP")) == 0) {
+    kind = NUT_KIND_STOP;
+    nutTlvOpen(w, NUT_TAG_CMD, 1)[0] = NUT_CMD_STOP;
+    return w.len;
+  }
+
+  // 설정값: pH/EC 99 이상은 해당 조정 생략 의미. 관수/주기 간 관계는 UNO가 현재 값과 합쳐 검증
+  JsonObject set = doc["set"];
+  if (!set.isNull()) {
+    nutTlvFloat(w, set, "ph", NUT_TAG_PH, 0.0f, 100.0f);
+    nutTlvFloat(w, set, "ec", NUT_TAG_EC, 0.0f, 1000.0f);
+    nutTlvFloat(w, set, "ep", NUT_TAG_EP, 0.0f, 100.0f);
+    nutTlvFloat(w, set, "ee", NUT_TAG_EE, 0.0f, 100.0f);
+    nutTlvFloat(w, set, "st", NUT_TAG_ST, 0.0f, 10080.0f);   // 분 (최대 1주)
+    nutTlvFloat(w, set, "ct", NUT_TAG_CT, 0.0f, 8760.0f);    // 시간 (최대 1년)
+    nutTlvU8(w, set, "a", NUT_TAG_BED_A, 1);
+    nutTlvU8(w, set, "b", NUT_TAG_BED_B, 1);
+    nutTlvU8(w, set, "c", NUT_TAG_BED_C, 1);
+    nutTlvU8(w, set, "d", NUT_TAG_BED_D, 1);
+  }
+
+  // 스케줄
+  JsonObject sch = doc["sch"];
+  if (!sch.isNull()) {
+    nutTlvU8(w, sch, "te", NUT_TAG_TE, 1);
+    nutTlvU8(w, sch, "de", NUT_TAG_DE, 1);
+    nutTlvU8(w, sch, "oe", NUT_TAG_OE, 1);
+    nutTlvU8(w, sch, "sh", NUT_TAG_SH, 23);
+    nutTlvU8(w, sch, "sm", NUT_TAG_SM, 59);
+    nutTlvU8(w, sch, "eh", NUT_TAG_EH, 23);
+    nutTlvU8(w, sch, "em", NUT_TAG_EM, 59);
+  }
+
+  // START는 설정 뒤에 (UNO는 설정 반영 후 시작)
+  if (strcasecmp_P(command, PSTR("START")) == 0) {
+    uint8_t *v = nutTlvOpen(w, NUT_TAG_CMD, 1);
+    if (v) v[0] = NUT_CMD_START;
+  } else if (command[0]) {
+    Serial.print(F("⚠️ 알 수 없는 nutCycle 명령 무시: "));
+    Serial.println(command);
+  }
+
+  if (!w.ok) return 0;
+  if (w.len == 0) {
+    Serial.println(F("❌ nutCycle 설정 없음 - 전송 생략"));
   }
+  return w.len;
 }
 
-// 센서 오프라인 마킹
-void markSensorOffline(uint8_t slaveId) {
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (modbusSensors[i].slaveId == slaveId) {
-      modbusSensors[i].isOnline = false;
-      modbusSensors[i].consecutiveFailures = 0;
-      break;
-    }
+// 본문 버퍼에 TLV + CRC를 적재해 제출 (버퍼가 비어 있거나 STOP일 때만)
+static void nutrientConfigSubmit(uint8_t kind, const uint8_t *tlv, uint8_t tlvLen, const CommandReply &reply)
+{
+  // ========== 링크 프레임: CMD_NUTCYCLE_BIN(0x35), 페이로드 = TLV (헤더는 cmd.frame, TLV + CRC는 본문) ==========
+  bool isStopCommand = kind == NUT_KIND_STOP;
+  Serial3Command cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.seq = unoNextSeq();
+  ulinkHeader(cmd.frame, CMD_NUTCYCLE_BIN, cmd.seq, tlvLen);
+  cmd.frameLen = ULINK_HEADER_LEN;
+
+  // 본문 = TLV + CRC16 (헤더부터 누적)
+  uint16_t crc = ulinkCrc(cmd.frame, tlv, tlvLen);
+  memcpy(nutrientConfigBuf, tlv, tlvLen);
+  nutrientConfigBuf[tlvLen] = (uint8_t)(crc & 0xFF);
+  nutrientConfigBuf[tlvLen + 1] = (uint8_t)(crc >> 8);
+  nutrientConfigGen++;
+  nutrientConfigBusy = true;
+  nutrientConfigKind = kind;
+  nutrientReplies[kind] = reply;
+
+  cmd.body = nutrientConfigBuf;
+  cmd.bodyLen = tlvLen + 2;
+  cmd.resp = S3_RESP_LINK;
+  cmd.respCode = ACK_OK;
+  cmd.timeoutMs = 500;
+  // STOP 명령은 안전 정지 클래스 + 최대 2회 재송신 (타임아웃/ACK_ERROR 모두)
+  cmd.retries = isStopCommand ? 2 : 0;
+  cmd.cb = onNutrientConfigAck;
+  cmd.ctx = (void *)(uintptr_t)(nutrientConfigGen | ((uint16_t)kind << 8));
+
+  Serial.print(F("📤 nutCycle 설정 전송 예약: TLV "));
+  Serial.print(tlvLen);
+  Serial.println(F("B"));
+
+  if (!serial3Submit(isStopCommand ? S3_CLASS_SAFETY : S3_CLASS_RELAY, cmd)) {
+    nutrientConfigBusy = false;
+    Serial.println(F("❌ nutCycle 설정 전달 실패 (큐 포화)"));
+    nutrientReply(reply, false, "nutCycle config dropped (queue full)");
+  } else if (isStopCommand) {
+    relayShadowSubmit(unoRelayShadow, UNO_RELAY_ALL);
   }
 }
 
-// 센서 온라인 마킹
-void markSensorOnline(uint8_t slaveId) {
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (modbusSensors[i].slaveId == slaveId) {
-      modbusSensors[i].isOnline = true;
-      modbusSensors[i].lastResponse = millis();
-      modbusSensors[i].consecutiveFailures = 0;
-      break;
-    }
+// 완료 후 대기 슬롯 제출 (사용자 설정 먼저, 큐 포화로 버려지면 다음 슬롯)
+static void nutrientSubmitPending()
+{
+  for (uint8_t k = 0; k < NUT_KIND_STOP && !nutrientConfigBusy; k++) {
+    NutrientPending &p = nutrientPending[k];
+    if (p.len == 0) continue;
+    uint8_t len = p.len;
+    p.len = 0;
+    nutrientConfigSubmit(k, p.tlv, len, p.reply);
   }
 }
 
-// 전체 센서 상태 체크
-void checkSensorHealth() {
-  unsigned long currentTime = millis();
-  
-  for (uint8_t i = 0; i < modbusSlaveCount; i++) {
-    if (!modbusSensors[i].active) continue;
-    
-    // 5분 이상 응답이 없으면 오프라인으로 마킹
-    if (currentTime - modbusSensors[i].lastResponse > 300000) {
-      if (modbusSensors[i].isOnline) {
-        modbusSensors[i].isOnline = false;
-        Serial.print(F("⚠️ 센서 "));
-        Serial.print(modbusSensors[i].slaveId);
-        Serial.print(F(" ("));
-        Serial.print(modbusSensors[i].name);
-        Serial.println(F(") 타임아웃 - 오프라인"));
-      }
+// UNO로 nutCycle 설정 전달 함수 (큐 적재 후 즉시 반환, 결과는 onNutrientConfigAck()에서 응답 발행)
+void sendNutrientConfigToUno(const char* jsonConfig) {
+  uint8_t tlv[NUT_TLV_MAX];
+  uint8_t kind;
+  CommandReply reply;
+  memset(&reply, 0, sizeof(reply));
+  uint8_t tlvLen = compileNutrientConfig(jsonConfig, tlv, kind, reply);
+  if (tlvLen == 0) {
+    nutrientReply(reply, false, "Invalid nutCycle config");
+    return;
+  }
+
+  if (kind == NUT_KIND_STOP) {
+    // 대기 중인 사용자 설정은 STOP이 대신함 (시각 동기는 유지)
+    NutrientPending &p = nutrientPending[NUT_KIND_CONFIG];
+    if (p.len) {
+      p.len = 0;
+      nutrientReply(p.reply, false, "nutCycle config cancelled by STOP");
+    }
+    if (nutrientConfigBusy && nutrientConfigKind == NUT_KIND_STOP) {
+      Serial.println(F("⚠️ STOP 명령 이미 전달 중 - 중복 무시"));
+      nutrientReply(reply, false, "nutCycle STOP already in progress");
+      return;
     }
+  } else if (nutrientConfigBusy) {
+    NutrientPending &p = nutrientPending[kind];
+    if (p.len) {
+      Serial.println(F("⚠️ 대기 중인 nutCycle 설정을 새 설정으로 교체"));
+      nutrientReply(p.reply, false, "nutCycle config superseded by newer config");
+    } else {
+      Serial.println(F("⏳ 이전 nutCycle 설정 전달 중 - 완료 후 전송"));
+    }
+    memcpy(p.tlv, tlv, tlvLen);
+    p.len = tlvLen;
+    p.reply = reply;
+    return;
   }
+
+  nutrientConfigSubmit(kind, tlv, tlvLen, reply);
 }
-*/
 
-// ============= I2C 센서 Modbus 통합 함수들 (UNO가 담당하므로 주석처리) =============
-/*
-// SHT20 온습도 센서 읽기 (Modbus)
-bool readSHT20Modbus(uint8_t slaveId, float* temp, float* humid) {
-  uint16_t data[2];
-  bool success = readModbusRegisters(slaveId, 0, 2, data);
-  
-  if (success) {
-    // 레지스터 값을 실제 값으로 변환
-    *temp = (float)data[0] / 100.0f;   // 온도 (×100으로 전송)
-    *humid = (float)data[1] / 100.0f;  // 습도 (×100으로 전송)
-    updateSensorStatus(slaveId, true);
-    return true;
+// ============= UNO 다중 릴레이 원자 적용 (CMD_MULTI_SET) =============
+
+// 완료 시 섀도에 반영할 마스크 + 응답 정보 (큐 깊이 + 실행 중 1건)
+struct UnoMaskOp {
+  uint16_t setMask;
+  uint16_t clearMask;
+  uint8_t seq;
+  bool used;
+  bool hasReply;   // MQTT 명령이면 완료 시 응답 발행
+  CommandReply reply;
+};
+static UnoMaskOp unoMaskOps[S3_DEPTH_RELAY + 1];
+
+// ctx: UnoMaskOp 슬롯
+static void onMultiRelayAck(bool ok, const uint8_t *resp, uint16_t len, void *ctx)
+{
+  UnoMaskOp *op = (UnoMaskOp *)ctx;
+  relayShadowDone(unoRelayShadow, ok, resp != nullptr && len == 0, op->setMask, op->clearMask, 0);
+  op->used = false;
+
+  Serial.print(ok ? F("✅ MULTI_SET seq=") : F("❌ MULTI_SET seq="));
+  Serial.print(op->seq);
+  const char *result;
+  if (ok) {
+    Serial.println();
+    result = "applied";
+  } else if (resp == nullptr) {
+    Serial.println(F(" (취소)"));
+    result = "cancelled";
+  } else if (len > 0) {
+    Serial.println(F(" (ACK_ERROR)"));
+    result = "rejected by UNO";
   } else {
-    updateSensorStatus(slaveId, false);
-    return false;
+    Serial.println(F(" (타임아웃)"));
+    result = "timeout";
   }
-}
 
-// SCD41 CO2 센서 읽기 (Modbus)
-bool readSCD41Modbus(uint8_t slaveId, float* co2_ppm) {
-  uint16_t data[1];
-  bool success = readModbusRegisters(slaveId, 0, 1, data);
-  
-  if (success) {
-    *co2_ppm = (float)data[0];  // CO2 ppm 값
-    updateSensorStatus(slaveId, true);
-    return true;
-  } else {
-    updateSensorStatus(slaveId, false);
-    return false;
+  if (op->hasReply) {
+    char text[56];
+    snprintf(text, sizeof(text), "MULTI_RELAY set=0x%X clr=0x%X %s", op->setMask, op->clearMask, result);
+    publishCommandResponse(op->reply, ok, text);
   }
 }
 
-// TSL2591 조도 센서 읽기 (Modbus)
-bool readTSL2591Modbus(uint8_t slaveId, float* lux, uint16_t* visible, uint16_t* infrared) {
-  uint16_t data[3];
-  bool success = readModbusRegisters(slaveId, 0, 3, data);
-  
-  if (success) {
-    *lux = (float)data[0] / 10.0f;  // lux (×10으로 전송)
-    *visible = data[1];              // 가시광
-    *infrared = data[2];            // 적외선
-    updateSensorStatus(slaveId, true);
-    return true;
-  } else {
-    updateSensorStatus(slaveId, false);
-    return false;
+// JSON 채널 배열 → 16비트 마스크 (UNO 범위 밖 채널은 무시)
+static uint16_t unoRelayMaskFromChannels(JsonArray &channels)
+{
+  uint16_t mask = 0;
+  for (int i = 0; i < channels.size(); i++) {
+    int channel = channels[i].as<int>();
+    if (channel >= 0 && channel < UNO_RELAY_CHANNELS) mask |= (uint16_t)1 << channel;
   }
+  return mask;
 }
 
-// BH1750 조도 센서 읽기 (Modbus)
-bool readBH1750Modbus(uint8_t slaveId, float* lux) {
-  uint16_t data[1];
-  bool success = readModbusRegisters(slaveId, 0, 1, data);
-  
-  if (success) {
-    *lux = (float)data[0] / 10.0f;  // lux (×10으로 전송)
-    updateSensorStatus(slaveId, true);
-    return true;
-  } else {
-    updateSensorStatus(slaveId, false);
+// 🔥 SET/CLEAR 마스크를 한 프레임으로 전송 - UNO가 포트 단위로 한 번에 적용
+// ========== 링크 프레임: CMD_MULTI_SET(0x34), 페이로드 = SET_H + SET_L + CLR_H + CLR_L ==========
+bool sendUnoRelayMask(uint16_t setMask, uint16_t clearMask, const CommandReply *reply)
+{
+  if ((setMask & clearMask) != 0 || (setMask | clearMask) == 0) {
+    Serial.println(F("❌ MULTI_SET 마스크 오류 (중복/빈 마스크)"));
     return false;
   }
-}
 
-// ADS1115 pH/EC 센서 읽기 (Modbus)
-bool readADS1115Modbus(uint8_t slaveId, float* ph_val, float* ec_val, float* water_temp) {
-  uint16_t data[3];
-  bool success = readModbusRegisters(slaveId, 0, 3, data);
-  
-  if (success) {
-    *ph_val = (float)data[0] / 100.0f;      // pH (×100으로 전송)
-    *ec_val = (float)data[1] / 100.0f;       // EC (×100으로 전송)
-    *water_temp = (float)data[2] / 100.0f;  // 수온 (×100으로 전송)
-    updateSensorStatus(slaveId, true);
+  // 이미 목표 상태인 채널은 빼고 전송 - 모두 같으면 송신 생략
+  uint16_t same = relayShadowSatisfied(unoRelayShadow, setMask, clearMask);
+  setMask &= ~same;
+  clearMask &= ~same;
+  if ((setMask | clearMask) == 0) {
+    unoRelayShadow.skipped++;
+    Serial.println(F("⏭ MULTI_SET 이미 목표 상태 - 송신 생략"));
+    if (reply) publishCommandResponse(*reply, true, "MULTI_RELAY already in target state");
     return true;
-  } else {
-    updateSensorStatus(slaveId, false);
-    return false;
   }
-}
 
-// DS18B20 온도 센서 읽기 (Modbus)
-bool readDS18B20Modbus(uint8_t slaveId, float* temperature) {
-  uint16_t data[1];
-  bool success = readModbusRegisters(slaveId, 0, 1, data);
-  
-  if (success) {
-    *temperature = (float)data[0] / 100.0f;  // 온도 (×100으로 전송)
-    updateSensorStatus(slaveId, true);
-    return true;
-  } else {
-    updateSensorStatus(slaveId, false);
+  UnoMaskOp *op = nullptr;
+  for (uint8_t i = 0; i < S3_DEPTH_RELAY + 1 && !op; i++) {
+    if (!unoMaskOps[i].used) op = &unoMaskOps[i];
+  }
+  if (!op) {
+    Serial.println(F("❌ MULTI_SET 완료 대기 슬롯 부족"));
     return false;
   }
+
+  const uint8_t masks[4] = {
+    (uint8_t)(setMask >> 8), (uint8_t)(setMask & 0xFF),
+    (uint8_t)(clearMask >> 8), (uint8_t)(clearMask & 0xFF)
+  };
+
+  Serial3Command cmd;
+  unoBuildCommand(cmd, CMD_MULTI_SET, masks, sizeof(masks), ACK_OK, S3_ACK_TIMEOUT_MS);
+  uint8_t seq = cmd.seq;
+  op->setMask = setMask;
+  op->clearMask = clearMask;
+  op->seq = seq;
+  op->hasReply = reply != nullptr;
+  if (reply) op->reply = *reply;
+  cmd.cb = onMultiRelayAck;
+  cmd.ctx = op;
+
+  Serial.print(F("📤 MULTI_SET seq="));
+  Serial.print(seq);
+  Serial.print(F(" set=0x"));
+  Serial.print(setMask, HEX);
+  Serial.print(F(" clr=0x"));
+  Serial.println(clearMask, HEX);
+
+  if (!serial3Submit(S3_CLASS_RELAY, cmd)) return false;
+  op->used = true;
+  relayShadowSubmit(unoRelayShadow, setMask | clearMask);
+  return true;
 }
-*/
 
 // 🔥 다중 릴레이 명령 처리 함수 (비트연산 방식)
-bool handleMultiRelayCommand(const String &action, JsonArray &channels, String &response)
+bool handleMultiRelayCommand(const String &action, JsonArray &channels, const CommandReply &reply, String &response)
 {
   String actionUpper = action;
   actionUpper.toUpperCase();
-  
-  // 비트마스크 생성 (0-9번 채널만 지원)
-  uint8_t bitmask = 0;
-  String channelList = "";
-  for (int i = 0; i < channels.size(); i++) {
-    uint8_t channel = channels[i].as<uint8_t>();
-    if (channel < 10) { // UNO는 10개 채널만 지원
-      bitmask |= (1 << channel);
-      if (channelList.length() > 0) channelList += ",";
-      channelList += String(channel);
-    }
-  }
-  
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-  
-  if (actionUpper == "ON")
+
+  bool on = (actionUpper == "ON");
+  if (!on && actionUpper != "OFF")
   {
-    // ========== 프로토콜: CMD_MULTI_ON(0x30) + BITMASK(1) + \n(0x0A) = 3바이트 ==========
-    Serial.print(F("📤 MULTI_ON ["));
-    Serial.print(channelList);
-    Serial.print(F("] bitmask=0x"));
-    Serial.println(bitmask, HEX);
-    
-    // 송신 시퀀스
-    RS485_CTRL_TX();
-    delayMicroseconds(RS485_TURNAROUND_US);
-    RS485_CONTROL_SERIAL.write((uint8_t)0x30); // CMD_MULTI_ON
-    RS485_CONTROL_SERIAL.write(bitmask);
-    RS485_CONTROL_SERIAL.write('\n');
-    RS485_CONTROL_SERIAL.flush();
-    
-    // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-    delayMicroseconds(RS485_TURNAROUND_US);
-    
-    // 수신 모드 전환
-    RS485_CTRL_RX();
-    
-    // ACK 수신 대기 (타임아웃: 50ms - 다중 릴레이 처리 시간 고려)
-    unsigned long startTime = millis();
-    bool ackReceived = false;
-    while (millis() - startTime < 50) {
-      if (RS485_CONTROL_SERIAL.available()) {
-        uint8_t ackCode = RS485_CONTROL_SERIAL.read();
-        if (ackCode == ACK_OK) {
-          ackReceived = true;
-          break;
-        } else if (ackCode == ACK_ERROR) {
-          break;
-        }
-      }
-      delay(1);
-    }
-    
-    if (ackReceived) {
-      Serial.print(F("✅ MULTI_ON ["));
-      Serial.print(channelList);
-      Serial.println(F("]"));
-      response = "MULTI_RELAY_ON_" + String(channels.size()) + "_BITS";
-      return true;
-    } else {
-      Serial.print(F("❌ MULTI_ON ["));
-      Serial.print(channelList);
-      Serial.println(F("] (타임아웃)"));
-      response = "MULTI_RELAY_ON_FAILED";
-      return false;
-    }
+    response = "Invalid multi-relay action: " + action;
+    return false;
   }
-  else if (actionUpper == "OFF")
-  {
-    // ========== 프로토콜: CMD_MULTI_OFF(0x31) + BITMASK(1) + \n(0x0A) = 3바이트 ==========
-    Serial.print(F("📤 MULTI_OFF ["));
-    Serial.print(channelList);
-    Serial.print(F("] bitmask=0x"));
-    Serial.println(bitmask, HEX);
-    
-    // 송신 시퀀스
-    RS485_CTRL_TX();
-    delayMicroseconds(RS485_TURNAROUND_US);
-    RS485_CONTROL_SERIAL.write((uint8_t)0x31); // CMD_MULTI_OFF
-    RS485_CONTROL_SERIAL.write(bitmask);
-    RS485_CONTROL_SERIAL.write('\n');
-    RS485_CONTROL_SERIAL.flush();
-    
-    // 마지막 바이트 선로 이탈 가드 (테스트 코드와 동일)
-    delayMicroseconds(RS485_TURNAROUND_US);
-    
-    // 수신 모드 전환
-    RS485_CTRL_RX();
-    
-    // ACK 수신 대기 (타임아웃: 50ms - 다중 릴레이 처리 시간 고려)
-    unsigned long startTime = millis();
-    bool ackReceived = false;
-    while (millis() - startTime < 50) {
-      if (RS485_CONTROL_SERIAL.available()) {
-        uint8_t ackCode = RS485_CONTROL_SERIAL.read();
-        if (ackCode == ACK_OK) {
-          ackReceived = true;
-          break;
-        } else if (ackCode == ACK_ERROR) {
-          break;
-        }
-      }
-      delay(1);
-    }
-    
-    if (ackReceived) {
-      Serial.print(F("✅ MULTI_OFF ["));
-      Serial.print(channelList);
-      Serial.println(F("]"));
-      response = "MULTI_RELAY_OFF_" + String(channels.size()) + "_BITS";
-      return true;
-    } else {
-      Serial.print(F("❌ MULTI_OFF ["));
-      Serial.print(channelList);
-      Serial.println(F("] (타임아웃)"));
-      response = "MULTI_RELAY_OFF_FAILED";
-      return false;
-    }
+
+  // 큐 적재 후 즉시 반환, 결과 응답은 onMultiRelayAck()
+  uint16_t mask = unoRelayMaskFromChannels(channels);
+  if (!sendUnoRelayMask(on ? mask : 0, on ? 0 : mask, &reply)) {
+    response = on ? "MULTI_RELAY_ON_FAILED" : "MULTI_RELAY_OFF_FAILED";
+    return false;
   }
-  else
-  {
-    response = "Invalid multi-relay action: " + action;
+  response = String(on ? "MULTI_RELAY_ON_" : "MULTI_RELAY_OFF_") + String(channels.size()) + "_BITS";
+  return true;
+}
+
+// 🔥 장면 전환: ON/OFF 채널을 한 프레임으로 (베드 + 펌프 + 밸브 동시 전환)
+bool handleRelaySceneCommand(JsonArray &onChannels, JsonArray &offChannels, const CommandReply &reply, String &response)
+{
+  uint16_t setMask = unoRelayMaskFromChannels(onChannels);
+  uint16_t clearMask = unoRelayMaskFromChannels(offChannels);
+  if (!sendUnoRelayMask(setMask, clearMask, &reply)) {
+    response = "MULTI_RELAY_SCENE_FAILED";
     return false;
   }
+  response = "MULTI_RELAY_SCENE_" + String(setMask, HEX) + "_" + String(clearMask, HEX);
+  return true;
 }
 
 // ============= NPN 비트연산 제어 함수들 =============
 
-// 🔥 NPN 다중 채널 제어 (비트연산 방식)
+// 🔥 NPN 다중 채널 제어: 배치 창에 합류 (연속 채널은 FC16 한 번, 결과는 로그)
+// 이미 목표 상태인 채널은 제외
 bool sendNPNMultiCommand(uint8_t cmd, uint16_t bitmask) {
-  // Modbus RTU 프레임 구성: [SlaveAddr][Function][StartAddr_H][StartAddr_L][Count_H][Count_L][CRC_L][CRC_H]
-  uint8_t frame[8];
-  frame[0] = NPN_SLAVE_ADDRESS;  // Slave Address
-  frame[1] = 0x10;               // Function Code (Write Multiple Coils)
-  frame[2] = 0x00;               // Start Address High
-  frame[3] = 0x00;               // Start Address Low
-  frame[4] = (bitmask >> 8) & 0xFF;  // Count High (상위 8비트)
-  frame[5] = bitmask & 0xFF;         // Count Low (하위 8비트)
-  
-  // CRC 계산
-  uint16_t crc = calculateCRC16(frame, 6);
-  frame[6] = crc & 0xFF;         // CRC Low
-  frame[7] = (crc >> 8) & 0xFF;  // CRC High
-  
-  // 버퍼 비움
-  while (RS485_CONTROL_SERIAL.available()) RS485_CONTROL_SERIAL.read();
-  
-  // RS485 전송
-  RS485_CTRL_TX();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  
-  for (int i = 0; i < 8; i++) {
-    RS485_CONTROL_SERIAL.write(frame[i]);
-  }
-  RS485_CONTROL_SERIAL.flush();
-  delayMicroseconds(RS485_TURNAROUND_US);
-  RS485_CTRL_RX();
-  delayMicroseconds(RS485_INTERCHAR_US);
-  
+  uint16_t mask = bitmask & NPN_RELAY_ALL;
+  if (mask == 0 || (cmd != NPN_CMD_MULTI_ON && cmd != NPN_CMD_MULTI_OFF)) return false;
+  bool on = (cmd == NPN_CMD_MULTI_ON);
+
   Serial.print(F("🔥 NPN 다중 제어: 0x"));
   Serial.print(cmd, HEX);
   Serial.print(F(", 비트마스크: 0x"));
-  Serial.println(bitmask, HEX);
-  
-  // Modbus RTU 응답 대기 (Write Multiple Coils는 8바이트 응답)
-  uint8_t response[8];
-  uint8_t responseLen = 0;
-  unsigned long startTime = millis();
-  uint16_t timeout = 300;
-  unsigned long endTime = startTime + timeout;
-
-  // millis() 오버플로우 안전한 타임아웃 체크
-  while ((long)(millis() - endTime) < 0)
-  {
-    while (RS485_CONTROL_SERIAL.available() && responseLen < sizeof(response))
-    {
-      response[responseLen++] = RS485_CONTROL_SERIAL.read();
-    }
-    
-    // Modbus RTU Write Multiple Coils 응답은 정확히 8바이트
-    if (responseLen >= 8)
-    {
-      // CRC 검증
-      uint16_t receivedCRC = (response[7] << 8) | response[6];
-      uint16_t calculatedCRC = calculateCRC16(response, 6);
-      
-      if (receivedCRC == calculatedCRC)
-      {
-        Serial.print(F("📥 NPN 다중 응답 수신: "));
-        for (int i = 0; i < responseLen; i++)
-        {
-          Serial.print(F("0x"));
-          if (response[i] < 0x10) Serial.print(F("0"));
-          Serial.print(response[i], HEX);
-          Serial.print(F(" "));
-        }
-        Serial.println(F("✅"));
-        return true;
-      }
-      else
-      {
-        Serial.print(F("❌ NPN 다중 CRC 오류: rx=0x"));
-        Serial.print(receivedCRC, HEX);
-        Serial.print(F(" calc=0x"));
-        Serial.println(calculatedCRC, HEX);
-        return false;
-      }
-    }
-    
-    // UNO 명령과 동일하게 delay(1) 사용 (CPU 독점 방지)
-    delay(1);
-  }
+  Serial.println(mask, HEX);
 
-  // 타임아웃
-  Serial.print(F("⏱ NPN 다중 응답 타임아웃 (수신: "));
-  Serial.print(responseLen);
-  Serial.println(F(" 바이트)"));
-  return false;
+  mask &= ~relayShadowSatisfied(npnRelayShadow, on ? mask : 0, on ? 0 : mask);
+  if (mask == 0) {
+    npnRelayShadow.skipped++;
+    Serial.println(F("⏭ NPN 채널 이미 목표 상태 - 송신 생략"));
+    return true;
+  }
+  return npnBatchAdd(on ? mask : 0, on ? 0 : mask, -1);
 }
 
 // 🔥 NPN 다중 채널 ON
@@ -25,13 +25,14 @@ inline void RS485_SENS_RX() { digitalWrite(RS485_SENSING_DE_RE_PIN, LOW); }
 // NPN 모듈 제어용 상수
 #define NPN_SLAVE_ADDRESS 0x01
 #define TOTAL_NPN_CHANNELS 12
-#define MAX_MODBUS_SLAVES 10
+#define MAX_MODBUS_SLAVES 32  // Combined ID 최대 256개 중 등록 가능 수 (SRAM: 레코드 13B + 레지스터 풀 평균 8B/센서)
 
 // 🔥 NPN 비트연산 명령 상수
 #define NPN_CMD_MULTI_ON 0x10   // 다중 NPN ON
 #define NPN_CMD_MULTI_OFF 0x11  // 다중 NPN OFF
 
-// ============= 바이트 기반 명령 정의 (UNO와 동일) =============
+// ============= 제어용 UNO 링크 프레임 TYPE (UNO와 동일, 프레임 형식은 UnoLink.h) =============
+// 요청 페이로드: 채널/비트마스크 명령은 1바이트, MULTI_SET은 SET/CLR 마스크 4바이트, nutCycle은 TLV, 나머지는 없음
 #define CMD_RESET 0x20          // 서버 호환성 (모든 핀 OFF)
 #define CMD_ALLOFF 0x21         // 서버 호환성 (모든 핀 OFF)
 #define CMD_TOGGLE 0x22         // 단일 핀 토글
@@ -41,16 +42,30 @@ inline void RS485_SENS_RX() { digitalWrite(RS485_SENSING_DE_RE_PIN, LOW); }
 #define CMD_EC_PULSE 0x26       // EC 펄스 토글 (2개 핀 동시 제어)
 #define CMD_EC_OFF 0x28         // EC OFF (2개 핀 동시 제어)
 #define CMD_BED_ON 0x29         // 베드 ON (4개 핀 동시 제어) - NPN 충돌 방지
+#define CMD_MULTI_ON 0x30       // 다중 릴레이 ON (8비트 마스크)
+#define CMD_MULTI_OFF 0x31      // 다중 릴레이 OFF (8비트 마스크)
+#define CMD_MULTI_SET 0x34      // 다중 릴레이 원자 적용 (SET 마스크 16비트 + CLEAR 마스크 16비트, big-endian)
+#define CMD_NUTCYCLE_BIN 0x35   // nutCycle 설정 전달 (TLV)
+#define UNO_RELAY_CHANNELS 10   // Command_UNO 릴레이 채널 수
 
-// 응답 코드 정의 (UNO와 동일)
+// 응답 TYPE 정의 (UNO와 동일, SEQ는 요청 순번 에코)
 #define ACK_OK 0x80
 #define ACK_ERROR 0x81
-#define ACK_SENSOR_DATA 0x82
-#define ACK_STATUS_DATA 0x83 // 상태 데이터 응답
+#define ACK_SENSOR_DATA 0x82 // 페이로드 7바이트: pH×100, EC/10, 수온×10 (각 big-endian 16비트) + 예약
+#define ACK_STATUS_BIN 0x84  // 상태 데이터 응답 (아래 배치)
 #define CMD_STATUS_REQUEST 0x33 // nutCycle 상태 요청
 
-// CRC16 테이블
-extern const uint16_t PROGMEM crc_table[256];
+// ============= UNO 상태 응답 (ACK_STATUS_BIN, Command_UNO와 동일) =============
+// 실행기 콜백의 resp 기준 (resp[0] = TYPE, resp[1..] = 페이로드). 무결성은 링크 프레임 CRC가 보장
+// [0] 0x84 [1] 버전 [2] cycle(int8) [3] status [4] flags [5] 시 [6] 분 [7..8] 릴레이 비트맵
+// [9] rm [10] rs [11] rh [12] rm_wait [13] rs_wait [14..15] pH×100 [16..17] EC(μS/cm)
+// [18..19] 수온×10(int16) [20..21] 예약
+// 다중 바이트 값은 big-endian
+#define UNO_STATUS_PAYLOAD_LEN 21
+#define UNO_STATUS_FRAME_VER 1
+#define UNO_STATUS_F_TIME     0x01  // 시간 수신됨
+#define UNO_STATUS_F_IN_RANGE 0x02  // 스케줄 시간대 안
+#define UNO_STATUS_F_STARTED  0x04  // 오늘 사이클 시작됨
 
 // ============= 센서 타입 정의 =============
 enum modbusSensorType { 
@@ -109,54 +124,206 @@ enum modbusSensorType {
 #define DS18B20_START         76
 #define DS18B20_END           80
 
+// ============= 응답 시간 추정 (TCP RTO 방식, RFC 6298 정수 구현) =============
+// srtt8 = SRTT×8, rttvar4 = RTTVAR×4 (ms 단위 고정소수점), srtt8 == 0이면 샘플 없음
+// RTO = SRTT + 4×RTTVAR, 연속 타임아웃마다 2배 (최대 8배)
+struct RttEstimator {
+  uint16_t srtt8;
+  uint16_t rttvar4;
+};
+#define MODBUS_RTO_INIT_MS      300  // 샘플이 없을 때 (기존 고정 타임아웃)
+#define MODBUS_RTO_MIN_MS       30   // UNO 응답 생성(센서값 조회) + 왕복 프레임 시간 + 여유
+#define MODBUS_RTO_MAX_MS       1000
+#define MODBUS_TIMEOUT_AUTO     0    // 타임아웃 인자로 주면 슬레이브별 학습 RTO 사용
+#define MODBUS_OFFLINE_FAILURES 3    // 연속 타임아웃 시 오프라인 판정
+
+void rttSample(RttEstimator &e, uint16_t rttMs);
+uint16_t rttTimeoutMs(const RttEstimator &e, uint8_t backoff);
+inline uint16_t rttSrttMs(const RttEstimator &e) { return e.srtt8 >> 3; }
+inline uint16_t rttVarMs(const RttEstimator &e) { return e.rttvar4 >> 2; }
+
+// 힙을 쓰지 않는 고정 레코드 (센서당 13바이트)
+// - 이름은 저장하지 않고 타입 디스크립터(PROGMEM)에서 출력
+// - 레지스터는 타입별 개수만큼 modbusRegPool에서 할당 (modbusReg()/modbusSetRegs() 사용)
+//   레지스터 0부터의 캐시 역할도 겸함 (regsValid + regStampMs로 신선도 판단)
+// - 시각은 modbusNowTick() 기준 16비트 상대값 (1틱 = 1.024초, 약 18.6시간 주기로 랩)
 struct ModbusSlave {
-  uint16_t slaveId;
-  modbusSensorType type;
-  bool active;
-  uint16_t registers[10];
-  unsigned long lastRead;
-  String name;
-  
-  // 센서 상태 모니터링
-  bool isOnline;           // 센서 온라인 상태
-  unsigned long lastResponse; // 마지막 응답 시간
-  uint8_t consecutiveFailures; // 연속 실패 횟수
-  unsigned long lastHealthCheck; // 마지막 헬스체크 시간
+  uint8_t slaveId;                 // Combined ID
+  uint8_t type;                    // modbusSensorType
+  uint8_t regOffset;               // modbusRegPool 시작 인덱스
+  uint8_t regCount;                // 할당된 레지스터 수
+  uint8_t active : 1;
+  uint8_t isOnline : 1;            // 센서 온라인 상태
+  uint8_t regsValid : 1;           // 레지스터 캐시 유효 (타임아웃/만료 시 해제)
+  uint8_t consecutiveFailures : 5; // 연속 타임아웃 횟수 (RTO 백오프 지수, 31에서 포화)
+  uint16_t lastSeenTick;           // 마지막 응답 시각 (modbusNowTick)
+  uint16_t regStampMs;             // 레지스터 갱신 시각 (millis 하위 16비트)
+  RttEstimator rtt;                // 이 슬레이브의 응답 시간 추정
 };
 
-struct SoilData {
-  float humidity;
-  float temperature;
-  float EC;
-  float pH;
-  uint16_t nitrogen;
-  uint16_t phosphorus;
-  uint16_t potassium;
-  bool isValid;
-};
+// 레지스터 풀: 평균 4개/센서 기준 (SOIL 8, RAIN 10, 그 외 2~3)
+#define MODBUS_REG_POOL_SIZE (MAX_MODBUS_SLAVES * 4)
 
 extern ModbusSlave modbusSensors[];
 extern uint8_t modbusSlaveCount;
+extern uint16_t modbusRegistryDropped;  // 등록 공간 부족으로 버린 신규 센서 수
+
+// Combined ID 직접 인덱스 레지스트리 (O(1) 조회)
+int findModbusSensor(uint8_t combinedId);  // 미등록이면 -1
+void clearModbusRegistry();
+void printModbusRegistryUsage();           // 센서당 바이트 수 등 SRAM 사용량 출력
+
+// 레코드 접근 (레지스터 풀 / 타입 디스크립터 / 16비트 시각)
+uint16_t modbusReg(uint8_t idx, uint8_t k);  // 할당 범위 밖이면 0
+void modbusSetRegs(uint8_t idx, const uint16_t *regs, uint8_t n);  // 할당 수만큼만 저장
+uint8_t modbusTypeRegCount(uint8_t type);
+const __FlashStringHelper *modbusTypeName(uint8_t type);
+void printModbusSensorName(uint8_t idx);     // 예: SHT20_T21_U1
+inline uint16_t modbusNowTick() { return (uint16_t)(millis() >> 10); }
+inline uint16_t modbusSensorAgeTicks(uint8_t idx) { return (uint16_t)(modbusNowTick() - modbusSensors[idx].lastSeenTick); }
+
+// ============= 레지스터 캐시 (Serial1 버스 왕복 절감) =============
+// 푸시 프레임/폴링 응답이 레지스터 풀에 기록되면 TTL 동안은 버스 대신 메모리에서 응답
+// 같은 슬레이브/시작 주소의 FC 0x03 요청이 큐에 있으면 새 트랜잭션 없이 응답을 공유 (coalescing)
+#define UNO_PUSH_MAX_SILENCE_MS 10000 // Sensor_UNO 예외 보고 최대 무전송 (SENSOR_TYPE_PROFILES maxSilenceS 최댓값과 일치)
+#define MODBUS_CACHE_TTL_MS   (UNO_PUSH_MAX_SILENCE_MS + 2000) // 기본 TTL: 최대 무전송 + 여유
+#define MODBUS_CACHE_TTL_MAX  30000 // 16비트 시각 랩(65초) 전에 반드시 만료
+#define MODBUS_COALESCE_MAX   4     // 진행 중 요청에 합류 가능한 대기자 수
+
+struct ModbusCacheStats {
+  uint32_t hits;       // 캐시로 응답 (버스 미사용)
+  uint32_t misses;     // 만료/미등록으로 버스 요청
+  uint32_t coalesced;  // 큐에 있던 동일 요청에 합류
+};
+extern ModbusCacheStats modbusCacheStats;
+extern uint16_t modbusCacheTtlMs;  // 런타임 조정 가능 (MODBUS_CACHE_TTL_MAX 이하)
+
+bool modbusRegsFresh(uint8_t idx, uint16_t maxAgeMs);
+void modbusInvalidateRegs(uint8_t idx);
+void printModbusCacheStats();
+
+// ============= 센서 업링크 페이로드 (sensors/modbus/<DEVICE_ID>) =============
+// 헤더 8B: [0x01][0x03][millis 4B BE][레코드 수][스키마 버전]
+// 스키마 v2 레코드: [타입][Combined ID][CH][값 개수 n] + n × uint16 BE
+// - 타입은 백엔드 타입 코드 (MODBUS_TYPE_DESCS의 uplinkType), 센서당 1레코드
+// - 페이로드 버퍼 없이 beginPublish()로 레코드 단위 스트리밍 (PubSubClient 버퍼 크기와 무관)
+// 스키마 v3 델타: 헤더 + [키프레임 millis 4B BE][키프레임 레코드 수] + 바뀐 레코드만
+//   레코드: [키프레임 내 순번][값 마스크] + 마스크 비트마다 zig-zag varint(현재값 - 키프레임값, 16비트 랩)
+// - 기준은 마지막으로 전송에 성공한 키프레임 (델타끼리는 독립 - 델타 유실이 누적되지 않음)
+// - 키프레임은 SENSOR_UPLINK_KEYFRAME_EVERY회마다, 레지스트리가 바뀌었거나 델타가 더 클 때
+// 배치: 한 메시지에 프레임(v2/v3)을 이어 붙임 - 각 프레임은 자체 헤더로 길이를 알 수 있음
+// - SENSOR_SAMPLE_INTERVAL_MS마다 델타 프레임을 링에 적재, 전송 주기마다 링 전체 + 꼬리 프레임 전송
+// - 꼬리 키프레임 앞의 델타는 이전 키프레임 기준 (백엔드는 앞에서부터 순서대로 적용)
+#define SENSOR_UPLINK_SCHEMA         2
+#define SENSOR_UPLINK_SCHEMA_DELTA   3
+#define SENSOR_UPLINK_HEADER_BYTES   8
+#define SENSOR_UPLINK_RECORD_HEADER  4
+#define SENSOR_UPLINK_MAX_VALUES     4   // 토양센서 (습도, 온도, EC, pH)
+#define SENSOR_UPLINK_MAX_RECORDS    (MAX_MODBUS_SLAVES + 1)  // + 제어용 UNO ADS1115
+#define SENSOR_UPLINK_KEYFRAME_EVERY 10  // 6초 주기 기준 1분마다 키프레임 (0이면 델타 미사용)
+#define SENSOR_SAMPLE_INTERVAL_MS    1000
+#define SENSOR_SAMPLE_RING_BYTES     384  // 길이 바이트 포함, 가득 차면 오래된 샘플부터 스필/버림
+#define SENSOR_SAMPLE_FRAME_MAX      160  // 샘플 프레임 최대 (오프라인 키프레임 샘플 포함, 길이 1바이트)
+// 저장 후 전송: 링에서 밀려나는 샘플을 SENSOR_SPILL_INTERVAL_MS 간격으로 EEPROM에 보관,
+// 재연결 후 replaySensorBacklog()가 조금씩 재전송 (끝에 레코드 0개 v2 헤더 = 현재 millis 앵커)
+#define SENSOR_SPILL_EEPROM_BASE     0
+#define SENSOR_SPILL_EEPROM_BYTES    4096  // Mega2560 EEPROM 전체 (다른 용도 없음)
+#define SENSOR_SPILL_INTERVAL_MS     60000UL
+#define SENSOR_REPLAY_INTERVAL_MS    2000
+#define SENSOR_REPLAY_MAX_BYTES      256
+
+struct SensorUplinkStats {
+  uint32_t publishes;    // 전송 성공
+  uint32_t failures;     // 전송 실패
+  uint32_t keyframes;
+  uint32_t deltas;
+  uint32_t rawBytes;     // 매번 키프레임이었다면 보냈을 바이트
+  uint32_t sentBytes;    // 실제 보낸 바이트
+  uint32_t samples;      // 링에 적재한 샘플
+  uint32_t dropped;      // 링/EEPROM이 가득 차 버린 샘플
+  uint32_t spilled;      // EEPROM에 보관한 샘플
+  uint32_t replayed;     // 재연결 후 재전송한 샘플
+  uint16_t lastBytes;    // 최근 페이로드 크기
+  uint16_t maxBytes;     // 최대 페이로드 크기
+  uint16_t lastFrames;   // 최근 메시지의 프레임 수
+};
+extern SensorUplinkStats sensorUplinkStats;
+
+struct UnoSensorData;
+// 현재 값을 델타 프레임으로 샘플 링에 적재 (SENSOR_SAMPLE_INTERVAL_MS마다, 오프라인이면 키프레임도)
+void sampleSensorPayload(const UnoSensorData *uno);
+void pollSensorSpill();      // 매 루프 (EEPROM 1바이트씩)
+void replaySensorBacklog();  // MQTT 연결 중 매 루프 (자체 스로틀)
+// 샘플 링 + 꼬리 프레임(키프레임 v2 또는 델타 v3)을 한 메시지로 전송 (uno != nullptr면 제어용 UNO pH/EC/수온 레코드 추가)
+bool publishSensorPayload(const UnoSensorData *uno);
+void printSensorUplinkStats();
 
 // ============= RS485 통신 함수들 (Serial1 센싱용: 센서 전용 UNO와 통신) =============
 void handleModbusInitialization();
-void scanModbusSensors();
-bool readModbusRegisters(uint8_t slaveAddr, uint16_t startAddr, uint16_t count, uint16_t* data);
-bool sendModbusRequest(uint8_t slaveAddr, uint8_t functionCode, 
-                       uint16_t startReg, uint16_t regCount, 
-                       uint8_t *response, uint8_t &responseLen, 
-                       uint16_t timeout = 500);
+
+// ============= Non-blocking Modbus RTU 마스터 엔진 (Serial1) =============
+// 요청을 큐에 쌓고 loop()의 modbusMasterPoll()이 진행, 완료 시 콜백 호출
+#define MODBUS_MASTER_QUEUE_SIZE 8
+#define MODBUS_MASTER_RX_MAX     64
+#define MODBUS_T35_US            1750  // 19200bps 초과 시 Modbus 규격 고정 t3.5
+
+// ============= Serial1 TDMA 슬롯 스케줄 =============
+// Mega가 매 사이클 시작에 동기 비콘(브로드캐스트)을 보내고, 각 Sensor_UNO는 gUnoId 슬롯에서만 푸시
+//   슬롯 0: 비콘 + 마스터 트랜잭션 / 슬롯 1~6: UNO ID 1~6 푸시 / 슬롯 7: 마스터 트랜잭션
+// 마스터 요청은 응답 대기까지 마스터 슬롯 안에서 끝나도록 시작 시점과 타임아웃을 제한
+// 푸시를 본 적 없는 UNO 슬롯, 최대 무전송 시간을 넘겨 푸시가 없는 UNO 슬롯은 마스터가 빌려 씀 (부팅 직후 탐색 속도 유지)
+// 비콘: [0x00][0x44][slotMsHi][slotMsLo][slotCount][seq][crcLo][crcHi]
+// Sensor_UNO.ino의 TDMA_* 정의와 일치해야 함 (슬롯 폭/개수는 비콘으로 전달되므로 FC만 고정)
+#define TDMA_ENABLED        1
+#define TDMA_SYNC_FC        0x44
+#define TDMA_SLOT_MS        150   // 지터(UNO loop 10ms + 비콘 검출) + 25B 프레임(4.3ms) 여유
+#define TDMA_SLOT_COUNT     8     // 사이클 1200ms (기존 3000ms 자유 주기 대비 단축)
+#define TDMA_CYCLE_MS       ((uint16_t)TDMA_SLOT_MS * TDMA_SLOT_COUNT)
+#define TDMA_GUARD_MS       10    // 마스터 슬롯 끝 보호 구간 (t3.5 + 송수신 전환)
+// 예외 보고로 조용한 정상 UNO의 슬롯은 빌리지 않도록 최대 무전송 시간 + 1사이클 (10초 → 10사이클)
+#define TDMA_SLOT_IDLE_CYCLES ((UNO_PUSH_MAX_SILENCE_MS + TDMA_CYCLE_MS - 1) / TDMA_CYCLE_MS + 1)
+
+struct TdmaStats {
+  uint32_t beacons;        // 송신한 비콘 수
+  uint32_t offSlotFrames;  // 자기 슬롯 밖에서 도착한 푸시 프레임 (미동기 UNO/충돌 위험)
+  uint32_t deferred;       // 마스터 슬롯이 아니어서 미뤄진 요청 시작 횟수
+};
+extern TdmaStats tdmaStats;
+
+enum ModbusResult {
+  MB_RESULT_OK,
+  MB_RESULT_TIMEOUT,     // 응답 없음
+  MB_RESULT_CRC_ERROR,   // CRC 불일치
+  MB_RESULT_EXCEPTION,   // 예외 응답 (FC | 0x80)
+  MB_RESULT_BAD_FRAME    // 길이/주소/FC 불일치
+};
+
+// frame/len은 콜백 안에서만 유효 (엔진 수신 버퍼)
+typedef void (*ModbusDoneCallback)(ModbusResult result, const uint8_t *frame, uint8_t len, void *ctx);
+
+void initModbusMaster();
+void modbusMasterPoll();   // loop()에서 매회 호출
+bool modbusMasterBusy();   // 송신/응답 대기 중이면 true
+uint16_t modbusMasterLastRttMs();  // 직전 트랜잭션 응답 시간 (콜백 안에서 유효)
+uint16_t modbusRtoForSlave(uint8_t slaveAddr);  // 학습된 타임아웃 (미등록 주소는 버스 전체 추정값)
+extern RttEstimator modbusBusRtt;
+// FC 0x03은 큐의 동일 요청(같은 주소/시작 레지스터)에 합류할 수 있음 (콜백 frame의 레지스터 수가 요청보다 많을 수 있음)
+bool modbusMasterSubmit(uint8_t slaveAddr, uint8_t functionCode,
+                        uint16_t startReg, uint16_t regCount,
+                        uint16_t timeoutMs, ModbusDoneCallback cb, void *ctx);
+
+// 링크 텔레메트리: 슬레이브별 RTT/RTO/온라인 + 프레이머/캐시 통계 (modbus/heartbeat/<DEVICE_ID>)
+bool publishModbusLinkTelemetry();
 
 // 디버그 폴링 (SHT20)
 void debugPollSHT20FromUno(uint8_t slaveAddr);
 
-// 하트비트 (Report Slave ID, FC=0x11)
+// 하트비트 (Report Slave ID, FC=0x11) - 큐 적재 성공 여부 반환, 결과는 로그로 출력
 bool unoHeartbeat(uint8_t slaveAddr);
 
 // ============= 제어용 UNO(Serial3) 존재 감지 및 활성화 토글 =============
-extern bool unoControlPresent;             // 제어용 UNO 존재 여부
-void pollUnoControlHandshake();            // IDLE 시 Serial3에서 헬로 토큰 감지
-#define UNO_CONTROL_HELLO "UNO_CTRL_HELLO" // UNO_RELAY가 주기적으로 전송하는 토큰
+extern bool unoControlPresent;             // 제어용 UNO 존재 여부 (ULINK_HELLO 또는 정상 응답 프레임 수신 시)
+void pollUnoControlHandshake();            // IDLE 시 Serial3 링크 프레임 수신 (헬로/늦은 응답 처리)
 
 // 센서 전용 UNO(SHT20) 주소 범위 (Serial1/Modbus RTU)
 #ifndef UNO_SHT20_START
@@ -169,8 +336,11 @@ void pollUnoControlHandshake();            // IDLE 시 Serial3에서 헬로 토
 // 순환 폴링 (하나씩 차례로 폴링)
 void debugPollSHT20Cycle(uint8_t startAddr, uint8_t endAddr);
 
-// 전체 주소 범위 스캔 (UNO 래핑 포함)
+// UNO 래핑 센서 백그라운드 탐색 - 비동기, 진행은 modbusMasterPoll() 콜백 + pollUnoDiscovery()
+// 푸시로 이미 등록된 주소는 건너뛰고 적응형 짧은 타임아웃 사용, 완료 시 소요 시간 출력
 void scanAllUnoSensors();
+void pollUnoDiscovery();   // loop()에서 매회 호출 (큐 포화 시 재적재)
+bool isUnoScanRunning();
 
 // 센서용 UNO(Serial1) 핸드셰이크 (동적 장착 지원)
 #define UNO_SENSING_HELLO "UNO_SENS_HELLO"
@@ -189,35 +359,46 @@ void refreshUnoWrappedSensors();
 void pollUnoPushFrames();
 void resetUnoBucketsIfExpired();
 
+// 푸시 프레임 헌팅 프레이머 (주소/FC/길이 검사 후 CRC 실패 시 1바이트씩 재동기)
+#define MODBUS_PUSH_MAX_REGS  10                                // 가장 긴 푸시 (강우센서 10 레지스터, 풀 할당 최대치)
+#define MODBUS_PUSH_BUF_SIZE  (MODBUS_PUSH_MAX_REGS * 2 + 5 + 7)  // 최대 프레임 25B + 여유
+
+struct ModbusPushFramerStats {
+  uint32_t framesOk;       // CRC 통과 프레임
+  uint32_t crcFail;        // 그럴듯한 헤더였지만 CRC 실패
+  uint32_t overflow;       // 버퍼 초과로 버린 바이트
+  uint32_t timeoutFlush;   // 프레임 중간 무음으로 미완성 폐기
+  uint32_t resyncShifts;   // 재동기를 위해 1바이트 민 횟수
+};
+extern ModbusPushFramerStats pushFramerStats;
+void printPushFramerStats();  // TDMA 통계 포함
+
 // ============= 디지털 핀 펄스 기반 UNO ID 할당 =============
 void assignUnoIdsByPulses();  // 초기화 시 UNO ID 할당
 
 // ============= Modbus CRC 계산 =============
 uint16_t calcCRC16(const uint8_t *buf, uint8_t len);
-/*
-// ============= Modbus 센서 읽기 함수들 =============
-bool readSoilSensor(uint8_t slaveAddr, SoilData* soilData);
-bool readWindDirection(uint8_t slaveAddr, uint16_t* gearValue, uint16_t* degreeValue);
-bool readWindSpeed(uint8_t slaveAddr, uint16_t* rawSpeed);
-bool readRainSnowSensor(uint8_t slaveAddr, uint16_t* rainFlag, uint16_t* snowFlag, 
-                        float* temperature, uint16_t* humidity, uint16_t* moistureLevel);
-uint8_t getPrecipitationStatus(uint16_t rainFlag, uint16_t snowFlag);
-*/
 
 // ============= RS485 제어 함수들 (Serial3 제어용-UNO and NPN)=============
-bool sendNPNModbusCommand(uint8_t *command, uint8_t length, uint16_t timeout = 300);
+// 모두 큐 적재 여부만 반환 (결과는 로그). 채널 ON/OFF는 배치 창에 모여 한 트랜잭션으로 전송
+bool sendNPNModbusCommand(uint8_t *command, uint8_t length, uint16_t timeout = MODBUS_TIMEOUT_AUTO);
 bool controlSingleNPNRelay(uint8_t channel, uint16_t command);
-bool allNPNChannelsOff();
+bool allNPNChannelsOff();   // 안전 정지 클래스, 모으는 중인 배치 취소
 bool npnChannelOn(uint8_t channel);
 bool npnChannelOff(uint8_t channel);
-uint16_t calculateCRC16(uint8_t *data, uint8_t length);
+
+// ============= NPN 채널 쓰기 배치 =============
+// 창 안의 채널 변경을 모아 연속 레지스터 구간마다 FC16(Write Multiple Registers) 한 번 - 12채널 전환도 1 트랜잭션
+#define NPN_BATCH_WINDOW_MS 20   // 첫 변경부터 모으는 시간 (이전 배치 완료 전이면 더 모음)
+#define NPN_BATCH_SLOTS     2    // 모으는 중 1 + 전송 중 1
+#define NPN_BATCH_MAX_RUNS  6    // 12채널이 번갈아 미확인일 때 최대 구간 수
+void npnBatchPoll();   // loop()에서 매회 호출 - 창이 지난 배치를 실행기 큐에 적재
 
 // ============= UNO 제어 함수들 추가 =============
 void unoStart();
 void unoStop();
 
 // ============= UNO 센서 데이터 함수들 =============
-bool requestUnoSensorData();
 bool isUnoSensorDataValid();
 bool parseUnoSensorData(const String& data);
 
@@ -231,7 +412,6 @@ enum UnoRequestState {
 
 extern UnoRequestState unoRequestState;
 extern unsigned long unoRequestStartTime;
-extern String unoResponseBuffer;
 
 void initUnoSensorRequest();
 bool updateUnoSensorRequest(); // Non-blocking 업데이트
@@ -240,46 +420,91 @@ void startUnoSensorRequest();  // 센서 요청 시작
 // ============= Non-blocking 상태 요청 시스템 =============
 extern UnoRequestState unoStatusRequestState;
 extern unsigned long unoStatusRequestStartTime;
-extern String unoStatusResponseBuffer;
 
 void initUnoStatusRequest();
 bool updateUnoStatusRequest(); // Non-blocking 업데이트
 void startUnoStatusRequest();  // 상태 요청 시작
 bool sendStatusToMQTT(); // UNO 상태 기반으로 서버에 전송
 
-// ============= Serial3 통신 관리 시스템 =============
-enum Serial3Owner {
-    SERIAL3_IDLE,       // 사용 중이 아님
-    SERIAL3_UNO_CONTROL, // UNO 제어 (최우선)
-    SERIAL3_NPN,        // NPN 모듈 제어 (중간 우선순위)
-    SERIAL3_UNO_SENSOR  // UNO 센서 (최저 우선순위)
+// ============= Serial3 제어 버스 명령 큐 (우선순위 + 단일 실행기) =============
+// Serial3 송수신은 serial3ExecutorPoll()만 수행. 모든 UNO/NPN 명령은 클래스별 큐에 제출
+// - 높은 클래스부터 한 건씩: 송신 → 응답/타임아웃 → 콜백 → 다음 건
+// - 안전 정지 제출 시 같은 대상(UNO/NPN)의 대기 중인 일반 제어 명령은 폐기 (정지 후 재점등 방지)
+// - 클래스별 깊이 고정, 가득 차면 새 명령을 버리고 통계에 기록
+enum Serial3Class : uint8_t {
+  S3_CLASS_SAFETY,   // UNO STOP/ALLOFF, NPN ALL_OFF, nutCycle STOP
+  S3_CLASS_RELAY,    // UNO 릴레이/펄스/다중 릴레이, nutCycle 설정
+  S3_CLASS_NPN,      // NPN 채널 제어 (배치 구간)
+  S3_CLASS_POLL,     // UNO 센서/상태 요청
+  S3_CLASS_COUNT
+};
+
+enum Serial3RespKind : uint8_t {
+  S3_RESP_NONE,      // 응답 없음 (송신 완료 = 성공)
+  S3_RESP_MODBUS8,   // NPN Modbus 에코 8바이트 (CRC 검증), 5바이트 예외 응답은 즉시 실패
+  S3_RESP_LINK       // UNO 링크 프레임 (UnoLink.h): SEQ 일치 + TYPE == respCode면 성공, ACK_ERROR 등은 실패
+};
+
+#define S3_FRAME_MAX        12    // UNO 링크 프레임 헤더 5 + 짧은 페이로드 + CRC 2 / NPN Modbus 8 또는 FC16 헤더 7
+#define S3_DEPTH_SAFETY     2
+#define S3_DEPTH_RELAY      8
+#define S3_DEPTH_NPN        NPN_BATCH_MAX_RUNS  // 한 배치의 구간 전부
+#define S3_DEPTH_POLL       2
+#define S3_BUS_GAP_MS       2     // 트랜잭션 간 최소 간격 (슬레이브 수신 전환 여유)
+#define S3_RETRY_GAP_MS     100   // 재송신 전 대기
+#define S3_TX_GUARD_MS      50    // TXC ISR 누락 대비 상한 - 최장 프레임 ≈ 8ms @57600
+#define S3_ACK_TIMEOUT_MS   50    // UNO 단순 명령 ACK (ACK 프레임 7바이트 ≈ 1.2ms + 처리)
+#define S3_SENSOR_TIMEOUT_MS 1000
+#define S3_STATUS_TIMEOUT_MS 500   // 28바이트 상태 프레임 (UNO 센서 측정 중 지연 포함)
+
+// 결과 콜백. resp/len은 콜백 안에서만 유효 (실행기 수신 버퍼)
+// - LINK: resp[0] = 응답 TYPE, resp[1..] = 페이로드 (ACK_ERROR 실패 시 resp[0] = ACK_ERROR, len = 1)
+// - MODBUS8: 수신한 바이트 그대로. 타임아웃은 len = 0, 안전 정지 폐기는 resp = nullptr
+// - 콜백 안에서 serial3Submit()으로 후속 명령 제출 가능
+typedef void (*Serial3DoneCallback)(bool ok, const uint8_t *resp, uint16_t len, void *ctx);
+
+struct Serial3Command {
+  uint8_t frame[S3_FRAME_MAX];  // 링크 프레임 전체 또는 헤더 (본문이 있으면 본문 끝에 CRC)
+  uint8_t frameLen;
+  uint8_t resp;                 // Serial3RespKind
+  uint8_t respCode;             // LINK 성공 응답 TYPE (ACK_OK, ACK_SENSOR_DATA, ACK_STATUS_BIN)
+  uint8_t retries : 4;          // 실패 시 재송신 횟수
+  uint8_t npn : 1;              // 대상이 NPN 모듈 (RTT 추정, 안전 정지 범위)
+  uint8_t seq;                  // LINK 요청 순번. 다른 순번의 응답은 늦은 응답으로 버림
+  uint16_t timeoutMs;           // 송신 완료 후 응답 완료까지 (NPN은 MODBUS_TIMEOUT_AUTO 허용)
+  const uint8_t *body;          // 헤더 뒤 가변 본문 (완료 때까지 호출부가 유지)
+  uint16_t bodyLen;
+  Serial3DoneCallback cb;
+  void *ctx;
 };
 
-// 우선순위 정의 (낮은 숫자가 높은 우선순위)
-#define PRIORITY_UNO_CONTROL 1
-#define PRIORITY_NPN         2
-#define PRIORITY_UNO_SENSOR  3
-
-extern Serial3Owner serial3Owner;
-extern unsigned long serial3LastUsed;
-extern unsigned long serial3CooldownTime;
-
-bool requestSerial3Access(Serial3Owner requester);
-void releaseSerial3Access();
-bool isSerial3Available();
-bool isSerial3AvailableFor(Serial3Owner requester); // 특정 요청자용 사용 가능 여부
-int getPriority(Serial3Owner owner); // 우선순위 조회
-void initSerial3Manager();
+struct Serial3Stats {
+  uint16_t submitted[S3_CLASS_COUNT];
+  uint16_t dropped[S3_CLASS_COUNT];   // 큐 포화로 버려진 명령
+  uint8_t peakDepth[S3_CLASS_COUNT];
+  uint16_t purged;                    // 안전 정지로 폐기된 대기 명령
+  uint16_t timeouts;
+  uint16_t retries;
+  uint16_t staleAcks;                 // 순번 불일치/대기 없음으로 버린 UNO 응답 (이전 명령의 늦은 응답)
+};
+extern Serial3Stats serial3Stats;
+
+void initSerial3Executor();
+void serial3ExecutorPoll();   // loop()에서 매회 호출
+bool serial3ExecutorBusy();   // 실행 중이거나 대기 명령이 있으면 true
+// false면 큐 포화로 버려짐 (콜백 호출 없음)
+bool serial3Submit(Serial3Class cls, const Serial3Command &cmd);
+void printSerial3QueueStats();
 void unoReset();
 void unoAllOff();
 void unoChannelOn(uint8_t channel);
 void unoChannelOff(uint8_t channel);
 
 
-// UNO 즉시 제어 함수들 (콜백 방식)
-bool waitForUnoAck(unsigned long timeoutMs = 1000);
-void unoChannelOnImmediate(uint8_t channel);
-void unoChannelOffImmediate(uint8_t channel);
+// UNO 즉시 제어 함수들 (Serial3 명령 큐 경유)
+// commandId: 완료 시 서버 응답에 실을 MQTT command_id (없으면 생성)
+void unoChannelOnImmediate(uint8_t channel, const char* commandId = nullptr);
+void unoChannelOffImmediate(uint8_t channel, const char* commandId = nullptr);
 void togglePulseImmediate(int pinIndex);
 void togglePulseFast(int pinIndex);
 void toggleECPulseFast(); // EC 펄스 전용 (2개 릴레이 동시 제어)
@@ -292,40 +517,101 @@ void allOffUnoImmediate();
 // ============= UNO ACK 서버 전달 함수 =============
 void sendUnoAckToServer(const char* command, uint8_t channel, bool success, const char* commandId = nullptr);
 
+// ============= 비동기 제어 명령 응답 =============
+// MQTT 콜백은 제어 명령을 Serial3 큐에 올리고 즉시 반환, 결과 응답은 실행기 콜백(loop)에서 전송
+#define COMMAND_ID_MAX     32
+#define CONTROL_ACK_SLOTS  10   // 완료 대기 중인 UNO/NPN 명령 컨텍스트 (command_id 보관)
+
+// modbus/command-responses 응답에 되돌려 줄 요청 필드
+struct CommandReply {
+  char commandId[COMMAND_ID_MAX + 1];
+  uint8_t slaveId;
+  uint8_t functionCode;
+  uint16_t address;
+  uint16_t value;
+  char npnCommand[8];   // npn_command 형식 요청이면 명령 이름 (응답에 npn_command/channel/device_type 포함)
+  uint8_t npnChannel;
+};
+void publishCommandResponse(const CommandReply& reply, bool success, const char* response);
+
+// ============= 릴레이 섀도 상태 (UNO 10채널 / NPN 12채널) =============
+// Mega가 보관하는 릴레이 상태 사본 - 상태 조회와 중복 명령 필터를 버스 송신 없이 처리
+// - ACK로 확인된 명령만 반영. 실패는 그대로, 타임아웃/에코 오류는 해당 채널을 미확인으로
+// - UNO는 STATUS 응답(30초마다)의 릴레이 비트맵으로 전체 교정 (nutCycle 자동 제어 반영)
+// - 필터: 확인 상태이고 완료 대기 명령이 없는 채널만, 마지막 확인 후 RELAY_SHADOW_TRUST_MS 이내,
+//   UNO는 nutCycle이 릴레이를 직접 바꾸지 않을 때만 (ALLOFF/RESET/ALL_OFF/토글은 필터하지 않음)
+#define RELAY_SHADOW_TRUST_MS 35000UL   // UNO 상태 요청 주기(30초) + 여유
+
+struct RelayShadow {
+  uint16_t state;          // ON 비트 (채널 0 = bit0)
+  uint16_t known;          // state를 믿을 수 있는 채널 (부팅 직후 0)
+  uint16_t pending;        // 완료 대기 중인 명령이 바꿀 채널 (모두 완료되면 0)
+  uint8_t inflight;        // 완료 대기 중인 명령 수
+  bool autonomous;         // UNO nutCycle 동작 중 - UNO가 스스로 릴레이를 바꿈
+  unsigned long confirmedMs;  // 마지막 ACK/상태 보고 시각
+  uint16_t skipped;        // 이미 같은 상태라 송신하지 않은 명령
+  uint16_t mismatches;     // 상태 보고로 교정된 채널 수
+};
+extern RelayShadow unoRelayShadow;
+extern RelayShadow npnRelayShadow;
+
+// 버스 송신 없이 건너뛸 수 있는 채널 (SET 중 이미 ON, CLEAR 중 이미 OFF)
+uint16_t relayShadowSatisfied(const RelayShadow& sh, uint16_t setMask, uint16_t clearMask);
+// 채널 상태 조회 - 미확인이면 false
+bool relayShadowGet(const RelayShadow& sh, uint8_t channel, bool* on);
+// 대시보드 조회 응답 (kind = RELAY_STATE): 미확인 채널은 -1
+bool publishRelayShadow(const CommandReply& reply);
+
 // ============= UNO nutCycle 설정 전달 함수 =============
+// MQTT JSON을 Mega에서 검증해 TLV 바이너리 프레임으로 변환 (Command_UNO nutCycle.h와 동일)
+// 링크 프레임 TYPE = CMD_NUTCYCLE_BIN(0x35), 페이로드 = TLV 나열 (최대 NUT_TLV_MAX)
+// TLV: TAG(1) + LEN(1) + VALUE. 실수는 IEEE754 float32 little-endian, 연도는 big-endian
+#define NUT_TLV_MAX    96
+#define NUT_TAG_CMD    0x01  // u8: NUT_CMD_START / NUT_CMD_STOP
+#define NUT_TAG_TIME   0x02  // 7바이트: 연(2) 월 일 시 분 초
+#define NUT_TAG_PH     0x10  // f32 목표 pH          ("set.ph")
+#define NUT_TAG_EC     0x11  // f32 목표 EC          ("set.ec")
+#define NUT_TAG_EP     0x12  // f32 pH 허용 오차(%)  ("set.ep")
+#define NUT_TAG_EE     0x13  // f32 EC 허용 오차(%)  ("set.ee")
+#define NUT_TAG_ST     0x14  // f32 관수시간(분)     ("set.st")
+#define NUT_TAG_CT     0x15  // f32 주기시간(시간)   ("set.ct")
+#define NUT_TAG_BED_A  0x16  // u8                   ("set.a" ~ "set.d")
+#define NUT_TAG_BED_B  0x17
+#define NUT_TAG_BED_C  0x18
+#define NUT_TAG_BED_D  0x19
+#define NUT_TAG_TE     0x20  // u8 시간대 스케줄     ("sch.te")
+#define NUT_TAG_DE     0x21  // u8 매일 스케줄       ("sch.de")
+#define NUT_TAG_OE     0x22  // u8 1회 실행          ("sch.oe")
+#define NUT_TAG_SH     0x23  // u8 시작 시           ("sch.sh")
+#define NUT_TAG_SM     0x24  // u8 시작 분           ("sch.sm")
+#define NUT_TAG_EH     0x25  // u8 종료 시           ("sch.eh")
+#define NUT_TAG_EM     0x26  // u8 종료 분           ("sch.em")
+#define NUT_CMD_START  1
+#define NUT_CMD_STOP   2
+
+// 큐 적재 후 즉시 반환 (결과는 modbus/command-responses로 발행). STOP은 항상 우선
+// 전달 중이면 종류별(설정 / TIME_SYNC) 대기 슬롯에 보관 - 최신 설정이 이전 대기 설정을 대체
+// 형식/범위 오류인 설정은 UNO로 보내지 않고 거부
 void sendNutrientConfigToUno(const char* jsonConfig);
 
 // ============= NPN 비트연산 제어 함수들 =============
+// 다중 제어는 배치 합류 여부 반환 (결과는 로그)
 bool sendNPNMultiCommand(uint8_t cmd, uint16_t bitmask);
 bool npnMultiChannelOn(uint16_t channelMask);
 bool npnMultiChannelOff(uint16_t channelMask);
 
-// ============= 센서 상태 모니터링 함수들 (UNO가 담당하므로 주석처리) =============
-/*
-void checkSensorHealth();
-void updateSensorStatus(uint8_t slaveId, bool success);
-bool isSensorOnline(uint8_t slaveId);
-void performHealthCheck();
-void resetSensorFailureCount(uint8_t slaveId);
-void markSensorOffline(uint8_t slaveId);
-void markSensorOnline(uint8_t slaveId);
-*/
-
-// ============= I2C 센서 Modbus 통합 함수들 (UNO가 담당하므로 주석처리) =============
-/*
-bool readSHT20Modbus(uint8_t slaveId, float* temp, float* humid);
-bool readSCD41Modbus(uint8_t slaveId, float* co2_ppm);
-bool readTSL2591Modbus(uint8_t slaveId, float* lux, uint16_t* visible, uint16_t* infrared);
-bool readBH1750Modbus(uint8_t slaveId, float* lux);
-bool readADS1115Modbus(uint8_t slaveId, float* ph_val, float* ec_val, float* water_temp);
-bool readDS18B20Modbus(uint8_t slaveId, float* temperature);
-*/
-
 // ============= 통합 제어 함수들 =============
-bool handleNPNCommand(const String& command, uint8_t channel, String& response);
-bool handleUNOCommand(const String& command, int channel, String& response);
-bool handleKindCommand(const String& kind, const String& command, uint8_t channel, String& response);
-bool handleMultiRelayCommand(const String& action, JsonArray& channels, String& response);
+// NPN: true면 명령 접수 - 결과 응답은 완료 시 publishCommandResponse()로 전송 (호출부는 응답하지 않음)
+//      false면 즉시 실패 (response에 사유, 호출부가 응답)
+bool handleNPNCommand(const String& command, uint8_t channel, const CommandReply& reply, String& response);
+bool handleUNOCommand(const String& command, int channel, const CommandReply& reply, String& response);
+bool handleKindCommand(const String& kind, const String& command, uint8_t channel,
+                       const CommandReply& reply, String& response);
+// 다중 릴레이/장면: 반환값과 응답 규칙은 NPN과 동일 (true면 완료 시 onMultiRelayAck()에서 응답)
+bool handleMultiRelayCommand(const String& action, JsonArray& channels, const CommandReply& reply, String& response);
+bool handleRelaySceneCommand(JsonArray& onChannels, JsonArray& offChannels, const CommandReply& reply, String& response);
+// 한 프레임으로 SET/CLEAR 동시 적용. reply가 있으면 결과를 publishCommandResponse()로 전송
+bool sendUnoRelayMask(uint16_t setMask, uint16_t clearMask, const CommandReply* reply = nullptr);
 
 void updateUnoIdAssignmentManager();
 